@@ -0,0 +1,530 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of CpuWaveformRasterizer
+ */
+#include "../scopehal/scopehal.h"
+#include "CpuWaveformRasterizer.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+	@brief Converts a float to uint the way the GPU does, saturating instead of invoking undefined behavior
+ */
+static uint32_t FloatToUint(float f)
+{
+	if(!(f > 0))
+		return 0;
+	if(f >= 4294967296.0f)
+		return UINT32_MAX;
+	return static_cast<uint32_t>(f);
+}
+
+/**
+	@brief Coordinates of one block of samples
+
+	For variants which use the next sample's coordinates, m_x and m_y hold one more point than there are samples, so
+	the right end of sample i is point i+1. Otherwise the right end is (m_rightX[i], m_y[i]).
+ */
+struct RasterBlock
+{
+	float m_x[CpuWaveformRasterizer::ROWS_PER_BLOCK + 1];
+	float m_y[CpuWaveformRasterizer::ROWS_PER_BLOCK + 1];
+	float m_rightX[CpuWaveformRasterizer::ROWS_PER_BLOCK];
+	float m_value[CpuWaveformRasterizer::ROWS_PER_BLOCK];
+};
+
+/**
+	@brief Computes X and Y positions of points [base, base+count) of a waveform
+
+	Same arithmetic as FetchX() and the coordinate calculations in the shader.
+ */
+static void ComputePoints(
+	const ConfigPushConstants& c,
+	const CpuRasterizerInputs& in,
+	uint32_t base,
+	uint32_t count,
+	float* xs,
+	float* ys)
+{
+	for(uint32_t k=0; k<count; k++)
+	{
+		uint32_t i = base + k;
+
+		int64_t x = in.m_offsets ? in.m_offsets[i] : static_cast<int64_t>(i);
+		xs[k] = static_cast<float>(x + c.innerXoff) * c.xscale + c.xoff;
+
+		if(in.m_path == CpuRasterizerInputs::PATH_DIGITAL)
+			ys[k] = static_cast<float>(static_cast<int>(in.m_digitalSamples[i])) * c.yscale + c.ybase;
+		else
+			ys[k] = (in.m_analogSamples[i] + c.yoff) * c.yscale + c.ybase;
+	}
+}
+
+#ifdef __x86_64__
+
+/**
+	@brief AVX2 version of ComputePoints() for uniform analog waveforms
+
+	int64 to float conversion needs AVX-512DQ, so X positions go through double instead. That's exact (and rounds
+	once, to the same float) as long as the sample index fits in a double's mantissa, which the caller checks.
+ */
+__attribute__((target("avx2")))
+static void ComputeDenseAnalogPointsAVX2(
+	const ConfigPushConstants& c,
+	const float* samples,
+	uint32_t base,
+	uint32_t count,
+	float* xs,
+	float* ys)
+{
+	double start = static_cast<double>(static_cast<int64_t>(base) + c.innerXoff);
+	__m256d vstart = _mm256_set1_pd(start);
+	__m256d vstep = _mm256_set_pd(3, 2, 1, 0);
+	__m256 xscale = _mm256_set1_ps(c.xscale);
+	__m256 xoff = _mm256_set1_ps(c.xoff);
+	__m256 yoff = _mm256_set1_ps(c.yoff);
+	__m256 yscale = _mm256_set1_ps(c.yscale);
+	__m256 ybase = _mm256_set1_ps(c.ybase);
+
+	uint32_t end = count - (count % 8);
+	for(uint32_t k=0; k<end; k+=8)
+	{
+		__m256d lo = _mm256_add_pd(_mm256_add_pd(vstart, _mm256_set1_pd(k)), vstep);
+		__m256d hi = _mm256_add_pd(lo, _mm256_set1_pd(4));
+		__m256 x = _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+		x = _mm256_add_ps(_mm256_mul_ps(x, xscale), xoff);
+		_mm256_storeu_ps(xs + k, x);
+
+		__m256 y = _mm256_loadu_ps(samples + base + k);
+		y = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(y, yoff), yscale), ybase);
+		_mm256_storeu_ps(ys + k, y);
+	}
+
+	for(uint32_t k=end; k<count; k++)
+	{
+		xs[k] = static_cast<float>(static_cast<int64_t>(base + k) + c.innerXoff) * c.xscale + c.xoff;
+		ys[k] = (samples[base + k] + c.yoff) * c.yscale + c.ybase;
+	}
+}
+
+/**
+	@brief AVX-512 version of ComputeDenseAnalogPointsAVX2()
+ */
+__attribute__((target("avx512f")))
+static void ComputeDenseAnalogPointsAVX512F(
+	const ConfigPushConstants& c,
+	const float* samples,
+	uint32_t base,
+	uint32_t count,
+	float* xs,
+	float* ys)
+{
+	double start = static_cast<double>(static_cast<int64_t>(base) + c.innerXoff);
+	__m512d vstart = _mm512_set1_pd(start);
+	__m512d vstep = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+	__m512 xscale = _mm512_set1_ps(c.xscale);
+	__m512 xoff = _mm512_set1_ps(c.xoff);
+	__m512 yoff = _mm512_set1_ps(c.yoff);
+	__m512 yscale = _mm512_set1_ps(c.yscale);
+	__m512 ybase = _mm512_set1_ps(c.ybase);
+
+	uint32_t end = count - (count % 16);
+	for(uint32_t k=0; k<end; k+=16)
+	{
+		__m512d lo = _mm512_add_pd(_mm512_add_pd(vstart, _mm512_set1_pd(k)), vstep);
+		__m512d hi = _mm512_add_pd(lo, _mm512_set1_pd(8));
+		__m512d x2 = _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo)));
+		x2 = _mm512_insertf64x4(x2, _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1);
+		__m512 x = _mm512_castpd_ps(x2);
+		x = _mm512_add_ps(_mm512_mul_ps(x, xscale), xoff);
+		_mm512_storeu_ps(xs + k, x);
+
+		__m512 y = _mm512_loadu_ps(samples + base + k);
+		y = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(y, yoff), yscale), ybase);
+		_mm512_storeu_ps(ys + k, y);
+	}
+
+	for(uint32_t k=end; k<count; k++)
+	{
+		xs[k] = static_cast<float>(static_cast<int64_t>(base + k) + c.innerXoff) * c.xscale + c.xoff;
+		ys[k] = (samples[base + k] + c.yoff) * c.yscale + c.ybase;
+	}
+}
+
+#endif /* __x86_64__ */
+
+/**
+	@brief Converts a tile's accumulated spans to intensities and writes them to the output
+
+	@param c			Shader configuration
+	@param histogram	True to clamp intensities to 1 (atomicMax instead of atomicAdd in the shader)
+	@param x0			First column of the tile
+	@param ntile		Number of columns in the tile
+	@param diff			Span start/end counts for each row of the tile
+	@param out			Output buffer
+ */
+static void WriteTile(
+	const ConfigPushConstants& c,
+	bool histogram,
+	uint32_t x0,
+	uint32_t ntile,
+	const int32_t* diff,
+	float* out)
+{
+	const uint32_t tw = CpuWaveformRasterizer::TILE_WIDTH;
+	int32_t acc[tw] = {0};
+	for(uint32_t y=0; y<c.windowHeight; y++)
+	{
+		auto row = out + static_cast<size_t>(c.windowWidth) * y + x0;
+		for(uint32_t t=0; t<ntile; t++)
+		{
+			acc[t] += diff[y*tw + t];
+
+			uint32_t count = acc[t];
+			if(histogram)
+				count = min(count, 1u);
+
+			float fout = count * c.alpha;
+			if(c.persistScale != 0)
+				fout += row[t] * c.persistScale;
+			row[t] = fout;
+		}
+	}
+}
+
+#ifdef __x86_64__
+
+/**
+	@brief AVX2 version of WriteTile() for full tiles
+ */
+__attribute__((target("avx2")))
+static void WriteTileAVX2(const ConfigPushConstants& c, bool histogram, uint32_t x0, const int32_t* diff, float* out)
+{
+	const uint32_t tw = CpuWaveformRasterizer::TILE_WIDTH;
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi32(1);
+	__m256 alpha = _mm256_set1_ps(c.alpha);
+	__m256 persist = _mm256_set1_ps(c.persistScale);
+
+	for(uint32_t y=0; y<c.windowHeight; y++)
+	{
+		auto row = out + static_cast<size_t>(c.windowWidth) * y + x0;
+
+		acc0 = _mm256_add_epi32(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diff + y*tw)));
+		acc1 = _mm256_add_epi32(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diff + y*tw + 8)));
+
+		__m256i count0 = acc0;
+		__m256i count1 = acc1;
+		if(histogram)
+		{
+			count0 = _mm256_min_epu32(count0, one);
+			count1 = _mm256_min_epu32(count1, one);
+		}
+
+		__m256 out0 = _mm256_mul_ps(_mm256_cvtepi32_ps(count0), alpha);
+		__m256 out1 = _mm256_mul_ps(_mm256_cvtepi32_ps(count1), alpha);
+		if(c.persistScale != 0)
+		{
+			out0 = _mm256_add_ps(out0, _mm256_mul_ps(_mm256_loadu_ps(row), persist));
+			out1 = _mm256_add_ps(out1, _mm256_mul_ps(_mm256_loadu_ps(row + 8), persist));
+		}
+		_mm256_storeu_ps(row, out0);
+		_mm256_storeu_ps(row + 8, out1);
+	}
+}
+
+/**
+	@brief AVX-512 version of WriteTile() for full tiles
+ */
+__attribute__((target("avx512f")))
+static void WriteTileAVX512F(const ConfigPushConstants& c, bool histogram, uint32_t x0, const int32_t* diff, float* out)
+{
+	const uint32_t tw = CpuWaveformRasterizer::TILE_WIDTH;
+	__m512i acc = _mm512_setzero_si512();
+	__m512i one = _mm512_set1_epi32(1);
+	__m512 alpha = _mm512_set1_ps(c.alpha);
+	__m512 persist = _mm512_set1_ps(c.persistScale);
+
+	for(uint32_t y=0; y<c.windowHeight; y++)
+	{
+		auto row = out + static_cast<size_t>(c.windowWidth) * y + x0;
+
+		acc = _mm512_add_epi32(acc, _mm512_loadu_si512(diff + y*tw));
+
+		__m512i count = acc;
+		if(histogram)
+			count = _mm512_min_epu32(count, one);
+
+		__m512 fout = _mm512_mul_ps(_mm512_cvtepi32_ps(count), alpha);
+		if(c.persistScale != 0)
+			fout = _mm512_add_ps(fout, _mm512_mul_ps(_mm512_loadu_ps(row), persist));
+		_mm512_storeu_ps(row, fout);
+	}
+}
+
+#endif /* __x86_64__ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rasterization
+
+/**
+	@brief Rasterizes one tile of columns
+
+	@param c		Shader configuration
+	@param in		Input buffers
+	@param x0		First column of the tile
+	@param ntile	Number of columns in the tile
+	@param diff		Scratch buffer of (windowHeight + 1) * TILE_WIDTH entries
+	@param block	Scratch buffer for sample coordinates
+	@param out		Output buffer
+ */
+static void RasterizeTile(
+	const ConfigPushConstants& c,
+	const CpuRasterizerInputs& in,
+	uint32_t x0,
+	uint32_t ntile,
+	int32_t* diff,
+	RasterBlock& block,
+	float* out)
+{
+	const uint32_t tw = CpuWaveformRasterizer::TILE_WIDTH;
+	const uint32_t blockSize = CpuWaveformRasterizer::ROWS_PER_BLOCK;
+
+	bool analog = (in.m_path == CpuRasterizerInputs::PATH_ANALOG);
+	bool digital = (in.m_path == CpuRasterizerInputs::PATH_DIGITAL);
+	bool histogram = (in.m_path == CpuRasterizerInputs::PATH_HISTOGRAM);
+
+	//Histograms use the next point to size the bar even though they don't interpolate
+	bool useNext = !in.m_zeroHold || histogram;
+	bool interpolate = analog && !in.m_zeroHold;
+	bool dense = (in.m_offsets == nullptr);
+
+	uint32_t limit = c.memDepth - (useNext ? 1 : 0);
+	float height = c.windowHeight;
+	float histogramBase = c.yoff*c.yscale + c.ybase;
+
+	//Fast paths for uniform analog waveforms, if the sample indexes are small enough to go through a double exactly
+	bool simdPoints = false;
+	#ifdef __x86_64__
+		simdPoints =
+			(g_hasAvx2 || g_hasAvx512F) &&
+			dense &&
+			!digital &&
+			(llabs(c.innerXoff) < (1LL << 52));
+	#endif
+
+	memset(diff, 0, (c.windowHeight + 1) * tw * sizeof(int32_t));
+
+	for(uint32_t t=0; t<ntile; t++)
+	{
+		uint32_t x = x0 + t;
+		float left = x;
+		float right = x + 1;
+
+		//Find the first sample, and check if there's nothing to draw at all
+		uint32_t istart;
+		bool done = false;
+		if(dense)
+		{
+			istart = FloatToUint(floor(left / c.xscale)) + c.offset_samples;
+			uint32_t iend = FloatToUint(floor(right / c.xscale)) + c.offset_samples;
+			if(iend == 0)
+				done = true;
+		}
+		else
+		{
+			istart = in.m_indexes[x];
+			if( (x + 1 < c.windowWidth) && (in.m_indexes[x + 1] == 0) )
+				done = true;
+		}
+
+		//Process samples a block at a time, stopping after the block that reaches the end of the pixel
+		for(uint32_t base = istart; ; base += blockSize)
+		{
+			uint32_t count = 0;
+			if(base < limit)
+				count = min(blockSize, limit - base);
+			if(count < blockSize)
+				done = true;
+
+			//Fetch coordinates for the whole block at once
+			uint32_t npoints = count + (useNext ? 1 : 0);
+			if(count == 0)
+				npoints = 0;
+			#ifdef __x86_64__
+				if(simdPoints && g_hasAvx512F)
+					ComputeDenseAnalogPointsAVX512F(c, in.m_analogSamples, base, npoints, block.m_x, block.m_y);
+				else if(simdPoints)
+					ComputeDenseAnalogPointsAVX2(c, in.m_analogSamples, base, npoints, block.m_x, block.m_y);
+				else
+			#endif
+				ComputePoints(c, in, base, npoints, block.m_x, block.m_y);
+
+			if(histogram)
+			{
+				for(uint32_t j=0; j<count; j++)
+					block.m_value[j] = in.m_analogSamples[base + j];
+			}
+			if(!useNext)
+			{
+				for(uint32_t j=0; j<count; j++)
+				{
+					float duration = in.m_durations ? static_cast<float>(in.m_durations[base + j]) : 1;
+					block.m_rightX[j] = block.m_x[j] + duration * c.xscale;
+				}
+			}
+
+			for(uint32_t j=0; j<count; j++)
+			{
+				float lx = block.m_x[j];
+				float ly = block.m_y[j];
+				float rx = useNext ? block.m_x[j+1] : block.m_rightX[j];
+				float ry = useNext ? block.m_y[j+1] : ly;
+
+				//Check if we're at the end of the pixel
+				if(rx > right)
+					done = true;
+
+				//Skip offscreen samples
+				if( (rx < left) || (lx > right) )
+					continue;
+
+				//To start, assume we're drawing the entire segment
+				float starty = ly;
+				float endy = ry;
+
+				//Interpolate analog signals if either end is outside our column
+				//(most samples are entirely within the column when zoomed out, so skip the divide for those)
+				if(interpolate && ( (lx < left) || (rx > right) ) )
+				{
+					float slope = (ry - ly) / (rx - lx);
+					if(lx < left)
+						starty = ly + (left - lx) * slope;
+					if(rx > right)
+						endy = ly + (right - lx) * slope;
+				}
+
+				//Digital signals draw a vertical line only at the right edge
+				if(digital)
+				{
+					if(!(fabs(rx - left) <= 1))
+						endy = ly;
+				}
+
+				if(histogram)
+				{
+					starty = histogramBase;
+					endy = ly;
+				}
+
+				//If start and end are both off screen, nothing to draw
+				if( ( (starty < 0) && (endy < 0) ) || ( (starty >= height) && (endy >= height) ) )
+					continue;
+
+				//Don't draw zero-height histogram bars
+				if(histogram && (block.m_value[j] <= 0) )
+					continue;
+
+				//Clip to window size in case anything is partially offscreen.
+				//Argument order makes NaNs clip to the bounds, like fmin/fmax, but without a libm call per sample
+				starty = max(0.0f, min(height - 1, starty));
+				endy = max(0.0f, min(height - 1, endy));
+				int blockmin = static_cast<int>(min(starty, endy));
+				int blockmax = static_cast<int>(max(starty, endy));
+
+				diff[blockmin*tw + t] ++;
+				diff[(blockmax + 1)*tw + t] --;
+			}
+
+			if(done)
+				break;
+		}
+	}
+
+	#ifdef __x86_64__
+		if( (ntile == tw) && g_hasAvx512F)
+		{
+			WriteTileAVX512F(c, histogram, x0, diff, out);
+			return;
+		}
+		if( (ntile == tw) && g_hasAvx2)
+		{
+			WriteTileAVX2(c, histogram, x0, diff, out);
+			return;
+		}
+	#endif
+	WriteTile(c, histogram, x0, ntile, diff, out);
+}
+
+/**
+	@brief Rasterizes a waveform
+
+	@param config	Shader configuration, exactly as it would be passed to waveform-compute.glsl
+	@param in		Input buffers, which must be valid on the CPU
+	@param out		Output buffer of windowWidth * windowHeight intensities (read too, if persistence is enabled)
+ */
+void CpuWaveformRasterizer::Rasterize(const ConfigPushConstants& config, const CpuRasterizerInputs& in, float* out)
+{
+	//Same early-outs as the shader
+	bool useNext = !in.m_zeroHold || (in.m_path == CpuRasterizerInputs::PATH_HISTOGRAM);
+	if(config.windowHeight > MAX_HEIGHT)
+		return;
+	if(config.memDepth < (useNext ? 2 : 1))
+		return;
+
+	const uint32_t tw = TILE_WIDTH;
+	size_t ntiles = (config.windowWidth + tw - 1) / tw;
+
+	#pragma omp parallel
+	{
+		vector<int32_t> diff( (config.windowHeight + 1) * TILE_WIDTH);
+		RasterBlock block;
+
+		#pragma omp for schedule(dynamic)
+		for(size_t i=0; i<ntiles; i++)
+		{
+			uint32_t x0 = i * tw;
+			uint32_t ntile = min(tw, config.windowWidth - x0);
+			RasterizeTile(config, in, x0, ntile, diff.data(), block, out);
+		}
+	}
+}
@@ -0,0 +1,133 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of CpuWaveformRasterizer
+ */
+#ifndef CpuWaveformRasterizer_h
+#define CpuWaveformRasterizer_h
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+	@brief Push constants for waveform-compute.glsl (layout must match the constants block in the shader)
+ */
+struct ConfigPushConstants
+{
+	int64_t innerXoff;
+	uint32_t windowHeight;
+	uint32_t windowWidth;
+	uint32_t memDepth;
+	uint32_t offset_samples;
+	float alpha;
+	float xoff;
+	float xscale;
+	float ybase;
+	float yscale;
+	float yoff;
+	float persistScale;
+};
+
+/**
+	@brief Buffers for a CpuWaveformRasterizer run, equivalent to the storage buffers bound to waveform-compute.glsl
+ */
+class CpuRasterizerInputs
+{
+public:
+	CpuRasterizerInputs()
+	: m_path(PATH_ANALOG)
+	, m_zeroHold(false)
+	, m_analogSamples(nullptr)
+	, m_digitalSamples(nullptr)
+	, m_offsets(nullptr)
+	, m_indexes(nullptr)
+	, m_durations(nullptr)
+	{}
+
+	///@brief Which shader variant to emulate
+	enum
+	{
+		PATH_ANALOG,		//waveform-compute.analog
+		PATH_DIGITAL,		//waveform-compute.digital
+		PATH_HISTOGRAM		//waveform-compute.histogram
+	} m_path;
+
+	///@brief Draw each sample as a flat line instead of interpolating to the next one (the .zerohold variants)
+	bool m_zeroHold;
+
+	///@brief Sample values for PATH_ANALOG and PATH_HISTOGRAM (binding 1)
+	const float* m_analogSamples;
+
+	///@brief Sample values for PATH_DIGITAL (binding 1)
+	const bool* m_digitalSamples;
+
+	///@brief Sample offsets, or null for uniform waveforms (the .dense variants) (binding 2)
+	const int64_t* m_offsets;
+
+	///@brief Index of the first sample in each pixel column, for sparse waveforms (binding 3)
+	const uint32_t* m_indexes;
+
+	///@brief Sample durations for sparse zero-hold waveforms, or null if every sample is one unit long (binding 4)
+	const int64_t* m_durations;
+};
+
+/**
+	@brief Software implementation of waveform-compute.glsl
+
+	Produces the same fp32 intensity buffer as the shader, for use when the Vulkan device is a software implementation
+	(or the user asks for it): a native CPU kernel is much faster than running the shader under an emulated GPU.
+
+	Columns are processed in tiles of TILE_WIDTH pixels, in parallel. Within a column, samples are consumed in blocks
+	of the shader's workgroup height, and the column stops after the first block that reaches the right edge of the
+	pixel, exactly like the shader does. Each drawn span is recorded as +1 at its top row and -1 below its bottom row,
+	so the cost per sample is constant regardless of how tall the span is, and the intensity of each row is the
+	running sum down the column.
+
+	Computing sample coordinates and writing the output are vectorized with AVX2 or AVX-512 if available.
+ */
+class CpuWaveformRasterizer
+{
+public:
+	static void Rasterize(const ConfigPushConstants& config, const CpuRasterizerInputs& in, float* out);
+
+	///@brief Maximum height of a waveform, in pixels (MAX_HEIGHT in the shader)
+	static const uint32_t MAX_HEIGHT = 2048;
+
+	///@brief Number of samples per column handled at once (ROWS_PER_BLOCK in the shader)
+	static const uint32_t ROWS_PER_BLOCK = 128;
+
+	///@brief Number of adjacent columns rasterized by one thread at a time
+	static const uint32_t TILE_WIDTH = 16;
+};
+
+#endif
@@ -266,7 +266,7 @@ void CreateFilterBrowser::DrawIconButton(
 		tl.x += extraSpace / 2;
 		br.x -= extraSpace / 2;
 
-		list->AddImage(m_parent->GetTexture(icon), tl, br);
+		m_parent->GetImage(icon).Draw(list, tl, br);
 	}
 
 	//Draw the text
@@ -0,0 +1,269 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of DigitalBusRunIndex
+ */
+#include "ngscopeclient.h"
+#include "DigitalBusRunIndex.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Change detection
+
+/*
+	Each of these looks for samples i in [begin, n) where samples[i] != samples[i+1], and appends i+1 (the start of a
+	new run) to starts. They give up and return false once there are more than maxRuns starts.
+ */
+
+template<class T>
+static bool FindChanges(const T* samples, size_t begin, size_t n, size_t maxRuns, vector<size_t>& starts)
+{
+	for(size_t i=begin; i<n; i++)
+	{
+		if(samples[i] != samples[i+1])
+		{
+			starts.push_back(i+1);
+			if(starts.size() > maxRuns)
+				return false;
+		}
+	}
+	return true;
+}
+
+#ifdef __x86_64__
+
+/**
+	@brief Appends the runs flagged by a bitmask of changed samples
+
+	@return False if there are too many runs
+ */
+static inline bool AddChanges(uint32_t mask, size_t base, size_t maxRuns, vector<size_t>& starts)
+{
+	while(mask)
+	{
+		starts.push_back(base + __builtin_ctz(mask) + 1);
+		mask &= mask - 1;
+	}
+	return (starts.size() <= maxRuns);
+}
+
+__attribute__((target("avx2")))
+static bool FindChangesAVX2(const uint32_t* samples, size_t n, size_t maxRuns, vector<size_t>& starts)
+{
+	size_t end = n - (n % 8);
+	for(size_t i=0; i<end; i+=8)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i + 1));
+		uint32_t same = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+		if( (same != 0xff) && !AddChanges(~same & 0xff, i, maxRuns, starts) )
+			return false;
+	}
+	return FindChanges(samples, end, n, maxRuns, starts);
+}
+
+__attribute__((target("avx2")))
+static bool FindChangesAVX2(const uint64_t* samples, size_t n, size_t maxRuns, vector<size_t>& starts)
+{
+	size_t end = n - (n % 4);
+	for(size_t i=0; i<end; i+=4)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i + 1));
+		uint32_t same = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)));
+		if( (same != 0xf) && !AddChanges(~same & 0xf, i, maxRuns, starts) )
+			return false;
+	}
+	return FindChanges(samples, end, n, maxRuns, starts);
+}
+
+__attribute__((target("avx512f")))
+static bool FindChangesAVX512F(const uint32_t* samples, size_t n, size_t maxRuns, vector<size_t>& starts)
+{
+	size_t end = n - (n % 16);
+	for(size_t i=0; i<end; i+=16)
+	{
+		__m512i a = _mm512_loadu_si512(samples + i);
+		__m512i b = _mm512_loadu_si512(samples + i + 1);
+		uint32_t changed = _mm512_cmpneq_epu32_mask(a, b);
+		if(changed && !AddChanges(changed, i, maxRuns, starts))
+			return false;
+	}
+	return FindChanges(samples, end, n, maxRuns, starts);
+}
+
+__attribute__((target("avx512f")))
+static bool FindChangesAVX512F(const uint64_t* samples, size_t n, size_t maxRuns, vector<size_t>& starts)
+{
+	size_t end = n - (n % 8);
+	for(size_t i=0; i<end; i+=8)
+	{
+		__m512i a = _mm512_loadu_si512(samples + i);
+		__m512i b = _mm512_loadu_si512(samples + i + 1);
+		uint32_t changed = _mm512_cmpneq_epu64_mask(a, b);
+		if(changed && !AddChanges(changed, i, maxRuns, starts))
+			return false;
+	}
+	return FindChanges(samples, end, n, maxRuns, starts);
+}
+
+#endif /* __x86_64__ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+DigitalBusRunIndex::DigitalBusRunIndex()
+	: m_valid(false)
+	, m_data(nullptr)
+	, m_revision(0)
+	, m_size(0)
+	, m_timestamp(0, 0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Index management
+
+/**
+	@brief Discards the index
+ */
+void DigitalBusRunIndex::Clear()
+{
+	m_starts.clear();
+	m_starts.shrink_to_fit();
+	m_values.clear();
+	m_values.shrink_to_fit();
+	m_valid = false;
+	m_data = nullptr;
+	m_revision = 0;
+	m_size = 0;
+	m_timestamp = TimePoint(0, 0);
+}
+
+/**
+	@brief Makes sure the index is up to date for the given waveform, rebuilding it if the waveform has changed
+
+	@return True if the index can be used, false if the waveform has too many runs to be worth indexing
+ */
+bool DigitalBusRunIndex::Update(UniformDigitalBusWaveform32* data)
+{
+	return DoUpdate(data);
+}
+
+/**
+	@brief Makes sure the index is up to date for the given waveform, rebuilding it if the waveform has changed
+
+	@return True if the index can be used, false if the waveform has too many runs to be worth indexing
+ */
+bool DigitalBusRunIndex::Update(UniformDigitalBusWaveform64* data)
+{
+	return DoUpdate(data);
+}
+
+template<class T>
+bool DigitalBusRunIndex::DoUpdate(UniformWaveform<T>* data)
+{
+	TimePoint timestamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	bool changed =
+		(data != m_data) ||
+		(data->m_revision != m_revision) ||
+		(data->size() != m_size) ||
+		(timestamp != m_timestamp);
+	if(!changed)
+		return m_valid;
+
+	Clear();
+	m_data = data;
+	m_revision = data->m_revision;
+	m_size = data->size();
+	m_timestamp = timestamp;
+
+	data->PrepareForCpuAccess();
+	m_valid = Build(data->m_samples.GetCpuPointer(), data->size());
+
+	//Don't keep a partial index around
+	if(!m_valid)
+	{
+		m_starts.clear();
+		m_starts.shrink_to_fit();
+	}
+	return m_valid;
+}
+
+/**
+	@brief Finds the run boundaries and values
+
+	@return False if there are too many runs
+ */
+template<class T>
+bool DigitalBusRunIndex::Build(const T* samples, size_t len)
+{
+	if(len == 0)
+		return true;
+
+	size_t maxRuns = max(len / MAX_RUN_FRACTION, (size_t)1);
+
+	m_starts.push_back(0);
+	bool ok;
+	#ifdef __x86_64__
+		if(g_hasAvx512F)
+			ok = FindChangesAVX512F(samples, len - 1, maxRuns, m_starts);
+		else if(g_hasAvx2)
+			ok = FindChangesAVX2(samples, len - 1, maxRuns, m_starts);
+		else
+	#endif
+		ok = FindChanges(samples, 0, len - 1, maxRuns, m_starts);
+	if(!ok)
+		return false;
+
+	m_values.resize(m_starts.size());
+	for(size_t i=0; i<m_starts.size(); i++)
+		m_values[i] = samples[m_starts[i]];
+	return true;
+}
+
+/**
+	@brief Finds the run containing a sample
+
+	@param i	Sample index (must be less than the size of the waveform)
+ */
+size_t DigitalBusRunIndex::FindRun(size_t i) const
+{
+	auto it = upper_bound(m_starts.begin(), m_starts.end(), i);
+	return (it - m_starts.begin()) - 1;
+}
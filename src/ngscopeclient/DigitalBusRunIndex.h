@@ -0,0 +1,113 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of DigitalBusRunIndex
+ */
+#ifndef DigitalBusRunIndex_h
+#define DigitalBusRunIndex_h
+
+/**
+	@brief Run-length index of a uniform digital bus waveform
+
+	Drawing a bus waveform merges consecutive samples with the same value into one segment. Rather than rescanning the
+	raw samples every frame, the runs (start index and value) are found once per waveform, and the renderer
+	binary-searches them for the visible window.
+
+	If the waveform changes value so often that the index would not be much smaller than the waveform itself, it is
+	not built, and the renderer falls back to scanning the samples.
+ */
+class DigitalBusRunIndex
+{
+public:
+	DigitalBusRunIndex();
+
+	bool Update(UniformDigitalBusWaveform32* data);
+	bool Update(UniformDigitalBusWaveform64* data);
+
+	void Clear();
+
+	size_t FindRun(size_t i) const;
+
+	///@brief Returns the number of runs in the waveform
+	size_t GetRunCount() const
+	{ return m_starts.size(); }
+
+	///@brief Returns the index of the first sample in a run
+	size_t GetRunStart(size_t run) const
+	{ return m_starts[run]; }
+
+	///@brief Returns the index of the last sample in a run
+	size_t GetRunLast(size_t run) const
+	{
+		if(run + 1 < m_starts.size())
+			return m_starts[run + 1] - 1;
+		return m_size - 1;
+	}
+
+	///@brief Returns the value of every sample in a run
+	uint64_t GetRunValue(size_t run) const
+	{ return m_values[run]; }
+
+protected:
+	template<class T>
+	bool DoUpdate(UniformWaveform<T>* data);
+
+	template<class T>
+	bool Build(const T* samples, size_t len);
+
+	///@brief Index of the first sample in each run
+	std::vector<size_t> m_starts;
+
+	///@brief Value of each run
+	std::vector<uint64_t> m_values;
+
+	///@brief True if the index is valid for m_data
+	bool m_valid;
+
+	///@brief The waveform the index was built from
+	WaveformBase* m_data;
+
+	///@brief Revision of m_data the index was built from
+	uint64_t m_revision;
+
+	///@brief Size of m_data when the index was built
+	size_t m_size;
+
+	///@brief Timestamp of m_data when the index was built
+	TimePoint m_timestamp;
+
+	///@brief Largest number of runs, relative to the number of samples, worth indexing
+	static const size_t MAX_RUN_FRACTION = 4;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of FenwickTree
+ */
+#ifndef FenwickTree_h
+#define FenwickTree_h
+
+#include <vector>
+
+/**
+	@brief Binary indexed tree for maintaining prefix sums of a list of non-negative values
+
+	Point updates, appends, prefix queries, and searching for the element containing a given running total are all
+	O(log n). Used for the cumulative row heights of large virtualized lists.
+ */
+template<class T>
+class FenwickTree
+{
+public:
+	FenwickTree()
+	: m_tree(1, 0)
+	{}
+
+	void Clear()
+	{
+		m_values.clear();
+		m_tree.assign(1, 0);
+	}
+
+	size_t size() const
+	{ return m_values.size(); }
+
+	bool empty() const
+	{ return m_values.empty(); }
+
+	/**
+		@brief Replaces the entire contents of the tree in O(n)
+	 */
+	void Build(const std::vector<T>& values)
+	{
+		m_values = values;
+		m_tree.resize(values.size() + 1);
+		m_tree[0] = 0;
+		for(size_t i=1; i<=values.size(); i++)
+			m_tree[i] = values[i-1];
+		for(size_t i=1; i<=values.size(); i++)
+		{
+			size_t parent = i + LowBit(i);
+			if(parent <= values.size())
+				m_tree[parent] += m_tree[i];
+		}
+	}
+
+	/**
+		@brief Appends a new value to the end of the list
+	 */
+	void PushBack(T value)
+	{
+		m_values.push_back(value);
+		size_t i = m_values.size();
+		m_tree.push_back(value + Prefix(i-1) - Prefix(i - LowBit(i)));
+	}
+
+	/**
+		@brief Removes the last value
+	 */
+	void PopBack()
+	{
+		m_values.pop_back();
+		m_tree.pop_back();
+	}
+
+	/**
+		@brief Gets a single value
+	 */
+	T Get(size_t i) const
+	{ return m_values[i]; }
+
+	/**
+		@brief Changes a single value
+	 */
+	void Set(size_t i, T value)
+	{
+		T delta = value - m_values[i];
+		m_values[i] = value;
+		for(size_t j=i+1; j<m_tree.size(); j += LowBit(j))
+			m_tree[j] += delta;
+	}
+
+	/**
+		@brief Sum of the first n values
+	 */
+	T Prefix(size_t n) const
+	{
+		T sum = 0;
+		for(size_t j=n; j>0; j -= LowBit(j))
+			sum += m_tree[j];
+		return sum;
+	}
+
+	/**
+		@brief Sum of all values
+	 */
+	T Total() const
+	{ return Prefix(m_values.size()); }
+
+	/**
+		@brief Finds the element containing a given running total
+
+		@return Index of the first element whose end (inclusive prefix sum) is greater than y,
+				or size() if y is past the end
+	 */
+	size_t Find(T y) const
+	{
+		size_t n = m_values.size();
+		size_t step = 1;
+		while( (step << 1) <= n)
+			step <<= 1;
+
+		size_t pos = 0;
+		for(; step > 0; step >>= 1)
+		{
+			if( (pos + step <= n) && (m_tree[pos + step] <= y) )
+			{
+				pos += step;
+				y -= m_tree[pos];
+			}
+		}
+		return pos;
+	}
+
+protected:
+	static size_t LowBit(size_t i)
+	{ return i & (~i + 1); }
+
+	///@brief Raw values
+	std::vector<T> m_values;
+
+	///@brief Tree nodes (1-based, m_tree[0] is unused)
+	std::vector<T> m_tree;
+};
+
+#endif
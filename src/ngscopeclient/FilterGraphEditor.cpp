@@ -2465,8 +2465,8 @@ void FilterGraphEditor::DoNodeForChannel(
 			rounding,
 			ImDrawFlags_RoundCornersAll);
 
-		bgList->AddImage(
-			m_parent->GetTextureManager()->GetTexture("time"),
+		m_parent->GetImage("time").Draw(
+			bgList,
 			clockiconpos,
 			clockiconpos + clockiconsize );
 
@@ -2499,7 +2499,7 @@ void FilterGraphEditor::DoNodeForChannel(
 		ImVec2 rectEnd(textpos.x + errorSize.x + ImGui::GetStyle().FramePadding.y, nextIconBot);
 
 		bgList->AddRectFilled(rectStart, rectEnd, bubbleColor, rounding, ImDrawFlags_RoundCornersAll);
-		bgList->AddImage(m_parent->GetTextureManager()->GetTexture("error"), erriconpos, erriconpos + erriconsize );
+		m_parent->GetImage("error").Draw(bgList, erriconpos, erriconpos + erriconsize );
 		bgList->AddText(textpos, textColor, errorText.c_str());
 
 		//See if the mouse is hovering this spot
@@ -2619,8 +2619,8 @@ void FilterGraphEditor::NodeIcon(InstrumentChannel* chan, ImVec2 pos, ImVec2 ico
 
 	if(iconname != "")
 	{
-		list->AddImage(
-			m_parent->GetTextureManager()->GetTexture(iconname),
+		m_parent->GetImage(iconname).Draw(
+			list,
 			pos,
 			pos + iconsize );
 		return;
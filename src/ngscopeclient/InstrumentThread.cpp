@@ -39,6 +39,236 @@
 
 using namespace std;
 
+/**
+	@brief Configuration of one oscilloscope channel as read back from the instrument
+
+	Filled in for every dirty channel before anything is published to the OscilloscopeState
+ */
+class ChannelStateSnapshot
+{
+public:
+	ChannelStateSnapshot(size_t index, OscilloscopeChannel* chan)
+		: m_index(index)
+		, m_chan(chan)
+		, m_digital(chan->GetType(0) == Stream::STREAM_TYPE_DIGITAL)
+		, m_analog(chan->GetType(0) == Stream::STREAM_TYPE_ANALOG)
+		, m_inverted(false)
+		, m_threshold(0)
+		, m_attenuation(0)
+		, m_bandwidthLimit(0)
+		, m_adcMode(0)
+		, m_coupling(OscilloscopeChannel::COUPLE_DC_1M)
+	{}
+
+	size_t m_index;
+	OscilloscopeChannel* m_chan;
+	bool m_digital;
+	bool m_analog;
+
+	bool m_inverted;
+	float m_threshold;
+	float m_attenuation;
+	unsigned int m_bandwidthLimit;
+	vector<uint32_t> m_bandwidthLimits;
+	string m_probeName;
+	size_t m_adcMode;
+	OscilloscopeChannel::CouplingType m_coupling;
+	vector<OscilloscopeChannel::CouplingType> m_couplings;
+	vector<float> m_offsets;
+	vector<float> m_ranges;
+};
+
+/**
+	@brief Returns the display name of a coupling mode
+ */
+static string GetCouplingName(OscilloscopeChannel::CouplingType c)
+{
+	switch(c)
+	{
+		case OscilloscopeChannel::COUPLE_DC_50:
+			return "DC 50Ω";
+
+		case OscilloscopeChannel::COUPLE_AC_50:
+			return "AC 50Ω";
+
+		case OscilloscopeChannel::COUPLE_DC_1M:
+			return "DC 1MΩ";
+
+		case OscilloscopeChannel::COUPLE_AC_1M:
+			return "AC 1MΩ";
+
+		case OscilloscopeChannel::COUPLE_GND:
+			return "Ground";
+
+		default:
+			return "Invalid";
+	}
+}
+
+/**
+	@brief Re-reads the configuration of every channel flagged as needing an update
+
+	All dirty channels are refreshed as one batch rather than one channel at a time. Each property is queried for
+	every dirty channel before moving on to the next property, so drivers which fetch a setting for all channels in a
+	single query on a cache miss answer the rest of the batch from cache, and each getter is only called once per
+	channel. Nothing is published to the UI state until the whole batch has been read back, so channels update together.
+
+	Update flags are cleared before querying, so a channel marked dirty again while the batch is in flight gets
+	refreshed again on the next pass instead of the request being lost.
+	The getters still block on each reply, so queries that miss the driver cache each cost a round trip. Pipelining
+	them through the transport would need a batch query API in the drivers themselves.
+ */
+static void RefreshOscilloscopeState(
+	Session* session,
+	shared_ptr<Oscilloscope> scope,
+	shared_ptr<OscilloscopeState> scopestate)
+{
+	//Figure out what needs refreshing
+	vector<ChannelStateSnapshot> batch;
+	for(size_t i=0; i<scope->GetChannelCount(); i++)
+	{
+		if(!scopestate->m_needsUpdate[i])
+			continue;
+		scopestate->m_needsUpdate[i] = false;
+
+		//Skip non-scope channels
+		auto scopechan = dynamic_cast<OscilloscopeChannel*>(scope->GetChannel(i));
+		if(!scopechan)
+			continue;
+
+		batch.push_back(ChannelStateSnapshot(i, scopechan));
+	}
+	if(batch.empty())
+		return;
+
+	//Read back each property for all channels in the batch
+	for(auto& c : batch)
+		c.m_inverted = scope->IsInverted(c.m_index);
+	for(auto& c : batch)
+	{
+		if(c.m_digital)
+			c.m_threshold = scope->GetDigitalThreshold(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_attenuation = scope->GetChannelAttenuation(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(!c.m_analog)
+			continue;
+		size_t nstreams = c.m_chan->GetStreamCount();
+		for(size_t j=0; j<nstreams; j++)
+			c.m_offsets.push_back(c.m_chan->GetOffset(j));
+	}
+	for(auto& c : batch)
+	{
+		if(!c.m_analog)
+			continue;
+		size_t nstreams = c.m_chan->GetStreamCount();
+		for(size_t j=0; j<nstreams; j++)
+			c.m_ranges.push_back(c.m_chan->GetVoltageRange(j));
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_probeName = scope->GetProbeName(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_bandwidthLimit = scope->GetChannelBandwidthLimit(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_bandwidthLimits = scope->GetChannelBandwidthLimiters(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_adcMode = scope->GetADCMode(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_coupling = scope->GetChannelCoupling(c.m_index);
+	}
+	for(auto& c : batch)
+	{
+		if(c.m_analog)
+			c.m_couplings = scope->GetAvailableCouplings(c.m_index);
+	}
+
+	//Publish the results
+	Unit counts(Unit::UNIT_COUNTS);
+	Unit hz(Unit::UNIT_HZ);
+	for(auto& c : batch)
+	{
+		size_t i = c.m_index;
+		scopestate->m_channelInverted[i] = c.m_inverted;
+
+		if(c.m_digital)
+		{
+			Unit unit = c.m_chan->GetYAxisUnits(0);
+			scopestate->m_channelDigitalThreshold[i] = c.m_threshold;
+			scopestate->m_committedDigitalThreshold[i] = c.m_threshold;
+			scopestate->m_strDigitalThreshold[i] = unit.PrettyPrint(c.m_threshold);
+		}
+		else if(c.m_analog)
+		{
+			scopestate->m_channelAttenuation[i] = c.m_attenuation;
+			scopestate->m_committedAttenuation[i] = c.m_attenuation;
+			scopestate->m_strAttenuation[i] = counts.PrettyPrint(c.m_attenuation);
+
+			for(size_t j=0; j<c.m_offsets.size(); j++)
+			{
+				Unit unit = c.m_chan->GetYAxisUnits(j);
+				scopestate->m_channelOffset[i][j] = c.m_offsets[j];
+				scopestate->m_channelRange[i][j] = c.m_ranges[j];
+				scopestate->m_committedOffset[i][j] = c.m_offsets[j];
+				scopestate->m_committedRange[i][j] = c.m_ranges[j];
+				scopestate->m_strOffset[i][j] = unit.PrettyPrint(c.m_offsets[j]);
+				scopestate->m_strRange[i][j] = unit.PrettyPrint(c.m_ranges[j]);
+			}
+
+			scopestate->m_probeName[i] = c.m_probeName;
+
+			// Populate bandwidth limit values
+			scopestate->m_channelBandwidthLimit[i] = c.m_bandwidthLimit;
+			scopestate->m_bandwidthLimitNames[i].clear();
+			scopestate->m_bandwidthLimits[i] = c.m_bandwidthLimits;
+			for(size_t j=0; j<c.m_bandwidthLimits.size(); j++)
+			{
+				auto b = c.m_bandwidthLimits[j];
+				if(b == 0)
+					scopestate->m_bandwidthLimitNames[i].push_back("Full");
+				else
+					scopestate->m_bandwidthLimitNames[i].push_back(hz.PrettyPrint(b*1e6));
+
+				if(b == c.m_bandwidthLimit)
+					scopestate->m_channelBandwidthLimit[i] = j;
+			}
+
+			scopestate->m_adcMode[i] = c.m_adcMode;
+
+			// Populate coupling values
+			scopestate->m_couplingNames[i].clear();
+			scopestate->m_couplings[i] = c.m_couplings;
+			for(size_t j=0; j<c.m_couplings.size(); j++)
+			{
+				scopestate->m_couplingNames[i].push_back(GetCouplingName(c.m_couplings[j]));
+				if(c.m_couplings[j] == c.m_coupling)
+					scopestate->m_channelCoupling[i] = j;
+			}
+		}
+	}
+
+	for(auto& c : batch)
+		session->MarkChannelDirty(c.m_chan);
+}
+
 void InstrumentThread(InstrumentThreadArgs args)
 {
 	pthread_setname_np_compat("InstrumentThread");
@@ -81,6 +311,11 @@ void InstrumentThread(InstrumentThreadArgs args)
 
 	bool triggerUpToDate = false;
 
+	//Drivers that don't talk SCPI answer trigger polls locally, so there's no point in slowing them down
+	auto scheduler = args.pollScheduler;
+	if(scheduler)
+		scheduler->SetLocal(dynamic_cast<SCPINullTransport*>(inst->GetTransport()) != nullptr);
+
 	while(!*args.shuttingDown)
 	{
 		//Flush any pending commands
@@ -102,6 +337,8 @@ void InstrumentThread(InstrumentThreadArgs args)
 			{
 				//LogTrace("Scope isn't armed, sleeping\n");
 				this_thread::sleep_for(chrono::milliseconds(5));
+				if(scheduler)
+					scheduler->OnDisarmed();
 				if(!triggerUpToDate)
 				{	// Check for trigger state change
 					auto stat = scope->PollTrigger();
@@ -115,9 +352,13 @@ void InstrumentThread(InstrumentThreadArgs args)
 
 			//Grab data if it's ready
 			//TODO: how is this going to play with reading realtime BER from BERT+scope deviecs?
-			else
+			//Only poll when the scheduler says a trigger might plausibly have happened, to save link bandwidth
+			else if(!scheduler || scheduler->IsPollDue())
 			{
+				double start = GetTime();
 				auto stat = scope->PollTrigger();
+				if(scheduler)
+					scheduler->OnPoll(start, GetTime(), stat == Oscilloscope::TRIGGER_MODE_TRIGGERED);
 				session->GetInstrumentConnectionState(inst)->m_lastTriggerState = stat;
 				if(stat == Oscilloscope::TRIGGER_MODE_TRIGGERED)
 				{
@@ -130,121 +371,9 @@ void InstrumentThread(InstrumentThreadArgs args)
 				triggerUpToDate = false;
 			}
 
+			//Read status for channels that need it
 			if(scopestate)
-			{	// Update state
-				//Read status for channels that need it
-				for(size_t i=0; i<scope->GetChannelCount(); i++)
-				{
-					if(scopestate->m_needsUpdate[i])
-					{
-						//Skip non-scope channels
-						auto scopechan = dynamic_cast<OscilloscopeChannel*>(scope->GetChannel(i));
-						if(!scopechan)
-							continue;
-
-						scopestate->m_channelInverted[i] = scope->IsInverted(i);
-
-						bool isDigital = (scopechan->GetType(0) == Stream::STREAM_TYPE_DIGITAL);
-						bool isAnalog = (scopechan->GetType(0) == Stream::STREAM_TYPE_ANALOG);
-						if(isDigital)
-						{
-							Unit unit = scopechan->GetYAxisUnits(0);
-							scopestate->m_channelDigitalThreshold[i] = scope->GetDigitalThreshold(i);
-							scopestate->m_committedDigitalThreshold[i] = scopestate->m_channelDigitalThreshold[i];
-							scopestate->m_strDigitalThreshold[i] = unit.PrettyPrint(scopestate->m_channelDigitalThreshold[i]);
-						}
-						else if(isAnalog)
-						{
-							scopestate->m_channelAttenuation[i] = scope->GetChannelAttenuation(i);
-							scopestate->m_channelBandwidthLimit[i] = scope->GetChannelBandwidthLimit(i);
-							scopestate->m_committedAttenuation[i] = scopestate->m_channelAttenuation[i];
-							Unit counts(Unit::UNIT_COUNTS);
-							scopestate->m_strAttenuation[i] = counts.PrettyPrint(scopestate->m_committedAttenuation[i]);
-
-							size_t nstreams = scopechan->GetStreamCount();
-							for(size_t j=0; j<nstreams; j++)
-							{
-								float offset = scopechan->GetOffset(j);
-								float range = scopechan->GetVoltageRange(j);
-								Unit unit = scopechan->GetYAxisUnits(j);
-								scopestate->m_channelOffset[i][j] = scopechan->GetOffset(j);
-								scopestate->m_channelRange[i][j] = scopechan->GetVoltageRange(j);
-								scopestate->m_committedOffset[i][j] = offset;
-								scopestate->m_committedRange[i][j] = range;
-								scopestate->m_strOffset[i][j] = unit.PrettyPrint(offset);
-								scopestate->m_strRange[i][j] = unit.PrettyPrint(range);
-							}
-
-							// Get probe name
-							scopestate->m_probeName[i] = scope->GetProbeName(i);
-
-							// Populate bandwidth limit values
-							auto limit = scope->GetChannelBandwidthLimit(i);
-							scopestate->m_bandwidthLimits[i].clear();
-							scopestate->m_bandwidthLimitNames[i].clear();
-							scopestate->m_bandwidthLimits[i] = scope->GetChannelBandwidthLimiters(i);
-							Unit hz(Unit::UNIT_HZ);
-							for(size_t j=0; j<scopestate->m_bandwidthLimits[i].size(); j++)
-							{
-								auto b = scopestate->m_bandwidthLimits[i][j];
-								if(b == 0)
-									scopestate->m_bandwidthLimitNames[i].push_back("Full");
-								else
-									scopestate->m_bandwidthLimitNames[i].push_back(hz.PrettyPrint(b*1e6));
-
-								if(b == limit)
-									scopestate->m_channelBandwidthLimit[i] = j;
-							}
-
-							scopestate->m_adcMode[i] = scope->GetADCMode(i);
-
-							// Populate coupling values
-							auto coupling = scope->GetChannelCoupling(i);
-							scopestate->m_couplings[i].clear();
-							scopestate->m_couplingNames[i].clear();
-							scopestate->m_couplings[i] = scope->GetAvailableCouplings(i);
-							for(size_t j=0; j<scopestate->m_couplings[i].size(); j++)
-							{
-								auto c = scopestate->m_couplings[i][j];
-
-								switch(c)
-								{
-									case OscilloscopeChannel::COUPLE_DC_50:
-										scopestate->m_couplingNames[i].push_back("DC 50Ω");
-										break;
-
-									case OscilloscopeChannel::COUPLE_AC_50:
-										scopestate->m_couplingNames[i].push_back("AC 50Ω");
-										break;
-
-									case OscilloscopeChannel::COUPLE_DC_1M:
-										scopestate->m_couplingNames[i].push_back("DC 1MΩ");
-										break;
-
-									case OscilloscopeChannel::COUPLE_AC_1M:
-										scopestate->m_couplingNames[i].push_back("AC 1MΩ");
-										break;
-
-									case OscilloscopeChannel::COUPLE_GND:
-										scopestate->m_couplingNames[i].push_back("Ground");
-										break;
-
-									default:
-										scopestate->m_couplingNames[i].push_back("Invalid");
-										break;
-								}
-								if(c == coupling)
-									scopestate->m_channelCoupling[i] = j;
-							}
-						}
-
-						session->MarkChannelDirty(scopechan);
-
-						scopestate->m_needsUpdate[i] = false;
-					}
-
-				}
-			}
+				RefreshOscilloscopeState(session, scope, scopestate);
 		}
 
 		//Always acquire data from non-scope instruments
@@ -91,6 +91,22 @@ using namespace std;
 extern Event g_rerenderRequestedEvent;
 extern unique_ptr<MainWindow> g_mainWindow;
 
+///@brief Set when new compute pipelines have been created since the pipeline cache was last saved
+static atomic<bool> g_pipelineCacheSaveRequested(false);
+
+///@brief How long to wait after new pipelines are created before saving the pipeline cache, in seconds
+#define PIPELINE_CACHE_SAVE_DELAY 5
+
+/**
+	@brief Requests that the Vulkan pipeline cache be written to disk soon
+
+	Call whenever new compute pipelines are created. Safe to call from any thread.
+ */
+void SchedulePipelineCacheSave()
+{
+	g_pipelineCacheSaveRequested = true;
+}
+
 // called by ImGui during ImGui::Begin()
 // when switching viewports, just after setting ImGuiStyle.FontScaleDpi
 static void MainWindow_OnChangedViewport([[maybe_unused]] ImGuiViewport *vp)
@@ -130,8 +146,11 @@ MainWindow::MainWindow(shared_ptr<QueueHandle> queue, bool maximized, bool resto
 	, m_showingLoadWarnings(false)
 	, m_loadConfirmationChecked(false)
 	, m_texmgr(queue)
+	, m_waveformPool(&m_texmgr)
 	, m_needRender(false)
+	, m_fontGeneration(0)
 	, m_toneMapTime(0)
+	, m_pipelineCacheSaveTime(0)
 {
 	LoadRecentInstrumentList();
 	LoadRecentFileList();
@@ -159,9 +178,13 @@ MainWindow::MainWindow(shared_ptr<QueueHandle> queue, bool maximized, bool resto
 				"MainWindow.m_cmdBuffer"));
 	}
 
+	double tstart = GetTime();
 	UpdateFonts();
+	double tfonts = GetTime();
 
-	//Load some textures
+	//Load some textures.
+	//Batch them all up so they're decoded in parallel and uploaded together
+	m_texmgr.BeginLoadBatch();
 	LoadToolbarIcons();
 	LoadGradients();
 	LoadMiscIcons();
@@ -169,6 +192,10 @@ MainWindow::MainWindow(shared_ptr<QueueHandle> queue, bool maximized, bool resto
 	LoadStatusBarIcons();
 	LoadWaveformShapeIcons();
 	LoadAppIcon();
+	m_texmgr.EndLoadBatch();
+	double ticons = GetTime();
+
+	LogDebug("Startup: fonts took %.2f ms, icons took %.2f ms\n", (tfonts - tstart) * 1000, (ticons - tfonts) * 1000);
 
 	//Don't move windows when dragging in the body, only the title bar
 	ImGui::GetIO().ConfigWindowsMoveFromTitleBarOnly = true;
@@ -189,6 +216,7 @@ MainWindow::~MainWindow()
 
 	lock_guard<shared_mutex> lock(g_vulkanActivityMutex);
 	g_vkComputeDevice->waitIdle();
+	m_waveformPool.clear();
 	m_texmgr.clear();
 
 	m_cmdBuffer = nullptr;
@@ -286,6 +314,7 @@ void MainWindow::CloseSession()
 	m_loadDialogs.clear();
 	m_dialogs.clear();
 	m_protocolAnalyzerDialogs.clear();
+	m_packetTimelineDialog = nullptr;
 	m_scpiConsoleDialogs.clear();
 	m_workspaces.clear();
 
@@ -543,6 +572,17 @@ void MainWindow::Render()
 	//Load all of our fonts
 	UpdateFonts();
 
+	//Write out the pipeline cache a little while after new pipelines show up, so they aren't lost if we crash or
+	//get killed rather than exiting cleanly. The delay gives them a chance to actually get compiled on first use.
+	if(g_pipelineCacheSaveRequested.exchange(false))
+		m_pipelineCacheSaveTime = GetTime() + PIPELINE_CACHE_SAVE_DELAY;
+	if( (m_pipelineCacheSaveTime > 0) && (GetTime() > m_pipelineCacheSaveTime) )
+	{
+		LogTrace("Saving pipeline cache\n");
+		g_pipelineCacheMgr->SaveToDisk();
+		m_pipelineCacheSaveTime = 0;
+	}
+
 	VulkanWindow::Render();
 }
 
@@ -580,18 +620,98 @@ void MainWindow::ToneMapAllWaveforms(vk::raii::CommandBuffer& cmdbuf)
 	m_toneMapTime = dt * FS_PER_SECOND;
 }
 
-void MainWindow::RenderWaveformTextures(
-	vk::raii::CommandBuffer& cmdbuf,
-	vector<shared_ptr<InputDescriptor> >& channels)
+/**
+	@brief Splits the waveform groups into independent sets that can be rasterized concurrently
+
+	Groups displaying the same waveform always end up in the same set, since the waveform's buffers can't safely be
+	prepared for GPU (or CPU) access from two threads at once. Sets are balanced by the number of samples to rasterize.
+
+	@param maxPartitions	Maximum number of sets to return
+
+	@return The sets of groups. Empty if there are no groups.
+ */
+vector<vector<shared_ptr<WaveformGroup>>> MainWindow::PartitionWaveformGroups(size_t maxPartitions)
 {
-	bool clear = m_clearPersistence.exchange(false);
 	vector<shared_ptr<WaveformGroup>> groups;
 	{
-		lock_guard<recursive_mutex> lock2(m_waveformGroupsMutex);
+		lock_guard<recursive_mutex> lock(m_waveformGroupsMutex);
 		groups = m_waveformGroups;
 	}
-	for(auto group : groups)
-		group->RenderWaveformTextures(cmdbuf, channels, clear);
+	if(groups.empty() || (maxPartitions == 0) )
+		return {};
+
+	//Merge groups that share any rasterized waveform (union-find)
+	vector<size_t> parents(groups.size());
+	for(size_t i=0; i<groups.size(); i++)
+		parents[i] = i;
+	auto root = [&](size_t i)
+	{
+		while(parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	};
+
+	map<WaveformBase*, size_t> owners;
+	vector<size_t> costs(groups.size(), 0);
+	for(size_t i=0; i<groups.size(); i++)
+	{
+		for(auto& area : groups[i]->GetWaveformAreas())
+		{
+			for(size_t j=0; j<area->GetStreamCount(); j++)
+			{
+				auto stream = area->GetStream(j);
+				if(stream.IsOutOfRange())
+					continue;
+				auto type = stream.GetType();
+				if( (type != Stream::STREAM_TYPE_ANALOG) && (type != Stream::STREAM_TYPE_DIGITAL) )
+					continue;
+				auto data = stream.GetData();
+				if(data == nullptr)
+					continue;
+
+				costs[i] += data->size();
+
+				auto it = owners.find(data);
+				if(it == owners.end())
+					owners[data] = i;
+				else
+					parents[root(i)] = root(it->second);
+			}
+		}
+	}
+
+	//Collect the connected components and their total cost
+	map<size_t, vector<size_t>> components;
+	map<size_t, size_t> componentCosts;
+	for(size_t i=0; i<groups.size(); i++)
+	{
+		auto r = root(i);
+		components[r].push_back(i);
+		componentCosts[r] += costs[i];
+	}
+
+	//Biggest first, each into whichever set has the least work so far
+	vector<size_t> order;
+	for(auto& it : components)
+		order.push_back(it.first);
+	sort(order.begin(), order.end(),
+		[&](size_t a, size_t b) { return componentCosts[a] > componentCosts[b]; });
+
+	size_t npartitions = min(maxPartitions, order.size());
+	vector<vector<shared_ptr<WaveformGroup>>> partitions(npartitions);
+	vector<size_t> loads(npartitions, 0);
+	for(auto r : order)
+	{
+		size_t best = min_element(loads.begin(), loads.end()) - loads.begin();
+		for(auto i : components[r])
+			partitions[best].push_back(groups[i]);
+		loads[best] += componentCosts[r];
+	}
+
+	return partitions;
 }
 
 void MainWindow::ResetStyle()
@@ -744,6 +864,7 @@ void MainWindow::RenderUI()
 		auto t = m_historyDialog->GetSelectedPoint();
 		if(t != TimePoint(0,0))
 		{
+			m_session.RestorePackets(t);
 			for(auto it : m_protocolAnalyzerDialogs)
 				it.second->OnWaveformLoaded(t);
 		}
@@ -762,23 +883,14 @@ void MainWindow::RenderUI()
 		if(it.second->PollForSelectionChanges())
 		{
 			LogTrace("Protocol analyzer selection changed\n");
-
-			auto tstamp = it.second->GetSelectedWaveformTimestamp();
-			auto& hist = m_session.GetHistory();
-			if(m_historyDialog)
-				m_historyDialog->SelectTimestamp(tstamp);
-
-			auto hpt = hist.GetHistory(tstamp);
-			if(hpt)
-			{
-				LogTrace("Loading history\n");
-
-				hpt->LoadHistoryToSession(m_session);
-				m_needRender = true;
-			}
-			m_session.RefreshAllFiltersNonblocking();
+			SelectHistoryTimestamp(it.second->GetSelectedWaveformTimestamp());
 		}
 	}
+	if(m_packetTimelineDialog && m_packetTimelineDialog->PollForSelectionChanges())
+	{
+		LogTrace("Packet timeline selection changed\n");
+		SelectHistoryTimestamp(m_packetTimelineDialog->GetSelectedWaveformTimestamp());
+	}
 
 	//Handle error messages and other blocking notifications
 	RenderReconnectPopup();
@@ -792,6 +904,9 @@ void MainWindow::RenderUI()
 	if(m_showDemo)
 		ImGui::ShowDemoWindow(&m_showDemo);
 
+	//Push any texture atlas images added this frame to the GPU before the frame is rendered
+	m_texmgr.FlushUploads();
+
 	ImGui::PopFont();
 }
 
@@ -885,7 +1000,7 @@ void MainWindow::LoadGradients()
 void MainWindow::LoadGradient(const string& friendlyName, const string& internalName)
 {
 	string prefix = string("icons/gradients/");
-	m_texmgr.LoadTexture(internalName, FindDataFile(prefix + internalName + ".png"));
+	m_texmgr.LoadTexture(internalName, FindDataFile(prefix + internalName + ".png"), true);
 	m_eyeGradientFriendlyNames[internalName] = friendlyName;
 	m_eyeGradients.push_back(internalName);
 }
@@ -1073,7 +1188,7 @@ void MainWindow::ToolbarButtons()
 	auto buttonStartPos = ImGui::GetCursorScreenPos();;
 
 	//Trigger button group
-	if(ImGui::ImageButton("trigger-start", GetTexture("trigger-start"), buttonsize))
+	if(GetImage("trigger-start").ImageButton("trigger-start", buttonsize))
 	{
 		m_session.ArmTrigger(TriggerGroup::TRIGGER_TYPE_NORMAL);
 
@@ -1098,7 +1213,7 @@ void MainWindow::ToolbarButtons()
 		m_tutorialDialog->DrawSpeechBubble(anchorPos, ImGuiDir_Up, "Arm the trigger");
 	}
 
-	if(ImGui::ImageButton("trigger-auto", GetTexture("trigger-auto"), buttonsize))
+	if(GetImage("trigger-auto").ImageButton("trigger-auto", buttonsize))
 		m_session.ArmTrigger(TriggerGroup::TRIGGER_TYPE_AUTO);
 	Dialog::Tooltip("Arm the trigger, then force an acquisition if no trigger event occurs");
 	if(multigroup)
@@ -1108,7 +1223,7 @@ void MainWindow::ToolbarButtons()
 	}
 
 	ImGui::SameLine(0.0, 0.0);
-	if(ImGui::ImageButton("trigger-single", GetTexture("trigger-single"), buttonsize))
+	if(GetImage("trigger-single").ImageButton("trigger-single", buttonsize))
 		m_session.ArmTrigger(TriggerGroup::TRIGGER_TYPE_SINGLE);
 	Dialog::Tooltip("Arm the trigger in one-shot mode");
 	if(multigroup)
@@ -1118,7 +1233,7 @@ void MainWindow::ToolbarButtons()
 	}
 
 	ImGui::SameLine(0.0, 0.0);
-	if(ImGui::ImageButton("trigger-force", GetTexture("trigger-force"), buttonsize))
+	if(GetImage("trigger-force").ImageButton("trigger-force", buttonsize))
 		m_session.ArmTrigger(TriggerGroup::TRIGGER_TYPE_FORCED);
 	Dialog::Tooltip("Acquire a waveform immediately, ignoring the trigger condition");
 	if(multigroup)
@@ -1128,7 +1243,7 @@ void MainWindow::ToolbarButtons()
 	}
 
 	ImGui::SameLine(0.0, 0.0);
-	if(ImGui::ImageButton("trigger-stop", GetTexture("trigger-stop"), buttonsize))
+	if(GetImage("trigger-stop").ImageButton("trigger-stop", buttonsize))
 		m_session.StopTrigger();
 	Dialog::Tooltip("Stop acquiring waveforms");
 	if(multigroup)
@@ -1145,7 +1260,7 @@ void MainWindow::ToolbarButtons()
 	ImGui::SameLine();
 	if(hasHist)
 		ImGui::BeginDisabled();
-	if(ImGui::ImageButton("history", GetTexture("history"), buttonsize))
+	if(GetImage("history").ImageButton("history", buttonsize))
 	{
 		m_historyDialog = make_shared<HistoryDialog>(m_session.GetHistory(), &m_session, this);
 		AddDialog(m_historyDialog);
@@ -1156,7 +1271,7 @@ void MainWindow::ToolbarButtons()
 
 	//Refresh scope settings
 	ImGui::SameLine();
-	if(ImGui::ImageButton("refresh-settings", GetTexture("refresh-settings"), buttonsize))
+	if(GetImage("refresh-settings").ImageButton("refresh-settings", buttonsize))
 	{
 		m_session.FlushConfigCache();
 		if(m_streamBrowser)
@@ -1171,7 +1286,7 @@ void MainWindow::ToolbarButtons()
 
 	//View settings
 	ImGui::SameLine();
-	if(ImGui::ImageButton("clear-sweeps", GetTexture("clear-sweeps"), buttonsize))
+	if(GetImage("clear-sweeps").ImageButton("clear-sweeps", buttonsize))
 	{
 		ClearPersistence();
 		m_session.ClearSweeps();
@@ -1182,13 +1297,13 @@ void MainWindow::ToolbarButtons()
 	ImGui::SameLine(0.0, 0.0);
 	if(m_fullscreen)
 	{
-		if(ImGui::ImageButton("fullscreen-exit", GetTexture("fullscreen-exit"), buttonsize))
+		if(GetImage("fullscreen-exit").ImageButton("fullscreen-exit", buttonsize))
 			SetFullscreen(false);
 		Dialog::Tooltip("Leave fullscreen mode");
 	}
 	else
 	{
-		if(ImGui::ImageButton("fullscreen-enter", GetTexture("fullscreen-enter"), buttonsize))
+		if(GetImage("fullscreen-enter").ImageButton("fullscreen-enter", buttonsize))
 			SetFullscreen(true);
 		Dialog::Tooltip("Enter fullscreen mode");
 	}
@@ -1228,6 +1343,8 @@ void MainWindow::OnDialogClosed(const std::shared_ptr<Dialog>& dlg)
 	//Handle single-instance dialogs
 	if(m_filterPalette == dlg)
 		m_filterPalette = nullptr;
+	if(m_packetTimelineDialog == dlg)
+		m_packetTimelineDialog = nullptr;
 	if(m_logViewerDialog == dlg)
 		m_logViewerDialog = nullptr;
 	if(m_streamBrowser == dlg)
@@ -1500,7 +1617,7 @@ void MainWindow::StatusBar(float height)
 		if(it.second.empty())
 			continue;
 
-		ImGui::Image(GetTexture(it.first), iconSize);
+		GetImage(it.first).Image(iconSize);
 		ImGui::SameLine();
 		ImGui::TextUnformatted(it.second.c_str());
 		ImGui::SameLine();
@@ -1510,6 +1627,28 @@ void MainWindow::StatusBar(float height)
 	m_statusHelp.clear();
 }
 
+/**
+	@brief Loads a waveform from history after it was selected in a packet view
+ */
+void MainWindow::SelectHistoryTimestamp(TimePoint tstamp)
+{
+	auto& hist = m_session.GetHistory();
+	if(m_historyDialog)
+		m_historyDialog->SelectTimestamp(tstamp);
+
+	m_session.RestorePackets(tstamp);
+
+	auto hpt = hist.GetHistory(tstamp);
+	if(hpt)
+	{
+		LogTrace("Loading history\n");
+
+		hpt->LoadHistoryToSession(m_session);
+		m_needRender = true;
+	}
+	m_session.RefreshAllFiltersNonblocking();
+}
+
 /**
 	@brief Scrolls all waveform groups so that the specified timestamp is visible
  */
@@ -2013,9 +2152,7 @@ void MainWindow::RenderLoadWarningPopup()
 		auto& warnings = m_session.GetWarnings();
 		if(!warnings.m_warnings.empty())
 		{
-			ImGui::Image(
-				GetTextureManager()->GetTexture("warning"),
-				ImVec2(warningSize, warningSize));
+			GetTextureManager()->GetImage("warning").Image(ImVec2(warningSize, warningSize));
 			ImGui::SameLine();
 			ImGui::TextUnformatted(
 				"Some of the instrument settings in the session you are loading do not match "
@@ -2136,6 +2273,13 @@ void MainWindow::RemoveFunctionGenerator(shared_ptr<SCPIFunctionGenerator> gen)
  */
 void MainWindow::UpdateFonts()
 {
+	//Fonts only come from preferences, so if no preference has changed since last time there's nothing to do.
+	//This is called every frame so avoid walking the whole preference tree unless we have to.
+	auto gen = Preference::GetGeneration();
+	if(gen == m_fontGeneration)
+		return;
+	m_fontGeneration = gen;
+
 	//Check for any changes to font preferences and rebuild the atlas if so
 	//Skip rebuilding atlas if nothing changed
 	auto& prefs = GetSession().GetPreferences();
@@ -2698,157 +2842,18 @@ bool MainWindow::LoadUIConfiguration(int version, const YAML::Node& node)
 	}
 
 	//Waveform groups
-	auto groups = node["groups"];
-	auto areas = node["areas"];
-	for(auto it : groups)
-	{
-		//Create the group
-		auto gn = it.second;
-		auto gname = gn["name"].as<string>();
-		LogTrace("Creating group %s\n", gname.c_str());
-		LogIndenter li2;
-		auto group = make_shared<WaveformGroup>(this, gname);
+	vector<shared_ptr<WaveformGroup>> groups;
+	bool ok = WaveformGroup::LoadLayout(m_session, this, version, node, groups);
+	for(auto& group : groups)
+	{
 		m_waveformGroups.push_back(group);
 
 		//Legacy file with no imgui config? auto dock the group next render
 		if(version < 2)
 			m_newWaveformGroups.push_back(group);
-
-		if(!group->LoadConfiguration(gn))
-		{
-			LogTrace("group loading failed\n");
-			return false;
-		}
-		else
-			LogTrace("Group ID is %s\n", group->GetID().c_str());
-
-		//Waveform areas
-		auto gareas = gn["areas"];
-		for(auto at : gareas)
-		{
-			//Load the area here (rather than by parsing the areas node as in glscopeclient)
-			//since ngscopeclient requires areas to be part of a group
-			auto aid = at.second["id"].as<int>();
-			LogTrace("Waveform area %d\n", aid);
-
-			if(version < 2)
-			{
-				//glscopeclient pre yaml-cpp refactor doesn't have named areas, need to bruteforce search for ID match
-				if(version == 0)
-				{
-					for(auto kt : areas)
-					{
-						auto an = kt.second;
-						if(an["id"].as<int>() == aid)
-						{
-							auto channel = m_session.m_idtable.Lookup<OscilloscopeChannel>(an["channel"].as<int>());
-							if(!channel)	//don't crash on bad IDs or missing filters
-								break;
-							size_t stream = 0;
-							if(an["stream"])
-								stream = an["stream"].as<int>();
-							auto area = make_shared<WaveformArea>(StreamDescriptor(channel, stream), group, this);
-							group->AddArea(area);
-
-							//Add any overlays
-							auto overlays = an["overlays"];
-							for(auto jt : overlays)
-							{
-								auto filter = m_session.m_idtable.Lookup<Filter>(jt.second["id"].as<int>());
-								stream = 0;
-								if(jt.second["stream"])
-									stream = jt.second["stream"].as<int>();
-								if(filter)
-									area->AddStream(StreamDescriptor(filter, stream));
-							}
-
-							//FIXME: This borks on some v1 files that are mislabeled as v0
-							//For now, ignore persistence settings on all v0/v1 files
-							/*
-							if (version == 0)
-								area->SetPersistenceEnabled(an["persistence"].as<int>() == 1);
-							else
-								area->SetPersistenceEnabled(an["persistence"].as<bool>());
-							*/
-
-							break;
-						}
-					}
-				}
-
-				//post refactor, area nodes are named
-				else
-				{
-					auto an = areas[string("area") + to_string(aid)];
-
-					auto channel = m_session.m_idtable.Lookup<OscilloscopeChannel>(an["channel"].as<int>());
-					if(!channel)	//don't crash on bad IDs or missing filters
-						continue;
-					size_t stream = 0;
-					if(an["stream"])
-						stream = an["stream"].as<int>();
-					auto area = make_shared<WaveformArea>(StreamDescriptor(channel, stream), group, this);
-					group->AddArea(area);
-
-					//Add any overlays
-					auto overlays = an["overlays"];
-					for(auto jt : overlays)
-					{
-						auto filter = m_session.m_idtable.Lookup<Filter>(jt.second["id"].as<int>());
-						stream = 0;
-						if(jt.second["stream"])
-							stream = jt.second["stream"].as<int>();
-						if(filter)
-							area->AddStream(StreamDescriptor(filter, stream));
-					}
-
-					//area->SetPersistenceEnabled(an["persistence"].as<bool>());
-				}
-			}
-
-			//ngscopeclient has a single list of streams
-			else
-			{
-				auto an = areas[string("area") + to_string(aid)];
-
-				shared_ptr<WaveformArea> area;
-
-				auto streams = an["streams"];
-				for(auto jt : streams)
-				{
-					auto chan = m_session.m_idtable.Lookup<OscilloscopeChannel>(jt.second["channel"].as<int>());
-					auto stream = jt.second["stream"].as<int>();
-					auto persist = jt.second["persistence"].as<bool>();
-					auto ramp = jt.second["colorRamp"].as<string>();
-					if(chan)
-					{
-						//Make the waveform area if needed
-						if(!area)
-						{
-							area = make_shared<WaveformArea>(StreamDescriptor(chan, stream), group, this);
-							area->RemoveStream(0);
-						}
-
-						area->AddStream(StreamDescriptor(chan, stream), persist, ramp);
-					}
-					else
-					{
-						LogWarning("channel %d not found in area %d\n",
-							jt.second["channel"].as<int>(),
-							aid);
-					}
-				}
-
-				if(!area)
-					LogWarning("no waveform area created for area %d\n", aid);
-				else
-				{
-					group->AddArea(area);
-					area->LoadConfiguration(an);
-				}
-			}
-		}
 	}
+	if(!ok)
+		return false;
 
 	//ignore splitter configuration from legacy format as imgui now handles that
 
@@ -3749,6 +3754,10 @@ bool MainWindow::OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType
 
 	bool moreFreed = m_session.OnMemoryPressure(level, type, requestedSize);
 
+	//Drop any waveform textures and buffers we were keeping around for reuse
+	if(m_waveformPool.clear())
+		moreFreed = true;
+
 	LogDebug("Memory minimization completed\n");
 	LogMemoryUsage();
 
@@ -41,9 +41,11 @@
 #include "TextureManager.h"
 #include "VulkanWindow.h"
 #include "WaveformGroup.h"
+#include "WaveformResourcePool.h"
 
 #include "FilterGraphEditor.h"
 #include "ManageInstrumentsDialog.h"
+#include "PacketTimelineDialog.h"
 #include "ProtocolAnalyzerDialog.h"
 #include "StreamBrowserDialog.h"
 #include "TriggerPropertiesDialog.h"
@@ -210,6 +212,8 @@ public:
 		int64_t duration = 0,
 		StreamDescriptor target = StreamDescriptor(nullptr, 0));
 
+	void SelectHistoryTimestamp(TimePoint tstamp);
+
 	/**
 		@brief Update the timebase properties dialog
 	 */
@@ -230,9 +234,7 @@ public:
 
 	void ToneMapAllWaveforms(vk::raii::CommandBuffer& cmdbuf);
 
-	void RenderWaveformTextures(
-		vk::raii::CommandBuffer& cmdbuf,
-		std::vector<std::shared_ptr<InputDescriptor> >& channels);
+	std::vector<std::vector<std::shared_ptr<WaveformGroup> > > PartitionWaveformGroups(size_t maxPartitions);
 
 	void SetNeedRender()
 	{ m_needRender = true; }
@@ -243,6 +245,12 @@ public:
 		SetNeedRender();
 	}
 
+	/**
+		@brief Returns true if persistence should be cleared on this render pass, and resets the request
+	 */
+	bool ConsumeClearPersistence()
+	{ return m_clearPersistence.exchange(false); }
+
 	virtual void Render();
 
 	void QueueCloseSession()
@@ -396,6 +404,9 @@ protected:
 	///@brief Map of filters to analyzer dialogs
 	std::map<PacketDecoder*, std::shared_ptr<ProtocolAnalyzerDialog> > m_protocolAnalyzerDialogs;
 
+	///@brief Merged timeline of all protocol analyzers
+	std::shared_ptr<PacketTimelineDialog> m_packetTimelineDialog;
+
 	///@brief Waveform groups
 	std::vector<std::shared_ptr<WaveformGroup> > m_waveformGroups;
 
@@ -608,6 +619,9 @@ protected:
 
 	TextureManager m_texmgr;
 
+	///@brief Textures and buffers for drawing waveforms, reused across resizes
+	WaveformResourcePool m_waveformPool;
+
 	/**
 		@brief True if a resize or other event this frame requires we re-rasterize waveforms
 
@@ -638,15 +652,24 @@ public:
 		return std::pair<ImFont*, float>(m_fontmgr.GetFont(desc), desc.second);
 	}
 
+	FontWithSize GetFontPref(PreferenceHandle<FontDescription>& pref)
+	{
+		auto& desc = pref.Get();
+		return std::pair<ImFont*, float>(m_fontmgr.GetFont(desc), desc.second);
+	}
+
 	ImU32 GetColorPref(const std::string& name)
 	{ return m_session.GetPreferences().GetColor(name); }
 
-	ImTextureID GetTexture(const std::string& name)
-	{ return m_texmgr.GetTexture(name); }
+	const TextureRegion& GetImage(const std::string& name)
+	{ return m_texmgr.GetImage(name); }
 
 	TextureManager* GetTextureManager()
 	{ return &m_texmgr; }
 
+	WaveformResourcePool& GetWaveformResourcePool()
+	{ return m_waveformPool; }
+
 	std::string GetIconForFilter(Filter* f);
 
 	std::string GetIconForWaveformShape(FunctionGenerator::WaveShape shape);
@@ -656,6 +679,9 @@ public:
 protected:
 	FontManager m_fontmgr;
 
+	///@brief Preference generation the fonts were last updated at
+	uint64_t m_fontGeneration;
+
 	///@brief Map of filter types to class names
 	std::map<std::type_index, std::string> m_filterIconMap;
 
@@ -680,6 +706,9 @@ protected:
 protected:
 	int64_t m_toneMapTime;
 
+	///@brief Time at which to write the pipeline cache to disk, or zero if there's nothing new to save
+	double m_pipelineCacheSaveTime;
+
 public:
 	int64_t GetToneMapTime()
 	{ return m_toneMapTime; }
@@ -847,6 +847,7 @@ void MainWindow::LoadToolbarIcons()
 	prefix += to_string(iconSize) + "x" + to_string(iconSize) + "/";
 
 	//Load the icons
+	m_texmgr.BeginLoadBatch();
 	m_texmgr.LoadTexture("clear-sweeps", FindDataFile(prefix + "clear-sweeps.png"));
 	m_texmgr.LoadTexture("fullscreen-enter", FindDataFile(prefix + "fullscreen-enter.png"));
 	m_texmgr.LoadTexture("fullscreen-exit", FindDataFile(prefix + "fullscreen-exit.png"));
@@ -857,4 +858,5 @@ void MainWindow::LoadToolbarIcons()
 	m_texmgr.LoadTexture("trigger-auto", FindDataFile(prefix + "trigger-auto.png"));
 	m_texmgr.LoadTexture("trigger-start", FindDataFile(prefix + "trigger-start.png"));
 	m_texmgr.LoadTexture("trigger-stop", FindDataFile(prefix + "trigger-stop.png"));
+	m_texmgr.EndLoadBatch();
 }
@@ -696,6 +696,20 @@ void MainWindow::WindowAnalyzerMenu()
 				ImGui::EndDisabled();
 		}
 
+		ImGui::Separator();
+
+		//Merged view of all decoders
+		bool hasTimeline = (m_packetTimelineDialog != nullptr);
+		if(hasTimeline)
+			ImGui::BeginDisabled();
+		if(ImGui::MenuItem("Merged Timeline"))
+		{
+			m_packetTimelineDialog = make_shared<PacketTimelineDialog>(&m_session, this);
+			AddDialog(m_packetTimelineDialog);
+		}
+		if(hasTimeline)
+			ImGui::EndDisabled();
+
 		ImGui::EndMenu();
 	}
 
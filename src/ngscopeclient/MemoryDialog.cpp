@@ -95,6 +95,8 @@ bool MemoryDialog::DoRender()
 
 	//TODO: summary of how many objects and how big
 
+	DoPacketTable();
+
 	if(ImGui::BeginTable("table", 10, flags))
 	{
 		Unit bytes(Unit::UNIT_BYTES);
@@ -227,5 +229,95 @@ bool MemoryDialog::DoRender()
 	return true;
 }
 
+/**
+	@brief Shows how much memory and disk the protocol analyzer packet history is using, per decoder
+ */
+void MemoryDialog::DoPacketTable()
+{
+	auto mgrs = m_session->GetPacketManagers();
+	if(mgrs.empty())
+		return;
+
+	if(!ImGui::CollapsingHeader("Protocol Analyzer Packets", ImGuiTreeNodeFlags_DefaultOpen))
+		return;
+
+	static ImGuiTableFlags flags =
+		ImGuiTableFlags_Resizable |
+		ImGuiTableFlags_BordersOuter |
+		ImGuiTableFlags_BordersV |
+		ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_SizingFixedFit;
+
+	float width = ImGui::GetFontSize();
+	if(ImGui::BeginTable("packets", 6, flags))
+	{
+		Unit bytes(Unit::UNIT_BYTES);
+
+		ImGui::TableSetupColumn("Decoder", ImGuiTableColumnFlags_WidthStretch, 0.0f);
+		ImGui::TableSetupColumn("Waveforms in memory", ImGuiTableColumnFlags_WidthFixed, 10*width);
+		ImGui::TableSetupColumn("Memory", ImGuiTableColumnFlags_WidthFixed, 7*width);
+		ImGui::TableSetupColumn("Waveforms on disk", ImGuiTableColumnFlags_WidthFixed, 10*width);
+		ImGui::TableSetupColumn("Disk", ImGuiTableColumnFlags_WidthFixed, 7*width);
+		ImGui::TableSetupColumn("Waveforms discarded", ImGuiTableColumnFlags_WidthFixed, 10*width);
+		ImGui::TableHeadersRow();
+
+		auto font = m_parent->GetFontPref("Appearance.General.console_font");
+		ImGui::PushFont(font.first, font.second);
+
+		size_t totalMemory = 0;
+		uint64_t totalDisk = 0;
+		for(auto& it : mgrs)
+		{
+			auto mgr = it.second;
+			auto memory = mgr->GetMemoryUsage();
+			auto disk = mgr->GetSpilledSize();
+			totalMemory += memory;
+			totalDisk += disk;
+
+			ImGui::PushID(it.first);
+			ImGui::TableNextRow(ImGuiTableRowFlags_None);
+
+			ImGui::TableSetColumnIndex(0);
+			ImGui::TextUnformatted(it.first->GetDisplayName().c_str());
+
+			ImGui::TableSetColumnIndex(1);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%zu", mgr->GetResidentCount());
+
+			ImGui::TableSetColumnIndex(2);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%s", bytes.PrettyPrintTabular(memory, 5, 3).c_str());
+
+			ImGui::TableSetColumnIndex(3);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%zu", mgr->GetSpilledCount());
+
+			ImGui::TableSetColumnIndex(4);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%s", bytes.PrettyPrintTabular(disk, 5, 3).c_str());
+
+			ImGui::TableSetColumnIndex(5);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%zu", mgr->GetDiscardedCount());
+
+			ImGui::PopID();
+		}
+
+		//Totals, if there's more than one decoder
+		if(mgrs.size() > 1)
+		{
+			ImGui::TableNextRow(ImGuiTableRowFlags_None);
+
+			ImGui::TableSetColumnIndex(0);
+			ImGui::TextUnformatted("Total");
+
+			ImGui::TableSetColumnIndex(2);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%s", bytes.PrettyPrintTabular(totalMemory, 5, 3).c_str());
+
+			ImGui::TableSetColumnIndex(4);
+			ImGui::TextAligned(1.0, -FLT_MIN, "%s", bytes.PrettyPrintTabular(totalDisk, 5, 3).c_str());
+		}
+
+		ImGui::PopFont();
+
+		ImGui::EndTable();
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // UI event handlers
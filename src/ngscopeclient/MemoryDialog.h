@@ -46,6 +46,7 @@ public:
 	virtual bool DoRender();
 
 protected:
+	void DoPacketTable();
 
 	AcceleratorBufferBase* m_selection;
 };
@@ -74,6 +74,7 @@ bool MetricsDialog::DoRender()
 	Unit counts(Unit::UNIT_COUNTS);
 	Unit fs(Unit::UNIT_FS);
 	Unit hz(Unit::UNIT_HZ);
+	Unit pct(Unit::UNIT_PERCENT);
 
 	string str;
 
@@ -113,6 +114,18 @@ bool MetricsDialog::DoRender()
 			"necessarily execute every frame. It runs asynchronously and is not locked to the display framerate."
 			);
 
+		ImGui::BeginDisabled();
+			str = counts.PrettyPrint(m_session->GetLastWaveformRenderPartitions());
+			ImGui::SetNextItemWidth(width);
+			ImGui::InputText("Rasterize queues", &str);
+		ImGui::EndDisabled();
+
+		HelpMarker(
+			"Number of command buffers the most recent waveform rasterization was split across.\n\n"
+			"Waveform groups that don't share any waveforms are rasterized concurrently by separate threads, up to "
+			"the limit set in Preferences | Miscellaneous | Rendering."
+			);
+
 		ImGui::BeginDisabled();
 			str = fs.PrettyPrint(m_session->GetToneMapTime());
 			ImGui::SetNextItemWidth(width);
@@ -211,6 +224,58 @@ bool MetricsDialog::DoRender()
 					"up with the instrument."
 					);
 
+				auto state = m_session->GetInstrumentConnectionState(s);
+				if(state)
+				{
+					auto& sched = state->m_pollScheduler;
+
+					ImGui::BeginDisabled();
+						str = hz.PrettyPrint(sched.GetPollRate());
+						ImGui::SetNextItemWidth(width);
+						ImGui::InputText("Trigger poll rate", &str);
+					ImGui::EndDisabled();
+
+					HelpMarker(
+						"Rate at which the instrument's trigger status is being polled.\n\n"
+						"Polling is slowed down between expected triggers to save link bandwidth, and runs at the full "
+						"rate only near the time the next trigger is expected or if polls don't generate any link traffic."
+						);
+
+					ImGui::BeginDisabled();
+						if(sched.IsFastPolling())
+							str = "Local";
+						else
+							str = pct.PrettyPrint(sched.GetPollLinkUtilization());
+						ImGui::SetNextItemWidth(width);
+						ImGui::InputText("Poll link usage", &str);
+					ImGui::EndDisabled();
+
+					HelpMarker(
+						"Fraction of time the instrument connection is busy answering trigger polls, and thus not "
+						"available for waveform download or other commands.\n\n"
+						"Shows \"Local\" if the driver answers trigger polls without any link traffic."
+						);
+
+					ImGui::BeginDisabled();
+						str = fs.PrettyPrint(sched.GetPollLatency() * FS_PER_SECOND);
+						ImGui::SetNextItemWidth(width);
+						ImGui::InputText("Poll latency", &str);
+					ImGui::EndDisabled();
+
+					HelpMarker("Average round trip time of a single trigger poll.");
+
+					ImGui::BeginDisabled();
+						str = fs.PrettyPrint(sched.GetExpectedTriggerInterval() * FS_PER_SECOND);
+						ImGui::SetNextItemWidth(width);
+						ImGui::InputText("Trigger interval", &str);
+					ImGui::EndDisabled();
+
+					HelpMarker(
+						"Learned average time from arming the trigger to the instrument triggering.\n\n"
+						"This is used to decide when to poll the trigger at the full rate."
+						);
+				}
+
 				ImGui::TreePop();
 			}
 		}
@@ -329,7 +394,6 @@ bool MetricsDialog::DoRender()
 	if(ImGui::CollapsingHeader("Memory"))
 	{
 		Unit bytes(Unit::UNIT_BYTES);
-		Unit pct(Unit::UNIT_PERCENT);
 
 		//Only show this section if available
 		if(g_hasMemoryBudget)
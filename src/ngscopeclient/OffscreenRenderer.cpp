@@ -0,0 +1,799 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of OffscreenRenderer
+ */
+#include "ngscopeclient.h"
+#include "OffscreenRenderer.h"
+#include "HistoryManager.h"
+#include "Session.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+OffscreenRenderer::OffscreenRenderer(Session& session)
+	: m_session(session)
+	, m_queue(g_vkQueueManager->GetComputeQueue("OffscreenRenderer.queue"))
+	, m_traceAlpha(0.75)
+	, m_imageMemorySize(0)
+	, m_imageMemoryType(0)
+	, m_batchPixels(0)
+	, m_batchUsesSession(false)
+{
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->GetQueue()->m_family );
+	m_cmdPool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_cmdPool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Same settings as the TextureManager sampler used by the on-screen view
+	vk::SamplerCreateInfo sinfo(
+		{},
+		vk::Filter::eLinear,
+		vk::Filter::eLinear,
+		vk::SamplerMipmapMode::eLinear,
+		vk::SamplerAddressMode::eRepeat,
+		vk::SamplerAddressMode::eRepeat,
+		vk::SamplerAddressMode::eRepeat,
+		{},
+		{},
+		1.0,
+		{},
+		vk::CompareOp::eNever,
+		-1000,
+		1000
+	);
+	m_sampler = make_unique<vk::raii::Sampler>(*g_vkComputeDevice, sinfo);
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+}
+
+OffscreenRenderer::Layer::Layer(
+	shared_ptr<WaveformArea> area,
+	shared_ptr<DisplayedChannel> channel,
+	WaveformBase* data)
+	: m_area(area)
+	, m_channel(channel)
+	, m_data(data)
+	, m_top(0)
+	, m_height(0)
+	, m_yscale(1)
+	, m_rasterized("OffscreenRenderer.m_rasterized")
+	, m_indexBuffer("OffscreenRenderer.m_indexBuffer")
+	, m_readback("OffscreenRenderer.m_readback")
+{
+	m_rasterized.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_rasterized.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	m_indexBuffer.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_indexBuffer.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+
+	m_readback.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_readback.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Command line export
+
+/**
+	@brief Loads a session offline and writes every waveform group, at every point in history, to PNG files
+
+	No MainWindow is created. The session is loaded into a bare Session, which builds its waveform groups from the saved
+	UI configuration, and they're drawn by an OffscreenRenderer only. Vulkan must already be initialized, but it can be
+	headless.
+
+	Files are named after the group title and the index of the history point, e.g. "Waveform Group 1_00003.png".
+
+	@param sessionPath	Path to the .scopesession file
+	@param dir			Directory to write images to
+	@param width		Width of each image, in pixels
+	@param height		Height of each image, in pixels
+
+	@return True if every image was written successfully
+ */
+bool OffscreenRenderer::ExportHistory(const string& sessionPath, const string& dir, uint32_t width, uint32_t height)
+{
+	//Get the data directory for the session
+	string base = sessionPath.substr(0, sessionPath.length() - strlen(".scopesession"));
+	string datadir = base + "_data";
+
+	LogDebug("Exporting session file \"%s\" (data directory %s)\n", sessionPath.c_str(), datadir.c_str());
+
+	Session session(nullptr);
+	float traceAlpha = 0.75;
+	try
+	{
+		auto docs = YAML::LoadAllFromFile(sessionPath);
+		if(docs.size() != 1)
+		{
+			LogError("Could not load the file \"%s\": expected one YAML document and found %zu\n",
+				sessionPath.c_str(), docs.size());
+			return false;
+		}
+
+		auto& node = docs[0];
+		if(!session.PreLoadFromYaml(node, datadir, false) || !session.LoadFromYaml(node, datadir, false))
+		{
+			LogError("Failed to load session \"%s\", nothing to export\n", sessionPath.c_str());
+			return false;
+		}
+
+		//Draw with the same intensity the session was saved with
+		auto window = node["ui_config"]["window"];
+		if(window && window["traceAlpha"])
+			traceAlpha = window["traceAlpha"].as<float>();
+	}
+	catch(const YAML::Exception& ex)
+	{
+		LogError("Could not load the file \"%s\": %s\n", sessionPath.c_str(), ex.what());
+		return false;
+	}
+
+	//Walk history in the outer loop, so filters only have to be refreshed once per point
+	auto& groups = session.GetHeadlessWaveformGroups();
+	OffscreenRenderer renderer(session);
+	renderer.SetTraceAlpha(traceAlpha);
+	size_t nimages = 0;
+	size_t i = 0;
+	for(auto& point : session.GetHistory().m_history)
+	{
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), "_%05zu.png", i);
+		i++;
+
+		for(auto& group : groups)
+		{
+			//Group titles are user supplied, don't let them escape the output directory
+			string name = group->GetTitle();
+			for(auto& c : name)
+			{
+				if( (c == '/') || (c == '\\') || (c == ':') )
+					c = '_';
+			}
+
+			renderer.Add(OffscreenRenderRequest(group, width, height, point->m_time, dir + "/" + name + suffix));
+			nimages ++;
+		}
+	}
+
+	size_t nwritten = renderer.Render();
+	LogNotice("Exported %zu of %zu images to %s\n", nwritten, nimages, dir.c_str());
+	return (nwritten == nimages);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rendering
+
+/**
+	@brief Draws every image added since the last call
+
+	@return Number of images successfully written
+ */
+size_t OffscreenRenderer::Render()
+{
+	double tstart = GetTime();
+	size_t nwritten = 0;
+
+	auto& history = m_session.GetHistory();
+	for(auto& request : m_requests)
+	{
+		auto point = history.GetHistory(request.m_point);
+		if(!point)
+		{
+			LogWarning("No history at %s, not writing %s\n",
+				request.m_point.PrettyPrint().c_str(), request.m_path.c_str());
+			continue;
+		}
+
+		//Filter outputs only exist for the point currently loaded into the session, and are overwritten as soon as
+		//another one is loaded. Anything already recorded against them has to be submitted before that happens.
+		bool usesFilters = UsesFilters(request.m_group);
+		if(usesFilters && (point != m_loadedPoint))
+		{
+			if(m_batchUsesSession)
+				nwritten += Submit();
+
+			{
+				lock_guard<shared_mutex> lock(m_session.GetWaveformDataMutex());
+				point->LoadHistoryToSession(m_session);
+			}
+			m_session.RefreshAllFilters();
+
+			m_loadedPoint = point;
+		}
+
+		unique_ptr<Image> image;
+		{
+			shared_lock<shared_mutex> lock(m_session.GetWaveformDataMutex());
+			image = PrepareImage(request, *point);
+		}
+		if(!image)
+			continue;
+
+		//Without push descriptors, each pipeline has a single descriptor set which is overwritten every time it's
+		//bound. A channel's pipelines can't be recorded twice into the same command buffer, so if this image draws a
+		//channel that's already in the batch, run the batch first.
+		if(!g_hasPushDescriptor)
+		{
+			bool reused = false;
+			for(auto& layer : image->m_layers)
+			{
+				if(m_batchChannels.find(layer->m_channel.get()) != m_batchChannels.end())
+					reused = true;
+			}
+			if(reused)
+				nwritten += Submit();
+		}
+
+		for(auto& layer : image->m_layers)
+		{
+			m_batchPixels += layer->m_rasterized.size();
+			m_batchChannels.emplace(layer->m_channel.get());
+		}
+		m_batch.push_back(std::move(image));
+		if(usesFilters)
+			m_batchUsesSession = true;
+
+		if( (m_batch.size() >= MAX_BATCH_SIZE) || (m_batchPixels >= MAX_BATCH_PIXELS) )
+			nwritten += Submit();
+	}
+	nwritten += Submit();
+
+	LogDebug("Wrote %zu of %zu offscreen images in %.2f ms\n",
+		nwritten, m_requests.size(), (GetTime() - tstart) * 1000);
+
+	m_requests.clear();
+	return nwritten;
+}
+
+/**
+	@brief Checks if any of the analog or digital streams in a group come from filters rather than instruments
+ */
+bool OffscreenRenderer::UsesFilters(shared_ptr<WaveformGroup> group)
+{
+	for(auto& area : group->GetWaveformAreas())
+	{
+		for(size_t i=0; i<area->GetStreamCount(); i++)
+		{
+			auto stream = area->GetStream(i);
+			auto type = stream.GetType();
+			bool drawn = (type == Stream::STREAM_TYPE_ANALOG) || (type == Stream::STREAM_TYPE_DIGITAL);
+			if(drawn && dynamic_cast<Filter*>(stream.m_channel))
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+	@brief Gets the waveform a stream had at a given point in history
+
+	Instrument channels come straight from the history, so they don't need to be loaded into the session.
+	Filter outputs aren't kept in history, so for those we use whatever the filter currently has.
+ */
+WaveformBase* OffscreenRenderer::GetData(HistoryPoint& point, StreamDescriptor stream)
+{
+	if(dynamic_cast<Filter*>(stream.m_channel))
+		return stream.GetData();
+
+	for(auto& it : point.m_history)
+	{
+		auto jt = it.second.find(stream);
+		if(jt != it.second.end())
+			return jt->second;
+	}
+	return nullptr;
+}
+
+/**
+	@brief Sets up buffers and scales for a single image
+
+	Must be called with the waveform data mutex held.
+
+	@return The image, or null if there's nothing to draw
+ */
+unique_ptr<OffscreenRenderer::Image> OffscreenRenderer::PrepareImage(
+	const OffscreenRenderRequest& request,
+	HistoryPoint& point)
+{
+	if( (request.m_width == 0) || (request.m_height == 0) )
+		return nullptr;
+
+	auto areas = request.m_group->GetWaveformAreas();
+	if(areas.empty())
+		return nullptr;
+
+	auto image = make_unique<Image>(request);
+
+	//Split the image evenly between the areas, top to bottom, same as on screen
+	uint32_t areaHeight = request.m_height / areas.size();
+	int64_t start = INT64_MAX;
+	int64_t end = INT64_MIN;
+	for(size_t i=0; i<areas.size(); i++)
+	{
+		auto area = areas[i];
+		uint32_t top = i * areaHeight;
+		uint32_t height = (i+1 == areas.size()) ? (request.m_height - top) : areaHeight;
+		if(height == 0)
+			continue;
+
+		//Y axis scale comes from the first analog stream in the area
+		auto first = area->GetFirstAnalogStream();
+		float yscale = first ? (height / first.GetVoltageRange()) : 1;
+
+		//Digital channels get a strip each, stacked down from the top in the same order as their buttons on screen
+		uint32_t digitalHeight = min(height, DIGITAL_TRACE_HEIGHT);
+		uint32_t digitalTop = top;
+
+		for(size_t j=0; j<area->GetStreamCount(); j++)
+		{
+			auto chan = area->GetDisplayedChannel(j);
+			auto type = chan->GetStream().GetType();
+			if( (type != Stream::STREAM_TYPE_ANALOG) && (type != Stream::STREAM_TYPE_DIGITAL) )
+				continue;
+
+			//Out of room for more strips
+			bool digital = (type == Stream::STREAM_TYPE_DIGITAL);
+			if(digital && (digitalTop + digitalHeight > top + height) )
+				continue;
+
+			auto data = GetData(point, chan->GetStream());
+			if( (data == nullptr) || data->empty() )
+				continue;
+
+			auto layer = make_unique<Layer>(area, chan, data);
+			if(digital)
+			{
+				layer->m_top = digitalTop;
+				layer->m_height = digitalHeight;
+				digitalTop += digitalHeight;
+			}
+			else
+			{
+				layer->m_top = top;
+				layer->m_height = height;
+				layer->m_yscale = yscale;
+			}
+			AllocateLayer(*layer, request.m_width);
+
+			//Keep track of how much time the waveforms cover, for autofitting
+			auto sdata = dynamic_cast<SparseWaveformBase*>(data);
+			auto udata = dynamic_cast<UniformWaveformBase*>(data);
+			if(sdata)
+			{
+				sdata->m_offsets.PrepareForCpuAccessFirstAndLastOnly();
+				sdata->m_durations.PrepareForCpuAccessFirstAndLastOnly();
+			}
+			auto last = data->size() - 1;
+			start = min(start, GetOffsetScaled(sdata, udata, 0));
+			end = max(end, GetOffsetScaled(sdata, udata, last) + GetDurationScaled(sdata, udata, last));
+
+			image->m_layers.push_back(std::move(layer));
+		}
+	}
+
+	if(request.m_autofit && (end > start))
+	{
+		image->m_xAxisOffset = start;
+		image->m_pixelsPerXUnit = static_cast<double>(request.m_width) / (end - start);
+	}
+	else
+	{
+		image->m_xAxisOffset = request.m_group->GetXAxisOffset();
+		image->m_pixelsPerXUnit = request.m_group->GetPixelsPerXUnit();
+	}
+
+	return image;
+}
+
+/**
+	@brief Allocates the intermediate buffers and output image for one layer
+
+	Memory for the image isn't allocated until the whole batch is known, see BindBatchMemory().
+ */
+void OffscreenRenderer::AllocateLayer(Layer& layer, uint32_t width)
+{
+	size_t npixels = static_cast<size_t>(width) * layer.m_height;
+
+	layer.m_rasterized.resize(npixels);
+	layer.m_rasterized.PrepareForCpuAccess();
+	memset(layer.m_rasterized.GetCpuPointer(), 0, npixels * sizeof(float));
+	layer.m_rasterized.MarkModifiedFromCpu();
+
+	if(dynamic_cast<SparseWaveformBase*>(layer.m_data))
+		layer.m_indexBuffer.resize(width);
+
+	layer.m_readback.resize(npixels * 4);
+
+	//Same format as the on-screen textures, but we copy out of it rather than sampling it
+	vk::ImageCreateInfo imageInfo(
+		{},
+		vk::ImageType::e2D,
+		vk::Format::eR32G32B32A32Sfloat,
+		vk::Extent3D(width, layer.m_height, 1),
+		1,
+		1,
+		VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
+		VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc,
+		vk::SharingMode::eExclusive,
+		{},
+		vk::ImageLayout::eUndefined
+		);
+	layer.m_image = make_unique<vk::raii::Image>(*g_vkComputeDevice, imageInfo);
+}
+
+/**
+	@brief Binds the output images of every layer in the batch to one block of device local memory
+
+	The images are packed back to back into m_imageMemory, which is only reallocated when it's too small for the
+	batch. Views can't be created until the memory is bound, so they're made here too.
+
+	@return True on success, false if no suitable memory type exists
+ */
+bool OffscreenRenderer::BindBatchMemory()
+{
+	//Lay the images out one after another, each aligned as it requires
+	vector<vk::DeviceSize> offsets;
+	vk::DeviceSize size = 0;
+	uint32_t typeBits = 0xffffffff;
+	for(auto& image : m_batch)
+	{
+		for(auto& layer : image->m_layers)
+		{
+			auto req = layer->m_image->getMemoryRequirements();
+			size = (size + req.alignment - 1) / req.alignment * req.alignment;
+			offsets.push_back(size);
+			size += req.size;
+			typeBits &= req.memoryTypeBits;
+		}
+	}
+	if(offsets.empty())
+		return true;
+
+	//Reuse the block from the last batch if it's big enough and of a type every image accepts
+	if(!m_imageMemory || (m_imageMemorySize < size) || !(typeBits & (1 << m_imageMemoryType)) )
+	{
+		m_imageMemory = nullptr;
+		m_imageMemorySize = 0;
+
+		auto memProperties = g_vkComputePhysicalDevice->getMemoryProperties();
+		uint32_t memType = memProperties.memoryTypeCount;
+		for(uint32_t i=0; i<memProperties.memoryTypeCount; i++)
+		{
+			if(!(memProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+				continue;
+			if(typeBits & (1 << i) )
+			{
+				memType = i;
+				break;
+			}
+		}
+		if(memType == memProperties.memoryTypeCount)
+		{
+			LogError("No device local memory type is usable for offscreen images (allowed types: 0x%x)\n", typeBits);
+			return false;
+		}
+
+		vk::MemoryAllocateInfo info(size, memType);
+		m_imageMemory = make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, info);
+		m_imageMemorySize = size;
+		m_imageMemoryType = memType;
+	}
+
+	size_t i = 0;
+	for(auto& image : m_batch)
+	{
+		for(auto& layer : image->m_layers)
+		{
+			layer->m_image->bindMemory(**m_imageMemory, offsets[i]);
+			i++;
+
+			vk::ImageViewCreateInfo vinfo(
+				{},
+				**layer->m_image,
+				vk::ImageViewType::e2D,
+				vk::Format::eR32G32B32A32Sfloat,
+				{},
+				vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+				);
+			layer->m_view = make_unique<vk::raii::ImageView>(*g_vkComputeDevice, vinfo);
+		}
+	}
+
+	return true;
+}
+
+/**
+	@brief Records the rasterization, tone mapping, and readback commands for one image into m_cmdBuf
+ */
+void OffscreenRenderer::RecordImage(Image& image)
+{
+	if(image.m_layers.empty())
+		return;
+
+	auto& cmdbuf = *m_cmdBuf;
+	uint32_t width = image.m_request.m_width;
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+	//Move the output images to the general layout so the tone mapping shader can write them
+	vector<vk::ImageMemoryBarrier> barriers;
+	for(auto& layer : image.m_layers)
+	{
+		barriers.push_back(vk::ImageMemoryBarrier(
+			vk::AccessFlagBits::eNone,
+			vk::AccessFlagBits::eShaderWrite,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eGeneral,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			**layer->m_image,
+			range));
+	}
+	cmdbuf.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe,
+		vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		{},
+		{},
+		barriers);
+
+	//Draw each channel with the same shaders as the on-screen view
+	for(auto& layer : image.m_layers)
+	{
+		WaveformRasterTarget target(
+			layer->m_rasterized,
+			layer->m_indexBuffer,
+			layer->m_indexCache,
+			layer->m_rebasedOffsets);
+		target.m_width = width;
+		target.m_height = layer->m_height;
+		target.m_xAxisOffset = image.m_xAxisOffset;
+		target.m_pixelsPerXUnit = image.m_pixelsPerXUnit;
+		target.m_pixelsPerYAxisUnit = layer->m_yscale;
+		target.m_digitalHeight = layer->m_height;
+		target.m_alpha = m_traceAlpha;
+
+		layer->m_area->RasterizeAnalogOrDigitalWaveform(layer->m_channel, layer->m_data, target, cmdbuf);
+		layer->m_area->ToneMapAnalogOrDigitalWaveform(
+			layer->m_channel,
+			layer->m_rasterized,
+			**m_sampler,
+			**layer->m_view,
+			width,
+			layer->m_height,
+			cmdbuf);
+	}
+
+	//Copy the tone mapped images somewhere we can read them back
+	barriers.clear();
+	for(auto& layer : image.m_layers)
+	{
+		barriers.push_back(vk::ImageMemoryBarrier(
+			vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eTransferRead,
+			vk::ImageLayout::eGeneral,
+			vk::ImageLayout::eGeneral,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			**layer->m_image,
+			range));
+	}
+	cmdbuf.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eTransfer,
+		{},
+		{},
+		{},
+		barriers);
+
+	for(auto& layer : image.m_layers)
+	{
+		vk::BufferImageCopy region(
+			0,
+			0,
+			0,
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(width, layer->m_height, 1));
+		cmdbuf.copyImageToBuffer(**layer->m_image, vk::ImageLayout::eGeneral, layer->m_readback.GetBuffer(), region);
+		layer->m_readback.MarkModifiedFromGpu();
+	}
+}
+
+/**
+	@brief Records every image in the batch into one command buffer, runs it, and writes out the results
+
+	@return Number of images successfully written
+ */
+size_t OffscreenRenderer::Submit()
+{
+	if(m_batch.empty())
+		return 0;
+
+	if(!BindBatchMemory())
+	{
+		LogError("Not writing %zu offscreen images\n", m_batch.size());
+		ClearBatch();
+		return 0;
+	}
+
+	{
+		//Must lock mutexes in this order to avoid deadlock
+		shared_lock<shared_mutex> lock1(m_session.GetWaveformDataMutex());
+		shared_lock<shared_mutex> lock2(g_vulkanActivityMutex);
+		lock_guard<mutex> lock3(m_session.GetRasterizedWaveformMutex());
+
+		m_cmdBuf->begin({});
+		for(auto& image : m_batch)
+			RecordImage(*image);
+		m_cmdBuf->end();
+		m_queue->SubmitAndBlock(*m_cmdBuf);
+	}
+
+	for(auto& image : m_batch)
+	{
+		for(auto& layer : image->m_layers)
+			layer->m_readback.PrepareForCpuAccess();
+	}
+
+	//Compositing and compression are independent for each image
+	size_t nwritten = 0;
+	#pragma omp parallel for reduction(+:nwritten)
+	for(size_t i=0; i<m_batch.size(); i++)
+	{
+		auto& image = *m_batch[i];
+
+		vector<uint8_t> rgb;
+		Composite(image, rgb);
+		if(WritePNG(image.m_request.m_path, image.m_request.m_width, image.m_request.m_height, rgb))
+			nwritten ++;
+	}
+
+	ClearBatch();
+	return nwritten;
+}
+
+/**
+	@brief Discards every image in the batch
+ */
+void OffscreenRenderer::ClearBatch()
+{
+	m_batch.clear();
+	m_batchChannels.clear();
+	m_batchPixels = 0;
+	m_batchUsesSession = false;
+}
+
+/**
+	@brief Blends the tone mapped channels of an image together over a black background
+
+	@param image	The image
+	@param rgb		8-bit RGB output, top row first
+ */
+void OffscreenRenderer::Composite(Image& image, vector<uint8_t>& rgb)
+{
+	uint32_t width = image.m_request.m_width;
+	uint32_t height = image.m_request.m_height;
+	vector<float> accum(static_cast<size_t>(width) * height * 3, 0.0f);
+
+	for(auto& layer : image.m_layers)
+	{
+		auto src = layer->m_readback.GetCpuPointer();
+		for(uint32_t y=0; y<layer->m_height; y++)
+		{
+			//Rasterized waveforms have the bottom row first
+			auto srow = src + static_cast<size_t>(layer->m_height - 1 - y) * width * 4;
+			auto drow = &accum[static_cast<size_t>(layer->m_top + y) * width * 3];
+			for(uint32_t x=0; x<width; x++)
+			{
+				float alpha = srow[x*4 + 3];
+				for(int c=0; c<3; c++)
+					drow[x*3 + c] = srow[x*4 + c]*alpha + drow[x*3 + c]*(1 - alpha);
+			}
+		}
+	}
+
+	rgb.resize(accum.size());
+	for(size_t i=0; i<accum.size(); i++)
+		rgb[i] = static_cast<uint8_t>(round(min(max(accum[i], 0.0f), 1.0f) * 255));
+}
+
+/**
+	@brief Writes an 8-bit RGB image to a PNG file
+
+	@return True on success
+ */
+bool OffscreenRenderer::WritePNG(const string& path, uint32_t width, uint32_t height, const vector<uint8_t>& rgb)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("Failed to open \"%s\" for writing\n", path.c_str());
+		return false;
+	}
+
+	auto png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if(!png)
+	{
+		LogError("Failed to create PNG write struct\n");
+		fclose(fp);
+		return false;
+	}
+	auto info = png_create_info_struct(png);
+	if(!info)
+	{
+		LogError("Failed to create PNG info struct\n");
+		png_destroy_write_struct(&png, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	vector<png_bytep> rows(height);
+	for(uint32_t y=0; y<height; y++)
+		rows[y] = const_cast<png_bytep>(&rgb[static_cast<size_t>(y) * width * 3]);
+
+	//libpng reports errors by longjmp'ing back here
+	if(setjmp(png_jmpbuf(png)))
+	{
+		LogError("Failed to write PNG file \"%s\"\n", path.c_str());
+		png_destroy_write_struct(&png, &info);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png, fp);
+	png_set_IHDR(
+		png,
+		info,
+		width,
+		height,
+		8,
+		PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT,
+		PNG_FILTER_TYPE_DEFAULT);
+	png_set_rows(png, info, rows.data());
+	png_write_png(png, info, PNG_TRANSFORM_IDENTITY, nullptr);
+
+	png_destroy_write_struct(&png, &info);
+	fclose(fp);
+	return true;
+}
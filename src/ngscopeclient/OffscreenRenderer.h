@@ -0,0 +1,251 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of OffscreenRenderer
+ */
+#ifndef OffscreenRenderer_h
+#define OffscreenRenderer_h
+
+#include "WaveformGroup.h"
+
+class HistoryPoint;
+
+/**
+	@brief A request to draw one WaveformGroup, as of one point in history, to an image file
+ */
+class OffscreenRenderRequest
+{
+public:
+	OffscreenRenderRequest(
+		std::shared_ptr<WaveformGroup> group,
+		uint32_t width,
+		uint32_t height,
+		TimePoint point,
+		const std::string& path,
+		bool autofit = true)
+		: m_group(group)
+		, m_width(width)
+		, m_height(height)
+		, m_point(point)
+		, m_path(path)
+		, m_autofit(autofit)
+	{}
+
+	///@brief The group whose layout (areas and channels) we're drawing
+	std::shared_ptr<WaveformGroup> m_group;
+
+	///@brief Size of the output image, in pixels
+	uint32_t m_width;
+	uint32_t m_height;
+
+	///@brief Timestamp of the history point to draw
+	TimePoint m_point;
+
+	///@brief Path of the PNG file to write
+	std::string m_path;
+
+	///@brief True to scale the X axis to fit the waveforms, false to use the group's current view
+	bool m_autofit;
+};
+
+/**
+	@brief Draws WaveformGroups to PNG files without going through the interactive window
+
+	Uses the same rasterization and tone mapping shaders as the on-screen view, but into buffers and images owned by
+	the renderer. Up to MAX_BATCH_SIZE images are recorded into a single command buffer and submitted together, with
+	all of their output images suballocated from one block of device memory.
+
+	Doesn't need a MainWindow (or a display), so it can run from the command line with Vulkan initialized headless.
+
+	Only analog and digital waveforms are drawn. Grid, axes, and overlays are not.
+ */
+class OffscreenRenderer
+{
+public:
+	OffscreenRenderer(Session& session);
+	~OffscreenRenderer();
+
+	void Add(const OffscreenRenderRequest& request)
+	{ m_requests.push_back(request); }
+
+	///@brief Sets the intensity of a single sample, same as the slider in the main window
+	void SetTraceAlpha(float alpha)
+	{ m_traceAlpha = alpha; }
+
+	size_t Render();
+
+	static bool ExportHistory(const std::string& sessionPath, const std::string& dir, uint32_t width, uint32_t height);
+
+	///@brief Maximum number of images recorded into one command buffer
+	static const size_t MAX_BATCH_SIZE = 32;
+
+	///@brief Maximum number of channel-pixels in one batch, to bound the memory used by intermediate buffers
+	static const size_t MAX_BATCH_PIXELS = 16 * 1024 * 1024;
+
+	///@brief Height of the strip each digital channel is drawn in, in pixels
+	static const uint32_t DIGITAL_TRACE_HEIGHT = 24;
+
+protected:
+
+	/**
+		@brief A single channel within an image being rendered
+	 */
+	class Layer
+	{
+	public:
+		Layer(std::shared_ptr<WaveformArea> area, std::shared_ptr<DisplayedChannel> channel, WaveformBase* data);
+
+		///@brief The area the channel is displayed in
+		std::shared_ptr<WaveformArea> m_area;
+
+		///@brief The channel being drawn
+		std::shared_ptr<DisplayedChannel> m_channel;
+
+		///@brief The waveform being drawn
+		WaveformBase* m_data;
+
+		///@brief Position of the top of this layer within the image
+		uint32_t m_top;
+
+		///@brief Height of this layer
+		uint32_t m_height;
+
+		///@brief Y axis scale
+		float m_yscale;
+
+		///@brief Rasterized fp32 waveform
+		AcceleratorBuffer<float> m_rasterized;
+
+		///@brief X axis index buffer (sparse waveforms only)
+		AcceleratorBuffer<uint32_t> m_indexBuffer;
+
+		///@brief What m_indexBuffer was computed for
+		SparseIndexCache m_indexCache;
+
+		///@brief Rebased X positions (sparse waveforms without shaderInt64 only)
+		RebasedOffsets m_rebasedOffsets;
+
+		///@brief Tone mapped output, bound to a slice of OffscreenRenderer::m_imageMemory
+		std::unique_ptr<vk::raii::Image> m_image;
+
+		///@brief View of m_image
+		std::unique_ptr<vk::raii::ImageView> m_view;
+
+		///@brief RGBA fp32 copy of m_image, read back to the CPU
+		AcceleratorBuffer<float> m_readback;
+	};
+
+	/**
+		@brief A single image being rendered
+	 */
+	class Image
+	{
+	public:
+		Image(const OffscreenRenderRequest& request)
+			: m_request(request)
+			, m_xAxisOffset(0)
+			, m_pixelsPerXUnit(1)
+		{}
+
+		///@brief What we're drawing
+		OffscreenRenderRequest m_request;
+
+		///@brief X axis position of the left edge of the image
+		int64_t m_xAxisOffset;
+
+		///@brief X axis scale
+		double m_pixelsPerXUnit;
+
+		///@brief The channels to draw
+		std::vector<std::unique_ptr<Layer> > m_layers;
+	};
+
+	bool UsesFilters(std::shared_ptr<WaveformGroup> group);
+	WaveformBase* GetData(HistoryPoint& point, StreamDescriptor stream);
+	std::unique_ptr<Image> PrepareImage(const OffscreenRenderRequest& request, HistoryPoint& point);
+	void AllocateLayer(Layer& layer, uint32_t width);
+	bool BindBatchMemory();
+	void RecordImage(Image& image);
+	size_t Submit();
+	void ClearBatch();
+
+	static void Composite(Image& image, std::vector<uint8_t>& rgb);
+	static bool WritePNG(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgb);
+
+	///@brief The session we're drawing waveforms from
+	Session& m_session;
+
+	///@brief Queue for submitting rendering commands
+	std::shared_ptr<QueueHandle> m_queue;
+
+	///@brief Pool for allocating m_cmdBuf
+	std::unique_ptr<vk::raii::CommandPool> m_cmdPool;
+
+	///@brief Command buffer all images in a batch are recorded into
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	///@brief Sampler bound along with the output images by the tone mapping shader
+	std::unique_ptr<vk::raii::Sampler> m_sampler;
+
+	///@brief Intensity of a single sample
+	float m_traceAlpha;
+
+	///@brief Images waiting for Render()
+	std::vector<OffscreenRenderRequest> m_requests;
+
+	///@brief Device local memory the output images of a batch are suballocated from, kept between batches
+	std::unique_ptr<vk::raii::DeviceMemory> m_imageMemory;
+
+	///@brief Size of m_imageMemory, in bytes
+	vk::DeviceSize m_imageMemorySize;
+
+	///@brief Memory type index of m_imageMemory
+	uint32_t m_imageMemoryType;
+
+	///@brief Images recorded but not yet submitted
+	std::vector<std::unique_ptr<Image> > m_batch;
+
+	///@brief Total number of channel-pixels in m_batch
+	size_t m_batchPixels;
+
+	///@brief Channels drawn by m_batch
+	std::set<DisplayedChannel*> m_batchChannels;
+
+	///@brief True if m_batch draws filter outputs, which are overwritten when another history point is loaded
+	bool m_batchUsesSession;
+
+	///@brief The history point currently loaded into the session, if we loaded one
+	std::shared_ptr<HistoryPoint> m_loadedPoint;
+};
+
+#endif
@@ -0,0 +1,608 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketArena
+ */
+#include "../scopehal/scopehal.h"
+#include "PacketArena.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serialization helpers
+
+/**
+	@brief Appends raw values to a byte buffer
+
+	Serialized arenas are only ever read back by the same process, so values are stored in native byte order.
+ */
+class PacketArenaWriter
+{
+public:
+	PacketArenaWriter(vector<uint8_t>& buf)
+	: m_buf(buf)
+	{}
+
+	void Write(const void* data, size_t len)
+	{
+		auto p = static_cast<const uint8_t*>(data);
+		m_buf.insert(m_buf.end(), p, p + len);
+	}
+
+	template<class T>
+	void Write(T value)
+	{ Write(&value, sizeof(value)); }
+
+	template<class T>
+	void WriteVector(const vector<T>& v)
+	{
+		Write<uint64_t>(v.size());
+		Write(v.data(), v.size() * sizeof(T));
+	}
+
+	void WriteString(const string& str)
+	{
+		Write<uint64_t>(str.size());
+		Write(str.data(), str.size());
+	}
+
+protected:
+	vector<uint8_t>& m_buf;
+};
+
+/**
+	@brief Reads raw values back from a buffer created by PacketArenaWriter
+
+	Every read is bounds checked. Once a read fails, all further reads fail too, so callers only need to check
+	IsOK() at the end.
+ */
+class PacketArenaReader
+{
+public:
+	PacketArenaReader(const uint8_t* data, size_t len)
+	: m_data(data)
+	, m_len(len)
+	, m_pos(0)
+	, m_ok(true)
+	{}
+
+	bool IsOK() const
+	{ return m_ok; }
+
+	bool Read(void* data, size_t len)
+	{
+		if(!m_ok || (len > m_len - m_pos) )
+		{
+			m_ok = false;
+			return false;
+		}
+		memcpy(data, m_data + m_pos, len);
+		m_pos += len;
+		return true;
+	}
+
+	template<class T>
+	T Read()
+	{
+		T value = {};
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	template<class T>
+	void ReadVector(vector<T>& v)
+	{
+		auto count = Read<uint64_t>();
+		if(!m_ok || (count > (m_len - m_pos) / sizeof(T)) )
+		{
+			m_ok = false;
+			return;
+		}
+		v.resize(count);
+		Read(v.data(), count * sizeof(T));
+	}
+
+	string ReadString()
+	{
+		auto len = Read<uint64_t>();
+		if(!m_ok || (len > m_len - m_pos) )
+		{
+			m_ok = false;
+			return "";
+		}
+		string ret(reinterpret_cast<const char*>(m_data + m_pos), len);
+		m_pos += len;
+		return ret;
+	}
+
+protected:
+	const uint8_t* m_data;
+	size_t m_len;
+	size_t m_pos;
+	bool m_ok;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketStringPool
+
+PacketStringPool::PacketStringPool()
+{
+	//ID 0 is the empty "no value" string
+	m_text.push_back('\0');
+	m_starts.push_back(0);
+	m_starts.push_back(1);
+}
+
+/**
+	@brief Adds a string to the pool, if not already present
+
+	@return ID of the string
+ */
+uint32_t PacketStringPool::Intern(const string& str)
+{
+	auto it = m_lookup.find(str);
+	if(it != m_lookup.end())
+		return it->second;
+
+	uint32_t id = m_starts.size() - 1;
+	m_text.insert(m_text.end(), str.begin(), str.end());
+	m_text.push_back('\0');
+	m_starts.push_back(m_text.size());
+	m_lookup[str] = id;
+	return id;
+}
+
+/**
+	@brief Frees the lookup table once no more strings are going to be added
+ */
+void PacketStringPool::Seal()
+{
+	m_lookup = unordered_map<string, uint32_t>();
+	m_text.shrink_to_fit();
+	m_starts.shrink_to_fit();
+}
+
+/**
+	@brief Gets the approximate number of bytes of memory used by the pool
+ */
+size_t PacketStringPool::GetMemoryUsage() const
+{
+	return m_text.capacity() + m_starts.capacity() * sizeof(size_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Moves a waveform's worth of packets into a new arena
+
+	The arena takes ownership of the packets: their headers and data are moved into the arena's own storage and the
+	original Packet objects are deleted.
+
+	@param columns		Header column names, as reported by PacketDecoder::GetHeaders()
+	@param packets		Top level packets, in order
+	@param children		Children of each top level packet (parallel to packets)
+ */
+PacketArena::PacketArena(
+	const vector<string>& columns,
+	const vector<Packet*>& packets,
+	const vector<vector<Packet*> >& children)
+	: m_count(packets.size())
+	, m_topLevelCount(packets.size())
+	, m_columnNames(columns)
+	, m_hasFilterResults(false)
+	, m_index(*this)
+{
+	//Figure out how much space we need
+	size_t nbytes = 0;
+	m_childStarts.resize(m_topLevelCount + 1);
+	for(size_t i=0; i<m_topLevelCount; i++)
+	{
+		nbytes += packets[i]->m_data.size();
+		m_childStarts[i] = m_count;
+		for(auto c : children[i])
+			nbytes += c->m_data.size();
+		m_count += children[i].size();
+	}
+	m_childStarts[m_topLevelCount] = m_count;
+
+	m_storage = static_cast<Packet*>(::operator new(m_count * sizeof(Packet)));
+	m_pointers.resize(m_count);
+	m_headers.resize(m_columnNames.size());
+	for(auto& col : m_headers)
+		col.resize(m_count);
+	m_bytes.reserve(nbytes);
+	m_dataStarts.reserve(m_count + 1);
+	m_dataStarts.push_back(0);
+	m_childOpen.resize(m_topLevelCount);
+
+	//Top level packets go first, then all of the children
+	for(size_t i=0; i<m_topLevelCount; i++)
+		AddPacket(i, packets[i]);
+	for(size_t i=0; i<m_topLevelCount; i++)
+	{
+		auto& kids = children[i];
+		for(size_t j=0; j<kids.size(); j++)
+			AddPacket(m_childStarts[i] + j, kids[j]);
+	}
+
+	m_strings.Seal();
+}
+
+/**
+	@brief Creates an empty arena, to be filled in by Deserialize()
+ */
+PacketArena::PacketArena()
+	: m_count(0)
+	, m_topLevelCount(0)
+	, m_storage(nullptr)
+	, m_hasFilterResults(false)
+	, m_index(*this)
+{
+}
+
+PacketArena::~PacketArena()
+{
+	//Headers and data were moved out of the packets when they were added, but the display color strings are
+	//still owned by each packet (usually short enough to live in the small string buffer, but not guaranteed),
+	//so each packet has to be destroyed before the storage is freed
+	for(size_t i=0; i<m_count; i++)
+		m_storage[i].~Packet();
+	::operator delete(m_storage);
+}
+
+/**
+	@brief Moves a single packet into the arena
+
+	The header map and data buffer are emptied before the remaining fields (including the display color strings,
+	which stay owned by the packet) are copied into the arena, then the original packet is deleted.
+
+	@param i		Index to store the packet at
+	@param pack		The packet
+ */
+void PacketArena::AddPacket(size_t i, Packet* pack)
+{
+	for(size_t j=0; j<m_columnNames.size(); j++)
+	{
+		auto it = pack->m_headers.find(m_columnNames[j]);
+		if(it != pack->m_headers.end())
+			m_headers[j][i] = m_strings.Intern(it->second);
+	}
+
+	m_bytes.insert(m_bytes.end(), pack->m_data.begin(), pack->m_data.end());
+	m_dataStarts.push_back(m_bytes.size());
+
+	pack->m_headers.clear();
+	vector<uint8_t>().swap(pack->m_data);
+
+	new(&m_storage[i]) Packet(*pack);
+	m_pointers[i] = &m_storage[i];
+	delete pack;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Gets the children of a top level packet (empty for child packets, or packets with no children)
+ */
+PacketSpan PacketArena::GetChildren(const Packet* pack) const
+{
+	if(!IsTopLevel(pack))
+		return PacketSpan();
+
+	auto i = GetIndex(pack);
+	return PacketSpan(m_pointers.data() + m_childStarts[i], m_childStarts[i+1] - m_childStarts[i]);
+}
+
+/**
+	@brief Gets the index of the header column with the given name
+
+	@return Column index, or -1 if there is no such column
+ */
+int PacketArena::GetColumnIndex(const string& name) const
+{
+	for(size_t i=0; i<m_columnNames.size(); i++)
+	{
+		if(m_columnNames[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+/**
+	@brief Gets the approximate number of bytes of memory used by the arena
+ */
+size_t PacketArena::GetMemoryUsage() const
+{
+	size_t ret = sizeof(PacketArena);
+	ret += m_count * sizeof(Packet);
+	ret += m_pointers.capacity() * sizeof(Packet*);
+	ret += m_childStarts.capacity() * sizeof(size_t);
+	ret += m_strings.GetMemoryUsage();
+	for(auto& col : m_headers)
+		ret += col.capacity() * sizeof(uint32_t);
+	ret += m_bytes.capacity();
+	ret += m_dataStarts.capacity() * sizeof(size_t);
+	ret += m_childOpen.capacity() / 8;
+	ret += m_filteredPackets.capacity() * sizeof(Packet*);
+	ret += m_filteredChildPackets.capacity() * sizeof(Packet*);
+	ret += m_filteredChildRanges.capacity() * sizeof(pair<size_t, size_t>);
+	ret += m_index.GetMemoryUsage();
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tree expansion state
+
+bool PacketArena::IsChildOpen(const Packet* pack) const
+{
+	if(!IsTopLevel(pack))
+		return false;
+	return m_childOpen[GetIndex(pack)];
+}
+
+void PacketArena::SetChildOpen(const Packet* pack, bool open)
+{
+	if(IsTopLevel(pack))
+		m_childOpen[GetIndex(pack)] = open;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filter results
+
+/**
+	@brief Replaces the filter results
+
+	@param packets		Top level packets that passed the filter, in order
+	@param children		Children that passed the filter, grouped by parent, in order
+ */
+void PacketArena::SetFilterResults(
+	vector<Packet*>&& packets,
+	vector<pair<Packet*, vector<Packet*> > >&& children)
+{
+	m_hasFilterResults = true;
+	m_filteredPackets = std::move(packets);
+
+	m_filteredChildPackets.clear();
+	m_filteredChildRanges.assign(m_topLevelCount, pair<size_t, size_t>(0, 0));
+	for(auto& it : children)
+	{
+		auto start = m_filteredChildPackets.size();
+		m_filteredChildPackets.insert(m_filteredChildPackets.end(), it.second.begin(), it.second.end());
+		m_filteredChildRanges[GetIndex(it.first)] = pair<size_t, size_t>(start, m_filteredChildPackets.size());
+	}
+}
+
+/**
+	@brief Discards the filter results, so the waveform is not displayed
+ */
+void PacketArena::ClearFilterResults()
+{
+	m_hasFilterResults = false;
+	m_filteredPackets.clear();
+	m_filteredChildPackets.clear();
+	m_filteredChildRanges.clear();
+}
+
+/**
+	@brief Gets the children of a top level packet that passed the filter
+ */
+PacketSpan PacketArena::GetFilteredChildren(const Packet* pack) const
+{
+	if(!m_hasFilterResults || !IsTopLevel(pack))
+		return PacketSpan();
+
+	auto& range = m_filteredChildRanges[GetIndex(pack)];
+	return PacketSpan(m_filteredChildPackets.data() + range.first, range.second - range.first);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serialization
+
+/**
+	@brief Appends a compact binary copy of the packets to a buffer, so they can be moved out of memory
+
+	Headers are written in their interned form and data bytes in one block, so the result is about the same size as
+	the arena itself. Tree expansion state is kept. Filter results and the search index are not, since both can be
+	rebuilt from the packets.
+
+	@param out	Buffer to append to
+ */
+void PacketArena::Serialize(vector<uint8_t>& out) const
+{
+	PacketArenaWriter w(out);
+
+	w.Write<uint64_t>(m_count);
+	w.Write<uint64_t>(m_topLevelCount);
+
+	w.Write<uint64_t>(m_columnNames.size());
+	for(auto& name : m_columnNames)
+		w.WriteString(name);
+
+	w.WriteVector(m_childStarts);
+	w.WriteVector(m_strings.m_text);
+	w.WriteVector(m_strings.m_starts);
+	for(auto& col : m_headers)
+		w.WriteVector(col);
+	w.WriteVector(m_bytes);
+	w.WriteVector(m_dataStarts);
+
+	for(size_t i=0; i<m_topLevelCount; i++)
+		w.Write<uint8_t>(m_childOpen[i]);
+
+	//Only a handful of distinct colors are ever used, so store them once and refer to them by index
+	vector<string> colors;
+	map<string, uint32_t> colorIDs;
+	auto colorID = [&](const string& color)
+	{
+		auto it = colorIDs.find(color);
+		if(it != colorIDs.end())
+			return it->second;
+		uint32_t id = colors.size();
+		colors.push_back(color);
+		colorIDs[color] = id;
+		return id;
+	};
+
+	vector<uint32_t> packetColors(m_count * 2);
+	for(size_t i=0; i<m_count; i++)
+	{
+		packetColors[i*2] = colorID(m_storage[i].m_displayForegroundColor);
+		packetColors[i*2 + 1] = colorID(m_storage[i].m_displayBackgroundColor);
+	}
+
+	w.Write<uint64_t>(colors.size());
+	for(auto& color : colors)
+		w.WriteString(color);
+	w.WriteVector(packetColors);
+
+	for(size_t i=0; i<m_count; i++)
+	{
+		w.Write<int64_t>(m_storage[i].m_offset);
+		w.Write<int64_t>(m_storage[i].m_len);
+	}
+}
+
+/**
+	@brief Recreates an arena from the output of Serialize()
+
+	@param data		Serialized arena
+	@param len		Size of the serialized arena
+
+	@return The arena, or null if the data is truncated or inconsistent
+ */
+shared_ptr<PacketArena> PacketArena::Deserialize(const uint8_t* data, size_t len)
+{
+	PacketArenaReader r(data, len);
+	shared_ptr<PacketArena> ret(new PacketArena);
+
+	//Don't set m_count until the packets actually exist, so the destructor is safe if we bail out early
+	auto count = r.Read<uint64_t>();
+	auto topLevelCount = r.Read<uint64_t>();
+	if(!r.IsOK() || (topLevelCount > count) || (count > len) )
+		return nullptr;
+
+	auto ncols = r.Read<uint64_t>();
+	if(!r.IsOK() || (ncols > len) )
+		return nullptr;
+	for(size_t i=0; i<ncols; i++)
+		ret->m_columnNames.push_back(r.ReadString());
+
+	r.ReadVector(ret->m_childStarts);
+	r.ReadVector(ret->m_strings.m_text);
+	r.ReadVector(ret->m_strings.m_starts);
+	ret->m_headers.resize(ncols);
+	for(auto& col : ret->m_headers)
+		r.ReadVector(col);
+	r.ReadVector(ret->m_bytes);
+	r.ReadVector(ret->m_dataStarts);
+
+	ret->m_childOpen.resize(topLevelCount);
+	for(size_t i=0; i<topLevelCount; i++)
+		ret->m_childOpen[i] = (r.Read<uint8_t>() != 0);
+
+	vector<string> colors(r.Read<uint64_t>());
+	if(!r.IsOK() || (colors.size() > len) )
+		return nullptr;
+	for(auto& color : colors)
+		color = r.ReadString();
+
+	vector<uint32_t> packetColors;
+	r.ReadVector(packetColors);
+
+	vector<int64_t> offsets(count * 2);
+	r.Read(offsets.data(), offsets.size() * sizeof(int64_t));
+
+	if(!r.IsOK())
+		return nullptr;
+
+	//Make sure all of the indexes are in range before we trust any of them
+	auto& starts = ret->m_strings.m_starts;
+	if( (starts.size() < 2) || (starts[0] != 0) || (starts.back() != ret->m_strings.m_text.size()) )
+		return nullptr;
+	for(size_t i=1; i<starts.size(); i++)
+	{
+		if(starts[i] <= starts[i-1])
+			return nullptr;
+	}
+	for(auto& col : ret->m_headers)
+	{
+		if(col.size() != count)
+			return nullptr;
+		for(auto id : col)
+		{
+			if(id >= ret->m_strings.size())
+				return nullptr;
+		}
+	}
+	if( (ret->m_dataStarts.size() != count + 1) || (ret->m_dataStarts.back() != ret->m_bytes.size()) )
+		return nullptr;
+	for(size_t i=1; i<ret->m_dataStarts.size(); i++)
+	{
+		if(ret->m_dataStarts[i] < ret->m_dataStarts[i-1])
+			return nullptr;
+	}
+	if( (ret->m_childStarts.size() != topLevelCount + 1) || (ret->m_childStarts.back() != count) )
+		return nullptr;
+	for(size_t i=0; i<topLevelCount; i++)
+	{
+		if( (ret->m_childStarts[i] < topLevelCount) || (ret->m_childStarts[i] > ret->m_childStarts[i+1]) )
+			return nullptr;
+	}
+	if(packetColors.size() != count * 2)
+		return nullptr;
+	for(auto id : packetColors)
+	{
+		if(id >= colors.size())
+			return nullptr;
+	}
+
+	//Everything checks out, make the packets
+	ret->m_storage = static_cast<Packet*>(::operator new(count * sizeof(Packet)));
+	ret->m_pointers.resize(count);
+	for(size_t i=0; i<count; i++)
+	{
+		auto p = new(&ret->m_storage[i]) Packet;
+		p->m_offset = offsets[i*2];
+		p->m_len = offsets[i*2 + 1];
+		p->m_displayForegroundColor = colors[packetColors[i*2]];
+		p->m_displayBackgroundColor = colors[packetColors[i*2 + 1]];
+		p->RefreshColors();
+		ret->m_pointers[i] = p;
+		ret->m_count = i+1;
+	}
+	ret->m_topLevelCount = topLevelCount;
+
+	return ret;
+}
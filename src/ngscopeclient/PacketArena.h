@@ -0,0 +1,280 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketArena
+ */
+#ifndef PacketArena_h
+#define PacketArena_h
+
+#include "../../lib/scopehal/PacketDecoder.h"
+#include "PacketSearchIndex.h"
+
+#include <string_view>
+#include <unordered_map>
+
+/**
+	@brief A read-only view of a contiguous run of elements owned by a PacketArena
+ */
+template<class T>
+class ArenaSpan
+{
+public:
+	ArenaSpan(const T* data = nullptr, size_t size = 0)
+	: m_data(data)
+	, m_size(size)
+	{}
+
+	const T* begin() const
+	{ return m_data; }
+
+	const T* end() const
+	{ return m_data + m_size; }
+
+	size_t size() const
+	{ return m_size; }
+
+	bool empty() const
+	{ return m_size == 0; }
+
+	const T& operator[](size_t i) const
+	{ return m_data[i]; }
+
+protected:
+	const T* m_data;
+	size_t m_size;
+};
+
+typedef ArenaSpan<Packet*> PacketSpan;
+typedef ArenaSpan<uint8_t> PacketBytes;
+
+/**
+	@brief Deduplicated storage for header strings
+
+	Each distinct string is stored once, null terminated and back to back in a single buffer, and referred to by a
+	32-bit ID. ID 0 is reserved to mean "no value".
+ */
+class PacketStringPool
+{
+public:
+	PacketStringPool();
+
+	uint32_t Intern(const std::string& str);
+	void Seal();
+
+	/**
+		@brief Gets the text of an interned string
+	 */
+	std::string_view Get(uint32_t id) const
+	{ return std::string_view(m_text.data() + m_starts[id], m_starts[id+1] - m_starts[id] - 1); }
+
+	///@brief Number of distinct strings, including the reserved empty entry
+	size_t size() const
+	{ return m_starts.size() - 1; }
+
+	size_t GetMemoryUsage() const;
+
+protected:
+	friend class PacketArena;
+
+	///@brief Text of every string, concatenated
+	std::vector<char> m_text;
+
+	///@brief Start of each string within m_text, plus one past the end of the last
+	std::vector<size_t> m_starts;
+
+	///@brief Map of strings to IDs (only used while adding strings, freed by Seal())
+	std::unordered_map<std::string, uint32_t> m_lookup;
+};
+
+/**
+	@brief All of the packets from a single waveform, stored together
+
+	Packet objects live in a single allocation, with their headers split out into one column of interned string IDs
+	per decoder column and their data bytes packed into one shared buffer. Top level packets come first, followed by
+	the children of each merged packet in order, so a parent's children are a simple index range.
+
+	The packets themselves are immutable once the arena is created, so background filter jobs may read them without
+	locking. Filter results and tree expansion state do change, but only with the PacketManager mutex held.
+
+	Dropping a waveform from history frees the whole arena at once rather than deleting packets one by one.
+ */
+class PacketArena
+{
+public:
+	PacketArena(
+		const std::vector<std::string>& columns,
+		const std::vector<Packet*>& packets,
+		const std::vector<std::vector<Packet*> >& children);
+	~PacketArena();
+
+	PacketArena(const PacketArena&) =delete;
+	PacketArena& operator=(const PacketArena&) =delete;
+
+	void Serialize(std::vector<uint8_t>& out) const;
+	static std::shared_ptr<PacketArena> Deserialize(const uint8_t* data, size_t len);
+
+	///@brief Total number of packets (top level and children)
+	size_t size() const
+	{ return m_count; }
+
+	///@brief Gets the top level packets
+	PacketSpan GetPackets() const
+	{ return PacketSpan(m_pointers.data(), m_topLevelCount); }
+
+	///@brief Gets every packet, top level packets first followed by children
+	PacketSpan GetAllPackets() const
+	{ return PacketSpan(m_pointers.data(), m_count); }
+
+	PacketSpan GetChildren(const Packet* pack) const;
+
+	///@brief Gets the index of a packet within the arena
+	size_t GetIndex(const Packet* pack) const
+	{ return pack - m_storage; }
+
+	///@brief Gets the names of the header columns
+	const std::vector<std::string>& GetColumns() const
+	{ return m_columnNames; }
+
+	int GetColumnIndex(const std::string& name) const;
+
+	///@brief Checks if a packet has a value for the given header column
+	bool HasHeader(const Packet* pack, size_t column) const
+	{ return m_headers[column][GetIndex(pack)] != 0; }
+
+	///@brief Gets the value of a header column for a packet (empty if not present)
+	std::string_view GetHeader(const Packet* pack, size_t column) const
+	{ return m_strings.Get(GetHeaderID(pack, column)); }
+
+	///@brief Gets the interned string ID of a header column for a packet (0 if not present)
+	uint32_t GetHeaderID(const Packet* pack, size_t column) const
+	{ return m_headers[column][GetIndex(pack)]; }
+
+	///@brief Gets the interned header values
+	const PacketStringPool& GetStrings() const
+	{ return m_strings; }
+
+	///@brief Gets the full text index of the packets
+	const PacketSearchIndex& GetSearchIndex() const
+	{ return m_index; }
+
+	///@brief Gets the data bytes of a packet
+	PacketBytes GetData(const Packet* pack) const
+	{
+		auto i = GetIndex(pack);
+		return PacketBytes(m_bytes.data() + m_dataStarts[i], m_dataStarts[i+1] - m_dataStarts[i]);
+	}
+
+	size_t GetMemoryUsage() const;
+
+	//Tree expansion state
+
+	bool IsChildOpen(const Packet* pack) const;
+	void SetChildOpen(const Packet* pack, bool open);
+
+	//Filter results
+
+	/**
+		@brief Returns true if filter results are available (i.e. the waveform should be displayed)
+	 */
+	bool HasFilterResults() const
+	{ return m_hasFilterResults; }
+
+	void SetFilterResults(
+		std::vector<Packet*>&& packets,
+		std::vector<std::pair<Packet*, std::vector<Packet*> > >&& children);
+	void ClearFilterResults();
+
+	///@brief Gets the top level packets that passed the filter
+	PacketSpan GetFilteredPackets() const
+	{ return PacketSpan(m_filteredPackets.data(), m_filteredPackets.size()); }
+
+	PacketSpan GetFilteredChildren(const Packet* pack) const;
+
+protected:
+	PacketArena();
+
+	bool IsTopLevel(const Packet* pack) const
+	{ return GetIndex(pack) < m_topLevelCount; }
+
+	void AddPacket(size_t i, Packet* pack);
+
+	///@brief Number of packets in the arena
+	size_t m_count;
+
+	///@brief Number of top level packets (these are at the start of m_storage)
+	size_t m_topLevelCount;
+
+	///@brief The packet objects
+	Packet* m_storage;
+
+	///@brief Pointers to every packet in m_storage, so ranges of them can be handed out as a PacketSpan
+	std::vector<Packet*> m_pointers;
+
+	///@brief Index of the first child of each top level packet, plus one past the end of the last
+	std::vector<size_t> m_childStarts;
+
+	///@brief Names of the header columns
+	std::vector<std::string> m_columnNames;
+
+	///@brief Interned header values
+	PacketStringPool m_strings;
+
+	///@brief String IDs for each header column, indexed by packet
+	std::vector<std::vector<uint32_t> > m_headers;
+
+	///@brief Data bytes of every packet, concatenated
+	std::vector<uint8_t> m_bytes;
+
+	///@brief Start of each packet's data within m_bytes, plus one past the end of the last
+	std::vector<size_t> m_dataStarts;
+
+	///@brief Tree expansion state of each top level packet
+	std::vector<bool> m_childOpen;
+
+	///@brief True if m_filteredPackets is valid
+	bool m_hasFilterResults;
+
+	///@brief Top level packets that passed the filter
+	std::vector<Packet*> m_filteredPackets;
+
+	///@brief Child packets that passed the filter, grouped by parent
+	std::vector<Packet*> m_filteredChildPackets;
+
+	///@brief Range of m_filteredChildPackets belonging to each top level packet
+	std::vector<std::pair<size_t, size_t> > m_filteredChildRanges;
+
+	///@brief Full text index of header values and data
+	PacketSearchIndex m_index;
+};
+
+#endif
@@ -45,22 +45,27 @@ PacketManager::PacketManager(PacketDecoder* pd, Session& session)
 	: m_session(session)
 	, m_filter(pd)
 	, m_refreshPending(false)
+	, m_generation(0)
+	, m_memoryUsage(0)
+	, m_memoryLimit(session.GetPreferences(), "Miscellaneous.Protocol Analyzer.packet_memory_limit")
+	, m_overflowPolicy(session.GetPreferences(), "Miscellaneous.Protocol Analyzer.packet_overflow_policy")
+	, m_pinnedTime(0, 0)
+	, m_discardedCount(0)
 {
 	m_filter->AddRef();
 }
 
 PacketManager::~PacketManager()
 {
-	for(auto& it : m_packets)
+	if(m_filterJob)
 	{
-		for(auto p : it.second)
-		{
-			RemoveChildHistoryFrom(p);
-			delete p;
-		}
+		m_filterJob->Cancel();
+		m_filterFuture.wait();
+		FinishFilterJob();
 	}
+
 	m_packets.clear();
-	m_childPackets.clear();
+	m_spilled.clear();
 
 	m_filter->Release();
 }
@@ -68,136 +73,111 @@ PacketManager::~PacketManager()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Waveform data processing
 
-void PacketManager::RefreshRows()
+/**
+	@brief Brings the displayed rows up to date with any changes to packets, filter results, or fonts
+ */
+void PacketManager::RefreshIfPending()
 {
-	LogTrace("Refreshing rows for %s\n", m_filter->GetDisplayName().c_str());
-	LogIndenter li;
-
 	lock_guard<recursive_mutex> lock(m_mutex);
 
-	//Clear all existing row state
-	m_refreshPending = false;
-	m_rows.clear();
-
-	//Make a list of waveform timestamps and make sure we display them in order
-	vector<TimePoint> times;
-	for(auto& it : m_filteredPackets)
-		times.push_back(it.first);
-	std::sort(times.begin(), times.end());
-	LogTrace("%zu times\n", times.size());
+	//HACK: If column is named Info assume it can be multiline
+	int infoColumn = -1;
+	auto cols = m_filter->GetHeaders();
+	for(size_t i=0; i<cols.size(); i++)
+	{
+		if(cols[i] == "Info")
+			infoColumn = i;
+	}
 
-	double totalHeight = 0;
+	//Font or style changes invalidate every cached row height
 	double lineheight = ImGui::CalcTextSize("dummy text").y;
 	double padding = ImGui::GetStyle().CellPadding.y;
+	if(m_rowModel.SetMetrics(lineheight, padding, infoColumn))
+		m_refreshPending = true;
 
-	//HACK: If column is named Info assume it can be multiline
-	bool hasInfoColumn = false;
-	auto cols = m_filter->GetHeaders();
-	for(auto& col : cols)
+	if(m_refreshPending)
 	{
-		if(col == "Info")
-			hasInfoColumn = true;
+		LogTrace("Refreshing rows for %s due to pending changes\n", m_filter->GetDisplayName().c_str());
+		RefreshRows();
 	}
 
-	//Process packets from each waveform
-	for(auto wavetime : times)
+	//Only rebuild rows for waveforms that changed
+	else if(!m_dirtyRowTimes.empty())
 	{
-		auto& wpackets = m_filteredPackets[wavetime];
-
-		//Get markers for this waveform, if any
-		auto& markers = m_session.GetMarkers(wavetime);
-		size_t imarker = 0;
-		int64_t lastoff = 0;
+		for(auto t : m_dirtyRowTimes)
+			RefreshRows(t);
+		m_dirtyRowTimes.clear();
+	}
+}
 
-		LogTrace("Refreshing (markers: %zu at %s), lineheight=%.1f\n",
-			markers.size(), wavetime.PrettyPrint().c_str(), lineheight);
-		LogIndenter li2;
+/**
+	@brief Rebuilds all of the displayed rows
+ */
+void PacketManager::RefreshRows()
+{
+	LogTrace("Refreshing rows for %s\n", m_filter->GetDisplayName().c_str());
+	LogIndenter li;
 
-		for(auto pack : wpackets)
-		{
-			//Add marker before this packet if needed
-			//(loop because we might have two or more markers between packets)
-			while( (imarker < markers.size()) &&
-				(markers[imarker].m_offset >= lastoff) &&
-				(markers[imarker].m_offset < pack->m_offset) )
-			{
-				RowData row(wavetime, markers[imarker]);
-				row.m_height = padding*2 + lineheight;
-				totalHeight += row.m_height;
-				row.m_totalHeight = totalHeight;
-				m_rows.push_back(row);
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-				imarker ++;
-			}
+	m_refreshPending = false;
+	m_dirtyRowTimes.clear();
+	m_rowModel.Clear();
 
-			//See if we have child packets
-			auto children = m_filteredChildPackets[pack];
+	//Timestamps are sorted so every waveform gets appended to the end
+	for(auto& it : m_packets)
+	{
+		if(it.second->HasFilterResults())
+			RefreshRows(it.first);
+	}
 
-			//Add an entry for the top level
-			RowData dat(wavetime, pack);
-			lastoff = pack->m_offset;
+	LogTrace("Refresh complete, totalheight=%.1f\n", m_rowModel.GetTotalHeight());
+}
 
-			//Calculate row height allowing for multiline text in the Info column
-			double height;
-			if(hasInfoColumn)
-				height = padding*2 + ImGui::CalcTextSize(pack->m_headers["Info"].c_str()).y;
-			else
-				height = padding*2 + lineheight;
+/**
+	@brief Rebuilds the displayed rows for a single waveform
 
-			//Integrate heights
-			dat.m_height = height;
-			totalHeight += height;
-			dat.m_totalHeight = totalHeight;
+	@param timestamp	Timestamp of the waveform
+ */
+void PacketManager::RefreshRows(TimePoint timestamp)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-			//Save this row
-			m_rows.push_back(dat);
+	auto arena = GetArena(timestamp);
+	if(!arena || !arena->HasFilterResults())
+		m_rowModel.RemoveTimestamp(timestamp);
+	else
+		m_rowModel.AddTimestamp(timestamp, *arena, m_session.GetMarkers(timestamp));
+}
 
-			if(IsChildOpen(pack))
-			{
-				for(auto child : children)
-				{
-					//Add an entry for the top level
-					RowData cdat(wavetime, child);
-
-					//Calculate row height
-					//TODO: account for hexdump expansion
-					if(hasInfoColumn)
-						height = padding*2 + ImGui::CalcTextSize(child->m_headers["Info"].c_str()).y;
-					else
-						height = padding*2 + lineheight;
-
-					//Integrate heights
-					cdat.m_height = height;
-					totalHeight += height;
-					cdat.m_totalHeight = totalHeight;
-
-					//Save this row
-					m_rows.push_back(cdat);
-				}
-			}
-		}
+/**
+	@brief Expands or collapses the children of a packet
 
-		//If we have a marker after the start of the last packet, add it now
-		//(loop because we might have two or more markers)
-		while( (imarker < markers.size()) && (markers[imarker].m_offset >= lastoff) )
-		{
-			RowData row(wavetime, markers[imarker]);
-			row.m_height = padding*2 + lineheight;
-			totalHeight += row.m_height;
-			row.m_totalHeight = totalHeight;
-			m_rows.push_back(row);
+	@param t		Timestamp of the waveform containing the packet
+	@param pack		The packet
+	@param open		True to expand, false to collapse
+ */
+void PacketManager::SetChildOpen(TimePoint t, Packet* pack, bool open)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-			imarker ++;
-		}
-	}
+	auto arena = GetArena(t);
+	if(!arena)
+		return;
 
-	LogTrace("Refresh complete, %zu rows, totalheight=%.1f\n", m_rows.size(), totalHeight);
+	arena->SetChildOpen(pack, open);
+	m_rowModel.SetOpen(t, *arena, pack, open);
 }
 
 void PacketManager::OnMarkerChanged()
 {
 	lock_guard<recursive_mutex> lock(m_mutex);
-	RefreshRows();
+
+	for(auto& it : m_packets)
+	{
+		if(it.second->HasFilterResults())
+			m_rowModel.UpdateMarkers(it.first, m_session.GetMarkers(it.first));
+	}
 }
 
 /**
@@ -205,6 +185,9 @@ void PacketManager::OnMarkerChanged()
  */
 void PacketManager::Update()
 {
+	//Pick up results of any background filtering
+	PollFilterJob();
+
 	//Do nothing if there's no waveform to get a timestamp from
 	auto data = m_filter->GetData(0);
 	if(!data)
@@ -230,8 +213,8 @@ void PacketManager::Update()
 	{
 		lock_guard<recursive_mutex> lock(m_mutex);
 
-		auto& outpackets = m_packets[time];
-		outpackets.clear();
+		vector<Packet*> outpackets;
+		vector<vector<Packet*> > children;
 
 		auto& packets = m_filter->GetPackets();
 		auto npackets = packets.size();
@@ -260,6 +243,7 @@ void PacketManager::Update()
 				firstChildPacketOfGroup = p;
 				parentOfGroup = m_filter->CreateMergedHeader(p, i);
 				outpackets.push_back(parentOfGroup);
+				children.push_back({});
 			}
 
 			//End a merge group
@@ -271,77 +255,223 @@ void PacketManager::Update()
 
 			//If we're a child of an group, add under the parent node
 			if(parentOfGroup)
-				m_childPackets[parentOfGroup].push_back(p);
+				children.back().push_back(p);
 
 			//Otherwise add at the top level
 			else
+			{
 				outpackets.push_back(p);
+				children.push_back({});
+			}
 
 			lastPacket = p;
 		}
 
 		LogTrace("Added %zu top-level packets after merge\n", outpackets.size());
+
+		//Move everything into a single arena. This deletes the original packets, so detach them first
+		m_filter->DetachPackets();
+		auto arena = make_shared<PacketArena>(m_filter->GetHeaders(), outpackets, children);
+
+		//Index the new packets now, so searching history never has to stop and index a whole waveform
+		arena->GetSearchIndex().Build();
+
+		m_packets[time] = arena;
+		m_stats.Add(time, *arena);
+		m_generation ++;
+		UpdateMemoryUsage(time);
 	}
-	m_filter->DetachPackets();
 
-	//Run filters
-	FilterPackets();
+	//Run filters on the new packets only, nothing else changed
+	FilterPackets(time);
+
+	//Make room for the new packets if needed
+	EnforceMemoryLimit();
 }
 
 /**
-	@brief Run the filter expression against the packets
+	@brief Run the filter expression against all packets from all timestamps
+
+	Only needed when the expression changes, new waveforms are filtered incrementally by FilterPackets(TimePoint).
+
+	Large histories are filtered in the background, call PollFilterJob() to pick up the results.
  */
 void PacketManager::FilterPackets()
 {
-	//If we do NOT have a filter, early out: just copy stuff
-	if(m_filterExpression == nullptr)
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	//If a previous expression is still being evaluated, throw its results away
+	if(m_filterJob)
+	{
+		LogTrace("Cancelling in-progress filter job\n");
+		m_filterJob->Cancel();
+		m_filterFuture.wait();
+		FinishFilterJob();
+	}
+
+	auto job = make_shared<PacketFilterJob>(m_filterExpression);
+	for(auto& it : m_packets)
+		job->AddTimestamp(it.first, it.second);
+
+	//Spilled waveforms are only worth reading back if a filter might pick out a few packets from them.
+	//With no filter they'd all match, and loading them all would defeat the point of spilling them.
+	if(m_filterExpression)
+	{
+		for(auto& it : m_spilled)
+			job->AddSpilledTimestamp(it.first, m_spillFile, it.second);
+	}
+
+	//Small jobs: just do it now
+	const size_t backgroundThreshold = 250000;
+	if(job->GetTotalWork() < backgroundThreshold)
 	{
-		m_filteredPackets = m_packets;
-		m_filteredChildPackets = m_childPackets;
+		job->Run();
 
-		//but still refresh the set of rows being displayed
+		ApplyFilterJob(*job, false);
 		m_refreshPending = true;
+		EnforceMemoryLimit();
 		return;
 	}
 
-	//We have a filter! Start out by clearing output, then we can re-add the ones that match
-	m_filteredPackets.clear();
-	m_filteredChildPackets.clear();
+	//Big jobs go in the background so the UI stays responsive.
+	//Until it's done we keep showing the results of the previous expression.
+	LogTrace("Filtering %zu packets in the background\n", job->GetTotalWork());
+	m_filterJob = job;
+	m_filterFuture = async(launch::async, [job]{ job->Run(); });
+}
 
-	//Check all top level packets against the filter
-	for(auto it : m_packets)
+/**
+	@brief Check if a background filter job has completed and, if so, apply its results
+ */
+void PacketManager::PollFilterJob()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	if(!m_filterJob)
+		return;
+	if(m_filterFuture.wait_for(0s) != future_status::ready)
+		return;
+
+	LogTrace("Background filter job complete\n");
+
+	//Everything that was in the snapshot gets replaced. Anything newer was already filtered
+	//with the current expression as it arrived.
+	ApplyFilterJob(*m_filterJob, true);
+	FinishFilterJob();
+
+	//Waveforms read back from disk may have pushed us over the limit
+	EnforceMemoryLimit();
+}
+
+/**
+	@brief Cleans up after a background filter job has finished (or been cancelled), without applying its results
+ */
+void PacketManager::FinishFilterJob()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	m_filterFuture.get();
+	m_filterJob = nullptr;
+	m_staleFilterTimes.clear();
+}
+
+/**
+	@brief Copies the results of a completed filter job into the filtered packet set
+
+	@param job			The job
+	Waveforms the job read back from disk are moved back into memory, unless they have been removed or restored since
+	the job was created.
+
+	@param background	True if the job ran in the background, so results for timestamps that have been removed
+						or replaced since the job was created must be ignored
+ */
+void PacketManager::ApplyFilterJob(PacketFilterJob& job, bool background)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	for(size_t i=0; i<job.m_times.size(); i++)
 	{
-		auto timestamp = it.first;
-		auto& packets = it.second;
-		for(auto p : packets)
+		auto t = job.m_times[i];
+		if(background && (m_staleFilterTimes.find(t) != m_staleFilterTimes.end()) )
+			continue;
+
+		if(i >= job.m_residentCount)
 		{
-			//If no children, just check the top level packet for a match
-			if(m_childPackets[p].empty())
+			auto& record = job.m_reloadedRecords[i - job.m_residentCount];
+			auto sit = m_spilled.find(t);
+			if( (sit == m_spilled.end()) ||
+				(sit->second.m_offset != record.m_offset) ||
+				(sit->second.m_len != record.m_len) )
 			{
-				if(m_filterExpression->Match(p))
-					m_filteredPackets[timestamp].push_back(p);
+				continue;
 			}
 
-			//We have children.
-			//Check them for matches, and add the parent if any child matches
-			else
-			{
-				bool anyChildMatched = false;
-				for(auto c : m_childPackets[p])
-				{
-					if(m_filterExpression->Match(c))
-					{
-						m_filteredChildPackets[p].push_back(c);
-						anyChildMatched = true;
-					}
-				}
-				if(anyChildMatched)
-					m_filteredPackets[timestamp].push_back(p);
-			}
+			LogTrace("Filter matched packets at %s, loading them back from disk\n", t.PrettyPrint().c_str());
+			m_spillFile->Release(sit->second);
+			m_spilled.erase(sit);
+			m_packets[t] = job.m_arenas[i];
+			m_generation ++;
+			UpdateMemoryUsage(t);
 		}
+
+		auto it = m_packets.find(t);
+		if( (it == m_packets.end()) || (it->second != job.m_arenas[i]) )
+			continue;
+
+		UnfilterPackets(t);
+
+		//Don't display empty timestamps if nothing matched the filter
+		if(m_filterExpression && job.m_filteredPackets[i].empty())
+			continue;
+
+		it->second->SetFilterResults(std::move(job.m_filteredPackets[i]), std::move(job.m_filteredChildPackets[i]));
+		m_dirtyRowTimes.emplace(t);
+		UpdateMemoryUsage(t);
 	}
+}
 
-	m_refreshPending = true;
+/**
+	@brief Run the filter expression against the packets from a single timestamp
+
+	@param timestamp	Time of the waveform to filter
+ */
+void PacketManager::FilterPackets(TimePoint timestamp)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	UnfilterPackets(timestamp);
+
+	auto it = m_packets.find(timestamp);
+	if(it == m_packets.end())
+		return;
+
+	PacketFilterJob job(m_filterExpression);
+	job.AddTimestamp(timestamp, it->second);
+	job.Run();
+
+	ApplyFilterJob(job, false);
+
+	//Results for this timestamp are current, even if a background job has an older copy of it
+	if(m_filterJob)
+		m_staleFilterTimes.emplace(timestamp);
+}
+
+/**
+	@brief Removes filter results for a single timestamp without touching the unfiltered packets
+
+	@param timestamp	Time of the waveform to unfilter
+ */
+void PacketManager::UnfilterPackets(TimePoint timestamp)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	auto arena = GetArena(timestamp);
+	if(!arena || !arena->HasFilterResults())
+		return;
+
+	arena->ClearFilterResults();
+	m_dirtyRowTimes.emplace(timestamp);
+	UpdateMemoryUsage(timestamp);
 }
 
 /**
@@ -355,426 +485,537 @@ void PacketManager::RemoveHistoryFrom(TimePoint timestamp)
 
 	LogTrace("Removing history from %s\n", timestamp.PrettyPrint().c_str());
 
-	auto& packets = m_packets[timestamp];
-	for(auto p : packets)
+	UnfilterPackets(timestamp);
+
+	//If a background filter job is looking at these packets it holds its own reference to the arena,
+	//so they won't actually be freed until it's done
+	auto it = m_packets.find(timestamp);
+	if(it != m_packets.end())
 	{
-		RemoveChildHistoryFrom(p);
-		delete p;
+		if(m_filterJob)
+			m_staleFilterTimes.emplace(timestamp);
+		m_stats.Remove(timestamp, *it->second);
+		m_packets.erase(it);
+		m_generation ++;
+		UpdateMemoryUsage(timestamp);
 	}
-	m_packets.erase(timestamp);
 
-	m_filteredPackets.erase(timestamp);
+	//If the packets were spilled, they're still counted in the statistics.
+	//Read them back to take them out again, then free their space in the file.
+	auto sit = m_spilled.find(timestamp);
+	if(sit != m_spilled.end())
+	{
+		if(m_filterJob)
+			m_staleFilterTimes.emplace(timestamp);
+
+		auto arena = m_spillFile->Read(sit->second);
+		if(arena)
+			m_stats.Remove(timestamp, *arena);
+		else
+			LogWarning("Could not load spilled packets for %s, statistics still include them\n",
+				timestamp.PrettyPrint().c_str());
+
+		m_spillFile->Release(sit->second);
+		m_spilled.erase(sit);
+	}
 
 	//update the list of displayed rows so we don't have anything left pointing to stale packets
-	m_refreshPending = true;
+	m_dirtyRowTimes.emplace(timestamp);
 }
 
-void PacketManager::RemoveChildHistoryFrom(Packet* pack)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory management
+
+/**
+	@brief Gets the approximate number of bytes of memory used by packets in history (not counting spilled packets)
+ */
+size_t PacketManager::GetMemoryUsage()
 {
-	//For now, we can only have one level of hierarchy
-	//so no need to check for children of children
-	auto& children = m_childPackets[pack];
-	for(auto p : children)
-		delete p;
-	m_childPackets.erase(pack);
-	m_filteredChildPackets.erase(pack);
-	m_lastChildOpen.erase(pack);
+	lock_guard<recursive_mutex> lock(m_mutex);
+	return m_memoryUsage;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// ProtocolDisplayFilter
+/**
+	@brief Updates the running memory usage total after a waveform's packets are added, removed, or refiltered
 
-ProtocolDisplayFilter::ProtocolDisplayFilter(const string& str, size_t& i)
+	@param timestamp	Timestamp of the waveform
+ */
+void PacketManager::UpdateMemoryUsage(TimePoint timestamp)
 {
-	//One or more clauses separated by operators
-	while(i < str.length())
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	auto sit = m_residentSizes.find(timestamp);
+	if(sit != m_residentSizes.end())
 	{
-		//Read the clause
-		m_clauses.push_back(new ProtocolDisplayFilterClause(str, i));
+		m_memoryUsage -= sit->second;
+		m_residentSizes.erase(sit);
+	}
 
-		//Remove spaces before the operator
-		EatSpaces(str, i);
-		if( (i >= str.length()) || (str[i] == ')') || (str[i] == ']') )
-			break;
+	auto arena = GetArena(timestamp);
+	if(!arena)
+		return;
 
-		//Read the operator, if any
-		string tmp;
-		while(i < str.length())
-		{
-			if(isspace(str[i]) || (str[i] == '\"') || (str[i] == '(') || (str[i] == ')') )
-				break;
+	auto size = arena->GetMemoryUsage();
+	m_residentSizes[timestamp] = size;
+	m_memoryUsage += size;
+}
 
-			//An alphanumeric character after an operator other than text terminates it
-			if( (tmp != "") && !isalnum(tmp[0]) && isalnum(str[i]) )
-				break;
+/**
+	@brief Loads a waveform's packets back into memory if they were spilled to disk, and keeps them there
 
-			tmp += str[i];
-			i++;
-		}
-		m_operators.push_back(tmp);
-	}
-}
+	Called when a waveform is selected in history, so it can be displayed immediately. The waveform stays pinned
+	in memory until another one is selected.
 
-ProtocolDisplayFilter::~ProtocolDisplayFilter()
+	@param timestamp	Timestamp of the waveform
+ */
+void PacketManager::Restore(TimePoint timestamp)
 {
-	for(auto c : m_clauses)
-		delete c;
-}
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-bool ProtocolDisplayFilter::Validate(const vector<string>& headers, bool nakedLiteralOK)
-{
-	//No clauses? valid all-pass filter
-	if(m_clauses.empty())
-		return true;
+	m_pinnedTime = timestamp;
 
-	//We should always have one more clause than operator
-	if( (m_operators.size() + 1) != m_clauses.size())
-		return false;
+	auto it = m_spilled.find(timestamp);
+	if(it == m_spilled.end())
+		return;
 
-	//Operators must make sense. For now only equal/unequal and boolean and/or allowed
-	for(auto& op : m_operators)
-	{
-		if( (op != "==") &&
-			(op != "!=") &&
-			(op != "||") &&
-			(op != "&&") &&
-			(op != "startswith") &&
-			(op != "contains")
-		)
-		{
-			return false;
-		}
-	}
+	LogTrace("Loading packets at %s back from disk\n", timestamp.PrettyPrint().c_str());
 
-	//If any clause is invalid, we're invalid
-	for(auto c : m_clauses)
-	{
-		if(!c->Validate(headers))
-			return false;
-	}
+	auto arena = m_spillFile->Read(it->second);
+	m_spillFile->Release(it->second);
+	m_spilled.erase(it);
 
-	//A single literal is not a legal filter, it has to be compared to something
-	//(But for sub-expressions used as indexes etc, it's OK)
-	if(!nakedLiteralOK)
+	//If we can't read it back, there's nothing more we can do.
+	//The packets will be recreated next time the decoder runs on this waveform.
+	//Without them we can't take them out of the statistics either, so they stay counted.
+	if(!arena)
 	{
-		if(m_clauses.size() == 1)
-		{
-			if(m_clauses[0]->m_type != ProtocolDisplayFilterClause::TYPE_EXPRESSION)
-				return false;
-		}
+		LogWarning("Could not load spilled packets for %s\n", timestamp.PrettyPrint().c_str());
+		return;
 	}
 
-	return true;
-}
+	//Spilled packets were never removed from the statistics, so don't add them again
+	m_packets[timestamp] = arena;
+	m_generation ++;
+	UpdateMemoryUsage(timestamp);
 
-void ProtocolDisplayFilter::EatSpaces(const string& str, size_t& i)
-{
-	while( (i < str.length()) && isspace(str[i]) )
-		i++;
+	FilterPackets(timestamp);
+	EnforceMemoryLimit();
 }
 
-bool ProtocolDisplayFilter::Match(const Packet* pack)
-{
-	if(m_clauses.empty())
-		return true;
-	else
-		return Evaluate(pack) != "0";
-}
+/**
+	@brief Spills or discards the oldest waveforms' packets until we're under the memory limit
 
-string ProtocolDisplayFilter::Evaluate(const Packet* pack)
+	The newest and the pinned waveforms are never evicted. Waveforms with no packets matching the current display
+	filter go first, since they aren't being displayed anyway.
+ */
+void PacketManager::EnforceMemoryLimit()
 {
-	//Calling code checks for validity so no need to verify here
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-	//For now, all operators have equal precedence and are evaluated left to right.
-	string current = m_clauses[0]->Evaluate(pack);
-	for(size_t i=1; i<m_clauses.size(); i++)
+	auto limitMB = m_memoryLimit.Get();
+	if( (limitMB <= 0) || (m_packets.size() < 2) )
+		return;
+	size_t limit = static_cast<size_t>(limitMB) * 1024 * 1024;
+
+	size_t total = m_memoryUsage;
+	if(total <= limit)
+		return;
+
+	bool spill = (m_overflowPolicy.Get() == 0);
+	auto newest = m_packets.rbegin()->first;
+
+	//Pick victims oldest first, hidden waveforms before displayed ones
+	vector<pair<TimePoint, size_t> > victims;
+	for(int pass=0; pass<2; pass++)
 	{
-		string rhs = m_clauses[i]->Evaluate(pack);
-		string op = m_operators[i-1];
-
-		bool a = (current != "0");
-		bool b = (rhs != "0");
-
-		//== and != do exact string equality checks
-		bool temp = false;
-		if(op == "==")
-			temp = (current == rhs);
-		else if(op == "!=")
-			temp = (current != rhs);
-
-		//&& and || do boolean operations
-		else if(op == "&&")
-			temp = (a && b);
-		else if(op == "||")
-			temp = (a || b);
-
-		//String prefix
-		else if(op == "startswith")
-			temp = (current.find(rhs) == 0);
-		else if(op == "contains")
-			temp = (current.find(rhs) != string::npos);
-
-		//done, convert back to string
-		current = temp ? "1" : "0";
+		bool displayed = (pass == 1);
+		for(auto& it : m_packets)
+		{
+			if(total <= limit)
+				break;
+			if( (it.first == newest) || (it.first == m_pinnedTime) )
+				continue;
+			if(it.second->HasFilterResults() != displayed)
+				continue;
+
+			auto size = m_residentSizes[it.first];
+			victims.push_back(pair<TimePoint, size_t>(it.first, size));
+			total -= size;
+		}
 	}
-	return current;
+
+	LogTrace("Packets for %s are over the memory limit, %s %zu waveforms\n",
+		m_filter->GetDisplayName().c_str(),
+		spill ? "spilling" : "discarding",
+		victims.size());
+
+	for(auto& it : victims)
+		Evict(it.first, spill);
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// ProtocolDisplayFilterClause
+/**
+	@brief Removes a waveform's packets from memory
 
-ProtocolDisplayFilterClause::ProtocolDisplayFilterClause(const string& str, size_t& i)
+	@param timestamp	Timestamp of the waveform
+	@param spill		True to write the packets to disk so they can be loaded back later, false to discard them
+ */
+void PacketManager::Evict(TimePoint timestamp, bool spill)
 {
-	ProtocolDisplayFilter::EatSpaces(str, i);
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-	m_real = 0;
-	m_long = 0;
-	m_expression = 0;
-	m_invert = false;
+	auto it = m_packets.find(timestamp);
+	if(it == m_packets.end())
+		return;
+	auto& arena = *it->second;
 
-	//Parenthetical expression
-	if( (str[i] == '(') || (str[i] == '!') )
+	if(spill)
 	{
-		//Inversion
-		if(str[i] == '!')
-		{
-			m_invert = true;
-			i++;
+		if(!m_spillFile)
+			m_spillFile = make_shared<PacketSpillFile>();
 
-			if(str[i] != '(')
-			{
-				m_type = TYPE_ERROR;
-				i++;
-				return;
-			}
+		PacketSpillRecord record;
+		if(m_spillFile->Write(timestamp, arena, record))
+		{
+			record.m_work = PacketFilterJob::GetWork(arena);
+			m_spilled[timestamp] = record;
 		}
 
-		i++;
-		m_type = TYPE_EXPRESSION;
-		m_expression = new ProtocolDisplayFilter(str, i);
-
-		//eat trailing spaces
-		ProtocolDisplayFilter::EatSpaces(str, i);
-
-		//expect closing parentheses
-		if(str[i] != ')')
-			m_type = TYPE_ERROR;
-		i++;
+		//If the disk is full (or the file couldn't be created) fall back to discarding them
+		else
+			spill = false;
 	}
 
-	//Quoted string
-	else if(str[i] == '\"')
+	//Spilled packets still exist and stay in the statistics, only discarded ones are taken out
+	if(!spill)
 	{
-		m_type = TYPE_STRING;
-		i++;
+		m_discardedCount ++;
+		m_stats.Remove(timestamp, arena);
+	}
 
-		while( (i < str.length()) && (str[i] != '\"') )
-		{
-			m_string += str[i];
-			i++;
-		}
-		if(i >= str.length())
-			return;
+	UnfilterPackets(timestamp);
+	if(m_filterJob)
+		m_staleFilterTimes.emplace(timestamp);
+	m_packets.erase(it);
+	m_generation ++;
+	m_dirtyRowTimes.emplace(timestamp);
+	UpdateMemoryUsage(timestamp);
+}
 
-		if(str[i] != '\"')
-			m_type = TYPE_ERROR;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Search
 
-		i++;
-	}
+/**
+	@brief Finds displayed packets with a header value or data bytes containing some text
 
-	//Number
-	else if(isdigit(str[i]) || (str[i] == '-') || (str[i] == '.') )
-	{
-		string tmp;
-		while( (i < str.length()) && (isdigit(str[i]) || (str[i] == '-')  || (str[i] == '.') || (str[i] == 'x')) )
-		{
-			tmp += str[i];
-			i++;
-		}
-		if(i >= str.length())
-			return;
+	Uses each waveform's search index, so only packets that could possibly match are actually compared.
 
-		//Hex string
-		if(tmp.find("0x") == 0)
-		{
-			sscanf(tmp.c_str(), "%lx", (unsigned long*)&m_long);
-			m_type = TYPE_INT;
-		}
+	@param text		Text to search for
 
-		//Number with decimal point
-		else if(tmp.find('.') != string::npos)
-		{
-			m_real = atof(tmp.c_str());
-			m_type = TYPE_REAL;
-		}
+	@return Matching packets (including children of collapsed packets), in display order
+ */
+vector<pair<TimePoint, Packet*> > PacketManager::Search(const string& text)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
 
-		//Number without decimal point
-		else
-		{
-			m_real = atol(tmp.c_str());
-			m_type = TYPE_INT;
-		}
+	vector<pair<TimePoint, Packet*> > ret;
+	if(text.empty())
+		return ret;
+
+	vector<pair<TimePoint, PacketArena*> > arenas;
+	for(auto& it : m_packets)
+	{
+		if(it.second->HasFilterResults())
+			arenas.push_back(pair<TimePoint, PacketArena*>(it.first, it.second.get()));
 	}
 
-	//Identifier (or data)
-	else
+	//Search each waveform in parallel (only waveforms read back from the spill file may need indexing)
+	vector<vector<bool> > hits(arenas.size());
+	#pragma omp parallel for
+	for(size_t i=0; i<arenas.size(); i++)
+		hits[i] = arenas[i].second->GetSearchIndex().FindPackets(text);
+
+	for(size_t i=0; i<arenas.size(); i++)
 	{
-		m_type = TYPE_IDENTIFIER;
+		auto t = arenas[i].first;
+		auto& arena = *arenas[i].second;
+		auto& flags = hits[i];
 
-		while( (i < str.length()) && isalnum(str[i]) )
+		for(auto p : arena.GetFilteredPackets())
 		{
-			m_identifier += str[i];
-			i++;
-		}
-		if(i >= str.length())
-			return;
+			if(flags[arena.GetIndex(p)])
+				ret.push_back(pair<TimePoint, Packet*>(t, p));
 
-		//Opening square bracket
-		if(str[i] == '[')
-		{
-			if(m_identifier == "data")
+			for(auto c : arena.GetFilteredChildren(p))
 			{
-				m_type = TYPE_DATA;
-				i++;
+				if(flags[arena.GetIndex(c)])
+					ret.push_back(pair<TimePoint, Packet*>(t, c));
+			}
+		}
+	}
 
-				//Read the index expression
-				m_expression = new ProtocolDisplayFilter(str, i);
+	LogTrace("Search for \"%s\" found %zu packets\n", text.c_str(), ret.size());
+	return ret;
+}
 
-				//eat trailing spaces
-				ProtocolDisplayFilter::EatSpaces(str, i);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketFilterJob
+
+PacketFilterJob::PacketFilterJob(shared_ptr<ProtocolDisplayFilter> filter)
+	: m_residentCount(0)
+	, m_filter(filter)
+	, m_totalWork(0)
+	, m_doneWork(0)
+	, m_cancel(false)
+{
+}
 
-				//expect closing square bracket
-				if(str[i] != ']')
-					m_type = TYPE_ERROR;
-				i++;
-			}
+/**
+	@brief Adds the packets from one waveform to the job
 
-			else
-			{
-				m_type = TYPE_ERROR;
-				i++;
-			}
-		}
+	@param t			Timestamp of the waveform
+	@param arena		The packets
+ */
+void PacketFilterJob::AddTimestamp(TimePoint t, shared_ptr<PacketArena> arena)
+{
+	m_times.push_back(t);
+	m_arenas.push_back(arena);
+	m_totalWork += GetWork(*arena);
+}
 
-		if(m_identifier == "")
-		{
-			i++;
-			m_type = TYPE_ERROR;
-		}
-	}
+/**
+	@brief Adds a waveform whose packets have been spilled to disk to the job
+
+	@param t			Timestamp of the waveform
+	@param file			File containing the packets
+	@param record		Location of the packets within the file
+ */
+void PacketFilterJob::AddSpilledTimestamp(TimePoint t, shared_ptr<PacketSpillFile> file, const PacketSpillRecord& record)
+{
+	m_spillFile = file;
+	m_spilled.push_back(pair<TimePoint, PacketSpillRecord>(t, record));
+	m_totalWork += record.m_work;
 }
 
 /**
-	@brief Returns a copy of the input string with spaces removed
+	@brief Gets the cost of filtering a waveform's packets
+
+	Childless packets count once, merged packets once per child.
  */
-string ProtocolDisplayFilterClause::EatSpaces(const string& str)
+size_t PacketFilterJob::GetWork(const PacketArena& arena)
 {
-	string ret;
-	for(auto c : str)
+	auto packets = arena.GetPackets();
+	size_t work = arena.size() - packets.size();
+	for(auto p : packets)
 	{
-		if(!isspace(c))
-			ret += c;
+		if(arena.GetChildren(p).empty())
+			work ++;
 	}
-	return ret;
+	return work;
 }
 
-string ProtocolDisplayFilterClause::Evaluate(const Packet* pack)
+/**
+	@brief Evaluates the filter against every packet in the job
+ */
+void PacketFilterJob::Run()
 {
-	char tmp[32];
+	m_residentCount = m_times.size();
 
-	switch(m_type)
+	//A range of top level packets from one timestamp, or a range of children from one parent
+	struct Chunk
+	{
+		size_t m_itime;
+		size_t m_start;
+		size_t m_end;
+		bool m_childRange;
+		size_t m_parent;
+		size_t m_work;
+	};
+
+	struct ChunkResult
+	{
+		vector<Packet*> m_packets;
+		vector<pair<Packet*, vector<Packet*> > > m_children;
+	};
+
+	//Split everything into chunks of roughly equal cost, so that one huge waveform or
+	//one parent with a huge child list still gets spread across all of the cores
+	const size_t chunkWork = 8192;
+	vector<Chunk> chunks;
+	for(size_t itime=0; itime<m_times.size(); itime++)
 	{
-		case TYPE_DATA:
+		auto& arena = *m_arenas[itime];
+		auto packets = arena.GetPackets();
+
+		size_t start = 0;
+		size_t work = 0;
+		for(size_t i=0; i<packets.size(); i++)
+		{
+			auto nkids = arena.GetChildren(packets[i]).size();
+
+			//Big child lists get chunks of their own
+			if(nkids > chunkWork)
 			{
-				string sindex = m_expression->Evaluate(pack);
-				int index = atoi(sindex.c_str());
+				if(start < i)
+					chunks.push_back({itime, start, i, false, 0, work});
 
-				//Bounds check
-				if(pack->m_data.size() <= (size_t)index)
-					return "NaN";
+				for(size_t base=0; base<nkids; base += chunkWork)
+				{
+					auto end = min(base + chunkWork, nkids);
+					chunks.push_back({itime, base, end, true, i, end - base});
+				}
 
-				return to_string(pack->m_data[index]);
+				start = i+1;
+				work = 0;
+				continue;
 			}
-			break;
 
-		case TYPE_IDENTIFIER:
+			work += nkids ? nkids : 1;
+			if(work >= chunkWork)
 			{
-				auto it = pack->m_headers.find(m_identifier);
-				if(it != pack->m_headers.end())
-					return it->second;
-				else
-					return "NaN";
+				chunks.push_back({itime, start, i+1, false, 0, work});
+				start = i+1;
+				work = 0;
 			}
+		}
+		if(start < packets.size())
+			chunks.push_back({itime, start, packets.size(), false, 0, work});
+	}
+
+	//Look up any text searches in each waveform's index
+	vector<ProtocolDisplayFilterContext> contexts(m_arenas.size());
+	if(m_filter)
+	{
+		#pragma omp parallel for
+		for(size_t i=0; i<m_arenas.size(); i++)
+			m_filter->Prepare(*m_arenas[i], contexts[i]);
+	}
 
-		case TYPE_STRING:
-			return m_string;
+	//Evaluate the chunks in parallel
+	vector<ChunkResult> results(chunks.size());
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i=0; i<chunks.size(); i++)
+	{
+		if(m_cancel)
+			continue;
 
-		case TYPE_REAL:
-			snprintf(tmp, sizeof(tmp), "%f", m_real);
-			return tmp;
+		auto& c = chunks[i];
+		auto& r = results[i];
+		auto& arena = *m_arenas[c.m_itime];
+		auto& context = contexts[c.m_itime];
+		auto packets = arena.GetPackets();
 
-		case TYPE_INT:
-			snprintf(tmp, sizeof(tmp), "%ld", m_long);
-			return tmp;
+		if(c.m_childRange)
+		{
+			auto p = packets[c.m_parent];
+			auto kids = arena.GetChildren(p);
+
+			vector<Packet*> matched;
+			for(size_t j=c.m_start; j<c.m_end; j++)
+			{
+				if(Matches(arena, context, kids[j]))
+					matched.push_back(kids[j]);
+			}
+			if(!matched.empty())
+			{
+				r.m_packets.push_back(p);
+				r.m_children.push_back(pair<Packet*, vector<Packet*> >(p, std::move(matched)));
+			}
+		}
 
-		case TYPE_EXPRESSION:
-			if(m_invert)
+		else
+		{
+			for(size_t j=c.m_start; j<c.m_end; j++)
 			{
-				if(m_expression->Evaluate(pack) == "1")
-					return "0";
+				auto p = packets[j];
+				auto kids = arena.GetChildren(p);
+
+				//If no children, just check the top level packet for a match
+				if(kids.empty())
+				{
+					if(Matches(arena, context, p))
+						r.m_packets.push_back(p);
+				}
+
+				//We have children.
+				//Check them for matches, and add the parent if any child matches
 				else
-					return "1";
+				{
+					vector<Packet*> matched;
+					for(auto k : kids)
+					{
+						if(Matches(arena, context, k))
+							matched.push_back(k);
+					}
+					if(!matched.empty())
+					{
+						r.m_packets.push_back(p);
+						r.m_children.push_back(pair<Packet*, vector<Packet*> >(p, std::move(matched)));
+					}
+				}
 			}
-			else
-				return m_expression->Evaluate(pack);
+		}
 
-		case TYPE_ERROR:
-		default:
-			return "NaN";
+		m_doneWork += c.m_work;
 	}
 
-	//never happens because of the 'default" clause, but prevents -Wreturn-type warning with some gcc versions
-	return "NaN";
-}
-
-ProtocolDisplayFilterClause::~ProtocolDisplayFilterClause()
-{
-	if(m_expression)
-		delete m_expression;
-}
+	if(m_cancel)
+		return;
 
-bool ProtocolDisplayFilterClause::Validate(const vector<string>& headers)
-{
-	switch(m_type)
+	//Merge results in order
+	m_filteredPackets.clear();
+	m_filteredChildPackets.clear();
+	m_filteredPackets.resize(m_times.size());
+	m_filteredChildPackets.resize(m_times.size());
+	for(size_t i=0; i<chunks.size(); i++)
 	{
-		case TYPE_ERROR:
-			return false;
+		auto& outPackets = m_filteredPackets[chunks[i].m_itime];
+		auto& outChildren = m_filteredChildPackets[chunks[i].m_itime];
+		auto& r = results[i];
 
-		case TYPE_DATA:
-			return m_expression->Validate(headers, true);
+		for(auto p : r.m_packets)
+		{
+			//Consecutive child ranges of the same parent only add the parent once
+			if(!outPackets.empty() && (outPackets.back() == p) )
+				continue;
+			outPackets.push_back(p);
+		}
 
-		//If we're an identifier, we must be a valid header field
-		//TODO: support comparisons on data
-		case TYPE_IDENTIFIER:
-			for(auto& h : headers)
+		for(auto& it : r.m_children)
+		{
+			if(!outChildren.empty() && (outChildren.back().first == it.first) )
 			{
-				//Match, removing spaces from header names if needed
-				//Note that m_identifier is now the real, un-spaced version of the identifier name
-				//so we can look it up in the packet
-				if(EatSpaces(h) == m_identifier)
-				{
-					m_identifier = h;
-					return true;
-				}
+				auto& dst = outChildren.back().second;
+				dst.insert(dst.end(), it.second.begin(), it.second.end());
 			}
+			else
+				outChildren.push_back(std::move(it));
+		}
+	}
+
+	//Read spilled waveforms back one at a time, so we never have more than one extra in memory
+	//unless it has packets to show
+	for(auto& it : m_spilled)
+	{
+		if(m_cancel)
+			return;
 
-			return false;
+		auto arena = m_spillFile->Read(it.second);
+		if(arena)
+		{
+			PacketFilterJob job(m_filter);
+			job.AddTimestamp(it.first, arena);
+			job.Run();
 
-		//If we're an expression, it must be valid
-		case TYPE_EXPRESSION:
-			return m_expression->Validate(headers);
+			if(!job.m_filteredPackets[0].empty())
+			{
+				m_times.push_back(it.first);
+				m_arenas.push_back(arena);
+				m_filteredPackets.push_back(std::move(job.m_filteredPackets[0]));
+				m_filteredChildPackets.push_back(std::move(job.m_filteredChildPackets[0]));
+				m_reloadedRecords.push_back(it.second);
+			}
+		}
 
-		default:
-			return true;
+		m_doneWork += it.second.m_work;
 	}
 }
@@ -37,117 +37,108 @@
 
 #include "../../lib/scopehal/PacketDecoder.h"
 #include "Marker.h"
+#include "PacketArena.h"
+#include "PacketRowModel.h"
+#include "PacketSpillFile.h"
+#include "PacketStatistics.h"
+#include "PreferenceHandle.h"
+#include "ProtocolDisplayFilter.h"
 #include "TextureManager.h"
 
+#include <future>
+
 class Session;
 
 /**
-	@brief Context data for a single row (used for culling)
- */
-class RowData
-{
-public:
-	RowData()
-	: m_height(0)
-	, m_totalHeight(0)
-	, m_stamp(0, 0)
-	, m_packet(nullptr)
-	, m_marker(TimePoint(0,0), 0, "")
-	{}
-
-	RowData(TimePoint t, Packet* p)
-	: m_height(0)
-	, m_totalHeight(0)
-	, m_stamp(t)
-	, m_packet(p)
-	, m_marker(t, 0, "")
-	{}
-
-	RowData(TimePoint t, const Marker& m)
-	: m_height(0)
-	, m_totalHeight(0)
-	, m_stamp(t)
-	, m_packet(nullptr)
-	, m_marker(m)
-	{}
-
-	///@brief Height of this row
-	double m_height;
-
-	///@brief Total height of the entire list up to this point
-	double m_totalHeight;
-
-	///@brief Timestamp of the waveform this packet came from
-	TimePoint m_stamp;
-
-	///@brief The packet in this row (null if m_marker is valid)
-	Packet* m_packet;
-
-	///@brief The marker in this row (ignored if m_packet is valid)
-	Marker m_marker;
-
-	///@brief Texture containing the scanline image for this row (only valid if m_packet is a VideoScanlinePacket)
-	std::shared_ptr<Texture> m_texture;
-};
+	@brief A snapshot of packets to run a display filter against, plus the filter results
+
+	Work is split into chunks of similar cost (a top level packet counts once, plus once per child) which are evaluated
+	in parallel then merged back in their original order, so results are identical to a serial run.
 
-class ProtocolDisplayFilter;
+	Jobs hold a reference to each PacketArena being filtered, so packets stay valid even if their waveform is removed
+	from history while the job is running in the background.
 
-class ProtocolDisplayFilterClause
+	Waveforms whose packets have been spilled to disk are read back one at a time after everything else is done, and
+	only kept (appended to m_times etc.) if at least one packet matched.
+ */
+class PacketFilterJob
 {
 public:
-	ProtocolDisplayFilterClause(const std::string& str, size_t& i);
-	ProtocolDisplayFilterClause(const ProtocolDisplayFilterClause&) =delete;
-	ProtocolDisplayFilterClause& operator=(const ProtocolDisplayFilterClause&) =delete;
+	PacketFilterJob(std::shared_ptr<ProtocolDisplayFilter> filter);
 
-	virtual ~ProtocolDisplayFilterClause();
+	void AddTimestamp(TimePoint t, std::shared_ptr<PacketArena> arena);
+	void AddSpilledTimestamp(TimePoint t, std::shared_ptr<PacketSpillFile> file, const PacketSpillRecord& record);
 
-	bool Validate(const std::vector<std::string>& headers);
+	void Run();
 
-	std::string Evaluate(const Packet* pack);
+	static size_t GetWork(const PacketArena& arena);
 
-	static std::string EatSpaces(const std::string& str);
+	/**
+		@brief Requests that a running job stop as soon as possible (its results are then incomplete)
+	 */
+	void Cancel()
+	{ m_cancel = true; }
 
-	enum
+	size_t GetTotalWork() const
+	{ return m_totalWork; }
+
+	/**
+		@brief Fraction of the job completed so far, from 0 to 1
+	 */
+	float GetProgress() const
 	{
-		TYPE_DATA,
-		TYPE_IDENTIFIER,
-		TYPE_STRING,
-		TYPE_REAL,
-		TYPE_INT,
-		TYPE_EXPRESSION,
-		TYPE_ERROR
-	} m_type;
-
-	std::string m_identifier;
-	std::string m_string;
-	float m_real;
-	long m_long;
-	ProtocolDisplayFilter* m_expression;
-	bool m_invert;
-};
+		if(m_totalWork == 0)
+			return 1;
+		return static_cast<float>(m_doneWork.load()) / m_totalWork;
+	}
 
-class ProtocolDisplayFilter
-{
-public:
-	ProtocolDisplayFilter(const std::string& str, size_t& i);
-	ProtocolDisplayFilter(const ProtocolDisplayFilterClause&) =delete;
-	ProtocolDisplayFilter& operator=(const ProtocolDisplayFilter&) =delete;
-	virtual ~ProtocolDisplayFilter();
+	///@brief Timestamps being filtered
+	std::vector<TimePoint> m_times;
+
+	///@brief Packets for each timestamp
+	std::vector<std::shared_ptr<PacketArena> > m_arenas;
+
+	///@brief Top level packets that passed the filter, for each timestamp
+	std::vector<std::vector<Packet*> > m_filteredPackets;
 
-	static void EatSpaces(const std::string& str, size_t& i);
+	///@brief Child packets that passed the filter, for each timestamp
+	std::vector<std::vector<std::pair<Packet*, std::vector<Packet*> > > > m_filteredChildPackets;
 
-	bool Validate(const std::vector<std::string>& headers, bool nakedLiteralOK = false);
+	///@brief Number of entries in m_times which were in memory when the job was created
+	size_t m_residentCount;
 
-	bool Match(const Packet* pack);
-	std::string Evaluate(const Packet* pack);
+	///@brief Where each entry of m_times past m_residentCount was read back from
+	std::vector<PacketSpillRecord> m_reloadedRecords;
 
 protected:
-	std::vector<ProtocolDisplayFilterClause*> m_clauses;
-	std::vector<std::string> m_operators;
+	bool Matches(const PacketArena& arena, const ProtocolDisplayFilterContext& context, const Packet* pack) const
+	{ return !m_filter || m_filter->Match(arena, context, pack); }
+
+	///@brief The expression to evaluate (null to pass everything)
+	std::shared_ptr<ProtocolDisplayFilter> m_filter;
+
+	///@brief Number of packets to evaluate
+	size_t m_totalWork;
+
+	///@brief Number of packets evaluated so far
+	std::atomic<size_t> m_doneWork;
+
+	///@brief Set to abort the job
+	std::atomic<bool> m_cancel;
+
+	///@brief File holding the spilled waveforms
+	std::shared_ptr<PacketSpillFile> m_spillFile;
+
+	///@brief Spilled waveforms to read back and filter
+	std::vector<std::pair<TimePoint, PacketSpillRecord> > m_spilled;
 };
 
 /**
 	@brief Keeps track of packetized data history from a single protocol analyzer filter
+
+	If the packets use more memory than the "Miscellaneous.Protocol Analyzer.packet_memory_limit" preference allows,
+	the oldest waveforms' packets are either moved to a temporary file or discarded. Spilled packets are loaded back
+	when their waveform is selected, or when a display filter finds matches in them.
  */
 class PacketManager
 {
@@ -157,62 +148,162 @@ public:
 
 	void Update();
 	void RemoveHistoryFrom(TimePoint timestamp);
+	void Restore(TimePoint timestamp);
 
 	std::recursive_mutex& GetMutex()
 	{ return m_mutex; }
 
-	const std::map<TimePoint, std::vector<Packet*> >& GetPackets()
+	const std::map<TimePoint, std::shared_ptr<PacketArena> >& GetPackets()
 	{ return m_packets; }
 
-	const std::vector<Packet*>& GetChildPackets(Packet* pack)
-	{ return m_childPackets[pack]; }
-
-	const std::map<TimePoint, std::vector<Packet*> >& GetFilteredPackets()
-	{ return m_filteredPackets; }
-
-	const std::vector<Packet*>& GetFilteredChildPackets(Packet* pack)
-	{ return m_filteredChildPackets[pack]; }
+	/**
+		@brief Gets the packets from a single waveform, or null if there are none
+	 */
+	PacketArena* GetArena(TimePoint t)
+	{
+		auto it = m_packets.find(t);
+		if(it == m_packets.end())
+			return nullptr;
+		return it->second.get();
+	}
 
 	/**
 		@brief Sets the current filter expression
+
+		@return True if the filter was applied, false if it failed to compile (the previous filter stays active and
+				the error is available from filter->GetError())
 	 */
-	void SetDisplayFilter(std::shared_ptr<ProtocolDisplayFilter> filter)
+	bool SetDisplayFilter(std::shared_ptr<ProtocolDisplayFilter> filter)
 	{
+		if(filter && !filter->Compile(m_filter->GetHeaders()))
+		{
+			LogWarning("Display filter failed to compile: %s\n", filter->GetError().c_str());
+			return false;
+		}
+
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 		m_filterExpression = filter;
 		FilterPackets();
+		return true;
 	}
 
 	void FilterPackets();
 
-	bool IsChildOpen(Packet* pack)
-	{ return m_lastChildOpen[pack]; }
+	/**
+		@brief Returns true if a full re-filter is running in the background
+	 */
+	bool IsFilterRunning()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return (m_filterJob != nullptr);
+	}
+
+	/**
+		@brief Gets the progress of the background filter job, from 0 to 1
+	 */
+	float GetFilterProgress()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		if(!m_filterJob)
+			return 1;
+		return m_filterJob->GetProgress();
+	}
+
+	void PollFilterJob();
+
+	std::vector<std::pair<TimePoint, Packet*> > Search(const std::string& text);
+
+	/**
+		@brief Requests the displayed rows be rebuilt before the next render (e.g. after a tree node opened)
+	 */
+	void SetRefreshPending()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		m_refreshPending = true;
+	}
 
-	void SetChildOpen(Packet* pack, bool open)
-	{ m_lastChildOpen[pack] = open; }
+	void SetChildOpen(TimePoint t, Packet* pack, bool open);
 
-	std::vector<RowData>& GetRows()
+	/**
+		@brief Gets the rows to display, based on current tree expansion and filter state
+	 */
+	PacketRowModel& GetRowModel()
 	{
 		RefreshIfPending();
-		return m_rows;
+		return m_rowModel;
 	}
 
 	void OnMarkerChanged();
 
+	void RefreshIfPending();
+
+	/**
+		@brief Gets per-column statistics over all packets in history
+
+		Waveforms whose packets have been spilled to disk are included, but discarded ones are not. The caller must hold
+		the mutex while using the result.
+	 */
+	PacketStatistics& GetStatistics()
+	{ return m_stats; }
+
 	/**
-		@brief Refresh the list of pending packets
+		@brief Gets a counter which is incremented every time a waveform is added to or removed from history
 	 */
-	void RefreshIfPending()
+	uint64_t GetGeneration()
 	{
 		std::lock_guard<std::recursive_mutex> lock(m_mutex);
-		if(m_refreshPending)
-		{
-			LogTrace("Refreshing rows for %s due to pending changes\n", m_filter->GetDisplayName().c_str());
-			RefreshRows();
-		}
+		return m_generation;
+	}
+
+	PacketDecoder* GetDecoder()
+	{ return m_filter; }
+
+	size_t GetMemoryUsage();
+
+	/**
+		@brief Gets the number of waveforms whose packets are currently in memory
+	 */
+	size_t GetResidentCount()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return m_packets.size();
+	}
+
+	/**
+		@brief Gets the number of waveforms whose packets have been spilled to disk
+	 */
+	size_t GetSpilledCount()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return m_spilled.size();
+	}
+
+	/**
+		@brief Gets the number of bytes of disk used by spilled packets
+	 */
+	uint64_t GetSpilledSize()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return m_spillFile ? m_spillFile->GetLiveSize() : 0;
+	}
+
+	/**
+		@brief Gets the number of waveforms whose packets were discarded to stay under the memory limit
+	 */
+	size_t GetDiscardedCount()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return m_discardedCount;
 	}
 
 protected:
-	void RemoveChildHistoryFrom(Packet* pack);
+	void FilterPackets(TimePoint timestamp);
+	void UnfilterPackets(TimePoint timestamp);
+	void ApplyFilterJob(PacketFilterJob& job, bool background);
+	void FinishFilterJob();
+	void EnforceMemoryLimit();
+	void Evict(TimePoint timestamp, bool spill);
+	void UpdateMemoryUsage(TimePoint timestamp);
 
 	///@brief Parent session object
 	Session& m_session;
@@ -223,17 +314,8 @@ protected:
 	///@brief The filter we're managing
 	PacketDecoder* m_filter;
 
-	///@brief Our saved packet data
-	std::map<TimePoint, std::vector<Packet*> > m_packets;
-
-	///@brief Merged child packets
-	std::map<Packet*, std::vector<Packet*> > m_childPackets;
-
-	///@brief Subset of m_packets that passed the current filter expression
-	std::map<TimePoint, std::vector<Packet*> > m_filteredPackets;
-
-	///@brief Subset of m_filteredChildPackets that passed the current filter expression
-	std::map<Packet*, std::vector<Packet*> > m_filteredChildPackets;
+	///@brief Our saved packet data (including filter results and tree expansion state)
+	std::map<TimePoint, std::shared_ptr<PacketArena> > m_packets;
 
 	///@brief Cache key for the current waveform
 	WaveformCacheKey m_cachekey;
@@ -241,17 +323,56 @@ protected:
 	///@brief Current filter expression
 	std::shared_ptr<ProtocolDisplayFilter> m_filterExpression;
 
-	///@brief Update the list of rows being displayed
+	///@brief Full re-filter currently running in the background, if any
+	std::shared_ptr<PacketFilterJob> m_filterJob;
+
+	///@brief Completion of m_filterJob
+	std::future<void> m_filterFuture;
+
+	///@brief Timestamps removed or replaced since m_filterJob was started, whose results must be discarded
+	std::set<TimePoint> m_staleFilterTimes;
+
 	void RefreshRows();
+	void RefreshRows(TimePoint timestamp);
 
 	///@brief The set of rows that are to be displayed, based on current tree expansion and filter state
-	std::vector<RowData> m_rows;
+	PacketRowModel m_rowModel;
 
-	///@brief Map of packets to child-open flags from last frame
-	std::map<Packet*, bool> m_lastChildOpen;
+	///@brief Timestamps whose filtered packets have changed since the rows were last refreshed
+	std::set<TimePoint> m_dirtyRowTimes;
 
-	///@brief True if we have a refresh pending before we can render (i.e. pending deletion or similar)
+	///@brief True if we have a full refresh pending before we can render (e.g. filter expression changed)
 	bool m_refreshPending;
+
+	///@brief Statistics over all packets in m_packets, updated as waveforms are added and removed
+	PacketStatistics m_stats;
+
+	///@brief Incremented whenever m_packets changes
+	uint64_t m_generation;
+
+	///@brief Approximate size of each waveform in m_packets, as of the last time its packets or filter results changed
+	std::map<TimePoint, size_t> m_residentSizes;
+
+	///@brief Sum of m_residentSizes
+	size_t m_memoryUsage;
+
+	///@brief The "Miscellaneous.Protocol Analyzer.packet_memory_limit" preference (only read under m_mutex)
+	PreferenceHandle<int64_t> m_memoryLimit;
+
+	///@brief The "Miscellaneous.Protocol Analyzer.packet_overflow_policy" preference (only read under m_mutex)
+	PreferenceHandle<int64_t> m_overflowPolicy;
+
+	///@brief Temporary file holding packets moved out of memory (created the first time it's needed)
+	std::shared_ptr<PacketSpillFile> m_spillFile;
+
+	///@brief Waveforms whose packets are in m_spillFile rather than m_packets
+	std::map<TimePoint, PacketSpillRecord> m_spilled;
+
+	///@brief Most recently selected waveform, which is never evicted
+	TimePoint m_pinnedTime;
+
+	///@brief Number of waveforms whose packets have been discarded (rather than spilled) since we were created
+	size_t m_discardedCount;
 };
 
 #endif
@@ -0,0 +1,561 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketRowModel
+ */
+#include "ngscopeclient.h"
+#include "PacketRowModel.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PacketRowModel::PacketRowModel()
+	: m_lineHeight(0)
+	, m_padding(0)
+	, m_infoColumn(-1)
+{
+}
+
+/**
+	@brief Sets the font metrics used to calculate row heights
+
+	@return True if the metrics changed, in which case the model has been cleared and must be repopulated
+ */
+bool PacketRowModel::SetMetrics(double lineHeight, double padding, int infoColumn)
+{
+	if( (lineHeight == m_lineHeight) && (padding == m_padding) && (infoColumn == m_infoColumn) )
+		return false;
+
+	m_lineHeight = lineHeight;
+	m_padding = padding;
+	m_infoColumn = infoColumn;
+	Clear();
+	return true;
+}
+
+/**
+	@brief Removes all rows
+ */
+void PacketRowModel::Clear()
+{
+	m_blocks.clear();
+	m_heights.Clear();
+	m_markers.clear();
+	m_openChildren.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Structural changes
+
+/**
+	@brief Adds rows for the packets from one waveform
+
+	Appending a waveform newer than everything already in the model is O(k log n) for k new packets. Inserting an
+	older waveform requires rebuilding the height tree, but no packets other than the new ones are re-measured.
+
+	@param t			Timestamp of the waveform
+	@param arena		Packets from the waveform, with filter results and tree expansion state
+	@param markers		Markers in this waveform
+ */
+void PacketRowModel::AddTimestamp(TimePoint t, const PacketArena& arena, const vector<Marker>& markers)
+{
+	RemoveTimestamp(t);
+
+	//Make the blocks (and measure the packets)
+	auto packets = arena.GetFilteredPackets();
+	vector<PacketRowBlock> blocks;
+	blocks.reserve(packets.size() + 1);
+	for(auto p : packets)
+	{
+		blocks.push_back({t, p, p->m_offset, 0, MeasurePacket(arena, p)});
+
+		if(!arena.IsChildOpen(p))
+			continue;
+		auto children = arena.GetFilteredChildren(p);
+		if(children.empty())
+			continue;
+		m_openChildren[p] = MeasureChildren(arena, children);
+	}
+	blocks.push_back({t, nullptr, INT64_MAX, 0, 0});
+
+	//Figure out where the new blocks go
+	auto pos = lower_bound(
+		m_blocks.begin(),
+		m_blocks.end(),
+		t,
+		[](const PacketRowBlock& b, TimePoint tp) { return b.m_stamp < tp; });
+	bool append = (pos == m_blocks.end());
+	size_t first = pos - m_blocks.begin();
+	size_t last = first + blocks.size();
+	m_blocks.insert(pos, blocks.begin(), blocks.end());
+
+	//Attach each marker to the first packet after it
+	auto& mcopy = m_markers[t];
+	mcopy = markers;
+	stable_sort(mcopy.begin(), mcopy.end(),
+		[](const Marker& a, const Marker& b) { return a.m_offset < b.m_offset; });
+	for(auto& m : mcopy)
+		m_blocks[GetMarkerBlock(first, last, m.m_offset)].m_markerCount ++;
+
+	//Common case: newest waveform, just push onto the end of the tree
+	if(append)
+	{
+		for(size_t i=first; i<m_blocks.size(); i++)
+			m_heights.PushBack(GetBlockHeight(i));
+	}
+
+	//Otherwise rebuild the tree (heights are cached so this is just a sum)
+	else
+	{
+		vector<double> heights(m_blocks.size());
+		for(size_t i=0; i<m_blocks.size(); i++)
+			heights[i] = GetBlockHeight(i);
+		m_heights.Build(heights);
+	}
+}
+
+/**
+	@brief Removes the rows for all packets from one waveform
+ */
+void PacketRowModel::RemoveTimestamp(TimePoint t)
+{
+	auto range = GetTimestampRange(t);
+	m_markers.erase(t);
+	if(range.first == range.second)
+		return;
+
+	for(size_t i=range.first; i<range.second; i++)
+	{
+		if(m_blocks[i].m_packet)
+			m_openChildren.erase(m_blocks[i].m_packet);
+	}
+
+	bool atEnd = (range.second == m_blocks.size());
+	m_blocks.erase(m_blocks.begin() + range.first, m_blocks.begin() + range.second);
+
+	//Removing from the end just truncates the tree
+	if(atEnd)
+	{
+		while(m_heights.size() > m_blocks.size())
+			m_heights.PopBack();
+	}
+
+	else
+	{
+		vector<double> heights(m_blocks.size());
+		for(size_t i=0; i<m_blocks.size(); i++)
+			heights[i] = GetBlockHeight(i);
+		m_heights.Build(heights);
+	}
+}
+
+/**
+	@brief Updates the markers displayed for a waveform
+
+	Only blocks that gained or lost a marker are touched.
+ */
+void PacketRowModel::UpdateMarkers(TimePoint t, const vector<Marker>& markers)
+{
+	auto range = GetTimestampRange(t);
+	if(range.first == range.second)
+		return;
+
+	auto sorted = markers;
+	stable_sort(sorted.begin(), sorted.end(),
+		[](const Marker& a, const Marker& b) { return a.m_offset < b.m_offset; });
+
+	//Early out if nothing changed
+	auto& old = m_markers[t];
+	if(old.size() == sorted.size())
+	{
+		bool same = true;
+		for(size_t i=0; i<old.size(); i++)
+		{
+			if( (old[i].m_offset != sorted[i].m_offset) || (old[i].m_name != sorted[i].m_name) )
+			{
+				same = false;
+				break;
+			}
+		}
+		if(same)
+			return;
+	}
+
+	//Move markers between blocks
+	set<size_t> touched;
+	for(auto& m : old)
+	{
+		auto b = GetMarkerBlock(range.first, range.second, m.m_offset);
+		m_blocks[b].m_markerCount --;
+		touched.emplace(b);
+	}
+	for(auto& m : sorted)
+	{
+		auto b = GetMarkerBlock(range.first, range.second, m.m_offset);
+		m_blocks[b].m_markerCount ++;
+		touched.emplace(b);
+	}
+	old = std::move(sorted);
+
+	for(auto b : touched)
+		m_heights.Set(b, GetBlockHeight(b));
+}
+
+/**
+	@brief Expands or collapses a packet
+
+	@param t			Timestamp of the waveform containing the packet
+	@param arena		Packets from the waveform
+	@param pack			The packet
+	@param open			True to expand, false to collapse
+ */
+void PacketRowModel::SetOpen(TimePoint t, const PacketArena& arena, Packet* pack, bool open)
+{
+	auto range = GetTimestampRange(t);
+	auto it = lower_bound(
+		m_blocks.begin() + range.first,
+		m_blocks.begin() + range.second,
+		pack->m_offset,
+		[](const PacketRowBlock& b, int64_t off) { return b.m_offset < off; });
+
+	//Several packets might have the same offset, find the right one
+	size_t block = it - m_blocks.begin();
+	for(; block < range.second; block++)
+	{
+		if(m_blocks[block].m_packet == pack)
+			break;
+		if(m_blocks[block].m_offset != pack->m_offset)
+			return;
+	}
+	if(block >= range.second)
+		return;
+
+	auto children = arena.GetFilteredChildren(pack);
+	if(open && !children.empty())
+		m_openChildren[pack] = MeasureChildren(arena, children);
+	else
+		m_openChildren.erase(pack);
+
+	m_heights.Set(block, GetBlockHeight(block));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Row access
+
+/**
+	@brief Finds the row containing a given vertical position
+
+	@return Cursor pointing to the row, or an invalid cursor if the position is past the end of the list
+ */
+PacketRowCursor PacketRowModel::FindRow(double y) const
+{
+	auto block = m_heights.Find(y);
+
+	//Skip empty blocks, in case rounding error landed us on one
+	while( (block < m_blocks.size()) && (GetRowCount(block) == 0) )
+		block ++;
+	if(block >= m_blocks.size())
+		return PacketRowCursor(m_blocks.size(), 0);
+
+	auto& b = m_blocks[block];
+	double local = max(0.0, y - m_heights.Prefix(block));
+
+	//Markers come first
+	double markerHeight = b.m_markerCount * (m_padding*2 + m_lineHeight);
+	if(local < markerHeight)
+	{
+		size_t row = floor(local / (m_padding*2 + m_lineHeight));
+		return PacketRowCursor(block, min(row, (size_t)b.m_markerCount - 1));
+	}
+	local -= markerHeight;
+
+	//Then the packet itself
+	if(!b.m_packet)
+		return PacketRowCursor(block, b.m_markerCount - 1);
+	if(local < b.m_packetHeight)
+		return PacketRowCursor(block, b.m_markerCount);
+	local -= b.m_packetHeight;
+
+	//Then the children
+	auto it = m_openChildren.find(b.m_packet);
+	if(it == m_openChildren.end())
+		return PacketRowCursor(block, b.m_markerCount);
+	auto& heights = it->second.m_heights;
+	size_t child = upper_bound(heights.begin() + 1, heights.end(), local) - (heights.begin() + 1);
+	child = min(child, it->second.m_packets.size() - 1);
+	return PacketRowCursor(block, b.m_markerCount + 1 + child);
+}
+
+/**
+	@brief Advances a cursor to the next row
+ */
+void PacketRowModel::Next(PacketRowCursor& cursor) const
+{
+	cursor.m_row ++;
+	while( (cursor.m_block < m_blocks.size()) && (cursor.m_row >= GetRowCount(cursor.m_block)) )
+	{
+		cursor.m_block ++;
+		cursor.m_row = 0;
+	}
+}
+
+/**
+	@brief Gets the vertical position of the top of a row
+ */
+double PacketRowModel::GetRowStart(const PacketRowCursor& cursor) const
+{
+	auto& b = m_blocks[cursor.m_block];
+	double y = m_heights.Prefix(cursor.m_block);
+	double markerRowHeight = m_padding*2 + m_lineHeight;
+
+	if(cursor.m_row < b.m_markerCount)
+		return y + cursor.m_row * markerRowHeight;
+	y += b.m_markerCount * markerRowHeight;
+
+	if(cursor.m_row == b.m_markerCount)
+		return y;
+	y += b.m_packetHeight;
+
+	auto& children = m_openChildren.find(b.m_packet)->second;
+	return y + children.m_heights[cursor.m_row - b.m_markerCount - 1];
+}
+
+/**
+	@brief Gets a single row
+ */
+RowData PacketRowModel::GetRow(const PacketRowCursor& cursor) const
+{
+	auto& b = m_blocks[cursor.m_block];
+	double start = GetRowStart(cursor);
+
+	//Marker
+	if(cursor.m_row < b.m_markerCount)
+	{
+		auto& markers = m_markers.find(b.m_stamp)->second;
+		RowData row(b.m_stamp, markers[GetFirstMarker(cursor.m_block) + cursor.m_row]);
+		row.m_height = m_padding*2 + m_lineHeight;
+		row.m_totalHeight = start + row.m_height;
+		return row;
+	}
+
+	//Top level packet
+	if(cursor.m_row == b.m_markerCount)
+	{
+		RowData row(b.m_stamp, b.m_packet);
+		row.m_height = b.m_packetHeight;
+		row.m_totalHeight = start + row.m_height;
+		return row;
+	}
+
+	//Child packet
+	auto& children = m_openChildren.find(b.m_packet)->second;
+	size_t child = cursor.m_row - b.m_markerCount - 1;
+	RowData row(b.m_stamp, children.m_packets[child]);
+	row.m_height = children.m_heights[child+1] - children.m_heights[child];
+	row.m_totalHeight = start + row.m_height;
+	return row;
+}
+
+/**
+	@brief Changes the height of a packet row (e.g. because its data column was expanded)
+ */
+void PacketRowModel::SetRowHeight(const PacketRowCursor& cursor, double height)
+{
+	auto& b = m_blocks[cursor.m_block];
+
+	//Marker heights are fixed
+	if(cursor.m_row < b.m_markerCount)
+		return;
+
+	if(cursor.m_row == b.m_markerCount)
+		b.m_packetHeight = height;
+
+	else
+	{
+		auto& heights = m_openChildren.find(b.m_packet)->second.m_heights;
+		size_t child = cursor.m_row - b.m_markerCount - 1;
+		double delta = height - (heights[child+1] - heights[child]);
+		for(size_t i=child+1; i<heights.size(); i++)
+			heights[i] += delta;
+	}
+
+	m_heights.Set(cursor.m_block, GetBlockHeight(cursor.m_block));
+}
+
+/**
+	@brief Gets the vertical position of the bottom of the first top level packet at or after an offset
+
+	@return Position of the row, or a negative value if the waveform isn't in the model
+ */
+double PacketRowModel::GetRowEndForOffset(TimePoint t, int64_t offset) const
+{
+	auto range = GetTimestampRange(t);
+	if(range.first == range.second)
+		return -1;
+
+	auto it = lower_bound(
+		m_blocks.begin() + range.first,
+		m_blocks.begin() + range.second,
+		offset,
+		[](const PacketRowBlock& b, int64_t off) { return b.m_offset < off; });
+	size_t block = it - m_blocks.begin();
+	if(block >= range.second)
+		block = range.second - 1;
+
+	auto& b = m_blocks[block];
+	return m_heights.Prefix(block) + b.m_markerCount * (m_padding*2 + m_lineHeight) + b.m_packetHeight;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+	@brief Gets the number of rows in a block
+ */
+size_t PacketRowModel::GetRowCount(size_t block) const
+{
+	auto& b = m_blocks[block];
+	size_t count = b.m_markerCount;
+	if(b.m_packet)
+	{
+		count ++;
+
+		auto it = m_openChildren.find(b.m_packet);
+		if(it != m_openChildren.end())
+			count += it->second.m_packets.size();
+	}
+	return count;
+}
+
+/**
+	@brief Gets the total height of all rows in a block
+ */
+double PacketRowModel::GetBlockHeight(size_t block) const
+{
+	auto& b = m_blocks[block];
+	double height = b.m_markerCount * (m_padding*2 + m_lineHeight) + b.m_packetHeight;
+	if(b.m_packet)
+	{
+		auto it = m_openChildren.find(b.m_packet);
+		if(it != m_openChildren.end())
+			height += it->second.m_heights.back();
+	}
+	return height;
+}
+
+/**
+	@brief Gets the half-open range of blocks containing packets from a waveform
+ */
+pair<size_t, size_t> PacketRowModel::GetTimestampRange(TimePoint t) const
+{
+	auto first = lower_bound(
+		m_blocks.begin(),
+		m_blocks.end(),
+		t,
+		[](const PacketRowBlock& b, TimePoint tp) { return b.m_stamp < tp; });
+	auto last = upper_bound(
+		first,
+		m_blocks.end(),
+		t,
+		[](TimePoint tp, const PacketRowBlock& b) { return tp < b.m_stamp; });
+	return pair<size_t, size_t>(first - m_blocks.begin(), last - m_blocks.begin());
+}
+
+/**
+	@brief Finds the block a marker is displayed in (the first packet after the marker, or the trailing block)
+
+	@param first	First block of the waveform
+	@param last		One past the last block of the waveform (the trailing block)
+	@param offset	Offset of the marker
+ */
+size_t PacketRowModel::GetMarkerBlock(size_t first, size_t last, int64_t offset) const
+{
+	auto it = upper_bound(
+		m_blocks.begin() + first,
+		m_blocks.begin() + last - 1,
+		offset,
+		[](int64_t off, const PacketRowBlock& b) { return off < b.m_offset; });
+	return it - m_blocks.begin();
+}
+
+/**
+	@brief Gets the index of the first marker displayed in a block
+ */
+size_t PacketRowModel::GetFirstMarker(size_t block) const
+{
+	//First block of the waveform shows everything up to the first packet
+	if( (block == 0) || (m_blocks[block-1].m_stamp != m_blocks[block].m_stamp) )
+		return 0;
+
+	//Otherwise, everything at or after the previous packet
+	auto& markers = m_markers.find(m_blocks[block].m_stamp)->second;
+	auto prev = m_blocks[block-1].m_offset;
+	auto it = lower_bound(
+		markers.begin(),
+		markers.end(),
+		prev,
+		[](const Marker& m, int64_t off) { return m.m_offset < off; });
+	return it - markers.begin();
+}
+
+/**
+	@brief Calculates the height of a packet's row, allowing for multiline text in the Info column
+ */
+double PacketRowModel::MeasurePacket(const PacketArena& arena, const Packet* pack) const
+{
+	//HACK: If column is named Info assume it can be multiline
+	if( (m_infoColumn >= 0) && arena.HasHeader(pack, m_infoColumn) )
+	{
+		auto info = arena.GetHeader(pack, m_infoColumn);
+		return m_padding*2 + ImGui::CalcTextSize(info.data(), info.data() + info.size()).y;
+	}
+
+	return m_padding*2 + m_lineHeight;
+}
+
+/**
+	@brief Measures the children of a packet being expanded
+ */
+PacketRowChildren PacketRowModel::MeasureChildren(const PacketArena& arena, PacketSpan children) const
+{
+	//TODO: account for hexdump expansion
+	PacketRowChildren ret;
+	ret.m_packets.assign(children.begin(), children.end());
+	ret.m_heights.resize(children.size() + 1);
+	ret.m_heights[0] = 0;
+	for(size_t i=0; i<children.size(); i++)
+		ret.m_heights[i+1] = ret.m_heights[i] + MeasurePacket(arena, children[i]);
+	return ret;
+}
@@ -0,0 +1,221 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketRowModel
+ */
+#ifndef PacketRowModel_h
+#define PacketRowModel_h
+
+#include "../../lib/scopehal/PacketDecoder.h"
+#include "Marker.h"
+#include "PacketArena.h"
+#include "FenwickTree.h"
+
+/**
+	@brief Context data for a single row (used for culling)
+ */
+class RowData
+{
+public:
+	RowData()
+	: m_height(0)
+	, m_totalHeight(0)
+	, m_stamp(0, 0)
+	, m_packet(nullptr)
+	, m_marker(TimePoint(0,0), 0, "")
+	{}
+
+	RowData(TimePoint t, Packet* p)
+	: m_height(0)
+	, m_totalHeight(0)
+	, m_stamp(t)
+	, m_packet(p)
+	, m_marker(t, 0, "")
+	{}
+
+	RowData(TimePoint t, const Marker& m)
+	: m_height(0)
+	, m_totalHeight(0)
+	, m_stamp(t)
+	, m_packet(nullptr)
+	, m_marker(m)
+	{}
+
+	///@brief Height of this row
+	double m_height;
+
+	///@brief Total height of the entire list up to this point
+	double m_totalHeight;
+
+	///@brief Timestamp of the waveform this packet came from
+	TimePoint m_stamp;
+
+	///@brief The packet in this row (null if m_marker is valid)
+	Packet* m_packet;
+
+	///@brief The marker in this row (ignored if m_packet is valid)
+	Marker m_marker;
+};
+
+/**
+	@brief Position of a single row within a PacketRowModel
+ */
+class PacketRowCursor
+{
+public:
+	PacketRowCursor(size_t block = 0, size_t row = 0)
+	: m_block(block)
+	, m_row(row)
+	{}
+
+	///@brief Index of the block containing the row
+	size_t m_block;
+
+	///@brief Index of the row within the block
+	size_t m_row;
+};
+
+/**
+	@brief A top level packet in the protocol analyzer, plus the rows that move with it
+
+	Each block contains the markers immediately before the packet, the packet itself, and its children if the tree
+	node is open. Every waveform also ends with a block with no packet, holding any markers after the last packet.
+ */
+class PacketRowBlock
+{
+public:
+	///@brief Timestamp of the waveform the packet came from
+	TimePoint m_stamp;
+
+	///@brief The top level packet (null for the trailing marker block)
+	Packet* m_packet;
+
+	///@brief Offset of the packet within the waveform (INT64_MAX for the trailing marker block)
+	int64_t m_offset;
+
+	///@brief Number of markers displayed before the packet
+	uint32_t m_markerCount;
+
+	///@brief Cached height of the packet's own row
+	double m_packetHeight;
+};
+
+/**
+	@brief Child rows of an expanded packet
+ */
+class PacketRowChildren
+{
+public:
+	///@brief The child packets that passed the filter
+	std::vector<Packet*> m_packets;
+
+	///@brief Cumulative heights of the children (one more entry than m_packets, starting at zero)
+	std::vector<double> m_heights;
+};
+
+/**
+	@brief Virtualized list of rows displayed by the protocol analyzer
+
+	Rather than materializing every row, the model keeps a list of blocks (see PacketRowBlock) with cached heights,
+	and cumulative block heights in a Fenwick tree. Expanding or collapsing a packet, moving a marker, or appending
+	a new waveform only touches the affected blocks plus O(log n) tree nodes, and finding the row at a given scroll
+	position is a tree search rather than a rebuild of the whole list.
+ */
+class PacketRowModel
+{
+public:
+	PacketRowModel();
+
+	bool SetMetrics(double lineHeight, double padding, int infoColumn);
+	void Clear();
+
+	void AddTimestamp(TimePoint t, const PacketArena& arena, const std::vector<Marker>& markers);
+	void RemoveTimestamp(TimePoint t);
+	void UpdateMarkers(TimePoint t, const std::vector<Marker>& markers);
+	void SetOpen(TimePoint t, const PacketArena& arena, Packet* pack, bool open);
+
+	bool empty() const
+	{ return m_blocks.empty(); }
+
+	/**
+		@brief Gets the height of the entire list
+	 */
+	double GetTotalHeight() const
+	{ return m_heights.Total(); }
+
+	PacketRowCursor FindRow(double y) const;
+
+	/**
+		@brief Checks if a cursor points to a row (false if it has run off the end of the list)
+	 */
+	bool IsValid(const PacketRowCursor& cursor) const
+	{ return cursor.m_block < m_blocks.size(); }
+
+	void Next(PacketRowCursor& cursor) const;
+	double GetRowStart(const PacketRowCursor& cursor) const;
+	RowData GetRow(const PacketRowCursor& cursor) const;
+	void SetRowHeight(const PacketRowCursor& cursor, double height);
+	double GetRowEndForOffset(TimePoint t, int64_t offset) const;
+
+protected:
+	size_t GetRowCount(size_t block) const;
+	double GetBlockHeight(size_t block) const;
+	std::pair<size_t, size_t> GetTimestampRange(TimePoint t) const;
+	size_t GetMarkerBlock(size_t first, size_t last, int64_t offset) const;
+	size_t GetFirstMarker(size_t block) const;
+	double MeasurePacket(const PacketArena& arena, const Packet* pack) const;
+	PacketRowChildren MeasureChildren(const PacketArena& arena, PacketSpan children) const;
+
+	///@brief Height of a line of text
+	double m_lineHeight;
+
+	///@brief Vertical padding at the top and bottom of each cell
+	double m_padding;
+
+	///@brief Index of the decoder's "Info" column which may be multiple lines tall, or -1 if there is none
+	int m_infoColumn;
+
+	///@brief Blocks of rows, sorted by timestamp then offset
+	std::vector<PacketRowBlock> m_blocks;
+
+	///@brief Heights of each block
+	FenwickTree<double> m_heights;
+
+	///@brief Copy of the markers for each timestamp, sorted by offset
+	std::map<TimePoint, std::vector<Marker> > m_markers;
+
+	///@brief Children of expanded packets
+	std::map<Packet*, PacketRowChildren> m_openChildren;
+};
+
+#endif
@@ -0,0 +1,304 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketSearchIndex
+ */
+#include "../scopehal/scopehal.h"
+#include "PacketArena.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketTrigramPostings
+
+/**
+	@brief Builds the index
+
+	@param pairs	Every (trigram, ID) pair to index, made by MakePair(). Sorted in place.
+ */
+void PacketTrigramPostings::Build(vector<uint64_t>& pairs)
+{
+	sort(pairs.begin(), pairs.end());
+	pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+
+	m_keys.clear();
+	m_starts.clear();
+	m_ids.resize(pairs.size());
+	for(size_t i=0; i<pairs.size(); i++)
+	{
+		uint32_t key = pairs[i] >> 32;
+		if(m_keys.empty() || (m_keys.back() != key) )
+		{
+			m_keys.push_back(key);
+			m_starts.push_back(i);
+		}
+		m_ids[i] = pairs[i] & 0xffffffff;
+	}
+	m_starts.push_back(pairs.size());
+
+	m_keys.shrink_to_fit();
+	m_starts.shrink_to_fit();
+}
+
+/**
+	@brief Finds the items which contain every trigram of a search term
+
+	The candidates are a superset of the actual matches, since the trigrams might not be in the right order.
+
+	@param needle		The search term
+	@param candidates	IDs of items which might contain the search term, in ascending order
+
+	@return False if the search term is too short to look up, in which case every item is a candidate
+ */
+bool PacketTrigramPostings::FindCandidates(string_view needle, vector<uint32_t>& candidates) const
+{
+	candidates.clear();
+	if(needle.size() < 3)
+		return false;
+
+	vector<uint32_t> trigrams;
+	GetTrigrams(reinterpret_cast<const uint8_t*>(needle.data()), needle.size(), trigrams);
+
+	//Look up each posting list. Any trigram that's not present at all means no matches
+	vector<pair<const uint32_t*, const uint32_t*> > lists;
+	for(auto t : trigrams)
+	{
+		auto it = lower_bound(m_keys.begin(), m_keys.end(), t);
+		if( (it == m_keys.end()) || (*it != t) )
+			return true;
+
+		auto i = it - m_keys.begin();
+		lists.push_back(pair<const uint32_t*, const uint32_t*>(m_ids.data() + m_starts[i], m_ids.data() + m_starts[i+1]));
+	}
+
+	//Intersect, starting from the shortest list so the working set only shrinks
+	sort(lists.begin(), lists.end(),
+		[](auto& a, auto& b) { return (a.second - a.first) < (b.second - b.first); });
+	candidates.assign(lists[0].first, lists[0].second);
+	vector<uint32_t> tmp;
+	for(size_t i=1; (i < lists.size()) && !candidates.empty(); i++)
+	{
+		tmp.clear();
+		set_intersection(
+			candidates.begin(), candidates.end(),
+			lists[i].first, lists[i].second,
+			back_inserter(tmp));
+		candidates.swap(tmp);
+	}
+	return true;
+}
+
+/**
+	@brief Gets the approximate number of bytes of memory used by the index
+ */
+size_t PacketTrigramPostings::GetMemoryUsage() const
+{
+	return (m_keys.capacity() + m_starts.capacity() + m_ids.capacity()) * sizeof(uint32_t);
+}
+
+/**
+	@brief Gets the distinct trigrams in a block of data, in ascending order
+ */
+void PacketTrigramPostings::GetTrigrams(const uint8_t* data, size_t len, vector<uint32_t>& trigrams)
+{
+	trigrams.clear();
+	for(size_t i=0; i+2 < len; i++)
+		trigrams.push_back( (data[i] << 16) | (data[i+1] << 8) | data[i+2]);
+
+	sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketSearchIndex
+
+PacketSearchIndex::PacketSearchIndex(const PacketArena& arena)
+	: m_arena(arena)
+	, m_stringsReady(false)
+	, m_dataReady(false)
+{
+}
+
+/**
+	@brief Builds both halves of the index now, rather than waiting for the first search
+ */
+void PacketSearchIndex::Build() const
+{
+	call_once(m_stringsBuilt, [this]{ BuildStringIndex(); });
+	call_once(m_dataBuilt, [this]{ BuildDataIndex(); });
+}
+
+void PacketSearchIndex::BuildStringIndex() const
+{
+	auto& pool = m_arena.GetStrings();
+
+	vector<uint64_t> pairs;
+	vector<uint32_t> trigrams;
+	for(size_t id=1; id<pool.size(); id++)
+	{
+		auto str = pool.Get(id);
+		PacketTrigramPostings::GetTrigrams(reinterpret_cast<const uint8_t*>(str.data()), str.size(), trigrams);
+		for(auto t : trigrams)
+			pairs.push_back(PacketTrigramPostings::MakePair(t, id));
+	}
+	m_strings.Build(pairs);
+	m_stringsReady = true;
+}
+
+void PacketSearchIndex::BuildDataIndex() const
+{
+	auto packets = m_arena.GetAllPackets();
+
+	vector<uint64_t> pairs;
+	vector<uint32_t> trigrams;
+	for(size_t i=0; i<packets.size(); i++)
+	{
+		auto bytes = m_arena.GetData(packets[i]);
+		PacketTrigramPostings::GetTrigrams(bytes.begin(), bytes.size(), trigrams);
+		for(auto t : trigrams)
+			pairs.push_back(PacketTrigramPostings::MakePair(t, i));
+	}
+	m_data.Build(pairs);
+	m_dataReady = true;
+}
+
+/**
+	@brief Finds all interned header strings containing (or starting with) a search term
+
+	@param needle	The search term
+	@param prefix	True to only match strings starting with the search term
+
+	@return Flag for each string ID in the arena's string pool. ID 0 (no value) only matches an empty search term,
+			since every value (even a missing one) contains and starts with the empty string.
+ */
+vector<bool> PacketSearchIndex::FindStrings(string_view needle, bool prefix) const
+{
+	call_once(m_stringsBuilt, [this]{ BuildStringIndex(); });
+
+	auto& pool = m_arena.GetStrings();
+	if(needle.empty())
+		return vector<bool>(pool.size(), true);
+	vector<bool> ret(pool.size(), false);
+
+	auto check = [&](size_t id)
+	{
+		auto str = pool.Get(id);
+		if(prefix)
+			ret[id] = (str.substr(0, needle.size()) == needle);
+		else
+			ret[id] = (str.find(needle) != string_view::npos);
+	};
+
+	vector<uint32_t> candidates;
+	if(m_strings.FindCandidates(needle, candidates))
+	{
+		for(auto id : candidates)
+			check(id);
+	}
+	else
+	{
+		for(size_t id=1; id<pool.size(); id++)
+			check(id);
+	}
+
+	return ret;
+}
+
+/**
+	@brief Finds all packets with a header value or data bytes containing a search term
+
+	@return Flag for each packet in the arena, by index
+ */
+vector<bool> PacketSearchIndex::FindPackets(string_view needle) const
+{
+	call_once(m_dataBuilt, [this]{ BuildDataIndex(); });
+
+	auto packets = m_arena.GetAllPackets();
+	vector<bool> ret(packets.size(), false);
+
+	//Header values: find the matching strings first, then which packets use them
+	auto strings = FindStrings(needle, false);
+	if(find(strings.begin(), strings.end(), true) != strings.end())
+	{
+		for(size_t col=0; col<m_arena.GetColumns().size(); col++)
+		{
+			for(size_t i=0; i<packets.size(); i++)
+			{
+				if(strings[m_arena.GetHeaderID(packets[i], col)])
+					ret[i] = true;
+			}
+		}
+	}
+
+	//Data bytes
+	auto check = [&](size_t i)
+	{
+		if(ret[i])
+			return;
+		auto bytes = m_arena.GetData(packets[i]);
+		auto it = search(
+			bytes.begin(),
+			bytes.end(),
+			needle.begin(),
+			needle.end(),
+			[](uint8_t a, char b) { return a == static_cast<uint8_t>(b); });
+		ret[i] = (it != bytes.end());
+	};
+
+	vector<uint32_t> candidates;
+	if(m_data.FindCandidates(needle, candidates))
+	{
+		for(auto i : candidates)
+			check(i);
+	}
+	else
+	{
+		for(size_t i=0; i<packets.size(); i++)
+			check(i);
+	}
+
+	return ret;
+}
+
+/**
+	@brief Gets the approximate number of bytes of memory used by the parts of the index built so far
+ */
+size_t PacketSearchIndex::GetMemoryUsage() const
+{
+	size_t ret = 0;
+	if(m_stringsReady)
+		ret += m_strings.GetMemoryUsage();
+	if(m_dataReady)
+		ret += m_data.GetMemoryUsage();
+	return ret;
+}
@@ -0,0 +1,128 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketSearchIndex
+ */
+#ifndef PacketSearchIndex_h
+#define PacketSearchIndex_h
+
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+class PacketArena;
+
+/**
+	@brief Inverted index from byte trigrams to the IDs of the items containing them
+
+	Stored as sorted keys plus one flat array of posting lists, so lookups are a binary search and posting lists are
+	contiguous and sorted by ID.
+ */
+class PacketTrigramPostings
+{
+public:
+	void Build(std::vector<uint64_t>& pairs);
+
+	bool FindCandidates(std::string_view needle, std::vector<uint32_t>& candidates) const;
+
+	size_t GetMemoryUsage() const;
+
+	static void GetTrigrams(const uint8_t* data, size_t len, std::vector<uint32_t>& trigrams);
+
+	/**
+		@brief Packs a trigram and an item ID into one value for Build()
+	 */
+	static uint64_t MakePair(uint32_t trigram, uint32_t id)
+	{ return (static_cast<uint64_t>(trigram) << 32) | id; }
+
+protected:
+	///@brief Sorted list of every trigram present
+	std::vector<uint32_t> m_keys;
+
+	///@brief Start of each trigram's posting list within m_ids, plus one past the end of the last
+	std::vector<uint32_t> m_starts;
+
+	///@brief Posting lists
+	std::vector<uint32_t> m_ids;
+};
+
+/**
+	@brief Full text index over the header values and data bytes of one PacketArena
+
+	Header values are indexed per distinct interned string rather than per packet, so a substring search only has to
+	look at strings which contain every trigram of the search term. Data bytes are indexed per packet.
+
+	PacketManager::Update() calls Build() for each new waveform as it arrives, so only the new packets are indexed and
+	searches never have to wait for indexing. Arenas created any other way (e.g. read back from the spill file) build
+	each half of the index the first time it's needed. Lookups are safe to call from multiple threads concurrently.
+ */
+class PacketSearchIndex
+{
+public:
+	PacketSearchIndex(const PacketArena& arena);
+
+	void Build() const;
+
+	std::vector<bool> FindStrings(std::string_view needle, bool prefix) const;
+	std::vector<bool> FindPackets(std::string_view needle) const;
+
+	size_t GetMemoryUsage() const;
+
+protected:
+	void BuildStringIndex() const;
+	void BuildDataIndex() const;
+
+	///@brief The arena being indexed
+	const PacketArena& m_arena;
+
+	///@brief Guards building m_strings
+	mutable std::once_flag m_stringsBuilt;
+
+	///@brief Trigrams of the interned header strings
+	mutable PacketTrigramPostings m_strings;
+
+	///@brief True once m_strings has been built
+	mutable std::atomic<bool> m_stringsReady;
+
+	///@brief Guards building m_data
+	mutable std::once_flag m_dataBuilt;
+
+	///@brief Trigrams of the data bytes of each packet
+	mutable PacketTrigramPostings m_data;
+
+	///@brief True once m_data has been built
+	mutable std::atomic<bool> m_dataReady;
+};
+
+#endif
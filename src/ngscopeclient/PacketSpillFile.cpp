@@ -0,0 +1,290 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketSpillFile
+ */
+#include "../scopehal/scopehal.h"
+#include "PacketSpillFile.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+///@brief Identifies the start of a record ("PKTS")
+static const uint32_t g_spillRecordMagic = 0x53544b50;
+
+/**
+	@brief Header at the start of each record
+ */
+struct PacketSpillHeader
+{
+	uint32_t m_magic;
+	uint32_t m_reserved;
+	int64_t m_sec;
+	int64_t m_fs;
+	uint64_t m_payloadLen;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a new, empty spill file in the system temporary directory
+ */
+PacketSpillFile::PacketSpillFile()
+	: m_end(0)
+	, m_liveSize(0)
+{
+	//Process ID plus our address is unique among all running instances
+	#ifdef _WIN32
+		auto pid = _getpid();
+	#else
+		auto pid = getpid();
+	#endif
+	char fname[128];
+	snprintf(fname, sizeof(fname), "ngscopeclient-packets-%d-%p.bin", static_cast<int>(pid), static_cast<void*>(this));
+
+	error_code ec;
+	auto dir = filesystem::temp_directory_path(ec);
+	if(ec)
+	{
+		LogWarning("Could not find temporary directory for packet spill file: %s\n", ec.message().c_str());
+		return;
+	}
+	m_path = (dir / fname).string();
+
+	m_file.open(m_path, ios::in | ios::out | ios::trunc | ios::binary);
+	if(!m_file.is_open())
+		LogWarning("Could not create packet spill file %s\n", m_path.c_str());
+	else
+		LogTrace("Created packet spill file %s\n", m_path.c_str());
+}
+
+PacketSpillFile::~PacketSpillFile()
+{
+	if(m_file.is_open())
+	{
+		m_file.close();
+
+		error_code ec;
+		filesystem::remove(m_path, ec);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Record management
+
+/**
+	@brief Finds space for a new record, reusing released space if possible
+
+	The caller must hold the mutex.
+
+	@param len	Size of the record
+
+	@return Offset of the record within the file
+ */
+uint64_t PacketSpillFile::Allocate(uint64_t len)
+{
+	for(size_t i=0; i<m_freeSpans.size(); i++)
+	{
+		auto& span = m_freeSpans[i];
+		if(span.second < len)
+			continue;
+
+		auto offset = span.first;
+		if(span.second == len)
+			m_freeSpans.erase(m_freeSpans.begin() + i);
+		else
+		{
+			span.first += len;
+			span.second -= len;
+		}
+		return offset;
+	}
+
+	auto offset = m_end;
+	m_end += len;
+	return offset;
+}
+
+/**
+	@brief Frees the space used by a record so it can be reused
+
+	@param record	The record to release
+ */
+void PacketSpillFile::Release(const PacketSpillRecord& record)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	if(record.m_len == 0)
+		return;
+	m_liveSize -= record.m_len;
+	Free(record.m_offset, record.m_len);
+}
+
+/**
+	@brief Adds a range of the file to the free list
+
+	The caller must hold the mutex.
+
+	@param offset	Start of the range
+	@param len		Size of the range
+ */
+void PacketSpillFile::Free(uint64_t offset, uint64_t len)
+{
+	//Insert in order, then merge with the spans on either side if they touch
+	auto it = lower_bound(
+		m_freeSpans.begin(),
+		m_freeSpans.end(),
+		pair<uint64_t, uint64_t>(offset, 0));
+	it = m_freeSpans.insert(it, pair<uint64_t, uint64_t>(offset, len));
+
+	auto next = it + 1;
+	if( (next != m_freeSpans.end()) && (it->first + it->second == next->first) )
+	{
+		it->second += next->second;
+		m_freeSpans.erase(next);
+	}
+
+	if(it != m_freeSpans.begin())
+	{
+		auto prev = it - 1;
+		if(prev->first + prev->second == it->first)
+		{
+			prev->second += it->second;
+			it = m_freeSpans.erase(it) - 1;
+		}
+	}
+
+	//Free space at the end of the file just moves the end back
+	if(it->first + it->second == m_end)
+	{
+		m_end = it->first;
+		m_freeSpans.erase(it);
+	}
+}
+
+/**
+	@brief Writes a waveform's packets to the file
+
+	@param t		Timestamp of the waveform
+	@param arena	The packets
+	@param record	Location of the packets within the file, for passing to Read() and Release() later
+
+	@return True on success, false if the packets could not be written (in which case they must be kept in memory)
+ */
+bool PacketSpillFile::Write(TimePoint t, const PacketArena& arena, PacketSpillRecord& record)
+{
+	//Serialize before taking the lock, this is the slow part
+	vector<uint8_t> buf(sizeof(PacketSpillHeader));
+	arena.Serialize(buf);
+
+	PacketSpillHeader header;
+	header.m_magic = g_spillRecordMagic;
+	header.m_reserved = 0;
+	header.m_sec = t.GetSec();
+	header.m_fs = t.GetFs();
+	header.m_payloadLen = buf.size() - sizeof(header);
+	memcpy(buf.data(), &header, sizeof(header));
+
+	lock_guard<mutex> lock(m_mutex);
+	if(!m_file.is_open())
+		return false;
+
+	auto offset = Allocate(buf.size());
+	m_file.seekp(offset);
+	m_file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+	m_file.flush();
+	if(!m_file)
+	{
+		LogWarning("Failed to write %zu bytes to packet spill file %s\n", buf.size(), m_path.c_str());
+		m_file.clear();
+		Free(offset, buf.size());
+		return false;
+	}
+
+	record.m_offset = offset;
+	record.m_len = buf.size();
+	record.m_timestamp = t;
+	record.m_packets = arena.size();
+	record.m_memory = arena.GetMemoryUsage();
+	m_liveSize += record.m_len;
+	return true;
+}
+
+/**
+	@brief Reads a waveform's packets back from the file
+
+	The record stays in the file until Release() is called.
+
+	@param record	Location of the packets
+
+	@return The packets, or null if they could not be read (or the record has been released and overwritten)
+ */
+shared_ptr<PacketArena> PacketSpillFile::Read(const PacketSpillRecord& record)
+{
+	vector<uint8_t> buf;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if(!m_file.is_open() || (record.m_len < sizeof(PacketSpillHeader)) || (record.m_offset + record.m_len > m_end) )
+			return nullptr;
+
+		buf.resize(record.m_len);
+		m_file.seekg(record.m_offset);
+		m_file.read(reinterpret_cast<char*>(buf.data()), buf.size());
+		if(!m_file)
+		{
+			LogWarning("Failed to read %zu bytes from packet spill file %s\n", buf.size(), m_path.c_str());
+			m_file.clear();
+			return nullptr;
+		}
+	}
+
+	PacketSpillHeader header;
+	memcpy(&header, buf.data(), sizeof(header));
+	if( (header.m_magic != g_spillRecordMagic) ||
+		(header.m_sec != record.m_timestamp.GetSec()) ||
+		(header.m_fs != record.m_timestamp.GetFs()) ||
+		(header.m_payloadLen != buf.size() - sizeof(header)) )
+	{
+		return nullptr;
+	}
+
+	return PacketArena::Deserialize(buf.data() + sizeof(header), header.m_payloadLen);
+}
@@ -0,0 +1,141 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketSpillFile
+ */
+#ifndef PacketSpillFile_h
+#define PacketSpillFile_h
+
+#include "PacketArena.h"
+
+#include <fstream>
+
+/**
+	@brief Location of one waveform's packets within a PacketSpillFile
+ */
+class PacketSpillRecord
+{
+public:
+	PacketSpillRecord()
+	: m_offset(0)
+	, m_len(0)
+	, m_packets(0)
+	, m_memory(0)
+	, m_work(0)
+	{}
+
+	///@brief Start of the record within the file
+	uint64_t m_offset;
+
+	///@brief Size of the record within the file, including its header
+	uint64_t m_len;
+
+	///@brief Timestamp of the waveform (stored in the record header too, to detect records that were overwritten)
+	TimePoint m_timestamp;
+
+	///@brief Number of packets in the record
+	size_t m_packets;
+
+	///@brief Memory used by the packets before they were written out
+	size_t m_memory;
+
+	///@brief Cost of filtering the packets (see PacketFilterJob::GetWork())
+	size_t m_work;
+};
+
+/**
+	@brief A temporary file holding packets that have been moved out of memory
+
+	Each waveform's packets are written as one record, in the format produced by PacketArena::Serialize(). Space
+	freed by released records is reused by later ones, so the file only grows as big as the most packets ever
+	stored in it at one time. The file is deleted when the object is destroyed.
+
+	All functions are thread safe, so background filter jobs may read records while the owning PacketManager is
+	writing or releasing others. A record that has been released may be overwritten at any time, in which case Read()
+	fails rather than returning the wrong packets.
+ */
+class PacketSpillFile
+{
+public:
+	PacketSpillFile();
+	~PacketSpillFile();
+
+	PacketSpillFile(const PacketSpillFile&) =delete;
+	PacketSpillFile& operator=(const PacketSpillFile&) =delete;
+
+	bool Write(TimePoint t, const PacketArena& arena, PacketSpillRecord& record);
+	std::shared_ptr<PacketArena> Read(const PacketSpillRecord& record);
+	void Release(const PacketSpillRecord& record);
+
+	/**
+		@brief Gets the number of bytes of the file used by records which have not been released
+	 */
+	uint64_t GetLiveSize()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_liveSize;
+	}
+
+	/**
+		@brief Gets the size of the file, including space freed by released records
+	 */
+	uint64_t GetFileSize()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_end;
+	}
+
+protected:
+	uint64_t Allocate(uint64_t len);
+	void Free(uint64_t offset, uint64_t len);
+
+	///@brief Guards the file and the free list
+	std::mutex m_mutex;
+
+	///@brief Path to the file
+	std::string m_path;
+
+	///@brief The open file
+	std::fstream m_file;
+
+	///@brief Released ranges of the file available for reuse, as (offset, length) sorted by offset
+	std::vector<std::pair<uint64_t, uint64_t> > m_freeSpans;
+
+	///@brief End of the last record in the file
+	uint64_t m_end;
+
+	///@brief Total size of all records not yet released
+	uint64_t m_liveSize;
+};
+
+#endif
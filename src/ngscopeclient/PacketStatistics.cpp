@@ -0,0 +1,386 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketStatistics
+ */
+
+#include "ngscopeclient.h"
+#include "PacketStatistics.h"
+
+#include <fstream>
+
+using namespace std;
+
+/**
+	@brief Calls a function on every packet in an arena that counts towards statistics
+
+	That's every top level packet, except merged packets which are replaced by their children.
+ */
+template<class F>
+static void ForEachCountedPacket(const PacketArena& arena, F func)
+{
+	for(auto p : arena.GetPackets())
+	{
+		auto children = arena.GetChildren(p);
+		if(children.empty())
+			func(p);
+		else
+		{
+			for(auto c : children)
+				func(c);
+		}
+	}
+}
+
+/**
+	@brief Parses a header value as a number (decimal or 0x-prefixed hex), ignoring surrounding whitespace
+
+	@return True if the entire value is a finite number
+ */
+static bool ParseNumber(string_view text, double& value)
+{
+	char tmp[64];
+	if(text.empty() || (text.size() >= sizeof(tmp)) )
+		return false;
+	memcpy(tmp, text.data(), text.size());
+	tmp[text.size()] = '\0';
+
+	char* end;
+	value = strtod(tmp, &end);
+	if(end == tmp)
+		return false;
+	while(isspace(*end))
+		end++;
+	return (*end == '\0') && isfinite(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PacketStatistics::PacketStatistics()
+	: m_packets(0)
+	, m_duration(0)
+	, m_numericDirty(false)
+{
+}
+
+/**
+	@brief Forgets all waveforms
+ */
+void PacketStatistics::clear()
+{
+	m_columns.clear();
+	m_waveforms.clear();
+	m_packets = 0;
+	m_duration = 0;
+	m_numericDirty = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental updates
+
+/**
+	@brief Adds a waveform's packets to the statistics
+
+	Any previous waveform at the same timestamp must have been removed first.
+ */
+void PacketStatistics::Add(TimePoint t, const PacketArena& arena)
+{
+	auto& summary = m_waveforms[t];
+
+	//Count packets and figure out how much time they span
+	int64_t start = INT64_MAX;
+	int64_t end = INT64_MIN;
+	ForEachCountedPacket(arena, [&](const Packet* p)
+		{
+			summary.m_packets ++;
+			start = min(start, p->m_offset);
+			end = max(end, p->m_offset + p->m_len);
+		});
+	if(summary.m_packets)
+		summary.m_duration = end - start;
+
+	Accumulate(arena, &summary, false);
+
+	m_packets += summary.m_packets;
+	m_duration += summary.m_duration;
+
+	//Numeric summaries can be merged in directly, unless they're about to be recomputed anyway
+	if(!m_numericDirty)
+	{
+		for(size_t i=0; i<summary.m_numeric.size(); i++)
+			m_columns[i].m_numeric.Add(summary.m_numeric[i]);
+	}
+}
+
+/**
+	@brief Removes a waveform's packets from the statistics
+
+	@param t		Timestamp the waveform was added under
+	@param arena	The same packets that were passed to Add()
+ */
+void PacketStatistics::Remove(TimePoint t, const PacketArena& arena)
+{
+	auto it = m_waveforms.find(t);
+	if(it == m_waveforms.end())
+		return;
+
+	Accumulate(arena, nullptr, true);
+
+	m_packets -= it->second.m_packets;
+	m_duration -= it->second.m_duration;
+	m_waveforms.erase(it);
+
+	m_numericDirty = true;
+}
+
+/**
+	@brief Adds or subtracts the per-value counts of a waveform
+
+	@param arena	The packets
+	@param summary	If adding, the waveform summary to fill out with numeric values
+	@param remove	True to subtract counts, false to add them
+ */
+void PacketStatistics::Accumulate(const PacketArena& arena, PacketWaveformStatistics* summary, bool remove)
+{
+	auto& strings = arena.GetStrings();
+	if(m_idCounts.size() < strings.size())
+		m_idCounts.resize(strings.size());
+
+	//Map the arena's columns to ours (before taking any references, since this may add columns)
+	auto& names = arena.GetColumns();
+	vector<size_t> columns;
+	for(auto& name : names)
+		columns.push_back(GetColumnIndex(name));
+	if(summary)
+		summary->m_numeric.resize(m_columns.size());
+
+	for(size_t icol=0; icol<names.size(); icol++)
+	{
+		auto& stats = m_columns[columns[icol]];
+
+		//Count how many packets have each value, without touching any strings yet
+		ForEachCountedPacket(arena, [&](const Packet* p)
+			{
+				auto id = arena.GetHeaderID(p, icol);
+				if(id == 0)
+					return;
+				if(m_idCounts[id] ++ == 0)
+					m_touchedIDs.push_back(id);
+			});
+
+		//Then fold each distinct value into the totals
+		for(auto id : m_touchedIDs)
+		{
+			auto n = m_idCounts[id];
+			m_idCounts[id] = 0;
+
+			auto text = strings.Get(id);
+			string value(text);
+			auto it = stats.m_valueCounts.find(value);
+
+			if(remove)
+			{
+				//If the value was added while the column was full it went to "other", but may since have been
+				//added individually by a later waveform. Either way the column total is preserved.
+				uint64_t fromValue = 0;
+				if(it != stats.m_valueCounts.end())
+				{
+					fromValue = min(it->second, n);
+					it->second -= fromValue;
+					if(it->second == 0)
+						stats.m_valueCounts.erase(it);
+				}
+				stats.m_otherCount -= min(stats.m_otherCount, n - fromValue);
+			}
+
+			else
+			{
+				if(it != stats.m_valueCounts.end())
+					it->second += n;
+				else if(stats.m_valueCounts.size() < MAX_DISTINCT_VALUES)
+					stats.m_valueCounts.emplace(value, n);
+				else
+					stats.m_otherCount += n;
+
+				double number;
+				if(summary && ParseNumber(text, number))
+					summary->m_numeric[columns[icol]].Add(number, n);
+			}
+		}
+		m_touchedIDs.clear();
+	}
+}
+
+/**
+	@brief Gets the index of a column by name, adding it if we haven't seen it before
+ */
+size_t PacketStatistics::GetColumnIndex(const string& name)
+{
+	for(size_t i=0; i<m_columns.size(); i++)
+	{
+		if(m_columns[i].m_name == name)
+			return i;
+	}
+
+	m_columns.push_back(PacketColumnStatistics(name));
+	return m_columns.size() - 1;
+}
+
+/**
+	@brief Recomputes numeric summaries from the per-waveform summaries after a waveform was removed
+ */
+void PacketStatistics::RefreshNumeric()
+{
+	for(auto& c : m_columns)
+		c.m_numeric = PacketNumericSummary();
+
+	for(auto& it : m_waveforms)
+	{
+		auto& numeric = it.second.m_numeric;
+		for(size_t i=0; i<numeric.size(); i++)
+			m_columns[i].m_numeric.Add(numeric[i]);
+	}
+
+	m_numericDirty = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Gets the statistics for a single column
+ */
+const PacketColumnStatistics& PacketStatistics::GetColumn(size_t i)
+{
+	if(m_numericDirty)
+		RefreshNumeric();
+	return m_columns[i];
+}
+
+/**
+	@brief Gets the most common values of a column, most frequent first
+
+	@param column		Column index
+	@param maxValues	Maximum number of values to return
+ */
+vector<pair<string, uint64_t> > PacketStatistics::GetSortedValues(size_t column, size_t maxValues)
+{
+	auto& counts = m_columns[column].m_valueCounts;
+	vector<pair<string, uint64_t> > ret(counts.begin(), counts.end());
+
+	auto order = [](const pair<string, uint64_t>& a, const pair<string, uint64_t>& b)
+		{
+			if(a.second != b.second)
+				return a.second > b.second;
+			return a.first < b.first;
+		};
+
+	if(ret.size() > maxValues)
+	{
+		partial_sort(ret.begin(), ret.begin() + maxValues, ret.end(), order);
+		ret.resize(maxValues);
+	}
+	else
+		sort(ret.begin(), ret.end(), order);
+
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Export
+
+/**
+	@brief Quotes a value for a CSV file if needed
+ */
+static string CSVEscape(const string& str)
+{
+	if(str.find_first_of(",\"\r\n") == string::npos)
+		return str;
+
+	string ret = "\"";
+	for(auto c : str)
+	{
+		if(c == '"')
+			ret += "\"\"";
+		else
+			ret += c;
+	}
+	ret += "\"";
+	return ret;
+}
+
+/**
+	@brief Writes per-value counts and numeric summaries of every column to a CSV file
+
+	@return True on success, false if the file could not be written
+ */
+bool PacketStatistics::ExportCSV(const string& path)
+{
+	ofstream outfs(path);
+	if(!outfs)
+	{
+		LogError("Failed to open statistics file \"%s\"\n", path.c_str());
+		return false;
+	}
+
+	outfs << "Column,Value,Count,Percent,Rate (/s)\n";
+	for(size_t i=0; i<m_columns.size(); i++)
+	{
+		auto& name = m_columns[i].m_name;
+		auto values = GetSortedValues(i);
+		if(m_columns[i].m_otherCount)
+			values.push_back(pair<string, uint64_t>("(other)", m_columns[i].m_otherCount));
+
+		for(auto& v : values)
+		{
+			outfs << CSVEscape(name) << "," << CSVEscape(v.first) << "," << v.second << ","
+				<< (m_packets ? v.second * 100.0 / m_packets : 0) << "," << GetRate(v.second) << "\n";
+		}
+	}
+
+	outfs << "\nColumn,Numeric Values,Min,Max,Mean\n";
+	for(size_t i=0; i<m_columns.size(); i++)
+	{
+		auto& numeric = GetColumn(i).m_numeric;
+		if(numeric.m_count == 0)
+			continue;
+		outfs << CSVEscape(m_columns[i].m_name) << "," << numeric.m_count << "," << numeric.m_min << ","
+			<< numeric.m_max << "," << numeric.GetMean() << "\n";
+	}
+
+	outfs << "\nTotal Packets," << m_packets << "\n";
+	outfs << "Duration (s)," << m_duration * 1e-15 << "\n";
+
+	return outfs.good();
+}
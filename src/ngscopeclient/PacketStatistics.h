@@ -0,0 +1,217 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketStatistics
+ */
+#ifndef PacketStatistics_h
+#define PacketStatistics_h
+
+#include "PacketArena.h"
+
+#include <cfloat>
+
+/**
+	@brief Count, sum, and range of the numeric values of a header column
+ */
+class PacketNumericSummary
+{
+public:
+	PacketNumericSummary()
+	: m_count(0)
+	, m_sum(0)
+	, m_min(DBL_MAX)
+	, m_max(-DBL_MAX)
+	{}
+
+	///@brief Adds n copies of a value
+	void Add(double value, uint64_t n)
+	{
+		m_count += n;
+		m_sum += value * n;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+	}
+
+	///@brief Merges another summary into this one
+	void Add(const PacketNumericSummary& rhs)
+	{
+		m_count += rhs.m_count;
+		m_sum += rhs.m_sum;
+		m_min = std::min(m_min, rhs.m_min);
+		m_max = std::max(m_max, rhs.m_max);
+	}
+
+	double GetMean() const
+	{
+		if(m_count == 0)
+			return 0;
+		return m_sum / m_count;
+	}
+
+	///@brief Number of numeric values
+	uint64_t m_count;
+
+	///@brief Sum of all numeric values
+	double m_sum;
+
+	///@brief Smallest numeric value
+	double m_min;
+
+	///@brief Largest numeric value
+	double m_max;
+};
+
+/**
+	@brief Statistics for one header column across every waveform in history
+ */
+class PacketColumnStatistics
+{
+public:
+	PacketColumnStatistics(const std::string& name)
+	: m_name(name)
+	, m_otherCount(0)
+	{}
+
+	///@brief Name of the column
+	std::string m_name;
+
+	///@brief Number of packets with each value
+	std::unordered_map<std::string, uint64_t> m_valueCounts;
+
+	///@brief Number of packets whose value isn't in m_valueCounts because the column had too many distinct values
+	uint64_t m_otherCount;
+
+	///@brief Summary of values which parse as numbers
+	PacketNumericSummary m_numeric;
+};
+
+/**
+	@brief The parts of one waveform's statistics that can't be recomputed from the totals when it's removed
+ */
+class PacketWaveformStatistics
+{
+public:
+	PacketWaveformStatistics()
+	: m_packets(0)
+	, m_duration(0)
+	{}
+
+	///@brief Numeric summary of each column, indexed the same as PacketStatistics columns
+	std::vector<PacketNumericSummary> m_numeric;
+
+	///@brief Number of packets counted
+	uint64_t m_packets;
+
+	///@brief Time from the start of the first packet to the end of the last, in fs
+	int64_t m_duration;
+};
+
+/**
+	@brief Streaming aggregates over every packet from one protocol decoder in history
+
+	Waveforms are added and removed as a whole, as they enter and leave history. Only the packets actually
+	decoded are counted: for merged packets the children count, not the summary row.
+
+	Per-value counts are interned string IDs counted over each waveform's arena, so each distinct value is hashed
+	once per waveform rather than once per packet. Numeric minimum and maximum can't be subtracted back out, so
+	those are recomputed from the per-waveform summaries (one entry per column per waveform) after a removal.
+ */
+class PacketStatistics
+{
+public:
+	PacketStatistics();
+
+	void clear();
+
+	void Add(TimePoint t, const PacketArena& arena);
+	void Remove(TimePoint t, const PacketArena& arena);
+
+	///@brief Gets the number of columns seen so far
+	size_t GetColumnCount() const
+	{ return m_columns.size(); }
+
+	const PacketColumnStatistics& GetColumn(size_t i);
+
+	///@brief Gets the total number of packets counted
+	uint64_t GetPacketCount() const
+	{ return m_packets; }
+
+	///@brief Gets the total duration of signal covered by packets, in fs
+	int64_t GetDuration() const
+	{ return m_duration; }
+
+	/**
+		@brief Converts a packet count to a rate, in packets per second of captured signal
+	 */
+	double GetRate(uint64_t count) const
+	{
+		if(m_duration <= 0)
+			return 0;
+		return count / (m_duration * 1e-15);
+	}
+
+	std::vector<std::pair<std::string, uint64_t> > GetSortedValues(size_t column, size_t maxValues = SIZE_MAX);
+
+	bool ExportCSV(const std::string& path);
+
+	///@brief Maximum number of distinct values tracked per column, beyond which packets are counted as "other"
+	static const size_t MAX_DISTINCT_VALUES = 4096;
+
+protected:
+	void Accumulate(const PacketArena& arena, PacketWaveformStatistics* summary, bool remove);
+	size_t GetColumnIndex(const std::string& name);
+	void RefreshNumeric();
+
+	///@brief Per-column statistics
+	std::vector<PacketColumnStatistics> m_columns;
+
+	///@brief Per-waveform summaries, needed for recomputing numeric ranges after a removal
+	std::map<TimePoint, PacketWaveformStatistics> m_waveforms;
+
+	///@brief Total number of packets counted
+	uint64_t m_packets;
+
+	///@brief Total duration of signal covered by packets, in fs
+	int64_t m_duration;
+
+	///@brief True if the numeric summaries in m_columns must be recomputed from m_waveforms
+	bool m_numericDirty;
+
+	///@brief Scratch space for counting string IDs (reused across waveforms)
+	std::vector<uint64_t> m_idCounts;
+
+	///@brief Scratch list of string IDs with nonzero entries in m_idCounts
+	std::vector<uint32_t> m_touchedIDs;
+};
+
+#endif
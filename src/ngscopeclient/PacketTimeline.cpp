@@ -0,0 +1,336 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketTimeline
+ */
+
+#include "ngscopeclient.h"
+#include "PacketTimeline.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PacketTimeline::PacketTimeline()
+	: m_filterDirty(false)
+	, m_sourcesChanged(false)
+	, m_totalRows(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Sets the packet managers to merge
+
+	Sources which were already present keep their filter results. Takes effect at the next Update().
+ */
+void PacketTimeline::SetSources(const vector<shared_ptr<PacketManager> >& mgrs)
+{
+	bool same = (mgrs.size() == m_sources.size());
+	for(size_t i=0; same && (i<mgrs.size()); i++)
+		same = (mgrs[i] == m_sources[i].m_mgr);
+	if(same)
+		return;
+
+	vector<PacketTimelineSource> sources;
+	for(auto& mgr : mgrs)
+	{
+		bool found = false;
+		for(auto& s : m_sources)
+		{
+			if(s.m_mgr == mgr)
+			{
+				sources.push_back(std::move(s));
+				found = true;
+				break;
+			}
+		}
+
+		//New sources need a full sync, including compiling the filter for their columns
+		if(!found)
+		{
+			sources.push_back(PacketTimelineSource(mgr));
+			m_filterDirty = true;
+		}
+	}
+
+	m_sources = std::move(sources);
+	m_sourcesChanged = true;
+}
+
+/**
+	@brief Sets the display filter expression. Takes effect at the next Update().
+
+	Each decoder has its own columns, so the expression is compiled separately for each one. Decoders it can't be
+	compiled for (e.g. because they don't have a column it refers to) show no packets.
+
+	@return True if the expression is empty or valid for at least one source. Invalid expressions are not applied.
+ */
+bool PacketTimeline::SetFilter(const string& expression)
+{
+	if(!expression.empty())
+	{
+		bool valid = false;
+		for(auto& s : m_sources)
+		{
+			size_t i = 0;
+			ProtocolDisplayFilter filter(expression, i);
+			if(filter.Validate(s.m_mgr->GetDecoder()->GetHeaders()))
+			{
+				valid = true;
+				break;
+			}
+		}
+		if(!valid)
+			return false;
+	}
+
+	if(expression != m_filterExpression)
+	{
+		m_filterExpression = expression;
+		m_filterDirty = true;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Synchronization with packet managers
+
+/**
+	@brief Picks up waveforms added to or removed from any source, and applies filter changes
+
+	@return True if the rows changed (so any merged rows and row indexes are invalidated)
+ */
+bool PacketTimeline::Update()
+{
+	bool changed = m_sourcesChanged || m_filterDirty;
+	for(auto& s : m_sources)
+	{
+		if(Sync(s, m_filterDirty))
+			changed = true;
+	}
+	m_filterDirty = false;
+	m_sourcesChanged = false;
+
+	if(changed)
+		ResetMerge();
+	return changed;
+}
+
+/**
+	@brief Brings one source up to date with its packet manager
+
+	Waveforms still in history keep their existing filter results unless the filter changed, so during continuous
+	acquisition only newly arrived waveforms are filtered.
+
+	@param source	The source
+	@param refilter	True if the filter expression changed
+
+	@return True if anything changed
+ */
+bool PacketTimeline::Sync(PacketTimelineSource& source, bool refilter)
+{
+	auto gen = source.m_mgr->GetGeneration();
+	if(!refilter && (gen == source.m_generation))
+		return false;
+	source.m_generation = gen;
+
+	if(refilter)
+	{
+		source.m_filter = nullptr;
+		source.m_excluded = false;
+		if(!m_filterExpression.empty())
+		{
+			auto headers = source.m_mgr->GetDecoder()->GetHeaders();
+			size_t i = 0;
+			auto filter = make_shared<ProtocolDisplayFilter>(m_filterExpression, i);
+			if(filter->Validate(headers) && filter->Compile(headers))
+				source.m_filter = filter;
+			else
+				source.m_excluded = true;
+		}
+	}
+
+	vector<PacketTimelineWaveform> waveforms;
+	vector<size_t> needFiltering;
+	if(!source.m_excluded)
+	{
+		lock_guard<recursive_mutex> lock(source.m_mgr->GetMutex());
+
+		//Both lists are in time order, so walk them together to find waveforms we already have
+		auto& old = source.m_waveforms;
+		size_t iold = 0;
+		for(auto& it : source.m_mgr->GetPackets())
+		{
+			while( (iold < old.size()) && (old[iold].m_stamp < it.first) )
+				iold ++;
+
+			if(!refilter && (iold < old.size()) && (old[iold].m_arena == it.second) )
+				waveforms.push_back(std::move(old[iold]));
+			else
+			{
+				needFiltering.push_back(waveforms.size());
+				waveforms.push_back(PacketTimelineWaveform(it.first, it.second));
+			}
+		}
+	}
+
+	//Arenas are immutable and we hold references to them, so no need to keep the manager locked while filtering
+	if(source.m_filter)
+	{
+		#pragma omp parallel for
+		for(size_t i=0; i<needFiltering.size(); i++)
+			Filter(source, waveforms[needFiltering[i]]);
+	}
+
+	source.m_waveforms = std::move(waveforms);
+	source.m_count = 0;
+	for(auto& w : source.m_waveforms)
+		source.m_count += w.GetPackets().size();
+
+	return true;
+}
+
+/**
+	@brief Runs a source's filter against one waveform
+ */
+void PacketTimeline::Filter(PacketTimelineSource& source, PacketTimelineWaveform& wfm)
+{
+	auto& arena = *wfm.m_arena;
+
+	ProtocolDisplayFilterContext context;
+	source.m_filter->Prepare(arena, context);
+
+	for(auto p : arena.GetPackets())
+	{
+		if(source.m_filter->Match(arena, context, p))
+			wfm.m_matches.push_back(p);
+	}
+	wfm.m_filtered = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Merging
+
+/**
+	@brief Throws away merged rows and restarts the merge from the first packet of each source
+ */
+void PacketTimeline::ResetMerge()
+{
+	m_rows.clear();
+	m_heap.clear();
+	m_totalRows = 0;
+
+	for(uint32_t i=0; i<m_sources.size(); i++)
+	{
+		m_totalRows += m_sources[i].m_count;
+
+		Cursor c;
+		c.m_row.m_source = i;
+		c.m_row.m_waveform = 0;
+		c.m_row.m_index = 0;
+		if(Seek(c))
+			m_heap.push_back(c);
+	}
+	make_heap(m_heap.begin(), m_heap.end());
+}
+
+/**
+	@brief Moves a cursor forward to the first packet at or after its current position, and computes its time
+
+	@return False if the source has no more packets
+ */
+bool PacketTimeline::Seek(Cursor& cursor)
+{
+	auto& row = cursor.m_row;
+	auto& waveforms = m_sources[row.m_source].m_waveforms;
+
+	while(row.m_waveform < waveforms.size())
+	{
+		auto& wfm = waveforms[row.m_waveform];
+		auto packets = wfm.GetPackets();
+		if(row.m_index < packets.size())
+		{
+			//Packet offsets can be more than a second past the start of the waveform, so normalize
+			int64_t fs = wfm.m_stamp.GetFs() + packets[row.m_index]->m_offset;
+			int64_t sec = wfm.m_stamp.GetSec() + fs / FS_PER_SECOND;
+			fs %= FS_PER_SECOND;
+			if(fs < 0)
+			{
+				fs += FS_PER_SECOND;
+				sec --;
+			}
+
+			cursor.m_sec = sec;
+			cursor.m_fs = fs;
+			return true;
+		}
+
+		row.m_waveform ++;
+		row.m_index = 0;
+	}
+
+	return false;
+}
+
+/**
+	@brief Continues the merge until at least n rows (or all of them) are available
+ */
+void PacketTimeline::MergeTo(size_t n)
+{
+	n = min(n, m_totalRows);
+	while( (m_rows.size() < n) && !m_heap.empty() )
+	{
+		pop_heap(m_heap.begin(), m_heap.end());
+		auto& c = m_heap.back();
+		m_rows.push_back(c.m_row);
+
+		c.m_row.m_index ++;
+		if(Seek(c))
+			push_heap(m_heap.begin(), m_heap.end());
+		else
+			m_heap.pop_back();
+	}
+}
+
+/**
+	@brief Gets a row, merging as far as needed to find it
+ */
+const PacketTimelineRow& PacketTimeline::GetRow(size_t i)
+{
+	MergeTo(i+1);
+	return m_rows[i];
+}
@@ -0,0 +1,214 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketTimeline
+ */
+#ifndef PacketTimeline_h
+#define PacketTimeline_h
+
+#include "PacketManager.h"
+
+/**
+	@brief Packets from one waveform of one decoder, as seen by a PacketTimeline
+ */
+class PacketTimelineWaveform
+{
+public:
+	PacketTimelineWaveform(TimePoint stamp, std::shared_ptr<PacketArena> arena)
+	: m_stamp(stamp)
+	, m_arena(arena)
+	, m_filtered(false)
+	{}
+
+	///@brief Gets the packets passing the timeline's filter
+	PacketSpan GetPackets() const
+	{
+		if(m_filtered)
+			return PacketSpan(m_matches.data(), m_matches.size());
+		return m_arena->GetPackets();
+	}
+
+	///@brief Timestamp of the waveform
+	TimePoint m_stamp;
+
+	///@brief The packets (held so they stay valid if the waveform leaves history)
+	std::shared_ptr<PacketArena> m_arena;
+
+	///@brief Top level packets that passed the filter, if m_filtered is set
+	std::vector<Packet*> m_matches;
+
+	///@brief True if a filter was applied, false to show every top level packet in the arena
+	bool m_filtered;
+};
+
+/**
+	@brief One decoder feeding a PacketTimeline
+ */
+class PacketTimelineSource
+{
+public:
+	PacketTimelineSource(std::shared_ptr<PacketManager> mgr)
+	: m_mgr(mgr)
+	, m_generation(UINT64_MAX)
+	, m_excluded(false)
+	, m_count(0)
+	{}
+
+	///@brief The packet manager we pull waveforms from
+	std::shared_ptr<PacketManager> m_mgr;
+
+	///@brief Generation of m_mgr as of the last sync
+	uint64_t m_generation;
+
+	///@brief Filter compiled against this decoder's columns, or null to show everything
+	std::shared_ptr<ProtocolDisplayFilter> m_filter;
+
+	///@brief True if the filter refers to columns this decoder doesn't have, so none of its packets are shown
+	bool m_excluded;
+
+	///@brief Waveforms in time order
+	std::vector<PacketTimelineWaveform> m_waveforms;
+
+	///@brief Total number of packets across m_waveforms
+	size_t m_count;
+};
+
+/**
+	@brief A row of a PacketTimeline, stored as indexes to keep millions of them compact
+ */
+class PacketTimelineRow
+{
+public:
+	///@brief Index of the source
+	uint32_t m_source;
+
+	///@brief Index of the waveform within the source
+	uint32_t m_waveform;
+
+	///@brief Index of the packet within the waveform's filtered packets
+	uint32_t m_index;
+};
+
+/**
+	@brief Packets from several PacketManagers in a single global time order
+
+	Each decoder's packets are already sorted (by waveform timestamp, then offset within the waveform), so the
+	timeline is a k-way merge of those existing sequences. Nothing is copied except the rows themselves, and rows are
+	only merged as far as the caller has asked for: a view showing the first screen of a million packet history
+	merges a screen's worth of rows. Scrolling further continues the merge where it left off.
+
+	The row count is known without merging, since it's the sum of each source's packet count.
+ */
+class PacketTimeline
+{
+public:
+	PacketTimeline();
+
+	void SetSources(const std::vector<std::shared_ptr<PacketManager> >& mgrs);
+	bool SetFilter(const std::string& expression);
+	bool Update();
+
+	///@brief Gets the total number of rows
+	size_t size() const
+	{ return m_totalRows; }
+
+	const PacketTimelineRow& GetRow(size_t i);
+	void MergeTo(size_t n);
+
+	///@brief Gets a source by index
+	const PacketTimelineSource& GetSource(size_t i) const
+	{ return m_sources[i]; }
+
+	size_t GetSourceCount() const
+	{ return m_sources.size(); }
+
+	///@brief Gets the waveform a row belongs to
+	const PacketTimelineWaveform& GetWaveform(const PacketTimelineRow& row) const
+	{ return m_sources[row.m_source].m_waveforms[row.m_waveform]; }
+
+	///@brief Gets the packet for a row
+	Packet* GetPacket(const PacketTimelineRow& row) const
+	{ return GetWaveform(row).GetPackets()[row.m_index]; }
+
+protected:
+	bool Sync(PacketTimelineSource& source, bool refilter);
+	void Filter(PacketTimelineSource& source, PacketTimelineWaveform& wfm);
+	void ResetMerge();
+
+	/**
+		@brief Position of the merge within one source
+	 */
+	struct Cursor
+	{
+		///@brief Absolute time of the current packet (seconds, and femtoseconds within the second)
+		int64_t m_sec;
+		int64_t m_fs;
+
+		PacketTimelineRow m_row;
+
+		///@brief Ordering for a min-heap: later times sort first, ties broken by source
+		bool operator<(const Cursor& rhs) const
+		{
+			if(m_sec != rhs.m_sec)
+				return m_sec > rhs.m_sec;
+			if(m_fs != rhs.m_fs)
+				return m_fs > rhs.m_fs;
+			return m_row.m_source > rhs.m_row.m_source;
+		}
+	};
+
+	bool Seek(Cursor& cursor);
+
+	///@brief Decoders feeding the timeline
+	std::vector<PacketTimelineSource> m_sources;
+
+	///@brief Current filter expression
+	std::string m_filterExpression;
+
+	///@brief True if the filter changed since the last Update()
+	bool m_filterDirty;
+
+	///@brief True if sources were added or removed since the last Update()
+	bool m_sourcesChanged;
+
+	///@brief Rows merged so far
+	std::vector<PacketTimelineRow> m_rows;
+
+	///@brief Heap of the next unmerged packet from each source
+	std::vector<Cursor> m_heap;
+
+	///@brief Total number of rows, merged or not
+	size_t m_totalRows;
+};
+
+#endif
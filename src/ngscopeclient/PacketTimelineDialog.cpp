@@ -0,0 +1,271 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketTimelineDialog
+ */
+
+#include "ngscopeclient.h"
+#include "PacketTimelineDialog.h"
+#include "MainWindow.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PacketTimelineDialog::PacketTimelineDialog(Session* session, MainWindow* parent)
+	: Dialog("Packet Timeline", "Packet Timeline", ImVec2(800, 400), session, parent)
+	, m_filterValid(true)
+	, m_selectedPacket(nullptr)
+	, m_lastSelectedWaveform(0, 0)
+	, m_waveformChanged(false)
+{
+}
+
+PacketTimelineDialog::~PacketTimelineDialog()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rendering
+
+/**
+	@brief Renders the dialog and handles UI events
+
+	@return		True if we should continue showing the dialog
+				False if it's been closed
+ */
+bool PacketTimelineDialog::DoRender()
+{
+	UpdateSources();
+
+	DoSourceList();
+	DoFilter();
+
+	//Pick up any new waveforms and filter changes
+	m_timeline.Update();
+
+	ImGui::Text("%zu packets", m_timeline.size());
+
+	DoTable();
+	return true;
+}
+
+/**
+	@brief Refreshes the list of decoders and tells the timeline which ones to show
+ */
+void PacketTimelineDialog::UpdateSources()
+{
+	m_decoders = m_session->GetPacketManagers();
+
+	//Forget about hidden decoders that no longer exist
+	for(auto it = m_hiddenDecoders.begin(); it != m_hiddenDecoders.end(); )
+	{
+		if(m_decoders.find(*it) == m_decoders.end())
+			it = m_hiddenDecoders.erase(it);
+		else
+			it++;
+	}
+
+	vector<shared_ptr<PacketManager> > mgrs;
+	for(auto& it : m_decoders)
+	{
+		if(m_hiddenDecoders.find(it.first) == m_hiddenDecoders.end())
+			mgrs.push_back(it.second);
+	}
+	m_timeline.SetSources(mgrs);
+}
+
+/**
+	@brief Checkboxes to choose which decoders to show
+ */
+void PacketTimelineDialog::DoSourceList()
+{
+	if(!ImGui::CollapsingHeader("Decoders"))
+		return;
+
+	for(auto& it : m_decoders)
+	{
+		auto pd = it.first;
+		bool shown = (m_hiddenDecoders.find(pd) == m_hiddenDecoders.end());
+		if(ImGui::Checkbox(pd->GetDisplayName().c_str(), &shown))
+		{
+			if(shown)
+				m_hiddenDecoders.erase(pd);
+			else
+				m_hiddenDecoders.emplace(pd);
+		}
+	}
+}
+
+/**
+	@brief Filter expression box
+ */
+void PacketTimelineDialog::DoFilter()
+{
+	ImU32 bgcolor;
+	if(m_filterExpression == "")
+		bgcolor = ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[ImGuiCol_FrameBg]);
+	else if(m_filterValid && (m_filterExpression == m_committedFilterExpression))
+		bgcolor = ColorFromString("#008000");
+	else if(m_filterValid)
+		bgcolor = ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[ImGuiCol_FrameBg]);
+	else
+		bgcolor = ColorFromString("#800000");
+
+	float boxwidth = ImGui::GetContentRegionAvail().x;
+	ImGui::SetNextItemWidth(boxwidth - ImGui::CalcTextSize("Filter").x - ImGui::GetStyle().ItemSpacing.x);
+	ImGui::PushStyleColor(ImGuiCol_FrameBg, bgcolor);
+	ImGui::InputText("Filter", &m_filterExpression);
+	bool updated = !ImGui::IsItemActive();
+	ImGui::PopStyleColor();
+	HelpMarker(
+		"Same syntax as the protocol analyzer filter.\n"
+		"Decoders without a column the expression refers to show no packets.");
+
+	//Apply when the user is done typing. If not valid for any decoder, keep the old filter active
+	if(updated && (m_committedFilterExpression != m_filterExpression))
+	{
+		m_committedFilterExpression = m_filterExpression;
+		m_filterValid = m_timeline.SetFilter(m_filterExpression);
+	}
+}
+
+/**
+	@brief The merged packet table
+
+	Only the visible rows are drawn, and the timeline only merges as far as the last visible row.
+ */
+void PacketTimelineDialog::DoTable()
+{
+	static ImGuiTableFlags flags =
+		ImGuiTableFlags_Resizable |
+		ImGuiTableFlags_BordersOuter |
+		ImGuiTableFlags_BordersV |
+		ImGuiTableFlags_ScrollY |
+		ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_SizingFixedFit;
+
+	if(!ImGui::BeginTable("timeline", 4, flags))
+		return;
+
+	float width = ImGui::GetFontSize();
+	ImGui::TableSetupScrollFreeze(0, 1);
+	ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed, 12*width);
+	ImGui::TableSetupColumn("Decoder", ImGuiTableColumnFlags_WidthFixed, 8*width);
+	ImGui::TableSetupColumn("Packet", ImGuiTableColumnFlags_WidthFixed, 30*width);
+	ImGui::TableSetupColumn("Data", ImGuiTableColumnFlags_WidthStretch);
+	ImGui::TableHeadersRow();
+
+	ImGuiListClipper clipper;
+	clipper.Begin(m_timeline.size());
+	while(clipper.Step())
+	{
+		m_timeline.MergeTo(clipper.DisplayEnd);
+
+		for(int i=clipper.DisplayStart; i<clipper.DisplayEnd; i++)
+		{
+			//Copy the row since merging further may move it
+			auto row = m_timeline.GetRow(i);
+			auto& source = m_timeline.GetSource(row.m_source);
+			auto& wfm = m_timeline.GetWaveform(row);
+			auto& arena = *wfm.m_arena;
+			auto pack = m_timeline.GetPacket(row);
+			auto decoder = source.m_mgr->GetDecoder();
+
+			pack->RefreshColors();
+
+			ImGui::PushID(i);
+			ImGui::TableNextRow(ImGuiTableRowFlags_None);
+			ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, pack->m_displayBackgroundColorPacked);
+			ImGui::PushStyleColor(ImGuiCol_Text, pack->m_displayForegroundColorPacked);
+
+			//Timestamp (and row selection)
+			ImGui::TableSetColumnIndex(0);
+			TimePoint packtime(wfm.m_stamp.GetSec(), wfm.m_stamp.GetFs() + pack->m_offset);
+			if(ImGui::Selectable(
+				packtime.PrettyPrint().c_str(),
+				m_selectedPacket == pack,
+				ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+			{
+				m_selectedPacket = pack;
+				if(m_lastSelectedWaveform != wfm.m_stamp)
+					m_waveformChanged = true;
+				m_lastSelectedWaveform = wfm.m_stamp;
+
+				m_parent->NavigateToTimestamp(pack->m_offset, pack->m_len, StreamDescriptor(decoder, 0));
+			}
+			if(ImGui::IsItemHovered())
+				m_parent->AddStatusHelp("mouse_lmb", "Jump to packet in waveform view");
+
+			//Decoder name
+			ImGui::TableSetColumnIndex(1);
+			ImGui::TextUnformatted(decoder->GetDisplayName().c_str());
+
+			//Headers
+			ImGui::TableSetColumnIndex(2);
+			string summary;
+			auto& cols = arena.GetColumns();
+			for(size_t j=0; j<cols.size(); j++)
+			{
+				if(!arena.HasHeader(pack, j))
+					continue;
+				if(!summary.empty())
+					summary += "  ";
+				summary += cols[j] + ": ";
+				summary += arena.GetHeader(pack, j);
+			}
+			ImGui::TextUnformatted(summary.c_str());
+
+			//First few data bytes
+			ImGui::TableSetColumnIndex(3);
+			auto bytes = arena.GetData(pack);
+			const size_t maxBytes = 16;
+			string data;
+			char tmp[4];
+			for(size_t j=0; j<min(bytes.size(), maxBytes); j++)
+			{
+				snprintf(tmp, sizeof(tmp), "%02x ", bytes[j]);
+				data += tmp;
+			}
+			if(bytes.size() > maxBytes)
+				data += "...";
+			ImGui::TextUnformatted(data.c_str());
+
+			ImGui::PopStyleColor();
+			ImGui::PopID();
+		}
+	}
+
+	ImGui::EndTable();
+}
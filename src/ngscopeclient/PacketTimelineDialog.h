@@ -0,0 +1,101 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketTimelineDialog
+ */
+#ifndef PacketTimelineDialog_h
+#define PacketTimelineDialog_h
+
+#include "Dialog.h"
+#include "Session.h"
+#include "PacketTimeline.h"
+
+/**
+	@brief Packets from several protocol decoders, merged into a single table in time order
+ */
+class PacketTimelineDialog : public Dialog
+{
+public:
+	PacketTimelineDialog(Session* session, MainWindow* parent);
+	virtual ~PacketTimelineDialog();
+
+	virtual bool DoRender();
+
+	/**
+		@brief Returns true if a packet from a different waveform was selected since the last call
+	 */
+	bool PollForSelectionChanges()
+	{
+		bool changed = m_waveformChanged;
+		m_waveformChanged = false;
+		return changed;
+	}
+
+	TimePoint GetSelectedWaveformTimestamp()
+	{ return m_lastSelectedWaveform; }
+
+protected:
+	void UpdateSources();
+	void DoSourceList();
+	void DoFilter();
+	void DoTable();
+
+	///@brief The merged packets
+	PacketTimeline m_timeline;
+
+	///@brief All decoders in the session
+	std::map<PacketDecoder*, std::shared_ptr<PacketManager> > m_decoders;
+
+	///@brief Decoders the user has chosen to hide
+	std::set<PacketDecoder*> m_hiddenDecoders;
+
+	///@brief Filter expression we're typing
+	std::string m_filterExpression;
+
+	///@brief Filter expression we're actually using
+	std::string m_committedFilterExpression;
+
+	///@brief True if m_filterExpression could be applied
+	bool m_filterValid;
+
+	///@brief Currently selected packet
+	Packet* m_selectedPacket;
+
+	///@brief Timestamp of the waveform containing the selected packet
+	TimePoint m_lastSelectedWaveform;
+
+	///@brief True if a packet in a new waveform was selected
+	bool m_waveformChanged;
+};
+
+#endif
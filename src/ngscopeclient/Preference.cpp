@@ -40,6 +40,8 @@
 
 using namespace std;
 
+atomic<uint64_t> Preference::m_generation(1);
+
 namespace impl
 {
 	PreferenceBuilder::PreferenceBuilder(Preference&& pref)
@@ -215,6 +217,7 @@ bool Preference::HasUnit()
 void Preference::ResetToDefault()
 {
 	m_value = std::move(m_defaultValue);
+	m_generation ++;
 }
 
 Unit& Preference::GetUnit()
@@ -37,6 +37,7 @@
 #define Preference_h
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -221,6 +222,15 @@ public:
 		this->SetEnumRaw(static_cast<std::int64_t>(value));
 	}
 
+	/**
+		@brief Returns the global preference generation
+
+		This is incremented every time the value of any preference changes, so hot-path code can cache values and
+		only go back to the tree when something actually changed.
+	 */
+	static uint64_t GetGeneration()
+	{ return m_generation.load(std::memory_order_relaxed); }
+
 public:
 	static impl::PreferenceBuilder Int(std::string identifier, int64_t defaultValue);
 	static impl::PreferenceBuilder Real(std::string identifier, double defaultValue);
@@ -256,8 +266,12 @@ private:
 	{
 		new (&m_value) T(std::move(value));
 		m_hasValue = true;
+		m_generation ++;
 	}
 
+	///@brief Change counter shared by all preferences
+	static std::atomic<uint64_t> m_generation;
+
 	void MoveFrom(Preference& other);
 };
 
@@ -0,0 +1,127 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PreferenceHandle
+ */
+
+#ifndef PreferenceHandle_h
+#define PreferenceHandle_h
+
+#include "PreferenceManager.h"
+
+/**
+	@brief Typed, pre-resolved reference to a single preference
+
+	Looks up the preference by path once at construction time, then caches its value. The cached value is only
+	re-read when the global preference generation changes, so reading a handle every frame costs one atomic load
+	rather than a walk down the preference tree.
+
+	Integer handles work for both Int and Enum preferences.
+ */
+template<typename T>
+class PreferenceHandle
+{
+public:
+	PreferenceHandle(PreferenceManager& prefs, const std::string& path)
+		: m_pref(&prefs.GetPreference(path))
+		, m_value()
+		, m_generation(0)
+	{}
+
+	/**
+		@brief Returns the current value of the preference
+	 */
+	const T& Get()
+	{
+		Refresh();
+		return m_value;
+	}
+
+	/**
+		@brief Returns true if the preference may have changed since the last call to Get() or HasChanged()
+
+		Any preference change bumps the global generation, so this can return true for changes to unrelated
+		preferences. Callers should treat it as a hint to recompute, not as proof of a change.
+	 */
+	bool HasChanged()
+	{ return Refresh(); }
+
+	Preference& GetPreference()
+	{ return *m_pref; }
+
+protected:
+	bool Refresh()
+	{
+		auto gen = Preference::GetGeneration();
+		if(gen == m_generation)
+			return false;
+
+		Read(m_value);
+		m_generation = gen;
+		return true;
+	}
+
+	void Read(bool& value)
+	{ value = m_pref->GetBool(); }
+
+	void Read(double& value)
+	{ value = m_pref->GetReal(); }
+
+	void Read(int64_t& value)
+	{
+		if(m_pref->GetType() == PreferenceType::Enum)
+			value = m_pref->GetEnumRaw();
+		else
+			value = m_pref->GetInt();
+	}
+
+	void Read(ImU32& value)
+	{ value = m_pref->GetColor(); }
+
+	void Read(std::string& value)
+	{ value = m_pref->GetString(); }
+
+	void Read(FontDescription& value)
+	{ value = m_pref->GetFont(); }
+
+	///@brief The preference we're tracking (tree nodes are never deleted, so this stays valid)
+	Preference* m_pref;
+
+	///@brief Cached value of the preference
+	T m_value;
+
+	///@brief Preference generation m_value was read at
+	uint64_t m_generation;
+};
+
+#endif
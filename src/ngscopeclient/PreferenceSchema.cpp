@@ -468,6 +468,16 @@ void PreferenceManager::InitializeDefaults()
 				Preference::Font("x_axis_font", FontDescription(FindDataFile("fonts/DejaVuSans.ttf"), 15))
 				.Label("X axis font")
 				.Description("Font used for X axis text"));
+			timeline.AddPreference(
+				Preference::Bool("show_overview", true)
+				.Label("Show overview")
+				.Description(
+					"Show a strip above the timeline with an outline of the entire acquisition of the first "
+					"analog channel in the group, which can be clicked to jump to that point"));
+			timeline.AddPreference(
+				Preference::Color("overview_window_color", ColorFromString("#ffffff40"))
+				.Label("Overview window color")
+				.Description("Color for the highlight showing the visible region in the overview strip"));
 
 		auto& toolbar = appearance.AddCategory("Toolbar");
 			toolbar.AddPreference(
@@ -627,6 +637,62 @@ void PreferenceManager::InitializeDefaults()
 				Preference::Int("recent_instrument_count", 20)
 				.Label("Recent instrument count")
 				.Description("Number of recently used instruments to display"));
+		auto& analyzer = misc.AddCategory("Protocol Analyzer");
+			analyzer.AddPreference(
+				Preference::Int("packet_memory_limit", 1024)
+				.Label("Packet memory limit (MB)")
+				.Description(
+					"Maximum amount of memory used to store decoded packets from history, per protocol decoder.\n\n"
+					"When the limit is exceeded, packets from the oldest waveforms are moved out of memory as specified "
+					"by the overflow policy. The newest waveform and the selected waveform are always kept.\n\n"
+					"Set to zero for no limit.")
+				.Unit(Unit::UNIT_COUNTS));
+			analyzer.AddPreference(
+				Preference::Enum("packet_overflow_policy", 0)
+				.Label("Packet overflow policy")
+				.Description(
+					"Specify what to do with packets from old waveforms once the memory limit is reached.\n"
+					"\n"
+					"Spill to disk writes them to a temporary file. They are loaded back when the waveform is selected in "
+					"history, or when a display filter matches some of them.\n"
+					"\n"
+					"Discard frees them. They are decoded again if the waveform is selected in history, but display "
+					"filters will not find them."
+					)
+				.EnumValue("Spill to disk", 0)
+				.EnumValue("Discard", 1)
+				);
+		auto& mrender = misc.AddCategory("Rendering");
+			mrender.AddPreference(
+				Preference::Enum("waveform_rasterizer", RASTERIZER_AUTO)
+				.Label("Waveform rasterizer")
+				.Description(
+					"Specify where analog and digital waveforms are rasterized.\n"
+					"\n"
+					"GPU runs the rasterizer as a Vulkan compute shader.\n"
+					"\n"
+					"CPU runs an equivalent vectorized native implementation on all CPU cores. This is much faster "
+					"when the Vulkan device is a software implementation such as llvmpipe or SwiftShader.\n"
+					"\n"
+					"Automatic uses the CPU rasterizer if the Vulkan device is a CPU, and the GPU otherwise."
+					)
+				.EnumValue("Automatic", RASTERIZER_AUTO)
+				.EnumValue("GPU", RASTERIZER_GPU)
+				.EnumValue("CPU", RASTERIZER_CPU)
+				);
+			mrender.AddPreference(
+				Preference::Int("rasterizer_queues", 4)
+				.Label("Rasterizer queues")
+				.Description(
+					"Maximum number of command buffers waveform rasterization is split across.\n"
+					"\n"
+					"Waveform groups that don't display any of the same waveforms are recorded by separate threads "
+					"and submitted to separate compute queues (if the Vulkan device has enough), so large layouts "
+					"with many groups are rasterized concurrently.\n"
+					"\n"
+					"Set to 1 to rasterize everything on a single queue."
+					)
+				.Unit(Unit::UNIT_COUNTS));
 
 	auto& pwr = this->m_treeRoot.AddCategory("Power");
 		auto& events = pwr.AddCategory("Events");
@@ -88,4 +88,11 @@ enum IconTheme_t
 	ICON_THEME_DARK
 };
 
+enum WaveformRasterizer
+{
+	RASTERIZER_AUTO,
+	RASTERIZER_GPU,
+	RASTERIZER_CPU
+};
+
 #endif
@@ -63,6 +63,7 @@ ProtocolAnalyzerDialog::ProtocolAnalyzerDialog(
 	, m_needToScrollToSelectedPacket(false)
 	, m_firstDataBlockOfFrame(true)
 	, m_bytesPerLine(1)
+	, m_statsColumn(0)
 {
 	//Hold a reference open to the filter so it doesn't disappear on us
 	m_filter->AddRef();
@@ -85,7 +86,18 @@ void ProtocolAnalyzerDialog::SetFilterExpression(const string& f)
 	size_t ifilter = 0;
 	auto pfilter = make_shared<ProtocolDisplayFilter>(f, ifilter);
 	if(pfilter->Validate(cols))
-		m_mgr->SetDisplayFilter(pfilter);
+		ApplyDisplayFilter(pfilter);
+}
+
+/**
+	@brief Installs a validated filter expression, keeping the old one active if it fails to compile
+ */
+void ProtocolAnalyzerDialog::ApplyDisplayFilter(shared_ptr<ProtocolDisplayFilter> filter)
+{
+	if(m_mgr->SetDisplayFilter(filter))
+		m_filterError = "";
+	else
+		m_filterError = filter->GetError();
 }
 
 /**
@@ -99,6 +111,21 @@ bool ProtocolAnalyzerDialog::DoRender()
 	//Keep title in sync
 	m_title = string("Protocol: ") + m_filter->GetDisplayName();
 
+	//Statistics export
+	if(m_exportDialog)
+	{
+		m_exportDialog->Render();
+
+		if(m_exportDialog->IsClosedOK())
+		{
+			lock_guard<recursive_mutex> lock(m_mgr->GetMutex());
+			m_mgr->GetStatistics().ExportCSV(m_exportDialog->GetFileName());
+		}
+
+		if(m_exportDialog->IsClosed())
+			m_exportDialog = nullptr;
+	}
+
 	static ImGuiTableFlags flags =
 		ImGuiTableFlags_Resizable |
 		ImGuiTableFlags_BordersOuter |
@@ -129,9 +156,10 @@ bool ProtocolAnalyzerDialog::DoRender()
 	ImU32 bgcolor;
 	size_t ifilter = 0;
 	ProtocolDisplayFilter filter(m_filterExpression, ifilter);
+	bool compileFailed = !m_filterError.empty() && (m_committedFilterExpression == m_filterExpression);
 	if(m_filterExpression == "")
 		bgcolor = ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[ImGuiCol_FrameBg]);
-	else if(filter.Validate(cols))
+	else if(filter.Validate(cols) && !compileFailed)
 		bgcolor = ColorFromString("#008000");
 	else
 		bgcolor = ColorFromString("#800000");
@@ -156,12 +184,11 @@ bool ProtocolAnalyzerDialog::DoRender()
 			lock_guard<recursive_mutex> lock(m_mgr->GetMutex());
 
 			auto& packets = m_mgr->GetPackets();
-			for(auto it : packets)
-				itotal += it.second.size();
-
-			auto& filt = m_mgr->GetFilteredPackets();
-			for(auto it : filt)
-				idisplayed += it.second.size();
+			for(auto& it : packets)
+			{
+				itotal += it.second->GetPackets().size();
+				idisplayed += it.second->GetFilteredPackets().size();
+			}
 		}
 		char stmp[128];
 		snprintf(stmp, sizeof(stmp), "%zu / %zu packets displayed (%.2f %%)\n",
@@ -169,11 +196,35 @@ bool ProtocolAnalyzerDialog::DoRender()
 
 		ImGui::BeginTooltip();
 		ImGui::PushTextWrapPos(ImGui::GetFontSize() * 50);
+		if(compileFailed)
+			ImGui::Text("Filter not applied: %s", m_filterError.c_str());
 		ImGui::TextUnformatted(stmp);
 		ImGui::PopTextWrapPos();
 		ImGui::EndTooltip();
 	}
 
+	//Show progress of long running filter jobs
+	if(m_mgr->IsFilterRunning())
+		ImGui::ProgressBar(m_mgr->GetFilterProgress(), ImVec2(boxwidth, 0), "Filtering...");
+
+	//Quick search
+	ImGui::SetNextItemWidth(boxwidth - ImGui::CalcTextSize("Search").x - ImGui::GetStyle().ItemSpacing.x);
+	if(ImGui::InputTextWithHint(
+		"Search",
+		"Text in any column or data, press Enter for next match",
+		&m_searchText,
+		ImGuiInputTextFlags_EnterReturnsTrue))
+	{
+		FindNextSearchResult();
+
+		//Keep focus so Enter can be pressed again
+		ImGui::SetKeyboardFocusHere(-1);
+	}
+	if(ImGui::IsItemEdited())
+		m_searchStatus = "";
+	if(!m_searchStatus.empty())
+		ImGui::TextUnformatted(m_searchStatus.c_str());
+
 	//Output format for data column
 	//If this is changed force a refresh
 	bool forceRefresh = false;
@@ -187,8 +238,10 @@ bool ProtocolAnalyzerDialog::DoRender()
 	//Do an update cycle to make sure any recently acquired packets are captured
 	m_mgr->Update();
 
+	DoStatistics();
+
 	lock_guard<recursive_mutex> lock(m_mgr->GetMutex());
-	auto& rows = m_mgr->GetRows();
+	auto& rows = m_mgr->GetRowModel();
 
 	m_firstDataBlockOfFrame = true;
 	int lastTextColumn = 0;
@@ -216,7 +269,7 @@ bool ProtocolAnalyzerDialog::DoRender()
 		ImGui::TableHeadersRow();
 
 		ImGuiListClipper clipper;
-		clipper.Begin((int)rows.back().m_totalHeight, 1.0f);
+		clipper.Begin((int)rows.GetTotalHeight(), 1.0f);
 
 		//see https://github.com/ocornut/imgui/issues/6042
 		// hacky way to disable clipper.Step() submitting a range for an offscreen row that has focus
@@ -229,21 +282,18 @@ bool ProtocolAnalyzerDialog::DoRender()
 
 		//Go through the rows and render them, culling anything offscreen
 		bool visibleRowSelected = false;
+		PacketArena* arena = nullptr;
+		TimePoint arenaStamp(0, 0);
 		while(clipper.Step())
 		{
 			double minY = (double)clipper.DisplayStart;
 			double maxY = (double)clipper.DisplayEnd;
 
-			const auto sit = std::lower_bound(
-				rows.begin(),
-				rows.end(),
-				minY,
-				[](const RowData& data, double f) { return f > data.m_totalHeight; });
-			size_t istart = sit - rows.begin();
-
-			for (size_t i = istart; i < rows.size() && (!i || maxY > rows[i - 1].m_totalHeight); i++)
+			auto cursor = rows.FindRow(minY);
+			bool firstRow = true;
+			for(; rows.IsValid(cursor) && (rows.GetRowStart(cursor) < maxY); rows.Next(cursor))
 			{
-				auto& row = rows[i];
+				auto row = rows.GetRow(cursor);
 
 				ImGui::PushID(row.m_stamp.first);
 				ImGui::PushID(row.m_stamp.second);
@@ -251,6 +301,13 @@ bool ProtocolAnalyzerDialog::DoRender()
 				//Is it a packet?
 				auto pack = row.m_packet;
 
+				//Rows are sorted by waveform, so the arena only changes at waveform boundaries
+				if(pack && (!arena || (arenaStamp != row.m_stamp)) )
+				{
+					arena = m_mgr->GetArena(row.m_stamp);
+					arenaStamp = row.m_stamp;
+				}
+
 				//Make sure we have the packed colors cached
 				if(pack)
 					pack->RefreshColors();
@@ -282,13 +339,9 @@ bool ProtocolAnalyzerDialog::DoRender()
 				//See if we have child packets
 				bool hasChildren = false;
 				if(pack)
-				{
-					auto children = m_mgr->GetFilteredChildPackets(pack);
-					hasChildren = !children.empty();
-				}
+					hasChildren = !arena->GetFilteredChildren(pack).empty();
 
-				float rowStart = rows[i].m_totalHeight - rows[i].m_height;
-				bool firstRow = (i == istart);
+				float rowStart = row.m_totalHeight - row.m_height;
 
 				//Timestamp (and row selection logic)
 				ImGui::TableSetColumnIndex(0);
@@ -299,12 +352,8 @@ bool ProtocolAnalyzerDialog::DoRender()
 				{
 					open = ImGui::TreeNodeEx("##tree", ImGuiTreeNodeFlags_OpenOnArrow);
 
-					if(m_mgr->IsChildOpen(pack) != open)
-					{
-						m_mgr->SetChildOpen(pack, open);
-						LogTrace("tree node opened or closed, forcing refresh\n");
-						forceRefresh = true;
-					}
+					if(arena->IsChildOpen(pack) != open)
+						m_mgr->SetChildOpen(row.m_stamp, pack, open);
 
 					if(open)
 						ImGui::TreePop();
@@ -371,7 +420,8 @@ bool ProtocolAnalyzerDialog::DoRender()
 							if(firstRow)
 								ImGui::SetCursorPosY(ImGui::GetCursorPosY() - (ImGui::GetScrollY() - rowStart));
 
-							ImGui::TextUnformatted(pack->m_headers[cols[j]].c_str());
+							auto text = arena->GetHeader(pack, j);
+							ImGui::TextUnformatted(text.data(), text.data() + text.size());
 						}
 					}
 
@@ -383,7 +433,7 @@ bool ProtocolAnalyzerDialog::DoRender()
 							if(firstRow)
 								ImGui::SetCursorPosY(ImGui::GetCursorPosY() - (ImGui::GetScrollY() - rowStart));
 
-							DoDataColumn(pack, dataFont, rows, i);
+							DoDataColumn(*arena, pack, dataFont, rows, cursor, row.m_height);
 						}
 					}
 
@@ -394,7 +444,7 @@ bool ProtocolAnalyzerDialog::DoRender()
 							if(firstRow)
 								ImGui::SetCursorPosY(ImGui::GetCursorPosY() - (ImGui::GetScrollY() - rowStart));
 
-							DoImageColumn(pack, rows, i);
+							DoImageColumn(*arena, pack);
 						}
 					}
 
@@ -418,22 +468,19 @@ bool ProtocolAnalyzerDialog::DoRender()
 				ImGui::PopID();
 				ImGui::PopID();
 				ImGui::PopID();
+
+				firstRow = false;
 			}
 		}
 
 		//Only scroll if requested packet is off screen
 		if(m_needToScrollToSelectedPacket && !visibleRowSelected)
 		{
-			//Go through our visible rows to find the closest packet
+			//Find the closest packet in the selected waveform
 			//(may not be the selected one we're just trying to scroll to that general area)
-			const auto sit = std::lower_bound(
-				rows.begin(),
-				rows.end(),
-				m_selectedPacket->m_offset,
-				[](const RowData& data, double f)
-					{ return f > (data.m_packet? data.m_packet->m_offset : data.m_marker.m_offset); });
-			auto& row = *sit;
-			ImGui::SetScrollFromPosY(ImGui::GetCursorStartPos().y + row.m_totalHeight);
+			double y = rows.GetRowEndForOffset(m_lastSelectedWaveform, m_selectedPacket->m_offset);
+			if(y >= 0)
+				ImGui::SetScrollFromPosY(ImGui::GetCursorStartPos().y + y);
 
 			m_needToScrollToSelectedPacket = false;
 		}
@@ -444,14 +491,16 @@ bool ProtocolAnalyzerDialog::DoRender()
 	}
 
 	//Apply filter expressions
-	if( (updated && filterDirty) || forceRefresh)
+	if(updated && filterDirty)
 	{
-		if(!forceRefresh)
-			m_committedFilterExpression = m_filterExpression;
+		m_committedFilterExpression = m_filterExpression;
 
 		//No filter expression? Nothing to do
 		if(m_filterExpression == "")
+		{
 			m_mgr->SetDisplayFilter(nullptr);
+			m_filterError = "";
+		}
 		else
 		{
 			//Parse the expression. Apply only if valid
@@ -459,65 +508,150 @@ bool ProtocolAnalyzerDialog::DoRender()
 			ifilter = 0;
 			auto pfilter = make_shared<ProtocolDisplayFilter>(m_filterExpression, ifilter);
 			if(pfilter->Validate(cols))
-				m_mgr->SetDisplayFilter(pfilter);
+				ApplyDisplayFilter(pfilter);
 		}
 	}
 
+	//Filter results are unchanged, but the set of visible rows (or their heights) may not be
+	else if(forceRefresh)
+		m_mgr->SetRefreshPending();
+
 	return true;
 }
 
+/**
+	@brief Runs the statistics pane, showing per-value counts for one column over all packets in history
+ */
+void ProtocolAnalyzerDialog::DoStatistics()
+{
+	if(!ImGui::CollapsingHeader("Statistics"))
+		return;
+
+	lock_guard<recursive_mutex> lock(m_mgr->GetMutex());
+	auto& stats = m_mgr->GetStatistics();
+
+	Unit fs(Unit::UNIT_FS);
+	Unit hz(Unit::UNIT_HZ);
+	ImGui::Text("%" PRIu64 " packets over %s of signal (%s)",
+		stats.GetPacketCount(),
+		fs.PrettyPrint(stats.GetDuration()).c_str(),
+		hz.PrettyPrint(stats.GetRate(stats.GetPacketCount())).c_str());
+
+	//Discarded waveforms are gone for good, so the totals don't cover the whole capture
+	auto ndiscarded = m_mgr->GetDiscardedCount();
+	if(ndiscarded)
+		ImGui::TextDisabled("%zu waveforms discarded over the memory limit are not counted", ndiscarded);
+
+	if(ImGui::Button("Export..."))
+	{
+		if(!m_exportDialog)
+		{
+			m_exportDialog = MakeFileBrowser(
+				m_parent,
+				"",
+				"Export Statistics",
+				"CSV files (*.csv)",
+				"*.csv",
+				true);
+		}
+	}
+
+	if(stats.GetColumnCount() == 0)
+		return;
+
+	//Column selector
+	m_statsColumn = min(m_statsColumn, static_cast<int>(stats.GetColumnCount()) - 1);
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10);
+	if(ImGui::BeginCombo("Column", stats.GetColumn(m_statsColumn).m_name.c_str()))
+	{
+		for(size_t i=0; i<stats.GetColumnCount(); i++)
+		{
+			if(ImGui::Selectable(stats.GetColumn(i).m_name.c_str(), static_cast<int>(i) == m_statsColumn))
+				m_statsColumn = i;
+		}
+		ImGui::EndCombo();
+	}
+
+	auto& column = stats.GetColumn(m_statsColumn);
+	auto& numeric = column.m_numeric;
+	if(numeric.m_count)
+	{
+		ImGui::Text("%" PRIu64 " numeric values: min %g, max %g, mean %g",
+			numeric.m_count, numeric.m_min, numeric.m_max, numeric.GetMean());
+	}
+
+	//Most common values
+	const size_t maxValues = 100;
+	auto values = stats.GetSortedValues(m_statsColumn, maxValues);
+	if(column.m_otherCount)
+		values.push_back(pair<string, uint64_t>("(other)", column.m_otherCount));
+
+	auto tableFlags =
+		ImGuiTableFlags_Resizable |
+		ImGuiTableFlags_BordersOuter |
+		ImGuiTableFlags_BordersV |
+		ImGuiTableFlags_ScrollY |
+		ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_SizingFixedFit;
+	float height = min(values.size() + 1, (size_t)8) * ImGui::GetFrameHeightWithSpacing();
+	if(ImGui::BeginTable("stats", 4, tableFlags, ImVec2(0, height)))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, ImGui::GetFontSize() * 6);
+		ImGui::TableSetupColumn("%", ImGuiTableColumnFlags_WidthFixed, ImGui::GetFontSize() * 4);
+		ImGui::TableSetupColumn("Rate", ImGuiTableColumnFlags_WidthFixed, ImGui::GetFontSize() * 6);
+		ImGui::TableHeadersRow();
+
+		for(auto& v : values)
+		{
+			ImGui::TableNextRow();
+
+			ImGui::TableSetColumnIndex(0);
+			ImGui::TextUnformatted(v.first.c_str());
+
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%" PRIu64, v.second);
+
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%.2f", stats.GetPacketCount() ? v.second * 100.0 / stats.GetPacketCount() : 0.0);
+
+			ImGui::TableSetColumnIndex(3);
+			ImGui::TextUnformatted(hz.PrettyPrint(stats.GetRate(v.second)).c_str());
+		}
+
+		ImGui::EndTable();
+	}
+}
+
 /**
 	@brief Handles the "image" column for packets
  */
-void ProtocolAnalyzerDialog::DoImageColumn(Packet* pack, vector<RowData>& rows, size_t nrow)
+void ProtocolAnalyzerDialog::DoImageColumn(const PacketArena& arena, Packet* pack)
 {
 	auto pos = ImGui::GetCursorScreenPos();
 	auto list = ImGui::GetWindowDrawList();
 	auto size = ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetTextLineHeight());
 
-	if(!rows[nrow].m_texture)
+	//Packet pointers can be reused once the old packet is deleted, so tag the image with the offset too
+	auto& atlas = m_parent->GetTextureManager()->GetScanlineAtlas();
+	uint64_t key = reinterpret_cast<uintptr_t>(pack);
+	auto image = atlas.Get(key, pack->m_offset);
+	if(!image)
 	{
-		size_t width = pack->m_data.size() / 3;
+		auto bytes = arena.GetData(pack);
+		size_t width = bytes.size() / 3;
 		if(width == 0)
 			return;
 
 		LogTrace("filling texture with 1x%zu pixels of scanline data\n", width);
-		LogIndenter li;
-
-		//TODO: this and TextureManager::LoadTexture have a lot in common
-		//we should refactor into common code
-		//TODO: reuse buffers as much as possible to avoid constant reallocations
-		VkDeviceSize devsize = width * 4;
-
-		//Allocate temporary staging buffer
-		vk::BufferCreateInfo bufinfo({}, devsize, vk::BufferUsageFlagBits::eTransferSrc);
-		vk::raii::Buffer stagingBuf(*g_vkComputeDevice, bufinfo);
-
-		//Figure out memory requirements of the buffer and decide what physical memory type to use
-		//For now, default to using the first type in the mask that is host visible
-		auto req = stagingBuf.getMemoryRequirements();
-		auto memProperties = g_vkComputePhysicalDevice->getMemoryProperties();
-		uint32_t memType = 0;
-		for(uint32_t i=0; i<32; i++)
-		{
-			//Skip anything not host visible since we have to be able to write to it
-			if(!(memProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible))
-				continue;
 
-			//Stop if buffer is compatible
-			if(req.memoryTypeBits & (1 << i) )
-			{
-				memType = i;
-				break;
-			}
-		}
-		LogTrace("Using memory type %u for staging buffer\n", memType);
-
-		//Allocate the memory and bind to the buffer
-		vk::MemoryAllocateInfo minfo(req.size, memType);
-		vk::raii::DeviceMemory physMem(*g_vkComputeDevice, minfo);
-		auto mappedPtr = reinterpret_cast<uint8_t*>(physMem.mapMemory(0, req.size));
-		stagingBuf.bindMemory(*physMem, 0);
+		//Scanlines wider than an atlas page are split across several pieces by the atlas
+		uint8_t* pixels;
+		image = atlas.Add(key, pack->m_offset, width, 1, pixels);
+		if(!image)
+			return;
 
 		//Special case: RGB LED decodes can have scaling if not running at full brightness
 		float scale = 1;
@@ -525,57 +659,33 @@ void ProtocolAnalyzerDialog::DoImageColumn(Packet* pack, vector<RowData>& rows,
 		if(rgbf)
 			scale = rgbf->GetScale();
 
-		//Fill the mapped buffer with image data
+		//Fill the staging memory with image data
 		for(size_t i=0; i<width; i++)
 		{
-			mappedPtr[i*4] 		= min(pack->m_data[i*3] * scale, 255.0f);
-			mappedPtr[i*4 + 1]	= min(pack->m_data[i*3 + 1] * scale, 255.0f);
-			mappedPtr[i*4 + 2]	= min(pack->m_data[i*3 + 2] * scale, 255.0f);
-			mappedPtr[i*4 + 3]	= 255;
+			size_t j = i*3;
+			pixels[i*4] 		= min(bytes[j] * scale, 255.0f);
+			pixels[i*4 + 1]	= min(bytes[j + 1] * scale, 255.0f);
+			pixels[i*4 + 2]	= min(bytes[j + 2] * scale, 255.0f);
+			pixels[i*4 + 3]	= 255;
 		}
-		physMem.unmapMemory();
-
-		//NOTE: Assumes the render queue is also capable of transfers (see QueueManager)
-		vk::ImageCreateInfo imageInfo(
-			{},
-			vk::ImageType::e2D,
-			vk::Format::eR8G8B8A8Unorm,
-			vk::Extent3D(width, 1, 1),
-			1,
-			1,
-			VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
-			VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-			vk::SharingMode::eExclusive,
-			{},
-			vk::ImageLayout::eUndefined
-			);
-
-		//Make the Vulkan texture for it
-		rows[nrow].m_texture = make_shared<Texture>(
-			*g_vkComputeDevice,
-			imageInfo,
-			stagingBuf,
-			width,
-			1,
-			m_parent->GetTextureManager(),
-			"ProtocolAnalyzerDialog.scanline",
-			false);
 	}
 
 	//Actually draw it
-	auto tex = rows[nrow].m_texture;
-	m_parent->AddTextureUsedThisFrame(tex);
-	list->AddImage(
-		tex->GetTexture(),
-		pos,
-		pos + size);
+	for(auto& piece : image->m_pieces)
+		m_parent->AddTextureUsedThisFrame(piece.m_region.m_texture);
+	image->Draw(list, pos, pos + size);
 }
 
 /**
 	@brief Handles the "data" column for packets
  */
-void ProtocolAnalyzerDialog::DoDataColumn(Packet* pack, FontWithSize dataFont, vector<RowData>& rows, size_t nrow)
+void ProtocolAnalyzerDialog::DoDataColumn(
+	const PacketArena& arena,
+	Packet* pack,
+	FontWithSize dataFont,
+	PacketRowModel& rows,
+	const PacketRowCursor& cursor,
+	double oldheight)
 {
 	ImGui::PushFont(dataFont.first, dataFont.second);
 
@@ -625,7 +735,7 @@ void ProtocolAnalyzerDialog::DoDataColumn(Packet* pack, FontWithSize dataFont, v
 
 	string firstLine;
 
-	auto& bytes = pack->m_data;
+	auto bytes = arena.GetData(pack);
 
 	string lineHex;
 	string lineAscii;
@@ -756,32 +866,69 @@ void ProtocolAnalyzerDialog::DoDataColumn(Packet* pack, FontWithSize dataFont, v
 	//If we have a "info" column, account for that height too
 	//HACK: we should have a list of multi row columns or something
 	double infoHeight = 0;
-	auto it = pack->m_headers.find("Info");
-	if(it != pack->m_headers.end())
+	int infoColumn = arena.GetColumnIndex("Info");
+	if( (infoColumn >= 0) && arena.HasHeader(pack, infoColumn) )
 	{
-		infoHeight = ImGui::CalcTextSize(it->second.c_str()).y;
+		auto info = arena.GetHeader(pack, infoColumn);
+		infoHeight = ImGui::CalcTextSize(info.data(), info.data() + info.size()).y;
 		height = max(height, infoHeight);
 	}
 
 	//Add padding
 	height += padding*2;
 
-	double oldheight = rows[nrow].m_height;
-	double delta = height - oldheight;
-	if(abs(delta) > 0.001)
-	{
-		//Apply the changed height
-		rows[nrow].m_height = height;
-
-		//Move every impacted row up or down as appropriate
-		for(size_t i=nrow; i<rows.size(); i++)
-			rows[i].m_totalHeight += delta;
-	}
+	//Apply the changed height (this moves every subsequent row up or down as appropriate)
+	if(abs(height - oldheight) > 0.001)
+		rows.SetRowHeight(cursor, height);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // UI event handlers
 
+/**
+	@brief Selects the next packet after the current selection matching the quick search text
+ */
+void ProtocolAnalyzerDialog::FindNextSearchResult()
+{
+	//Search again every time, so we pick up new waveforms or filter changes
+	auto results = m_mgr->Search(m_searchText);
+	if(results.empty())
+	{
+		m_searchStatus = "No matches";
+		return;
+	}
+
+	//Find the first match after the current selection, wrapping around at the end
+	size_t next = 0;
+	for(size_t i=0; i<results.size(); i++)
+	{
+		auto& r = results[i];
+		if(r.second == m_selectedPacket)
+		{
+			next = (i+1) % results.size();
+			break;
+		}
+
+		if( (r.first > m_lastSelectedWaveform) ||
+			( (r.first == m_lastSelectedWaveform) && m_selectedPacket && (r.second->m_offset > m_selectedPacket->m_offset) ) )
+		{
+			next = i;
+			break;
+		}
+	}
+
+	auto& hit = results[next];
+	if(m_lastSelectedWaveform != hit.first)
+		m_waveformChanged = true;
+	m_lastSelectedWaveform = hit.first;
+	m_selectedPacket = hit.second;
+	m_needToScrollToSelectedPacket = true;
+
+	m_parent->NavigateToTimestamp(hit.second->m_offset, hit.second->m_len, StreamDescriptor(m_filter, 0));
+
+	m_searchStatus = "Match " + to_string(next + 1) + " of " + to_string(results.size());
+}
+
 /**
 	@brief Notifies the dialog that a cursor has been moved
  */
@@ -796,18 +943,16 @@ void ProtocolAnalyzerDialog::OnCursorMoved(int64_t offset)
 		m_lastSelectedWaveform = TimePoint(data->m_startTimestamp, data->m_startFemtoseconds);
 	}
 
-	auto& allpackets = m_mgr->GetFilteredPackets();
-	auto it = allpackets.find(m_lastSelectedWaveform);
-	if(it == allpackets.end())
+	lock_guard<recursive_mutex> lock(m_mgr->GetMutex());
+	auto arena = m_mgr->GetArena(m_lastSelectedWaveform);
+	if(!arena)
 		return;
-	auto packets = it->second;
 
 	//TODO: binary search vs linear
-	for(auto p : packets)
+	for(auto p : arena->GetFilteredPackets())
 	{
 		//Check child packets first
-		auto& children = m_mgr->GetFilteredChildPackets(p);
-		for(auto c : children)
+		for(auto c : arena->GetFilteredChildren(p))
 		{
 			if(offset > (c->m_offset + c->m_len) )
 				continue;
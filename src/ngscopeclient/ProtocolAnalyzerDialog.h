@@ -36,6 +36,7 @@
 #define ProtocolAnalyzerDialog_h
 
 #include "Dialog.h"
+#include "FileBrowser.h"
 #include "Session.h"
 
 #include "../scopehal/PacketDecoder.h"
@@ -112,8 +113,19 @@ protected:
 	///@brief True if the selected packet should be scrolled to
 	bool m_needToScrollToSelectedPacket;
 
-	void DoDataColumn(Packet* pack, FontWithSize dataFont, std::vector<RowData>& rows, size_t nrow);
-	void DoImageColumn(Packet* pack, std::vector<RowData>& rows, size_t nrow);
+	void DoDataColumn(
+		const PacketArena& arena,
+		Packet* pack,
+		FontWithSize dataFont,
+		PacketRowModel& rows,
+		const PacketRowCursor& cursor,
+		double oldheight);
+	void DoImageColumn(const PacketArena& arena, Packet* pack);
+	void DoStatistics();
+
+	void FindNextSearchResult();
+
+	void ApplyDisplayFilter(std::shared_ptr<ProtocolDisplayFilter> filter);
 
 	///@brief True the first time DoDataColumn() is called in a given frame
 	bool m_firstDataBlockOfFrame;
@@ -126,6 +138,21 @@ protected:
 
 	///@brief Filter expression we're actually using
 	std::string m_committedFilterExpression;
+
+	///@brief Why the committed filter expression failed to compile (empty if it's active)
+	std::string m_filterError;
+
+	///@brief Quick search text
+	std::string m_searchText;
+
+	///@brief Description of the last quick search result
+	std::string m_searchStatus;
+
+	///@brief Column shown in the statistics pane
+	int m_statsColumn;
+
+	///@brief Browser for exporting statistics
+	std::shared_ptr<FileBrowser> m_exportDialog;
 };
 
 #endif
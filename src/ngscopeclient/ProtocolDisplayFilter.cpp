@@ -0,0 +1,945 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ProtocolDisplayFilter
+ */
+#include "../scopehal/scopehal.h"
+#include "ProtocolDisplayFilter.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ProtocolDisplayFilter
+
+ProtocolDisplayFilter::ProtocolDisplayFilter(const string& str, size_t& i)
+{
+	//One or more clauses separated by operators
+	while(i < str.length())
+	{
+		//Read the clause
+		m_clauses.push_back(new ProtocolDisplayFilterClause(str, i));
+
+		//Remove spaces before the operator
+		EatSpaces(str, i);
+		if( (i >= str.length()) || (str[i] == ')') || (str[i] == ']') )
+			break;
+
+		//Read the operator, if any
+		string tmp;
+		while(i < str.length())
+		{
+			if(isspace(str[i]) || (str[i] == '\"') || (str[i] == '(') || (str[i] == ')') )
+				break;
+
+			//An alphanumeric character after an operator other than text terminates it
+			if( (tmp != "") && !isalnum(tmp[0]) && isalnum(str[i]) )
+				break;
+
+			tmp += str[i];
+			i++;
+		}
+		m_operators.push_back(tmp);
+	}
+}
+
+ProtocolDisplayFilter::~ProtocolDisplayFilter()
+{
+	for(auto c : m_clauses)
+		delete c;
+}
+
+bool ProtocolDisplayFilter::Validate(const vector<string>& headers, bool nakedLiteralOK)
+{
+	//No clauses? valid all-pass filter
+	if(m_clauses.empty())
+		return true;
+
+	//We should always have one more clause than operator
+	if( (m_operators.size() + 1) != m_clauses.size())
+		return false;
+
+	//Operators must make sense. For now only equal/unequal and boolean and/or allowed
+	for(auto& op : m_operators)
+	{
+		if( (op != "==") &&
+			(op != "!=") &&
+			(op != "||") &&
+			(op != "&&") &&
+			(op != "startswith") &&
+			(op != "contains")
+		)
+		{
+			return false;
+		}
+	}
+
+	//If any clause is invalid, we're invalid
+	for(auto c : m_clauses)
+	{
+		if(!c->Validate(headers))
+			return false;
+	}
+
+	//A single literal is not a legal filter, it has to be compared to something
+	//(But for sub-expressions used as indexes etc, it's OK)
+	if(!nakedLiteralOK)
+	{
+		if(m_clauses.size() == 1)
+		{
+			if(m_clauses[0]->m_type != ProtocolDisplayFilterClause::TYPE_EXPRESSION)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void ProtocolDisplayFilter::EatSpaces(const string& str, size_t& i)
+{
+	while( (i < str.length()) && isspace(str[i]) )
+		i++;
+}
+
+/**
+	@brief Compiles the (already validated) expression so it can be evaluated with Match()
+
+	@param headers	Column names of the decoder the filter will be run against
+
+	@return True on success, false if the expression could not be compiled
+ */
+bool ProtocolDisplayFilter::Compile(const vector<string>& headers)
+{
+	auto program = make_unique<ProtocolDisplayFilterProgram>(headers);
+	if(!program->Compile(this))
+	{
+		m_error = program->GetError();
+		m_program = nullptr;
+		return false;
+	}
+
+	m_error = "";
+	m_program = std::move(program);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ProtocolDisplayFilterClause
+
+ProtocolDisplayFilterClause::ProtocolDisplayFilterClause(const string& str, size_t& i)
+{
+	ProtocolDisplayFilter::EatSpaces(str, i);
+
+	m_real = 0;
+	m_long = 0;
+	m_expression = 0;
+	m_invert = false;
+
+	//Parenthetical expression
+	if( (str[i] == '(') || (str[i] == '!') )
+	{
+		//Inversion
+		if(str[i] == '!')
+		{
+			m_invert = true;
+			i++;
+
+			if(str[i] != '(')
+			{
+				m_type = TYPE_ERROR;
+				i++;
+				return;
+			}
+		}
+
+		i++;
+		m_type = TYPE_EXPRESSION;
+		m_expression = new ProtocolDisplayFilter(str, i);
+
+		//eat trailing spaces
+		ProtocolDisplayFilter::EatSpaces(str, i);
+
+		//expect closing parentheses
+		if(str[i] != ')')
+			m_type = TYPE_ERROR;
+		i++;
+	}
+
+	//Quoted string
+	else if(str[i] == '\"')
+	{
+		m_type = TYPE_STRING;
+		i++;
+
+		while( (i < str.length()) && (str[i] != '\"') )
+		{
+			m_string += str[i];
+			i++;
+		}
+		if(i >= str.length())
+			return;
+
+		if(str[i] != '\"')
+			m_type = TYPE_ERROR;
+
+		i++;
+	}
+
+	//Number
+	else if(isdigit(str[i]) || (str[i] == '-') || (str[i] == '.') )
+	{
+		string tmp;
+		while( (i < str.length()) && (isdigit(str[i]) || (str[i] == '-')  || (str[i] == '.') || (str[i] == 'x')) )
+		{
+			tmp += str[i];
+			i++;
+		}
+
+		//Hex string
+		if(tmp.find("0x") == 0)
+		{
+			sscanf(tmp.c_str(), "%lx", (unsigned long*)&m_long);
+			m_type = TYPE_INT;
+		}
+
+		//Number with decimal point
+		else if(tmp.find('.') != string::npos)
+		{
+			m_real = atof(tmp.c_str());
+			m_type = TYPE_REAL;
+		}
+
+		//Number without decimal point
+		else
+		{
+			m_long = atol(tmp.c_str());
+			m_type = TYPE_INT;
+		}
+	}
+
+	//Identifier (or data)
+	else
+	{
+		m_type = TYPE_IDENTIFIER;
+
+		while( (i < str.length()) && isalnum(str[i]) )
+		{
+			m_identifier += str[i];
+			i++;
+		}
+		if(i >= str.length())
+			return;
+
+		//Opening square bracket
+		if(str[i] == '[')
+		{
+			if(m_identifier == "data")
+			{
+				m_type = TYPE_DATA;
+				i++;
+
+				//Read the index expression
+				m_expression = new ProtocolDisplayFilter(str, i);
+
+				//eat trailing spaces
+				ProtocolDisplayFilter::EatSpaces(str, i);
+
+				//expect closing square bracket
+				if(str[i] != ']')
+					m_type = TYPE_ERROR;
+				i++;
+			}
+
+			else
+			{
+				m_type = TYPE_ERROR;
+				i++;
+			}
+		}
+
+		if(m_identifier == "")
+		{
+			i++;
+			m_type = TYPE_ERROR;
+		}
+	}
+}
+
+/**
+	@brief Returns a copy of the input string with spaces removed
+ */
+string ProtocolDisplayFilterClause::EatSpaces(const string& str)
+{
+	string ret;
+	for(auto c : str)
+	{
+		if(!isspace(c))
+			ret += c;
+	}
+	return ret;
+}
+
+ProtocolDisplayFilterClause::~ProtocolDisplayFilterClause()
+{
+	if(m_expression)
+		delete m_expression;
+}
+
+bool ProtocolDisplayFilterClause::Validate(const vector<string>& headers)
+{
+	switch(m_type)
+	{
+		case TYPE_ERROR:
+			return false;
+
+		case TYPE_DATA:
+			return m_expression->Validate(headers, true);
+
+		//If we're an identifier, we must be a valid header field
+		//TODO: support comparisons on data
+		case TYPE_IDENTIFIER:
+			for(auto& h : headers)
+			{
+				//Match, removing spaces from header names if needed
+				//Note that m_identifier is now the real, un-spaced version of the identifier name
+				//so we can look it up in the packet
+				if(EatSpaces(h) == m_identifier)
+				{
+					m_identifier = h;
+					return true;
+				}
+			}
+
+			return false;
+
+		//If we're an expression, it must be valid
+		case TYPE_EXPRESSION:
+			return m_expression->Validate(headers);
+
+		default:
+			return true;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ProtocolDisplayFilterValue
+
+/**
+	@brief Converts the value to a boolean
+
+	Nonzero numbers and any string other than "0" are true, missing values are false.
+ */
+bool ProtocolDisplayFilterValue::ToBool() const
+{
+	switch(m_type)
+	{
+		case TYPE_BOOL:
+		case TYPE_NUMBER:
+			return (m_number != 0);
+
+		case TYPE_STRING:
+			return (m_text != "0");
+
+		case TYPE_NONE:
+		default:
+			return false;
+	}
+}
+
+/**
+	@brief Converts the value to a number, if possible
+
+	Strings are only considered numeric if the entire string (other than trailing whitespace) parses as a number,
+	so "12 bytes" is not equal to 12. Hex strings with a 0x prefix are accepted.
+
+	@param out	Numeric value
+
+	@return True if the value is numeric
+ */
+bool ProtocolDisplayFilterValue::ToNumber(double& out) const
+{
+	switch(m_type)
+	{
+		case TYPE_BOOL:
+		case TYPE_NUMBER:
+			out = m_number;
+			return true;
+
+		case TYPE_STRING:
+			{
+				if(m_text.empty())
+					return false;
+
+				//String values always view an entire std::string, so they're null terminated
+				auto start = m_text.data();
+				auto end = start + m_text.size();
+				char* parsed = nullptr;
+				out = strtod(start, &parsed);
+				if(parsed == start)
+					return false;
+				while( (parsed < end) && isspace(*parsed) )
+					parsed ++;
+				return (parsed == end);
+			}
+
+		case TYPE_NONE:
+		default:
+			return false;
+	}
+}
+
+/**
+	@brief Gets the text form of the value
+
+	@param scratch	Buffer used to format computed numbers
+	@param len		Size of scratch
+ */
+string_view ProtocolDisplayFilterValue::ToText(char* scratch, size_t len) const
+{
+	switch(m_type)
+	{
+		case TYPE_STRING:
+			return m_text;
+
+		case TYPE_BOOL:
+			return (m_number != 0) ? "1" : "0";
+
+		case TYPE_NUMBER:
+			if(!m_text.empty())
+				return m_text;
+			snprintf(scratch, len, "%g", m_number);
+			return scratch;
+
+		case TYPE_NONE:
+		default:
+			return "NaN";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ProtocolDisplayFilterProgram
+
+ProtocolDisplayFilterProgram::ProtocolDisplayFilterProgram(const vector<string>& headers)
+	: m_columns(headers)
+	, m_depth(0)
+	, m_maxDepth(0)
+{
+}
+
+/**
+	@brief Compiles a parsed expression
+
+	@param filter	The expression to compile. Must have been validated against the same set of headers.
+
+	@return True on success, false if the expression is malformed
+ */
+bool ProtocolDisplayFilterProgram::Compile(ProtocolDisplayFilter* filter)
+{
+	m_code.clear();
+	m_constants.clear();
+	m_constantText.clear();
+	m_textQueries.clear();
+	m_depth = 0;
+	m_maxDepth = 0;
+	m_error = "";
+
+	//Empty filter: everything matches
+	if(filter->m_clauses.empty())
+	{
+		ProtocolDisplayFilterValue v;
+		v.m_type = ProtocolDisplayFilterValue::TYPE_BOOL;
+		v.m_number = 1;
+		Emit(OP_PUSH_CONST, AddConstant(v, ""));
+	}
+	else if(!CompileExpression(filter))
+	{
+		SetError("Malformed expression");
+		return false;
+	}
+
+	//Now that the constant pool is done growing, point literal values at their text
+	for(size_t i=0; i<m_constants.size(); i++)
+	{
+		if(m_constants[i].m_type != ProtocolDisplayFilterValue::TYPE_BOOL)
+			m_constants[i].m_text = m_constantText[i];
+	}
+
+	LogTrace("Compiled filter expression to %zu instructions, stack depth %zu\n", m_code.size(), m_maxDepth);
+	if(m_depth != 1)
+	{
+		SetError("Expression does not produce a single value");
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Records why compilation failed
+
+	Only the first (innermost) error is kept, since outer levels just report that something below them failed
+ */
+void ProtocolDisplayFilterProgram::SetError(const string& err)
+{
+	if(m_error.empty())
+		m_error = err;
+}
+
+/**
+	@brief Compiles a full (possibly parenthesized) expression, leaving its value on the stack
+ */
+bool ProtocolDisplayFilterProgram::CompileExpression(ProtocolDisplayFilter* filter)
+{
+	if(filter->m_clauses.empty())
+	{
+		SetError("Empty subexpression");
+		return false;
+	}
+	if( (filter->m_operators.size() + 1) != filter->m_clauses.size())
+	{
+		SetError("Missing operator or operand");
+		return false;
+	}
+
+	size_t iclause = 0;
+	if(!CompileBinary(filter, iclause, 0))
+		return false;
+	if(iclause != filter->m_clauses.size())
+	{
+		SetError("Unexpected trailing operand");
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Precedence-climbing compilation of a clause and all following operators binding at least as tightly
+
+	@param filter			The expression being compiled
+	@param iclause			Index of the next clause to consume
+	@param minPrecedence	Lowest operator precedence to consume
+ */
+bool ProtocolDisplayFilterProgram::CompileBinary(ProtocolDisplayFilter* filter, size_t& iclause, int minPrecedence)
+{
+	size_t lhsStart = m_code.size();
+	if(!CompileClause(filter->m_clauses[iclause]))
+		return false;
+	iclause ++;
+
+	while(iclause < filter->m_clauses.size())
+	{
+		//Operator between the previous clause and the next one
+		auto& op = filter->m_operators[iclause - 1];
+		int prec = GetPrecedence(op);
+		if(prec < 0)
+		{
+			SetError(string("Unknown operator \"") + op + "\"");
+			return false;
+		}
+		if(prec < minPrecedence)
+			break;
+
+		//Boolean operators short-circuit: if the left side decides the result, skip the right side
+		//and leave the left side (as a bool) on the stack
+		if( (op == "&&") || (op == "||") )
+		{
+			Emit(OP_TO_BOOL);
+			size_t jump = m_code.size();
+			Emit( (op == "&&") ? OP_JUMP_IF_FALSE : OP_JUMP_IF_TRUE);
+			Emit(OP_POP);
+			if(!CompileBinary(filter, iclause, prec + 1))
+				return false;
+			Emit(OP_TO_BOOL);
+			m_code[jump].m_arg = m_code.size();
+		}
+
+		else
+		{
+			size_t rhsStart = m_code.size();
+			if(!CompileBinary(filter, iclause, prec + 1))
+				return false;
+
+			if(op == "==")
+				Emit(OP_EQ);
+			else if(op == "!=")
+				Emit(OP_NE);
+			else if(op == "startswith")
+			{
+				if(!CompileTextQuery(lhsStart, rhsStart, true))
+					Emit(OP_STARTSWITH);
+			}
+			else
+			{
+				if(!CompileTextQuery(lhsStart, rhsStart, false))
+					Emit(OP_CONTAINS);
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+	@brief Compiles a single clause, leaving its value on the stack
+ */
+bool ProtocolDisplayFilterProgram::CompileClause(ProtocolDisplayFilterClause* clause)
+{
+	ProtocolDisplayFilterValue v;
+	char tmp[32];
+
+	switch(clause->m_type)
+	{
+		case ProtocolDisplayFilterClause::TYPE_DATA:
+			if(!CompileExpression(clause->m_expression))
+				return false;
+			Emit(OP_DATA);
+			return true;
+
+		//Resolve header names to column indexes now so we don't have to search for them per packet
+		case ProtocolDisplayFilterClause::TYPE_IDENTIFIER:
+			for(size_t i=0; i<m_columns.size(); i++)
+			{
+				if( (m_columns[i] == clause->m_identifier) ||
+					(ProtocolDisplayFilterClause::EatSpaces(m_columns[i]) == clause->m_identifier) )
+				{
+					Emit(OP_PUSH_HEADER, i);
+					return true;
+				}
+			}
+			SetError(string("Unknown column \"") + clause->m_identifier + "\"");
+			return false;
+
+		case ProtocolDisplayFilterClause::TYPE_STRING:
+			v.m_type = ProtocolDisplayFilterValue::TYPE_STRING;
+			Emit(OP_PUSH_CONST, AddConstant(v, clause->m_string));
+			return true;
+
+		case ProtocolDisplayFilterClause::TYPE_REAL:
+			v.m_type = ProtocolDisplayFilterValue::TYPE_NUMBER;
+			v.m_number = clause->m_real;
+			snprintf(tmp, sizeof(tmp), "%f", clause->m_real);
+			Emit(OP_PUSH_CONST, AddConstant(v, tmp));
+			return true;
+
+		case ProtocolDisplayFilterClause::TYPE_INT:
+			v.m_type = ProtocolDisplayFilterValue::TYPE_NUMBER;
+			v.m_number = clause->m_long;
+			snprintf(tmp, sizeof(tmp), "%ld", clause->m_long);
+			Emit(OP_PUSH_CONST, AddConstant(v, tmp));
+			return true;
+
+		case ProtocolDisplayFilterClause::TYPE_EXPRESSION:
+			if(!CompileExpression(clause->m_expression))
+				return false;
+			if(clause->m_invert)
+				Emit(OP_NOT);
+			return true;
+
+		case ProtocolDisplayFilterClause::TYPE_ERROR:
+		default:
+			SetError("Syntax error");
+			return false;
+	}
+}
+
+/**
+	@brief Replaces a just-compiled "header contains/startswith literal" with a text query, if that's what it is
+
+	@param lhsStart		Index of the first instruction of the left hand side
+	@param rhsStart		Index of the first instruction of the right hand side
+	@param prefix		True for startswith, false for contains
+
+	@return True if the comparison was compiled to a text query
+ */
+bool ProtocolDisplayFilterProgram::CompileTextQuery(size_t lhsStart, size_t rhsStart, bool prefix)
+{
+	//Both sides have to be a single instruction
+	if( (rhsStart != lhsStart + 1) || (m_code.size() != rhsStart + 1) )
+		return false;
+	if( (m_code[lhsStart].m_op != OP_PUSH_HEADER) || (m_code[rhsStart].m_op != OP_PUSH_CONST) )
+		return false;
+
+	TextQuery query;
+	query.m_column = m_code[lhsStart].m_arg;
+	query.m_prefix = prefix;
+	query.m_text = m_constantText[m_code[rhsStart].m_arg];
+	m_textQueries.push_back(query);
+
+	m_code.resize(lhsStart);
+	m_depth -= 2;
+	Emit(OP_TEXT_QUERY, m_textQueries.size() - 1);
+	return true;
+}
+
+/**
+	@brief Appends an instruction and keeps track of the stack depth
+ */
+void ProtocolDisplayFilterProgram::Emit(Opcode op, uint32_t arg)
+{
+	m_code.push_back({op, arg});
+
+	switch(op)
+	{
+		case OP_PUSH_CONST:
+		case OP_PUSH_HEADER:
+		case OP_TEXT_QUERY:
+			m_depth ++;
+			break;
+
+		case OP_EQ:
+		case OP_NE:
+		case OP_STARTSWITH:
+		case OP_CONTAINS:
+		case OP_POP:
+			m_depth --;
+			break;
+
+		default:
+			break;
+	}
+
+	m_maxDepth = max(m_maxDepth, m_depth);
+}
+
+/**
+	@brief Adds a literal to the constant pool
+
+	@return Index of the constant
+ */
+uint32_t ProtocolDisplayFilterProgram::AddConstant(const ProtocolDisplayFilterValue& value, const string& text)
+{
+	m_constants.push_back(value);
+	m_constantText.push_back(text);
+	return m_constants.size() - 1;
+}
+
+/**
+	@brief Gets the binding strength of an operator, or -1 if it's not a legal operator
+ */
+int ProtocolDisplayFilterProgram::GetPrecedence(const string& op)
+{
+	if(op == "||")
+		return 1;
+	else if(op == "&&")
+		return 2;
+	else if( (op == "==") || (op == "!=") || (op == "startswith") || (op == "contains") )
+		return 3;
+	else
+		return -1;
+}
+
+/**
+	@brief Equality test between two values
+
+	Two strings compare as text. Anything compared against a number or boolean compares numerically, so "0x10" == 16
+	and "3.0" == 3. Missing values are never equal to anything.
+ */
+bool ProtocolDisplayFilterProgram::Equal(const ProtocolDisplayFilterValue& a, const ProtocolDisplayFilterValue& b)
+{
+	if( (a.m_type == ProtocolDisplayFilterValue::TYPE_NONE) || (b.m_type == ProtocolDisplayFilterValue::TYPE_NONE) )
+		return false;
+
+	if( (a.m_type == ProtocolDisplayFilterValue::TYPE_STRING) && (b.m_type == ProtocolDisplayFilterValue::TYPE_STRING) )
+		return (a.m_text == b.m_text);
+
+	double x;
+	double y;
+	if(a.ToNumber(x) && b.ToNumber(y))
+		return (x == y);
+	return false;
+}
+
+/**
+	@brief Resolves the program's text queries against a waveform's search index
+
+	@param arena	Arena to prepare for (header column indexes must match those the program was compiled for)
+	@param context	Results of the lookups, to pass to Match()
+ */
+void ProtocolDisplayFilterProgram::Prepare(const PacketArena& arena, ProtocolDisplayFilterContext& context) const
+{
+	auto& index = arena.GetSearchIndex();
+	context.m_queryMatches.resize(m_textQueries.size());
+	for(size_t i=0; i<m_textQueries.size(); i++)
+		context.m_queryMatches[i] = index.FindStrings(m_textQueries[i].m_text, m_textQueries[i].m_prefix);
+}
+
+/**
+	@brief Runs the program against a packet
+
+	Does not modify any state, so it's safe to evaluate many packets in parallel against the same program.
+
+	@param arena	Arena containing the packet (header column indexes must match those the program was compiled for)
+	@param context	Output of Prepare() for the arena
+	@param pack		The packet
+ */
+bool ProtocolDisplayFilterProgram::Match(
+	const PacketArena& arena,
+	const ProtocolDisplayFilterContext& context,
+	const Packet* pack) const
+{
+	//Almost every expression fits in a fixed size stack, only allocate for absurdly deep ones
+	const size_t fixedDepth = 32;
+	ProtocolDisplayFilterValue fixedStack[fixedDepth];
+	vector<ProtocolDisplayFilterValue> dynamicStack;
+	ProtocolDisplayFilterValue* stack = fixedStack;
+	if(m_maxDepth > fixedDepth)
+	{
+		dynamicStack.resize(m_maxDepth);
+		stack = dynamicStack.data();
+	}
+
+	char scratchA[32];
+	char scratchB[32];
+
+	size_t sp = 0;
+	size_t pc = 0;
+	size_t len = m_code.size();
+	while(pc < len)
+	{
+		auto& insn = m_code[pc];
+		pc ++;
+
+		switch(insn.m_op)
+		{
+			case OP_PUSH_CONST:
+				stack[sp] = m_constants[insn.m_arg];
+				sp ++;
+				break;
+
+			case OP_PUSH_HEADER:
+				{
+					auto& v = stack[sp];
+					sp ++;
+
+					if(!arena.HasHeader(pack, insn.m_arg))
+						v = ProtocolDisplayFilterValue();
+					else
+					{
+						v.m_type = ProtocolDisplayFilterValue::TYPE_STRING;
+						v.m_text = arena.GetHeader(pack, insn.m_arg);
+					}
+				}
+				break;
+
+			case OP_DATA:
+				{
+					auto& v = stack[sp-1];
+					auto bytes = arena.GetData(pack);
+					double index;
+					if(!v.ToNumber(index) || (index < 0) || (index >= bytes.size()) )
+						v = ProtocolDisplayFilterValue();
+					else
+					{
+						v.m_type = ProtocolDisplayFilterValue::TYPE_NUMBER;
+						v.m_number = bytes[static_cast<size_t>(index)];
+						v.m_text = string_view();
+					}
+				}
+				break;
+
+			case OP_EQ:
+			case OP_NE:
+				{
+					auto& a = stack[sp-2];
+					bool eq = Equal(a, stack[sp-1]);
+					sp --;
+
+					a.m_type = ProtocolDisplayFilterValue::TYPE_BOOL;
+					a.m_number = (eq == (insn.m_op == OP_EQ)) ? 1 : 0;
+				}
+				break;
+
+			case OP_STARTSWITH:
+			case OP_CONTAINS:
+				{
+					auto& a = stack[sp-2];
+					auto& b = stack[sp-1];
+					bool hit = false;
+					if(b.m_type != ProtocolDisplayFilterValue::TYPE_NONE)
+					{
+						auto haystack = a.ToText(scratchA, sizeof(scratchA));
+						auto needle = b.ToText(scratchB, sizeof(scratchB));
+
+						//Everything contains the empty string, even a missing header
+						if(needle.empty())
+							hit = true;
+						else if(a.m_type == ProtocolDisplayFilterValue::TYPE_NONE)
+							hit = false;
+						else if(insn.m_op == OP_STARTSWITH)
+							hit = (haystack.substr(0, needle.size()) == needle);
+						else
+							hit = (haystack.find(needle) != string_view::npos);
+					}
+					sp --;
+
+					a.m_type = ProtocolDisplayFilterValue::TYPE_BOOL;
+					a.m_number = hit ? 1 : 0;
+				}
+				break;
+
+			case OP_NOT:
+			case OP_TO_BOOL:
+				{
+					auto& v = stack[sp-1];
+					bool b = v.ToBool();
+					v.m_type = ProtocolDisplayFilterValue::TYPE_BOOL;
+					v.m_number = (b == (insn.m_op == OP_TO_BOOL)) ? 1 : 0;
+				}
+				break;
+
+			case OP_JUMP_IF_FALSE:
+				if(!stack[sp-1].ToBool())
+					pc = insn.m_arg;
+				break;
+
+			case OP_JUMP_IF_TRUE:
+				if(stack[sp-1].ToBool())
+					pc = insn.m_arg;
+				break;
+
+			case OP_POP:
+				sp --;
+				break;
+
+			case OP_TEXT_QUERY:
+				{
+					auto& v = stack[sp];
+					sp ++;
+
+					auto id = arena.GetHeaderID(pack, m_textQueries[insn.m_arg].m_column);
+					v.m_type = ProtocolDisplayFilterValue::TYPE_BOOL;
+					v.m_number = context.m_queryMatches[insn.m_arg][id] ? 1 : 0;
+				}
+				break;
+		}
+	}
+
+	return stack[0].ToBool();
+}
@@ -0,0 +1,278 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ProtocolDisplayFilter
+ */
+#ifndef ProtocolDisplayFilter_h
+#define ProtocolDisplayFilter_h
+
+#include "PacketArena.h"
+
+#include <memory>
+
+class ProtocolDisplayFilter;
+
+class ProtocolDisplayFilterClause
+{
+public:
+	ProtocolDisplayFilterClause(const std::string& str, size_t& i);
+	ProtocolDisplayFilterClause(const ProtocolDisplayFilterClause&) =delete;
+	ProtocolDisplayFilterClause& operator=(const ProtocolDisplayFilterClause&) =delete;
+
+	virtual ~ProtocolDisplayFilterClause();
+
+	bool Validate(const std::vector<std::string>& headers);
+
+	static std::string EatSpaces(const std::string& str);
+
+	enum
+	{
+		TYPE_DATA,
+		TYPE_IDENTIFIER,
+		TYPE_STRING,
+		TYPE_REAL,
+		TYPE_INT,
+		TYPE_EXPRESSION,
+		TYPE_ERROR
+	} m_type;
+
+	std::string m_identifier;
+	std::string m_string;
+	float m_real;
+	long m_long;
+	ProtocolDisplayFilter* m_expression;
+	bool m_invert;
+};
+
+/**
+	@brief A single typed value on the evaluation stack of a ProtocolDisplayFilterProgram
+
+	String values are views into either the packet being evaluated or the program's constant pool, so no copies are
+	made during evaluation.
+ */
+class ProtocolDisplayFilterValue
+{
+public:
+	ProtocolDisplayFilterValue()
+	: m_type(TYPE_NONE)
+	, m_number(0)
+	{}
+
+	enum Type : uint8_t
+	{
+		TYPE_NONE,		//missing header or out-of-range data index
+		TYPE_BOOL,
+		TYPE_NUMBER,
+		TYPE_STRING
+	} m_type;
+
+	///@brief Numeric value (also 0/1 for booleans)
+	double m_number;
+
+	///@brief Text value (valid for strings, and for numeric literals which keep their formatted text)
+	std::string_view m_text;
+
+	bool ToBool() const;
+	bool ToNumber(double& out) const;
+	std::string_view ToText(char* scratch, size_t len) const;
+};
+
+/**
+	@brief Per-waveform data needed to run a ProtocolDisplayFilterProgram against the packets in one PacketArena
+ */
+class ProtocolDisplayFilterContext
+{
+public:
+	///@brief For each of the program's text queries, which of the arena's interned strings match it
+	std::vector<std::vector<bool> > m_queryMatches;
+};
+
+/**
+	@brief A ProtocolDisplayFilter compiled to a flat, typed stack program
+
+	Header names are resolved to column indexes and literals are converted to their native types once, at compile
+	time, so evaluating a packet does not allocate or reformat anything.
+
+	Operator precedence (highest first): ==, !=, startswith, contains; then &&; then ||. && and || short-circuit.
+
+	"header contains literal" and "header startswith literal" are compiled to text queries, which Prepare() resolves
+	once per waveform through the arena's search index. Evaluating them per packet is then a table lookup.
+ */
+class ProtocolDisplayFilterProgram
+{
+public:
+	ProtocolDisplayFilterProgram(const std::vector<std::string>& headers);
+
+	bool Compile(ProtocolDisplayFilter* filter);
+
+	void Prepare(const PacketArena& arena, ProtocolDisplayFilterContext& context) const;
+	bool Match(const PacketArena& arena, const ProtocolDisplayFilterContext& context, const Packet* pack) const;
+
+	/**
+		@brief Gets the list of column names the program's header indexes refer to
+	 */
+	const std::vector<std::string>& GetColumns() const
+	{ return m_columns; }
+
+	/**
+		@brief Gets a description of why the last Compile() call failed
+	 */
+	const std::string& GetError() const
+	{ return m_error; }
+
+protected:
+
+	enum Opcode : uint8_t
+	{
+		OP_PUSH_CONST,		//push m_constants[arg]
+		OP_PUSH_HEADER,		//push value of header column arg, or none if not present
+		OP_DATA,			//pop index, push the data byte at that index
+		OP_EQ,
+		OP_NE,
+		OP_STARTSWITH,
+		OP_CONTAINS,
+		OP_NOT,
+		OP_TO_BOOL,
+		OP_JUMP_IF_FALSE,	//jump to arg if top of stack is false, without popping
+		OP_JUMP_IF_TRUE,	//jump to arg if top of stack is true, without popping
+		OP_POP,
+		OP_TEXT_QUERY		//push result of m_textQueries[arg]
+	};
+
+	struct Instruction
+	{
+		Opcode m_op;
+		uint32_t m_arg;
+	};
+
+	///@brief A contains or startswith test of a header column against a literal
+	struct TextQuery
+	{
+		uint32_t m_column;
+		bool m_prefix;
+		std::string m_text;
+	};
+
+	bool CompileExpression(ProtocolDisplayFilter* filter);
+	bool CompileBinary(ProtocolDisplayFilter* filter, size_t& iclause, int minPrecedence);
+	bool CompileClause(ProtocolDisplayFilterClause* clause);
+	bool CompileTextQuery(size_t lhsStart, size_t rhsStart, bool prefix);
+	void Emit(Opcode op, uint32_t arg = 0);
+	uint32_t AddConstant(const ProtocolDisplayFilterValue& value, const std::string& text);
+	void SetError(const std::string& err);
+
+	static int GetPrecedence(const std::string& op);
+
+	static bool Equal(const ProtocolDisplayFilterValue& a, const ProtocolDisplayFilterValue& b);
+
+	///@brief Names of the decoder columns, indexed by OP_PUSH_HEADER argument
+	std::vector<std::string> m_columns;
+
+	///@brief The instruction stream
+	std::vector<Instruction> m_code;
+
+	///@brief Literal values
+	std::vector<ProtocolDisplayFilterValue> m_constants;
+
+	///@brief Backing storage for text of literal values (never resized after compilation)
+	std::vector<std::string> m_constantText;
+
+	///@brief Header text searches, indexed by OP_TEXT_QUERY argument
+	std::vector<TextQuery> m_textQueries;
+
+	///@brief Current stack depth during compilation
+	size_t m_depth;
+
+	///@brief Maximum stack depth needed to run the program
+	size_t m_maxDepth;
+
+	///@brief Description of the first compilation error, if any
+	std::string m_error;
+};
+
+class ProtocolDisplayFilter
+{
+public:
+	ProtocolDisplayFilter(const std::string& str, size_t& i);
+	ProtocolDisplayFilter(const ProtocolDisplayFilterClause&) =delete;
+	ProtocolDisplayFilter& operator=(const ProtocolDisplayFilter&) =delete;
+	virtual ~ProtocolDisplayFilter();
+
+	static void EatSpaces(const std::string& str, size_t& i);
+
+	bool Validate(const std::vector<std::string>& headers, bool nakedLiteralOK = false);
+
+	bool Compile(const std::vector<std::string>& headers);
+
+	/**
+		@brief Gets a description of why the last Compile() call failed
+	 */
+	const std::string& GetError() const
+	{ return m_error; }
+
+	/**
+		@brief Looks up anything the filter needs from a waveform's search index before its packets are matched
+
+		Compile() must have been called first.
+	 */
+	void Prepare(const PacketArena& arena, ProtocolDisplayFilterContext& context) const
+	{
+		if(m_program)
+			m_program->Prepare(arena, context);
+	}
+
+	/**
+		@brief Checks if a packet matches the filter
+
+		Prepare() must have been called for the packet's arena first. Safe to call from multiple threads concurrently.
+	 */
+	bool Match(const PacketArena& arena, const ProtocolDisplayFilterContext& context, const Packet* pack) const
+	{
+		if(m_program)
+			return m_program->Match(arena, context, pack);
+		return m_clauses.empty();
+	}
+
+protected:
+	friend class ProtocolDisplayFilterProgram;
+
+	std::vector<ProtocolDisplayFilterClause*> m_clauses;
+	std::vector<std::string> m_operators;
+
+	///@brief Compiled form of the expression
+	std::unique_ptr<ProtocolDisplayFilterProgram> m_program;
+
+	///@brief Description of the last compilation error, if any
+	std::string m_error;
+};
+
+#endif
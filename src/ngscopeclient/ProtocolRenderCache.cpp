@@ -0,0 +1,273 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ProtocolRenderCache
+ */
+#include "ngscopeclient.h"
+#include "ProtocolRenderCache.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+ProtocolRenderCache::ProtocolRenderCache()
+	: m_useCount(0)
+	, m_data(nullptr)
+	, m_revision(0)
+	, m_size(0)
+	, m_timestamp(0, 0)
+	, m_triggerPhase(0)
+	, m_timescale(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache management
+
+/**
+	@brief Discards all cached levels
+ */
+void ProtocolRenderCache::Clear()
+{
+	m_levels.clear();
+	m_data = nullptr;
+	m_revision = 0;
+	m_size = 0;
+	m_timestamp = TimePoint(0, 0);
+	m_triggerPhase = 0;
+	m_timescale = 0;
+}
+
+/**
+	@brief Gets the zoom level for a given scale
+
+	Level L is used for scales from 2^L up to (but not including) 2^(L+1) X axis units per pixel.
+ */
+int ProtocolRenderCache::GetLevel(double unitsPerPixel)
+{
+	return static_cast<int>(floor(log2(unitsPerPixel)));
+}
+
+/**
+	@brief Finds the last symbol starting at or before a given time
+
+	@param data		The waveform
+	@param t		Time in X axis units
+
+	@return Index of the symbol, or zero if the waveform starts after t
+ */
+size_t ProtocolRenderCache::FindSymbol(SparseWaveformBase* data, int64_t t)
+{
+	int64_t offset_samples = (t - data->m_triggerPhase) / data->m_timescale;
+	size_t i = BinarySearchForGequal(
+		data->m_offsets.GetCpuPointer(),
+		data->size(),
+		offset_samples);
+
+	//The last symbol BEFORE t might extend past it
+	if(i > 0)
+		i --;
+	return i;
+}
+
+/**
+	@brief Gets the merged spans for drawing a waveform at the given scale, building them if necessary
+
+	@param data				The waveform being drawn
+	@param unitsPerPixel	Current horizontal scale, in X axis units per pixel
+	@param tleft			Left edge of the visible area, in X axis units
+	@param tright			Right edge of the visible area, in X axis units
+
+	@return Spans sorted by start time, covering at least the visible area. Null if nothing in the visible area
+			needs merging at this scale, in which case the symbols should be drawn directly.
+ */
+const vector<ProtocolRenderSpan>* ProtocolRenderCache::GetSpans(
+	SparseWaveformBase* data,
+	double unitsPerPixel,
+	int64_t tleft,
+	int64_t tright)
+{
+	//Start over if we have a new waveform
+	TimePoint timestamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	bool changed =
+		(data != m_data) ||
+		(data->m_revision != m_revision) ||
+		(data->size() != m_size) ||
+		(timestamp != m_timestamp) ||
+		(data->m_triggerPhase != m_triggerPhase) ||
+		(data->m_timescale != m_timescale);
+	if(changed)
+	{
+		Clear();
+		m_data = data;
+		m_revision = data->m_revision;
+		m_size = data->size();
+		m_timestamp = timestamp;
+		m_triggerPhase = data->m_triggerPhase;
+		m_timescale = data->m_timescale;
+	}
+
+	m_useCount ++;
+
+	//Find the existing level if we have it
+	int level = GetLevel(unitsPerPixel);
+	Level* pl = nullptr;
+	for(auto& l : m_levels)
+	{
+		if(l.m_level == level)
+		{
+			pl = &l;
+			break;
+		}
+	}
+
+	//If not, make room for a new one if needed
+	if(!pl)
+	{
+		if(m_levels.size() >= MAX_LEVELS)
+		{
+			size_t oldest = 0;
+			for(size_t i=1; i<m_levels.size(); i++)
+			{
+				if(m_levels[i].m_lastUse < m_levels[oldest].m_lastUse)
+					oldest = i;
+			}
+			m_levels.erase(m_levels.begin() + oldest);
+		}
+
+		m_levels.push_back(Level());
+		pl = &m_levels.back();
+		pl->m_level = level;
+		pl->m_start = 0;
+		pl->m_end = 0;
+		pl->m_direct = false;
+		Build(data, *pl, tleft - (tright - tleft), tright + (tright - tleft));
+	}
+
+	//Rebuild with fresh margins if we've scrolled out of what the level covers
+	else if( (tleft < pl->m_start) || (tright > pl->m_end) )
+		Build(data, *pl, tleft - (tright - tleft), tright + (tright - tleft));
+
+	pl->m_lastUse = m_useCount;
+	if(pl->m_direct)
+		return nullptr;
+	return &pl->m_spans;
+}
+
+/**
+	@brief Merges the symbols of a waveform for one zoom level
+
+	Uses the same rules WaveformArea used to apply per frame: a symbol less than two pixels wide has no room for text,
+	and is averaged with every following symbol that starts within two pixels of it. The pixel size used is the
+	smallest in the level, so a span is never merged more aggressively than the actual scale calls for.
+
+	@param data		The waveform
+	@param level	The level to fill in
+	@param tstart	Start of the range to cover, in X axis units
+	@param tend		End of the range to cover, in X axis units
+ */
+void ProtocolRenderCache::Build(SparseWaveformBase* data, Level& level, int64_t tstart, int64_t tend)
+{
+	double pixelWidth = ldexp(1.0, level.m_level);
+	double minWidth = 2 * pixelWidth;
+
+	data->CacheColors();
+	data->PrepareForCpuAccess();
+
+	level.m_start = tstart;
+	level.m_end = tend;
+	level.m_direct = true;
+
+	auto& spans = level.m_spans;
+	spans.clear();
+
+	size_t len = data->size();
+	for(size_t i=FindSymbol(data, tstart); i<len; i++)
+	{
+		int64_t symstart = (data->m_offsets[i] * data->m_timescale) + data->m_triggerPhase;
+		int64_t symend = symstart + (data->m_durations[i] * data->m_timescale);
+		if(symstart > tend)
+			break;
+
+		ProtocolRenderSpan span;
+		span.m_start = symstart;
+		span.m_end = symend;
+		span.m_color = data->GetColorCached(i);
+		span.m_index = i;
+		span.m_hasText = (symend - symstart) >= minWidth;
+
+		if(!span.m_hasText)
+		{
+			level.m_direct = false;
+
+			//Average the color of all samples touching this pixel
+			size_t nmerged = 1;
+			float sum_red = (span.m_color >> IM_COL32_R_SHIFT) & 0xff;
+			float sum_green = (span.m_color >> IM_COL32_G_SHIFT) & 0xff;
+			float sum_blue = (span.m_color >> IM_COL32_B_SHIFT) & 0xff;
+			for(size_t j=i+1; j<len; j++)
+			{
+				int64_t cellstart = (data->m_offsets[j] * data->m_timescale) + data->m_triggerPhase;
+				if(cellstart - symstart > minWidth)
+					break;
+
+				auto c = data->GetColorCached(j);
+
+				sum_red += (c >> IM_COL32_R_SHIFT) & 0xff;
+				sum_green += (c >> IM_COL32_G_SHIFT) & 0xff;
+				sum_blue += (c >> IM_COL32_B_SHIFT) & 0xff;
+				nmerged ++;
+
+				//Skip these samples in the outer loop
+				i = j;
+			}
+
+			sum_red /= nmerged;
+			sum_green /= nmerged;
+			sum_blue /= nmerged;
+			span.m_color =
+				((static_cast<int>(sum_red) & 0xff) << IM_COL32_R_SHIFT) |
+				((static_cast<int>(sum_green) & 0xff) << IM_COL32_G_SHIFT) |
+				((static_cast<int>(sum_blue) & 0xff) << IM_COL32_B_SHIFT) |
+				(0xff << IM_COL32_A_SHIFT);
+		}
+
+		spans.push_back(span);
+	}
+
+	//Nothing merged, so the spans are just a copy of the symbols. Don't keep them around.
+	if(level.m_direct)
+		spans.clear();
+	spans.shrink_to_fit();
+}
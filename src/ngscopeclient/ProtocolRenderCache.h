@@ -0,0 +1,153 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ProtocolRenderCache
+ */
+#ifndef ProtocolRenderCache_h
+#define ProtocolRenderCache_h
+
+/**
+	@brief One box drawn for a protocol waveform: either a single symbol, or several skinny symbols merged together
+ */
+class ProtocolRenderSpan
+{
+public:
+	///@brief Start of the box, in X axis units
+	int64_t m_start;
+
+	///@brief End of the box, in X axis units
+	int64_t m_end;
+
+	///@brief Fill color (averaged over all merged symbols)
+	ImU32 m_color;
+
+	///@brief Index of the first symbol in the box
+	size_t m_index;
+
+	///@brief True if the box is wide enough that it might have room for the symbol's text
+	bool m_hasText;
+};
+
+/**
+	@brief Level-of-detail cache for drawing a protocol waveform
+
+	Rendering a zoomed-out protocol waveform means merging large numbers of symbols narrower than a couple of pixels
+	into averaged boxes. Doing this every frame costs time proportional to the number of symbols on screen. Instead,
+	the merged boxes are computed once per zoom level (a power of two in X axis units per pixel) and kept until the
+	waveform changes, so each frame only walks roughly one box per pixel.
+
+	Each level only covers the visible part of the waveform plus one screen width of margin on either side, so
+	building a level costs time proportional to the symbols near the screen rather than the whole waveform, and the
+	number of boxes stored is bounded by the number of pixels covered. Boxes are stored in X axis units rather than
+	pixels, so scrolling within the margin doesn't invalidate anything.
+
+	If none of the symbols near the screen need merging at a level (the usual case when zoomed in), no boxes are
+	stored and the caller draws the symbols directly.
+ */
+class ProtocolRenderCache
+{
+public:
+	ProtocolRenderCache();
+
+	const std::vector<ProtocolRenderSpan>* GetSpans(
+		SparseWaveformBase* data,
+		double unitsPerPixel,
+		int64_t tleft,
+		int64_t tright);
+
+	void Clear();
+
+	static int GetLevel(double unitsPerPixel);
+	static size_t FindSymbol(SparseWaveformBase* data, int64_t t);
+
+protected:
+
+	///@brief Merged spans for one zoom level
+	class Level
+	{
+	public:
+		///@brief log2 of the X axis units per pixel this level was built for
+		int m_level;
+
+		///@brief Value of m_useCount the last time this level was used
+		uint64_t m_lastUse;
+
+		///@brief Start of the range of the waveform covered by the level, in X axis units
+		int64_t m_start;
+
+		///@brief End of the range of the waveform covered by the level, in X axis units
+		int64_t m_end;
+
+		///@brief True if no symbols in the range need merging, so m_spans is empty and symbols are drawn directly
+		bool m_direct;
+
+		///@brief The spans, sorted by start time
+		std::vector<ProtocolRenderSpan> m_spans;
+	};
+
+	void Build(SparseWaveformBase* data, Level& level, int64_t tstart, int64_t tend);
+
+	///@brief Cached zoom levels
+	std::vector<Level> m_levels;
+
+	///@brief Counter for finding the least recently used level
+	uint64_t m_useCount;
+
+	///@brief The waveform the cache was built from
+	WaveformBase* m_data;
+
+	///@brief Revision of m_data the cache was built from
+	uint64_t m_revision;
+
+	///@brief Size of m_data when the cache was built
+	size_t m_size;
+
+	/**
+		@brief Timestamp of m_data when the cache was built
+
+		A new waveform may be allocated at the same address as one we've seen, with the same revision, so this
+		catches most of those cases.
+	 */
+	TimePoint m_timestamp;
+
+	///@brief Trigger phase of m_data when the cache was built
+	int64_t m_triggerPhase;
+
+	///@brief Timescale of m_data when the cache was built
+	int64_t m_timescale;
+
+	///@brief Maximum number of zoom levels to keep at once
+	static const size_t MAX_LEVELS = 4;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of RebasedOffsets
+ */
+#include "../scopehal/scopehal.h"
+#include "RebasedOffsets.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+RebasedOffsets::RebasedOffsets()
+	: m_offsets("RebasedOffsets.m_offsets")
+	, m_base(0)
+	, m_data(nullptr)
+	, m_revision(0)
+	, m_size(0)
+	, m_timestamp(0, 0)
+{
+	//Written once per rebuild on the CPU, then read by every render on the GPU
+	m_offsets.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_offsets.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+}
+
+/**
+	@brief Frees the rebased offsets
+ */
+void RebasedOffsets::Clear()
+{
+	m_offsets.clear();
+	m_offsets.shrink_to_fit();
+	m_base = 0;
+	m_data = nullptr;
+	m_revision = 0;
+	m_size = 0;
+	m_timestamp = TimePoint(0, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rebasing
+
+/**
+	@brief Makes sure the rebased offsets are current for a waveform and visible area, rebuilding them if needed
+
+	@param data		The waveform being drawn
+	@param left		Position of the left edge of the visible area, in sample ticks
+	@param span		Width of the visible area, in sample ticks
+
+	@return True if the offsets were rebuilt
+ */
+bool RebasedOffsets::Update(SparseWaveformBase* data, int64_t left, int64_t span)
+{
+	//Allow the view to wander a couple of screen widths before rebasing, but not so far that positions in it
+	//no longer fit in the 32-bit offset passed to the shader
+	int64_t maxDistance = span * 2;
+	if(maxDistance < MIN_REBASE_DISTANCE)
+		maxDistance = MIN_REBASE_DISTANCE;
+	if(maxDistance > MAX_REBASE_DISTANCE)
+		maxDistance = MAX_REBASE_DISTANCE;
+
+	TimePoint timestamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	bool changed =
+		(data != m_data) ||
+		(data->m_revision != m_revision) ||
+		(data->size() != m_size) ||
+		(timestamp != m_timestamp) ||
+		(abs(left - m_base) > maxDistance);
+	if(!changed)
+		return false;
+
+	m_data = data;
+	m_revision = data->m_revision;
+	m_size = data->size();
+	m_timestamp = timestamp;
+	m_base = left;
+
+	size_t len = data->size();
+	m_offsets.resize(len);
+	m_offsets.PrepareForCpuAccess();
+	data->m_offsets.PrepareForCpuAccess();
+
+	auto pin = data->m_offsets.GetCpuPointer();
+	auto pout = m_offsets.GetCpuPointer();
+	int64_t base = m_base;
+	#pragma omp parallel for
+	for(size_t i=0; i<len; i++)
+		pout[i] = pin[i] - base;
+
+	m_offsets.MarkModifiedFromCpu();
+	return true;
+}
@@ -0,0 +1,99 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of RebasedOffsets
+ */
+#ifndef RebasedOffsets_h
+#define RebasedOffsets_h
+
+/**
+	@brief Sparse waveform X positions converted to float, relative to a base point near the visible area
+
+	GPUs without shaderInt64 would otherwise have to emulate 64-bit adds and conversions for every sample fetched by
+	the rasterizer and index search. Offsets within 2^24 sample ticks of the base are exact in a float. Farther ones
+	are rounded to within 2^-24 of their distance from the base, and keep their order.
+
+	The buffer is rebuilt when the waveform changes, or when the visible area moves more than a couple of screen
+	widths from the base. Samples on screen are then never more than a few screen widths from the base, so they are
+	exact unless the screen is more than about 2^22 ticks wide, in which case the rounding is a tiny fraction of a
+	pixel.
+ */
+class RebasedOffsets
+{
+public:
+	RebasedOffsets();
+
+	void Clear();
+
+	bool Update(SparseWaveformBase* data, int64_t left, int64_t span);
+
+	///@brief Returns the rebased X positions
+	AcceleratorBuffer<float>& GetOffsets()
+	{ return m_offsets; }
+
+	///@brief Returns the position, in sample ticks, that the offsets are relative to
+	int64_t GetBase() const
+	{ return m_base; }
+
+protected:
+	///@brief The rebased X positions
+	AcceleratorBuffer<float> m_offsets;
+
+	///@brief The position, in sample ticks, that m_offsets is relative to
+	int64_t m_base;
+
+	///@brief The waveform the offsets were converted from
+	WaveformBase* m_data;
+
+	///@brief Revision of m_data the offsets were converted from
+	uint64_t m_revision;
+
+	///@brief Size of m_data when the offsets were converted
+	size_t m_size;
+
+	///@brief Timestamp of m_data when the offsets were converted
+	TimePoint m_timestamp;
+
+	///@brief Distance from the base the visible area can always move without a rebuild, in sample ticks
+	static const int64_t MIN_REBASE_DISTANCE = 1 << 20;
+
+	/**
+		@brief Largest distance from the base the visible area can move without a rebuild, in sample ticks
+
+		Larger than the 2^24 floats represent exactly, since this only kicks in when the screen is so wide that
+		rounding is far below a pixel. It's limited by the 32-bit offset to the visible area passed to the shader.
+	 */
+	static const int64_t MAX_REBASE_DISTANCE = 1 << 30;
+};
+
+#endif
@@ -117,6 +117,8 @@ ScopeDeskewWizard::ScopeDeskewWizard(
 	m_corrOut.resize(2*m_maxSkewSamples);
 
 	m_gpuCorrelationAvailable = g_hasShaderInt64;
+	if(m_gpuCorrelationAvailable)
+		SchedulePipelineCacheSave();
 
 	//Clear out any existing skew calibration
 	m_session->SetDeskew(m_secondary, 0);
@@ -97,9 +97,8 @@ Session::Session(MainWindow* wnd)
 	, m_history(*this)
 	, m_multiScope(false)
 	, m_nextMarkerNum(1)
+	, m_allReferenceFiltersCreated(false)
 {
-	CreateReferenceFilters();
-
 	SCPIOscilloscope::EnumDrivers(m_driverNamesByType["oscilloscope"]);
 	SCPIPowerSupply::EnumDrivers(m_driverNamesByType["psu"]);
 	SCPIRFSignalGenerator::EnumDrivers(m_driverNamesByType["rfgen"]);
@@ -203,6 +202,11 @@ void Session::Clear()
 	//and can't happen after we hold the lock
 	ClearBackgroundThreads();
 
+	//Destroy offscreen views before the instruments and filters they refer to
+	for(auto g : m_headlessGroups)
+		g->Clear();
+	m_headlessGroups.clear();
+
 	lock_guard<shared_mutex> lock(m_waveformDataMutex);
 
 	//Clear packet managers before removing filters (since they can hold references to them)
@@ -394,7 +398,12 @@ bool Session::LoadFromYaml(const YAML::Node& node, const string& dataDir, bool o
 		return false;
 	if(!LoadInstrumentInputs(m_fileLoadVersion, node["instruments"]))
 		return false;
-	if(!m_mainWindow->LoadUIConfiguration(m_fileLoadVersion, node["ui_config"]))
+	if(m_mainWindow)
+	{
+		if(!m_mainWindow->LoadUIConfiguration(m_fileLoadVersion, node["ui_config"]))
+			return false;
+	}
+	else if(!WaveformGroup::LoadLayout(*this, nullptr, m_fileLoadVersion, node["ui_config"], m_headlessGroups))
 		return false;
 	if(!LoadTriggerGroups(node["triggergroups"]))
 		return false;
@@ -1125,7 +1134,7 @@ bool Session::PreLoadInstruments(int version, const YAML::Node& node, bool onlin
 
 	if(!node)
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"File load error",
 			"The session file is invalid because there is no \"instruments\" section.");
 		return false;
@@ -1200,7 +1209,7 @@ bool Session::PreLoadInstruments(int version, const YAML::Node& node, bool onlin
 		//Unknown instrument type - too new file format?
 		else
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"File load error",
 				string("Instrument ") + nick + " is of unknown type " + type);
 			return false;
@@ -1240,7 +1249,7 @@ SCPITransport* Session::CreateTransportForNode(const YAML::Node& node)
 	//Check if the transport failed to initialize
 	if((transport == nullptr) || !transport->IsConnected())
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"Unable to reconnect",
 			string("Failed to connect to instrument using connection string ") + node["args"].as<string>() +
 			"Loading in offline mode.");
@@ -1255,7 +1264,7 @@ bool Session::VerifyInstrument(const YAML::Node& node, shared_ptr<Instrument> in
 	//TODO: preference to enforce serial match?
 	if(node["name"].as<string>() != inst->GetName())
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"Unable to reconnect",
 			string("Unable to connect to oscilloscope: instrument has model name \"") +
 			inst->GetName() + "\", save file has model name \"" + node["name"].as<string>()  + "\"");
@@ -1263,7 +1272,7 @@ bool Session::VerifyInstrument(const YAML::Node& node, shared_ptr<Instrument> in
 	}
 	else if(node["vendor"].as<string>() != inst->GetVendor())
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"Unable to reconnect",
 			string("Unable to connect to oscilloscope: instrument has vendor \"") +
 			inst->GetVendor() + "\", save file has vendor \"" + node["vendor"].as<string>()  + "\"");
@@ -1271,7 +1280,7 @@ bool Session::VerifyInstrument(const YAML::Node& node, shared_ptr<Instrument> in
 	}
 	else if(node["serial"].as<string>() != inst->GetSerial())
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"Unable to reconnect",
 			string("Unable to connect to oscilloscope: instrument has serial \"") +
 			inst->GetSerial() + "\", save file has serial \"" + node["serial"].as<string>()  + "\"");
@@ -1293,7 +1302,7 @@ bool Session::PreLoadOscilloscope(int version, const YAML::Node& node, bool onli
 	{
 		if( (transtype == "null") && (driver != "demo") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1314,7 +1323,7 @@ bool Session::PreLoadOscilloscope(int version, const YAML::Node& node, bool onli
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to oscilloscope at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1365,7 +1374,7 @@ bool Session::PreLoadVNA(int version, const YAML::Node& node, bool online)
 	{
 		if( (transtype == "null") && (driver != "demo") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1386,7 +1395,7 @@ bool Session::PreLoadVNA(int version, const YAML::Node& node, bool online)
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to oscilloscope at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1432,7 +1441,7 @@ bool Session::PreLoadLoad(int version, const YAML::Node& node, bool online)
 	{
 		if( (transtype == "null") && (driver != "demoload") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1454,7 +1463,7 @@ bool Session::PreLoadLoad(int version, const YAML::Node& node, bool online)
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to load at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1504,7 +1513,7 @@ bool Session::PreLoadMisc(int version, const YAML::Node& node, bool online)
 	{
 		if( (transtype == "null") && (driver != "demoload") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1526,7 +1535,7 @@ bool Session::PreLoadMisc(int version, const YAML::Node& node, bool online)
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to miscellaneous instrument at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1576,7 +1585,7 @@ bool Session::PreLoadBERT(int version, const YAML::Node& node, bool online)
 	{
 		if(transtype == "null")
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1598,7 +1607,7 @@ bool Session::PreLoadBERT(int version, const YAML::Node& node, bool online)
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to BERT at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1648,7 +1657,7 @@ bool Session::PreLoadSDR(int version, const YAML::Node& node, bool online)
 	{
 		if( (transtype == "null") && (driver != "demospec") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1670,7 +1679,7 @@ bool Session::PreLoadSDR(int version, const YAML::Node& node, bool online)
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to SDR at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1720,7 +1729,7 @@ bool Session::PreLoadSpectrometer(int version, const YAML::Node& node, bool onli
 	{
 		if( (transtype == "null") && (driver != "demospec") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1742,7 +1751,7 @@ bool Session::PreLoadSpectrometer(int version, const YAML::Node& node, bool onli
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to spectrometer at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1792,7 +1801,7 @@ bool Session::PreLoadMultimeter(int version, const YAML::Node& node, bool online
 	{
 		if( (transtype == "null") && (driver != "demometer") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1814,7 +1823,7 @@ bool Session::PreLoadMultimeter(int version, const YAML::Node& node, bool online
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to multimeter at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1864,7 +1873,7 @@ bool Session::PreLoadPowerSupply(int version, const YAML::Node& node, bool onlin
 	{
 		if( (transtype == "null") && (driver != "demopsu") )
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1886,7 +1895,7 @@ bool Session::PreLoadPowerSupply(int version, const YAML::Node& node, bool onlin
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to power supply at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -1932,7 +1941,7 @@ bool Session::PreLoadRFSignalGenerator(int version, const YAML::Node& node, bool
 	{
 		if(transtype == "null")
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -1954,7 +1963,7 @@ bool Session::PreLoadRFSignalGenerator(int version, const YAML::Node& node, bool
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to RF signal generator at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -2004,7 +2013,7 @@ bool Session::PreLoadFunctionGenerator(int version, const YAML::Node& node, bool
 	{
 		if(transtype == "null")
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Unable to reconnect",
 				"The session file does not contain any connection information.\n\n"
 				"Loading in offline mode.");
@@ -2026,7 +2035,7 @@ bool Session::PreLoadFunctionGenerator(int version, const YAML::Node& node, bool
 			{
 				delete transport;
 
-				m_mainWindow->ShowErrorPopup(
+				ShowErrorPopup(
 					"Unable to reconnect",
 					string("Failed to reconnect to function generator at ") + node["args"].as<string>() + ".\n\n"
 					"Loading this instrument in offline mode.");
@@ -2203,7 +2212,7 @@ bool Session::LoadFilters(int /*version*/, const YAML::Node& node)
 		auto filter = Filter::CreateFilter(proto, dnode["color"].as<string>());
 		if(filter == NULL)
 		{
-			m_mainWindow->ShowErrorPopup(
+			ShowErrorPopup(
 				"Filter creation failed",
 				string("Unable to create filter \"") + proto + "\". Skipping...\n");
 			continue;
@@ -3172,7 +3181,7 @@ bool Session::CreateAndAddInstrument(const string& driver, SCPITransport* transp
 	//If we couldn't make it, abort
 	if(!inst)
 	{
-		m_mainWindow->ShowErrorPopup(
+		ShowErrorPopup(
 			"Driver error",
 			"Failed to create instrument driver instance of type \"" + driver + "\"");
 		delete transport;
@@ -3264,7 +3273,7 @@ void Session::AddInstrument(shared_ptr<Instrument> inst, bool createDialogs)
 		m_instrumentStates[inst] = make_shared<InstrumentConnectionState>(args);
 
 	//Spawn dialogs/views if requested
-	if(createDialogs)
+	if(createDialogs && m_mainWindow)
 	{
 		if(psu && (types & Instrument::INST_PSU) )
 			m_mainWindow->AddDialog(make_shared<PowerSupplyDialog>(psu, args.psustate, this));
@@ -3277,12 +3286,14 @@ void Session::AddInstrument(shared_ptr<Instrument> inst, bool createDialogs)
 	}
 	if(scope)
 	{
-		m_mainWindow->OnScopeAdded(scope, createDialogs);
+		if(m_mainWindow)
+			m_mainWindow->OnScopeAdded(scope, createDialogs);
 		if(!scope->IsOffline())
 			MakeNewTriggerGroup(scope);
 	}
 
-	m_mainWindow->AddToRecentInstrumentList(si);
+	if(m_mainWindow)
+		m_mainWindow->AddToRecentInstrumentList(si);
 
 	StartWaveformThreadIfNeeded();
 }
@@ -3822,6 +3833,16 @@ void Session::RemovePackets(TimePoint t)
 		it.second->RemoveHistoryFrom(t);
 }
 
+/**
+	@brief Loads packets for a waveform timestamp back into memory, if they were spilled to disk
+ */
+void Session::RestorePackets(TimePoint t)
+{
+	lock_guard<mutex> lock(m_packetMgrMutex);
+	for(auto it : m_packetmgrs)
+		it.second->Restore(t);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Rendering
 
@@ -3830,19 +3851,50 @@ void Session::RemovePackets(TimePoint t)
  */
 int64_t Session::GetToneMapTime()
 {
+	if(!m_mainWindow)
+		return 0;
 	return m_mainWindow->GetToneMapTime();
 }
 
-void Session::RenderWaveformTextures(vk::raii::CommandBuffer& cmdbuf, vector<shared_ptr<InputDescriptor> >& channels)
+/**
+	@brief Reports an error to the user
+
+	Shows a popup in the main window if there is one, otherwise the message just goes to the log.
+ */
+void Session::ShowErrorPopup(const string& title, const string& msg)
 {
-	m_mainWindow->RenderWaveformTextures(cmdbuf, channels);
+	if(m_mainWindow)
+		m_mainWindow->ShowErrorPopup(title, msg);
+	else
+		LogError("%s: %s\n", title.c_str(), msg.c_str());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Reference filters
 
+/**
+	@brief Gets the reference instance of a given filter, creating it if this is the first time it's been asked for
+
+	Reference filters are only created on demand since instantiating every filter type is slow, and most sessions only
+	ever query a handful of them.
+ */
+Filter* Session::GetReferenceFilter(const string& name)
+{
+	auto it = m_referenceFilters.find(name);
+	if(it != m_referenceFilters.end())
+		return it->second;
+
+	auto f = Filter::CreateFilter(name.c_str(), "");
+	if(f)
+		f->HideFromList();
+	m_referenceFilters[name] = f;
+	return f;
+}
+
 /**
 	@brief Creates one filter of each known type to use as a reference for what inputs are legal to use to a new filter
+
+	Filters which already have a reference instance are left alone.
  */
 void Session::CreateReferenceFilters()
 {
@@ -3852,11 +3904,8 @@ void Session::CreateReferenceFilters()
 	Filter::EnumProtocols(names);
 
 	for(auto n : names)
-	{
-		auto f = Filter::CreateFilter(n.c_str(), "");;
-		f->HideFromList();
-		m_referenceFilters[n] = f;
-	}
+		GetReferenceFilter(n);
+	m_allReferenceFiltersCreated = true;
 
 	LogTrace("Created %zu reference filters in %.2f ms\n", m_referenceFilters.size(), (GetTime() - start) * 1000);
 }
@@ -3872,6 +3921,7 @@ void Session::DestroyReferenceFilters()
 	for(auto it : m_referenceFilters)
 		delete it.second;
 	m_referenceFilters.clear();
+	m_allReferenceFiltersCreated = false;
 }
 
 /**
@@ -37,6 +37,7 @@
 
 class MainWindow;
 class WaveformArea;
+class WaveformGroup;
 class DisplayedChannel;
 
 #include "../xptools/HzClock.h"
@@ -47,6 +48,7 @@ class DisplayedChannel;
 #include "TriggerGroup.h"
 
 extern std::atomic<int64_t> g_lastWaveformRenderTime;
+extern std::atomic<size_t> g_lastWaveformRenderPartitions;
 
 class Session;
 
@@ -58,6 +60,7 @@ public:
 		, m_lastTriggerState(Oscilloscope::TRIGGER_MODE_WAIT)
 	{
 		args.shuttingDown = &m_shuttingDown;
+		args.pollScheduler = &m_pollScheduler;
 
 		//Can't initialize this in initializer list because we need args.shuttingDown set first
 		//cppcheck-suppress useInitializationList
@@ -86,6 +89,9 @@ public:
 
 	///@brief Cached trigger state, to reflect in the UI
 	Oscilloscope::TriggerMode m_lastTriggerState;
+
+	///@brief Schedules trigger polls and tracks polling statistics for the instrument
+	TriggerPollScheduler m_pollScheduler;
 };
 
 /**
@@ -143,10 +149,6 @@ public:
 
 	void MarkChannelDirty(InstrumentChannel* chan);
 
-	void RenderWaveformTextures(
-		vk::raii::CommandBuffer& cmdbuf,
-		std::vector<std::shared_ptr<InputDescriptor> >& channels);
-
 	void Clear();
 	void ClearBackgroundThreads();
 
@@ -175,6 +177,16 @@ public:
 	MainWindow* GetMainWindow()
 	{ return m_mainWindow; }
 
+	/**
+		@brief Returns the waveform groups loaded from the session file when there is no main window
+
+		These are only drawn offscreen, e.g. when exporting images from the command line.
+	 */
+	const std::vector<std::shared_ptr<WaveformGroup> >& GetHeadlessWaveformGroups()
+	{ return m_headlessGroups; }
+
+	void ShowErrorPopup(const std::string& title, const std::string& msg);
+
 	/**
 		@brief Returns a pointer to the state for a function generator
 	 */
@@ -254,6 +266,15 @@ public:
 		}
 	}
 
+	/**
+		@brief Returns a snapshot of all packet managers
+	 */
+	std::map<PacketDecoder*, std::shared_ptr<PacketManager> > GetPacketManagers()
+	{
+		std::lock_guard<std::mutex> lock(m_packetMgrMutex);
+		return m_packetmgrs;
+	}
+
 	void ApplyPreferences(std::shared_ptr<Oscilloscope> scope);
 
 	size_t GetFilterCount();
@@ -274,6 +295,12 @@ public:
 	int64_t GetLastWaveformRenderTime()
 	{ return g_lastWaveformRenderTime.load(); }
 
+	/**
+		@brief Gets the number of queues the last run of the waveform rendering shaders was split across
+	 */
+	size_t GetLastWaveformRenderPartitions()
+	{ return g_lastWaveformRenderPartitions.load(); }
+
 	/**
 		@brief Gets the average rate at which we are pulling waveforms off the scope, in Hz
 	 */
@@ -472,9 +499,12 @@ protected:
 	///@brief Mutex for controlling access to filter graph
 	std::mutex m_filterUpdatingMutex;
 
-	///@brief Top level UI window
+	///@brief Top level UI window (null if running headless)
 	MainWindow* m_mainWindow;
 
+	///@brief Waveform groups loaded from the session file when there is no main window to own them
+	std::vector<std::shared_ptr<WaveformGroup> > m_headlessGroups;
+
 	///@brief Flag for shutting down all scope threads when we exit
 	std::atomic<bool> m_shuttingDown;
 
@@ -612,6 +642,7 @@ public:
 	{ m_markers.erase(t); }
 
 	void RemovePackets(TimePoint t);
+	void RestorePackets(TimePoint t);
 
 	std::set<FlowGraphNode*> GetAllGraphNodes();
 
@@ -637,14 +668,17 @@ public:
 
 public:
 
+	Filter* GetReferenceFilter(const std::string& name);
+
 	/**
-		@brief Gets the reference instance of a given filter
+		@brief Gets the reference instances of every filter, creating any that don't exist yet
 	 */
-	Filter* GetReferenceFilter(const std::string& name)
-	{ return m_referenceFilters[name]; }
-
 	const std::map<std::string, Filter*, StringLessCaseInsensitive>& GetReferenceFilters()
-	{ return m_referenceFilters; }
+	{
+		if(!m_allReferenceFiltersCreated)
+			CreateReferenceFilters();
+		return m_referenceFilters;
+	}
 
 	///@brief Get all of the drivers of a given type
 	const std::vector<std::string>& GetDriverNamesForType(const std::string& type)
@@ -659,8 +693,12 @@ protected:
 	void CreateReferenceFilters();
 	void DestroyReferenceFilters();
 
+	///@brief Reference filters created so far, by protocol name
 	std::map<std::string, Filter*, StringLessCaseInsensitive> m_referenceFilters;
 
+	///@brief True once m_referenceFilters has one of every filter
+	bool m_allReferenceFiltersCreated;
+
 	///@brief Map of "type" to drivername[]
 	std::map<std::string, std::vector<std::string> > m_driverNamesByType;
 };
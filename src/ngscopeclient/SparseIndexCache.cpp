@@ -0,0 +1,204 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SparseIndexCache
+ */
+#include "ngscopeclient.h"
+#include "SparseIndexCache.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SparseIndexCache::SparseIndexCache()
+	: m_data(nullptr)
+	, m_revision(0)
+	, m_size(0)
+	, m_timestamp(0, 0)
+	, m_timescale(0)
+	, m_width(0)
+	, m_xscale(0)
+	, m_offsetSamples(0)
+{
+}
+
+/**
+	@brief Forgets the previous search, forcing the next one to be done from scratch
+ */
+void SparseIndexCache::Clear()
+{
+	m_data = nullptr;
+	m_revision = 0;
+	m_size = 0;
+	m_timestamp = TimePoint(0, 0);
+	m_timescale = 0;
+	m_width = 0;
+	m_xscale = 0;
+	m_offsetSamples = 0;
+	m_targets.clear();
+	m_bounds.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache keys
+
+/**
+	@brief Checks if the index buffer was computed for the same waveform contents and buffer width
+ */
+bool SparseIndexCache::IsSameWaveform(SparseWaveformBase* data, size_t w)
+{
+	return
+		(data == m_data) &&
+		(data->m_revision == m_revision) &&
+		(data->size() == m_size) &&
+		(TimePoint(data->m_startTimestamp, data->m_startFemtoseconds) == m_timestamp) &&
+		(data->m_timescale == m_timescale) &&
+		(w == m_width);
+}
+
+/**
+	@brief Checks if the index buffer is still valid for a waveform and X axis configuration
+
+	@param data				The waveform being drawn
+	@param w				Width of the index buffer, in pixels
+	@param xscale			Pixels per sample tick
+	@param offsetSamples	Offset of the leftmost pixel, in sample ticks
+ */
+bool SparseIndexCache::IsCurrent(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples)
+{
+	return IsSameWaveform(data, w) && (xscale == m_xscale) && (offsetSamples == m_offsetSamples);
+}
+
+void SparseIndexCache::SetKey(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples)
+{
+	m_data = data;
+	m_revision = data->m_revision;
+	m_size = data->size();
+	m_timestamp = TimePoint(data->m_startTimestamp, data->m_startFemtoseconds);
+	m_timescale = data->m_timescale;
+	m_width = w;
+	m_xscale = xscale;
+	m_offsetSamples = offsetSamples;
+}
+
+/**
+	@brief Records that the index buffer was just recomputed by a GPU search
+
+	The targets are not available on the CPU, so the next CPU search will start from scratch.
+ */
+void SparseIndexCache::OnGpuSearch(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples)
+{
+	SetKey(data, w, xscale, offsetSamples);
+	m_targets.clear();
+	m_bounds.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Searching
+
+/**
+	@brief Computes the index buffer on the CPU
+
+	Results match IndexSearch.glsl: each pixel starts two samples before the first sample past its left edge, so that
+	the segment entering the pixel from the left is drawn too. The GPU search wraps around to 0xffffffff for pixels
+	before the start of the waveform; we clamp to the first sample instead.
+
+	@param data				The waveform being drawn
+	@param ibuf				Index buffer (must already be w elements long)
+	@param w				Width of the index buffer, in pixels
+	@param xscale			Pixels per sample tick
+	@param offsetSamples	Offset of the leftmost pixel, in sample ticks
+ */
+void SparseIndexCache::SearchOnCpu(
+	SparseWaveformBase* data,
+	AcceleratorBuffer<uint32_t>& ibuf,
+	size_t w,
+	double xscale,
+	int64_t offsetSamples)
+{
+	//Keep the old results around if we can use them to narrow the search
+	bool incremental = IsSameWaveform(data, w) && (m_targets.size() == w);
+	vector<int64_t> oldTargets;
+	vector<size_t> oldBounds;
+	if(incremental)
+	{
+		oldTargets.swap(m_targets);
+		oldBounds.swap(m_bounds);
+	}
+
+	SetKey(data, w, xscale, offsetSamples);
+	m_targets.resize(w);
+	m_bounds.resize(w);
+	for(size_t i=0; i<w; i++)
+		m_targets[i] = floor(i / xscale) + offsetSamples;
+
+	size_t len = data->size();
+	data->m_offsets.PrepareForCpuAccess();
+	auto offsets = data->m_offsets.GetCpuPointer();
+
+	//Find the first sample past each target.
+	//Both sets of targets are sorted, so walk the old ones alongside the new ones: the bound for any old target
+	//at or before the new one is a lower limit on the new bound, and any after it is an upper limit.
+	size_t j = 0;
+	for(size_t i=0; i<w; i++)
+	{
+		int64_t target = m_targets[i];
+
+		size_t lo = 0;
+		size_t hi = len;
+		if(incremental)
+		{
+			while( (j < w) && (oldTargets[j] <= target) )
+				j++;
+
+			if( (j > 0) && (oldTargets[j-1] == target) )
+			{
+				m_bounds[i] = oldBounds[j-1];
+				continue;
+			}
+
+			if(j > 0)
+				lo = oldBounds[j-1];
+			if(j < w)
+				hi = oldBounds[j];
+		}
+
+		m_bounds[i] = upper_bound(offsets + lo, offsets + hi, target) - offsets;
+	}
+
+	ibuf.PrepareForCpuAccess();
+	for(size_t i=0; i<w; i++)
+		ibuf[i] = (m_bounds[i] > 2) ? (m_bounds[i] - 2) : 0;
+	ibuf.MarkModifiedFromCpu();
+}
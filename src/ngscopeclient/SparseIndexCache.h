@@ -0,0 +1,103 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SparseIndexCache
+ */
+#ifndef SparseIndexCache_h
+#define SparseIndexCache_h
+
+/**
+	@brief Keeps track of what the X axis index buffer of a sparse waveform was last computed for
+
+	Rasterizing a sparse waveform needs, for each pixel column, the index of the first sample at or after it. This
+	only depends on the waveform and the X axis scale and offset, so re-rendering for any other reason (Y axis changes,
+	persistence, etc) can reuse the previous search results.
+
+	When the search is done on the CPU, the targets of the previous search are kept as well. If the same waveform is
+	then drawn with a different offset or scale (panning or zooming), the old results bracket the new ones and each
+	binary search only has to look between its neighboring brackets rather than the whole waveform.
+ */
+class SparseIndexCache
+{
+public:
+	SparseIndexCache();
+
+	void Clear();
+
+	bool IsCurrent(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples);
+
+	void OnGpuSearch(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples);
+
+	void SearchOnCpu(
+		SparseWaveformBase* data,
+		AcceleratorBuffer<uint32_t>& ibuf,
+		size_t w,
+		double xscale,
+		int64_t offsetSamples);
+
+protected:
+	bool IsSameWaveform(SparseWaveformBase* data, size_t w);
+	void SetKey(SparseWaveformBase* data, size_t w, double xscale, int64_t offsetSamples);
+
+	///@brief The waveform the index buffer was computed from
+	WaveformBase* m_data;
+
+	///@brief Revision of m_data the index buffer was computed from
+	uint64_t m_revision;
+
+	///@brief Size of m_data when the index buffer was computed
+	size_t m_size;
+
+	///@brief Timestamp of m_data when the index buffer was computed
+	TimePoint m_timestamp;
+
+	///@brief Timescale of m_data when the index buffer was computed
+	int64_t m_timescale;
+
+	///@brief Width of the index buffer, in pixels
+	size_t m_width;
+
+	///@brief Pixels per sample tick
+	double m_xscale;
+
+	///@brief Offset of the leftmost pixel, in sample ticks
+	int64_t m_offsetSamples;
+
+	///@brief Search target for each pixel column (empty if the last search was done on the GPU)
+	std::vector<int64_t> m_targets;
+
+	///@brief Index of the first sample past each target (empty if the last search was done on the GPU)
+	std::vector<size_t> m_bounds;
+};
+
+#endif
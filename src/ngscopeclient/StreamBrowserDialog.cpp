@@ -904,9 +904,7 @@ void StreamBrowserDialog::renderAwgProperties(std::shared_ptr<FunctionGenerator>
 		ImGui::SameLine(m_badgeXCur);
 		// But use y position of row 2
 		ImGui::SetCursorPosY(shapePreviewY);
-		ImGui::Image(
-			m_parent->GetTextureManager()->GetTexture(m_parent->GetIconForWaveformShape(shape)),
-			ImVec2(width,height));
+		m_parent->GetImage(m_parent->GetIconForWaveformShape(shape)).Image(ImVec2(width,height));
 		// Now that we're done with shape preview, restore y position of row 3
 		ImGui::SetCursorPosY(currentY);
 	}
@@ -0,0 +1,632 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of TextureAtlas and TextureStagingRing
+ */
+
+#include "ngscopeclient.h"
+#include "TextureManager.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureStagingRing
+
+TextureStagingRing::TextureStagingRing(vk::DeviceSize size)
+	: m_mappedPtr(nullptr)
+	, m_size(0)
+	, m_writeOffset(0)
+{
+	Reallocate(size);
+}
+
+TextureStagingRing::~TextureStagingRing()
+{
+	if(m_mappedPtr)
+		m_memory->unmapMemory();
+}
+
+/**
+	@brief Replaces the buffer with a new one of (at least) the requested size
+ */
+void TextureStagingRing::Reallocate(vk::DeviceSize size)
+{
+	if(m_mappedPtr)
+		m_memory->unmapMemory();
+	m_mappedPtr = nullptr;
+	m_buffer = nullptr;
+	m_memory = nullptr;
+
+	vk::BufferCreateInfo bufinfo({}, size, vk::BufferUsageFlagBits::eTransferSrc);
+	m_buffer = make_unique<vk::raii::Buffer>(*g_vkComputeDevice, bufinfo);
+
+	//Figure out memory requirements of the buffer and decide what physical memory type to use.
+	//We never flush the mapping, so insist on coherent memory.
+	auto req = m_buffer->getMemoryRequirements();
+	auto memProperties = g_vkComputePhysicalDevice->getMemoryProperties();
+	auto flags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	uint32_t memType = 0;
+	for(uint32_t i=0; i<32; i++)
+	{
+		//Skip anything not host visible since we have to be able to write to it
+		if( (memProperties.memoryTypes[i].propertyFlags & flags) != flags)
+			continue;
+
+		//Stop if buffer is compatible
+		if(req.memoryTypeBits & (1 << i) )
+		{
+			memType = i;
+			break;
+		}
+	}
+	LogTrace("Using memory type %u for %zu kB texture staging ring\n", memType, static_cast<size_t>(size / 1024));
+
+	//Allocate the memory, bind to the buffer, and keep it mapped for the life of the ring
+	vk::MemoryAllocateInfo minfo(req.size, memType);
+	m_memory = make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, minfo);
+	m_buffer->bindMemory(**m_memory, 0);
+	m_mappedPtr = reinterpret_cast<uint8_t*>(m_memory->mapMemory(0, req.size));
+
+	m_size = size;
+	m_writeOffset = 0;
+}
+
+/**
+	@brief Allocates space in the ring
+
+	If the ring is empty but too small for the request, it is grown to fit.
+
+	@param size		Number of bytes needed
+	@param offset	Offset of the allocation within GetBuffer()
+
+	@return Pointer to the allocated space, or nullptr if there isn't enough room until the ring is reset
+ */
+uint8_t* TextureStagingRing::Allocate(vk::DeviceSize size, vk::DeviceSize& offset)
+{
+	//Keep every allocation texel aligned, as required for buffer to image copies
+	vk::DeviceSize start = (m_writeOffset + 15) & ~static_cast<vk::DeviceSize>(15);
+
+	if(start + size > m_size)
+	{
+		if(m_writeOffset != 0)
+			return nullptr;
+
+		Reallocate(max(size, m_size * 2));
+		start = 0;
+	}
+
+	offset = start;
+	m_writeOffset = start + size;
+	return m_mappedPtr + start;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureRegion
+
+ImTextureID TextureRegion::GetTexture() const
+{
+	return m_texture->GetTexture();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureAtlasEntry
+
+/**
+	@brief Draws the image stretched to fill a rectangle, reassembling it if it was split into several pieces
+ */
+void TextureAtlasEntry::Draw(ImDrawList* list, ImVec2 p0, ImVec2 p1) const
+{
+	float scale = (p1.x - p0.x) / m_width;
+	for(auto& piece : m_pieces)
+	{
+		float left = p0.x + piece.m_srcX * scale;
+		float right = p0.x + (piece.m_srcX + piece.m_srcWidth) * scale;
+		piece.m_region.Draw(list, ImVec2(left, p0.y), ImVec2(right, p1.y));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureAtlasShelf
+
+/**
+	@brief Allocates a span of the shelf, first fit
+
+	@return True on success, false if there's no free span wide enough
+ */
+bool TextureAtlasShelf::Allocate(uint32_t width, uint32_t& x)
+{
+	for(auto it = m_free.begin(); it != m_free.end(); it++)
+	{
+		if(it->second - it->first < width)
+			continue;
+
+		x = it->first;
+		it->first += width;
+		if(it->first == it->second)
+			m_free.erase(it);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+	@brief Returns a span to the free list, merging it with its neighbors
+ */
+void TextureAtlasShelf::Release(uint32_t x, uint32_t width)
+{
+	auto it = lower_bound(m_free.begin(), m_free.end(), pair<uint32_t, uint32_t>(x, x));
+	it = m_free.insert(it, pair<uint32_t, uint32_t>(x, x + width));
+
+	auto next = it + 1;
+	if( (next != m_free.end()) && (next->first == it->second) )
+	{
+		it->second = next->second;
+		m_free.erase(next);
+	}
+
+	if(it != m_free.begin())
+	{
+		auto prev = it - 1;
+		if(prev->second == it->first)
+		{
+			prev->second = it->second;
+			m_free.erase(it);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an empty atlas. Pages are allocated on demand.
+
+	@param mgr			Texture manager used for uploads
+	@param name			Debug name for the page textures
+	@param pageWidth	Width of each page. Wider images are split across several pieces.
+	@param pageHeight	Height of each page, which is also the tallest image the atlas can hold
+	@param maxPages		Maximum number of pages to allocate before failing new images
+	@param linear		True to sample with linear filtering (and pad images to keep neighbors from bleeding in),
+						false for nearest neighbor with images packed edge to edge
+ */
+TextureAtlas::TextureAtlas(
+	TextureManager* mgr,
+	const string& name,
+	uint32_t pageWidth,
+	uint32_t pageHeight,
+	size_t maxPages,
+	bool linear)
+	: m_mgr(mgr)
+	, m_name(name)
+	, m_pageWidth(pageWidth)
+	, m_pageHeight(pageHeight)
+	, m_maxPages(maxPages)
+	, m_linear(linear)
+	, m_padding(linear ? 1 : 0)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+/**
+	@brief Removes all images and frees all pages
+
+	Only safe to call when no frame using the atlas is still in flight.
+ */
+void TextureAtlas::clear()
+{
+	m_entries.clear();
+	m_lru.clear();
+	m_deferredReleases.clear();
+	m_pages.clear();
+}
+
+void TextureAtlas::AddPage()
+{
+	LogTrace("Adding %u x %u page to texture atlas %s\n", m_pageWidth, m_pageHeight, m_name.c_str());
+
+	vk::ImageCreateInfo imageInfo(
+		{},
+		vk::ImageType::e2D,
+		vk::Format::eR8G8B8A8Unorm,
+		vk::Extent3D(m_pageWidth, m_pageHeight, 1),
+		1,
+		1,
+		VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
+		VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+		vk::SharingMode::eExclusive,
+		{},
+		vk::ImageLayout::eUndefined
+		);
+
+	TextureAtlasPage page;
+	page.m_texture = make_shared<Texture>(
+		*g_vkComputeDevice,
+		imageInfo,
+		m_mgr,
+		m_name + ".page" + to_string(m_pages.size()),
+		m_linear);
+
+	//Pages stay in the general layout for their entire life,
+	//so uploading one image never has to transition a page that earlier frames are still sampling from
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	vk::ImageMemoryBarrier barrier(
+		vk::AccessFlagBits::eNone,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eGeneral,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED,
+		page.m_texture->GetImage(),
+		range);
+	auto& cmdBuf = m_mgr->GetCmdBuffer();
+	cmdBuf.begin({});
+	cmdBuf.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe,
+		vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader,
+		{},
+		{},
+		{},
+		barrier);
+	cmdBuf.end();
+	m_mgr->GetQueue()->SubmitAndBlock(cmdBuf);
+
+	m_pages.push_back(page);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Lookup
+
+/**
+	@brief Looks up an image and marks it as used this frame
+
+	@param key	Key the image was added under
+	@param tag	Expected tag. If the stored image has a different tag, it is dropped as stale.
+
+	@return The image, or nullptr if it's not in the atlas
+ */
+TextureAtlasEntry* TextureAtlas::Get(uint64_t key, int64_t tag)
+{
+	auto it = m_entries.find(key);
+	if(it == m_entries.end())
+		return nullptr;
+
+	auto& entry = it->second;
+	if(entry.m_tag != tag)
+	{
+		Remove(key);
+		return nullptr;
+	}
+
+	entry.m_lastUsedFrame = ImGui::GetFrameCount();
+	if(!entry.m_pinned)
+		m_lru.splice(m_lru.begin(), m_lru, entry.m_lruPosition);
+	return &entry;
+}
+
+/**
+	@brief Adds an image to the atlas, replacing any existing image with the same key
+
+	@param key		Key to store the image under
+	@param tag		Tag to validate future lookups against
+	@param width	Width of the image, in pixels
+	@param height	Height of the image, in pixels
+	@param pixels	On success, points to width*height RGBA8 pixels of staging memory the caller must fill
+					before the end of the frame
+	@param pinned	True if the image should never be evicted
+
+	@return The new image, or nullptr if it's taller than a page or the atlas is full of images in use
+ */
+TextureAtlasEntry* TextureAtlas::Add(
+	uint64_t key,
+	int64_t tag,
+	uint32_t width,
+	uint32_t height,
+	uint8_t*& pixels,
+	bool pinned)
+{
+	Remove(key);
+
+	if( (width == 0) || (height == 0) )
+		return nullptr;
+	if(height + 2*m_padding > m_pageHeight)
+	{
+		LogError("Can't add %u x %u image to texture atlas %s, it's taller than a page (%u pixels)\n",
+			width, height, m_name.c_str(), m_pageHeight - 2*m_padding);
+		return nullptr;
+	}
+
+	TextureAtlasEntry entry;
+	entry.m_tag = tag;
+	entry.m_width = width;
+	entry.m_pinned = pinned;
+	entry.m_lastUsedFrame = ImGui::GetFrameCount();
+	if(!AllocatePieces(entry, height))
+		return nullptr;
+
+	//Grab staging space for the whole image, and copy each piece out of it into its page
+	vk::DeviceSize offset;
+	pixels = m_mgr->AllocateStaging(static_cast<vk::DeviceSize>(width) * height * 4, offset);
+	for(auto& piece : entry.m_pieces)
+		QueuePieceUpload(piece, height, offset, width);
+
+	if(pinned)
+		entry.m_lruPosition = m_lru.end();
+	else
+	{
+		m_lru.push_front(key);
+		entry.m_lruPosition = m_lru.begin();
+	}
+
+	auto& ret = m_entries[key];
+	ret = std::move(entry);
+	return &ret;
+}
+
+/**
+	@brief Splits an image into pieces no wider than a page, and finds space for each of them
+
+	@return True on success. On failure, any space already allocated is released again.
+ */
+bool TextureAtlas::AllocatePieces(TextureAtlasEntry& entry, uint32_t height)
+{
+	uint32_t maxPieceWidth = m_pageWidth - 2*m_padding;
+	uint32_t paddedHeight = height + 2*m_padding;
+	for(uint32_t srcX = 0; srcX < entry.m_width; srcX += maxPieceWidth)
+	{
+		TextureAtlasPiece piece;
+		piece.m_srcX = srcX;
+		piece.m_srcWidth = min(maxPieceWidth, entry.m_width - srcX);
+		piece.m_width = piece.m_srcWidth + 2*m_padding;
+
+		if(!Allocate(piece.m_width, paddedHeight, piece.m_pageIndex, piece.m_shelfIndex, piece.m_x))
+		{
+			for(auto& p : entry.m_pieces)
+				ReleaseSpan(p.m_pageIndex, p.m_shelfIndex, p.m_x, p.m_width);
+			entry.m_pieces.clear();
+			return false;
+		}
+
+		uint32_t x = piece.m_x + m_padding;
+		uint32_t y = m_pages[piece.m_pageIndex].m_shelves[piece.m_shelfIndex].m_y + m_padding;
+		piece.m_region.m_texture = m_pages[piece.m_pageIndex].m_texture;
+		piece.m_region.m_uv0 = ImVec2(x * 1.0f / m_pageWidth, y * 1.0f / m_pageHeight);
+		piece.m_region.m_uv1 = ImVec2( (x + piece.m_srcWidth) * 1.0f / m_pageWidth, (y + height) * 1.0f / m_pageHeight);
+		entry.m_pieces.push_back(piece);
+	}
+
+	if(entry.m_pieces.size() > 1)
+	{
+		LogTrace("Split %u pixel wide image into %zu pieces in texture atlas %s\n",
+			entry.m_width, entry.m_pieces.size(), m_name.c_str());
+	}
+	return true;
+}
+
+/**
+	@brief Queues the copies from staging memory into the page for one piece of an image
+
+	If the atlas is padded, the edges of the piece are also copied into the border around it.
+
+	@param piece		The piece to upload
+	@param height		Height of the image
+	@param offset		Offset of the first pixel of the image in the staging ring
+	@param rowLength	Width of the whole image, in pixels
+ */
+void TextureAtlas::QueuePieceUpload(
+	const TextureAtlasPiece& piece,
+	uint32_t height,
+	vk::DeviceSize offset,
+	uint32_t rowLength)
+{
+	auto& page = m_pages[piece.m_pageIndex];
+	int32_t x = piece.m_x + m_padding;
+	int32_t y = page.m_shelves[piece.m_shelfIndex].m_y + m_padding;
+	int32_t w = piece.m_srcWidth;
+	int32_t h = height;
+
+	//Copies a block of the image (relative to the piece) to a position in the page
+	vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	auto copy = [&](int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t cw, int32_t ch)
+	{
+		vk::DeviceSize start = offset + ( static_cast<vk::DeviceSize>(srcY) * rowLength + piece.m_srcX + srcX) * 4;
+		vk::BufferImageCopy region(
+			start, rowLength, height, subresource, vk::Offset3D(dstX, dstY, 0), vk::Extent3D(cw, ch, 1) );
+		m_mgr->QueueUpload(page.m_texture, region);
+	};
+
+	copy(0, 0, x, y, w, h);
+	if(m_padding == 0)
+		return;
+
+	//Replicate the edges into the border
+	copy(0, 0, x, y-1, w, 1);
+	copy(0, h-1, x, y+h, w, 1);
+	copy(0, 0, x-1, y, 1, h);
+	copy(w-1, 0, x+w, y, 1, h);
+
+	//and the corners
+	copy(0, 0, x-1, y-1, 1, 1);
+	copy(w-1, 0, x+w, y-1, 1, 1);
+	copy(0, h-1, x-1, y+h, 1, 1);
+	copy(w-1, h-1, x+w, y+h, 1, 1);
+}
+
+/**
+	@brief Removes an image from the atlas, if present
+ */
+void TextureAtlas::Remove(uint64_t key)
+{
+	auto it = m_entries.find(key);
+	if(it == m_entries.end())
+		return;
+
+	Release(it->second);
+	if(!it->second.m_pinned)
+		m_lru.erase(it->second.m_lruPosition);
+	m_entries.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation
+
+/**
+	@brief Finds space for an image, evicting old images or adding pages as needed
+ */
+bool TextureAtlas::Allocate(uint32_t width, uint32_t height, size_t& page, size_t& shelf, uint32_t& x)
+{
+	ReclaimDeferredReleases();
+
+	while(true)
+	{
+		for(size_t i=0; i<m_pages.size(); i++)
+		{
+			if(AllocateInPage(m_pages[i], width, height, shelf, x))
+			{
+				page = i;
+				return true;
+			}
+		}
+
+		//Prefer recycling space from images that scrolled away over growing the atlas
+		if(EvictLeastRecentlyUsed())
+			continue;
+		if(m_pages.size() < m_maxPages)
+		{
+			AddPage();
+			continue;
+		}
+
+		return false;
+	}
+}
+
+bool TextureAtlas::AllocateInPage(TextureAtlasPage& page, uint32_t width, uint32_t height, size_t& shelf, uint32_t& x)
+{
+	//Look for an existing shelf that isn't too much taller than we need
+	for(size_t i=0; i<page.m_shelves.size(); i++)
+	{
+		auto& s = page.m_shelves[i];
+		if( (s.m_height < height) || (s.m_height > height + height/2) )
+			continue;
+
+		if(s.Allocate(width, x))
+		{
+			shelf = i;
+			return true;
+		}
+	}
+
+	//Start a new shelf, if there's room
+	if(page.m_nextShelfY + height > m_pageHeight)
+		return false;
+	page.m_shelves.push_back(TextureAtlasShelf(page.m_nextShelfY, height, m_pageWidth));
+	page.m_nextShelfY += height;
+
+	shelf = page.m_shelves.size() - 1;
+	return page.m_shelves[shelf].Allocate(width, x);
+}
+
+/**
+	@brief Evicts the least recently used image, if it's old enough that no frame in flight can be drawing it
+
+	@return True if an image was evicted
+ */
+bool TextureAtlas::EvictLeastRecentlyUsed()
+{
+	if(m_lru.empty())
+		return false;
+
+	uint64_t key = m_lru.back();
+	auto& entry = m_entries[key];
+	if(entry.m_lastUsedFrame + EVICTION_DELAY_FRAMES > ImGui::GetFrameCount())
+		return false;
+
+	Remove(key);
+	return true;
+}
+
+/**
+	@brief Returns an image's space to its shelf
+
+	If the image was drawn recently, the space is held back until no frame in flight can still be sampling it.
+ */
+void TextureAtlas::Release(TextureAtlasEntry& entry)
+{
+	if(entry.m_lastUsedFrame + EVICTION_DELAY_FRAMES > ImGui::GetFrameCount())
+		m_deferredReleases.push_back(entry);
+	else
+	{
+		for(auto& piece : entry.m_pieces)
+			ReleaseSpan(piece.m_pageIndex, piece.m_shelfIndex, piece.m_x, piece.m_width);
+	}
+}
+
+void TextureAtlas::ReclaimDeferredReleases()
+{
+	int frame = ImGui::GetFrameCount();
+	for(size_t i=0; i<m_deferredReleases.size(); )
+	{
+		auto& entry = m_deferredReleases[i];
+		if(entry.m_lastUsedFrame + EVICTION_DELAY_FRAMES > frame)
+			i++;
+		else
+		{
+			for(auto& piece : entry.m_pieces)
+				ReleaseSpan(piece.m_pageIndex, piece.m_shelfIndex, piece.m_x, piece.m_width);
+			m_deferredReleases[i] = m_deferredReleases.back();
+			m_deferredReleases.pop_back();
+		}
+	}
+}
+
+void TextureAtlas::ReleaseSpan(size_t ipage, size_t ishelf, uint32_t x, uint32_t width)
+{
+	auto& page = m_pages[ipage];
+	page.m_shelves[ishelf].Release(x, width);
+
+	//Drop empty shelves at the bottom of the page so the rows can be reused for images of a different height
+	while(!page.m_shelves.empty())
+	{
+		auto& last = page.m_shelves.back();
+		if( (last.m_free.size() != 1) || (last.m_free[0].first != 0) || (last.m_free[0].second != m_pageWidth) )
+			break;
+
+		page.m_nextShelfY = last.m_y;
+		page.m_shelves.pop_back();
+	}
+}
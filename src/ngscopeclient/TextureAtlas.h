@@ -0,0 +1,348 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of TextureAtlas and TextureStagingRing
+ */
+#ifndef TextureAtlas_h
+#define TextureAtlas_h
+
+#include <list>
+#include <unordered_map>
+
+class Texture;
+class TextureManager;
+
+/**
+	@brief Persistent host-visible staging buffer shared by all texture uploads
+
+	Space is handed out linearly from the start of the buffer. Once the transfers reading from it have completed,
+	Reset() wraps the write pointer back to the start so the same memory is reused for the next batch, rather than
+	allocating and freeing a temporary buffer for every upload.
+ */
+class TextureStagingRing
+{
+public:
+	TextureStagingRing(vk::DeviceSize size);
+	~TextureStagingRing();
+
+	uint8_t* Allocate(vk::DeviceSize size, vk::DeviceSize& offset);
+
+	/**
+		@brief Makes the entire ring available again
+
+		Must only be called once every transfer reading from previously allocated space has completed.
+	 */
+	void Reset()
+	{ m_writeOffset = 0; }
+
+	///@brief Returns true if nothing has been allocated since the last reset
+	bool empty() const
+	{ return m_writeOffset == 0; }
+
+	const vk::raii::Buffer& GetBuffer()
+	{ return *m_buffer; }
+
+	vk::DeviceSize GetSize() const
+	{ return m_size; }
+
+protected:
+	void Reallocate(vk::DeviceSize size);
+
+	///@brief The staging buffer
+	std::unique_ptr<vk::raii::Buffer> m_buffer;
+
+	///@brief Host-visible memory backing the buffer
+	std::unique_ptr<vk::raii::DeviceMemory> m_memory;
+
+	///@brief Persistently mapped pointer to m_memory
+	uint8_t* m_mappedPtr;
+
+	///@brief Size of the buffer, in bytes
+	vk::DeviceSize m_size;
+
+	///@brief Offset of the next free byte
+	vk::DeviceSize m_writeOffset;
+};
+
+/**
+	@brief A rectangular region of a texture, which can be drawn with ImGui
+ */
+class TextureRegion
+{
+public:
+	TextureRegion()
+	: m_uv0(0, 0)
+	, m_uv1(1, 1)
+	{}
+
+	ImTextureID GetTexture() const;
+
+	void Draw(ImDrawList* list, ImVec2 p0, ImVec2 p1) const
+	{ list->AddImage(GetTexture(), p0, p1, m_uv0, m_uv1); }
+
+	void Image(ImVec2 size) const
+	{ ImGui::Image(GetTexture(), size, m_uv0, m_uv1); }
+
+	bool ImageButton(const char* id, ImVec2 size) const
+	{ return ImGui::ImageButton(id, GetTexture(), size, m_uv0, m_uv1); }
+
+	///@brief The texture containing the region
+	std::shared_ptr<Texture> m_texture;
+
+	///@brief Texture coordinates of the top left corner of the region
+	ImVec2 m_uv0;
+
+	///@brief Texture coordinates of the bottom right corner of the region
+	ImVec2 m_uv1;
+};
+
+/**
+	@brief Part of an image stored in a TextureAtlas
+
+	Images no wider than a page are stored as a single piece. Wider images are split into vertical strips, each
+	allocated separately (possibly on different pages).
+ */
+class TextureAtlasPiece
+{
+public:
+
+	///@brief Where the piece is in its page
+	TextureRegion m_region;
+
+	///@brief Index of the page in the atlas
+	size_t m_pageIndex;
+
+	///@brief Index of the shelf within the page
+	size_t m_shelfIndex;
+
+	///@brief X position of the allocated span within the shelf (including padding)
+	uint32_t m_x;
+
+	///@brief Width of the allocated span (including padding)
+	uint32_t m_width;
+
+	///@brief First column of the source image stored in this piece
+	uint32_t m_srcX;
+
+	///@brief Number of columns of the source image stored in this piece
+	uint32_t m_srcWidth;
+};
+
+/**
+	@brief One image stored in a TextureAtlas
+ */
+class TextureAtlasEntry
+{
+public:
+	void Draw(ImDrawList* list, ImVec2 p0, ImVec2 p1) const;
+
+	///@brief Returns the image as a single region, if it fits in one piece (which is always true of images no
+	///wider than a page)
+	const TextureRegion& GetRegion() const
+	{ return m_pieces[0].m_region; }
+
+	///@brief The pieces of the image, from left to right
+	std::vector<TextureAtlasPiece> m_pieces;
+
+	///@brief Caller supplied tag used to detect stale images (e.g. when a key is reused for different content)
+	int64_t m_tag;
+
+	///@brief Width of the image
+	uint32_t m_width;
+
+	///@brief True if the image is never evicted
+	bool m_pinned;
+
+	///@brief ImGui frame number the image was last drawn in
+	int m_lastUsedFrame;
+
+	///@brief Position of this entry in the atlas LRU list (unused for pinned images)
+	std::list<uint64_t>::iterator m_lruPosition;
+};
+
+/**
+	@brief A horizontal strip of an atlas page holding images of similar height
+
+	Free space within the shelf is tracked as a sorted list of [start, end) spans, which are coalesced on release.
+ */
+class TextureAtlasShelf
+{
+public:
+	TextureAtlasShelf(uint32_t y, uint32_t height, uint32_t width)
+	: m_y(y)
+	, m_height(height)
+	{ m_free.push_back(std::pair<uint32_t, uint32_t>(0, width)); }
+
+	bool Allocate(uint32_t width, uint32_t& x);
+	void Release(uint32_t x, uint32_t width);
+
+	///@brief Y position of the top of the shelf
+	uint32_t m_y;
+
+	///@brief Height of the shelf
+	uint32_t m_height;
+
+	///@brief Free spans, sorted by start position
+	std::vector< std::pair<uint32_t, uint32_t> > m_free;
+};
+
+/**
+	@brief One texture in a TextureAtlas
+ */
+class TextureAtlasPage
+{
+public:
+	TextureAtlasPage()
+	: m_nextShelfY(0)
+	{}
+
+	///@brief The texture
+	std::shared_ptr<Texture> m_texture;
+
+	///@brief Shelves allocated so far, from top to bottom
+	std::vector<TextureAtlasShelf> m_shelves;
+
+	///@brief Y position of the first row not yet assigned to a shelf
+	uint32_t m_nextShelfY;
+};
+
+/**
+	@brief A cache of small images packed into a few large RGBA8 textures
+
+	Images are identified by a caller supplied 64-bit key and placed on shelves of similar height within fixed size
+	pages, so drawing many small images touches a handful of textures instead of creating one per image. When the
+	atlas is full, images that have not been drawn in the last few frames are evicted in least-recently-used order.
+
+	Images wider than a page are split into strips stored separately; TextureAtlasEntry::Draw() puts them back
+	together. Images taller than a page are rejected.
+
+	Atlases drawn at their native size (e.g. scanlines) use nearest neighbor filtering with no space between images.
+	Atlases of images drawn scaled (e.g. icons) use linear filtering, and pad each image with a one pixel border
+	copied from its edges so filtering never bleeds in the neighboring images.
+
+	Pinned images (e.g. icons, which live for the entire session) are never evicted.
+
+	Pixel data is written directly into the TextureManager staging ring and uploaded in one batch by
+	TextureManager::FlushUploads(), which must run before the frame using the images is rendered.
+ */
+class TextureAtlas
+{
+public:
+	TextureAtlas(
+		TextureManager* mgr,
+		const std::string& name,
+		uint32_t pageWidth,
+		uint32_t pageHeight,
+		size_t maxPages,
+		bool linear = false);
+	~TextureAtlas();
+
+	TextureAtlasEntry* Get(uint64_t key, int64_t tag);
+	TextureAtlasEntry* Add(
+		uint64_t key,
+		int64_t tag,
+		uint32_t width,
+		uint32_t height,
+		uint8_t*& pixels,
+		bool pinned = false);
+	void Remove(uint64_t key);
+	void clear();
+
+	///@brief Returns the number of images currently in the atlas
+	size_t size() const
+	{ return m_entries.size(); }
+
+	///@brief Returns the number of pages currently allocated
+	size_t GetPageCount() const
+	{ return m_pages.size(); }
+
+	///@brief Returns the width of a page
+	uint32_t GetPageWidth() const
+	{ return m_pageWidth; }
+
+	uint64_t GetMemoryUsage() const
+	{ return static_cast<uint64_t>(m_pages.size()) * m_pageWidth * m_pageHeight * 4; }
+
+protected:
+	bool Allocate(uint32_t width, uint32_t height, size_t& page, size_t& shelf, uint32_t& x);
+	bool AllocateInPage(TextureAtlasPage& page, uint32_t width, uint32_t height, size_t& shelf, uint32_t& x);
+	bool AllocatePieces(TextureAtlasEntry& entry, uint32_t height);
+	void QueuePieceUpload(
+		const TextureAtlasPiece& piece,
+		uint32_t height,
+		vk::DeviceSize offset,
+		uint32_t rowLength);
+	bool EvictLeastRecentlyUsed();
+	void Release(TextureAtlasEntry& entry);
+	void ReclaimDeferredReleases();
+	void ReleaseSpan(size_t ipage, size_t ishelf, uint32_t x, uint32_t width);
+	void AddPage();
+
+	///@brief Number of frames an image must go undrawn before its space can be reused
+	static constexpr int EVICTION_DELAY_FRAMES = 3;
+
+	///@brief The texture manager we upload through
+	TextureManager* m_mgr;
+
+	///@brief Debug name of the atlas
+	std::string m_name;
+
+	///@brief Width of each page
+	uint32_t m_pageWidth;
+
+	///@brief Height of each page
+	uint32_t m_pageHeight;
+
+	///@brief Maximum number of pages we're allowed to allocate
+	size_t m_maxPages;
+
+	///@brief True to sample pages with linear filtering
+	bool m_linear;
+
+	///@brief Width of the border around each image, in pixels
+	uint32_t m_padding;
+
+	///@brief Texture pages
+	std::vector<TextureAtlasPage> m_pages;
+
+	///@brief Images currently in the atlas
+	std::unordered_map<uint64_t, TextureAtlasEntry> m_entries;
+
+	///@brief Keys of images in the atlas, most recently used first
+	std::list<uint64_t> m_lru;
+
+	///@brief Removed images whose space may still be sampled by a frame in flight
+	std::vector<TextureAtlasEntry> m_deferredReleases;
+};
+
+#endif
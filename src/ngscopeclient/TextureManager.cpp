@@ -52,7 +52,9 @@ Texture::Texture(
 	int height,
 	TextureManager* mgr,
 	const std::string& name,
-	bool upsampleLinear
+	bool upsampleLinear,
+	vk::DeviceSize srcOffset,
+	vk::raii::CommandBuffer* batchCmdBuf
 	)
 	: m_image(device, imageInfo)
 {
@@ -83,8 +85,9 @@ Texture::Texture(
 
 	//Transfer our image data over from the staging buffer
 	{
-		vk::raii::CommandBuffer& cmdBuf = mgr->GetCmdBuffer();
-		cmdBuf.begin({});
+		vk::raii::CommandBuffer& cmdBuf = batchCmdBuf ? *batchCmdBuf : mgr->GetCmdBuffer();
+		if(!batchCmdBuf)
+			cmdBuf.begin({});
 
 		//Initial image layout transition
 		LayoutTransition(
@@ -96,7 +99,7 @@ Texture::Texture(
 
 		//Copy the buffer to the image
 		vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
-		vk::BufferImageCopy region(0, 0, 0, subresource, vk::Offset3D(0, 0, 0), vk::Extent3D(width, height, 1) );
+		vk::BufferImageCopy region(srcOffset, 0, 0, subresource, vk::Offset3D(0, 0, 0), vk::Extent3D(width, height, 1) );
 		cmdBuf.copyBufferToImage(*srcBuf, *m_image, vk::ImageLayout::eTransferDstOptimal, region);
 
 		//Convert to something optimal for texture reads
@@ -107,10 +110,12 @@ Texture::Texture(
 			vk::ImageLayout::eTransferDstOptimal,
 			vk::ImageLayout::eShaderReadOnlyOptimal);
 
-		cmdBuf.end();
-
-		//Submit the request and block until it completes
-		mgr->GetQueue()->SubmitAndBlock(cmdBuf);
+		//Submit the request and block until it completes, unless the caller is batching uploads
+		if(!batchCmdBuf)
+		{
+			cmdBuf.end();
+			mgr->GetQueue()->SubmitAndBlock(cmdBuf);
+		}
 	}
 
 	//Make a view for the image
@@ -140,7 +145,8 @@ Texture::Texture(
 	const vk::raii::Device& device,
 	const vk::ImageCreateInfo& imageInfo,
 	TextureManager* mgr,
-	const string& name)
+	const string& name,
+	bool upsampleLinear)
 	: m_image(device, imageInfo)
 {
 	auto req = m_image.getMemoryRequirements();
@@ -175,14 +181,17 @@ Texture::Texture(
 		{},
 		*m_image,
 		vk::ImageViewType::e2D,
-		vk::Format::eR32G32B32A32Sfloat,
+		imageInfo.format,
 		{},
 		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
 		);
 	m_view = make_unique<vk::raii::ImageView>(*g_vkComputeDevice, vinfo);
 
 	m_texture = reinterpret_cast<intptr_t>(
-		ImGui_ImplVulkan_AddTexture(**mgr->GetSampler(), **m_view, VK_IMAGE_LAYOUT_GENERAL));
+		ImGui_ImplVulkan_AddTexture(
+			upsampleLinear ? **mgr->GetSampler() : **mgr->GetNearestSampler(),
+			**m_view,
+			VK_IMAGE_LAYOUT_GENERAL));
 
 	SetName(name);
 }
@@ -277,6 +286,7 @@ Texture::~Texture()
 
 TextureManager::TextureManager(shared_ptr<QueueHandle> queue)
 	: m_queue(queue)
+	, m_loadBatchDepth(0)
 {
 	//Make a sampler using configuration that matches imgui
 	vk::SamplerCreateInfo sinfo(
@@ -325,10 +335,25 @@ TextureManager::TextureManager(shared_ptr<QueueHandle> queue)
 	vk::CommandBufferAllocateInfo bufinfo(**m_cmdPool, vk::CommandBufferLevel::ePrimary, 1);
 	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
 		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Staging ring starts out big enough for a few toolbar icons, and grows if a larger image ever shows up
+	m_staging = make_unique<TextureStagingRing>(4 * 1024 * 1024);
+
+	//Scanlines are one pixel tall, so a page holds a few hundred rows' worth of images
+	uint32_t maxWidth = g_vkComputePhysicalDevice->getProperties().limits.maxImageDimension2D;
+	m_scanlineAtlas = make_unique<TextureAtlas>(this, "scanlines", min(maxWidth, 8192u), 256, 8);
+
+	//All of our icons together fit in a page or two
+	m_iconAtlas = make_unique<TextureAtlas>(this, "icons", min(maxWidth, 2048u), min(maxWidth, 2048u), 16, true);
 }
 
 TextureManager::~TextureManager()
 {
+	m_images.clear();
+	m_iconAtlas = nullptr;
+	m_scanlineAtlas = nullptr;
+	m_pendingUploads.clear();
+	m_staging = nullptr;
 	m_cmdBuf = nullptr;
 	m_cmdPool = nullptr;
 	m_queue = nullptr;
@@ -467,86 +492,295 @@ GLFWimage TextureManager::LoadPNGToGLFWImage(const string& path)
 	@brief Loads a texture from a file into a named resource
 
 	If an existing texture by the same name already exists, it is overwritten.
+
+	@param name				Name of the resource
+	@param path				Path to the PNG file
+	@param shaderSampled	True if the texture will be sampled by shaders (e.g. color ramps) and needs a dedicated
+							image covering the full UV range. Otherwise it is packed into the icon atlas.
  */
 void TextureManager::LoadTexture(
 	const string& name,
-	const string& path)
+	const string& path,
+	bool shaderSampled)
 {
-	LogTrace("Loading texture \"%s\" from file \"%s\"\n", name.c_str(), path.c_str());
-	LogIndenter li;
+	TextureLoadRequest req(name, path, shaderSampled);
 
-	//Load the headers and validate things
-	size_t width;
-	size_t height;
+	//Defer to the end of the batch if there is one
+	if(m_loadBatchDepth > 0)
+		m_pendingLoads.push_back(req);
+	else
+		LoadTextures({req});
+}
+
+/**
+	@brief Starts deferring LoadTexture() calls until the matching EndLoadBatch()
+
+	Batches may be nested; the textures are loaded when the outermost one ends. Textures in a batch cannot be used
+	until then.
+ */
+void TextureManager::BeginLoadBatch()
+{
+	m_loadBatchDepth ++;
+}
+
+/**
+	@brief Loads every texture requested since the matching BeginLoadBatch()
+ */
+void TextureManager::EndLoadBatch()
+{
+	m_loadBatchDepth --;
+	if(m_loadBatchDepth > 0)
+		return;
+
+	vector<TextureLoadRequest> files;
+	files.swap(m_pendingLoads);
+	LoadTextures(files);
+}
+
+/**
+	@brief Decodes a PNG file to RGBA8888 pixels
+
+	Safe to call from multiple threads at once.
+ */
+bool TextureManager::DecodePNG(const string& path, size_t& width, size_t& height, vector<uint8_t>& pixels)
+{
 	FILE* fp;
 	png_infop info;
 	png_infop end;
 	auto png = LoadPNG(path, width, height, fp, info, end);
 	if(!png)
-		return;
+		return false;
 
 	auto rowPtrs = png_get_rows(png, info);
+	size_t rowSize = width * 4;
+	pixels.resize(rowSize * height);
+	for(size_t y=0; y<height; y++)
+		memcpy(&pixels[y*rowSize], rowPtrs[y], rowSize);
 
-	int bytesPerComponent = 1;
-	size_t bytesPerPixel = 4*bytesPerComponent;
-	LogTrace("Image is %zu x %zu pixels, RGBA8888\n", width, height);
-	VkDeviceSize size = width * height * bytesPerPixel;
+	png_destroy_read_struct(&png, &info, &end);
+	fclose(fp);
+	return true;
+}
 
-	//Allocate temporary staging buffer
-	//TODO: reuse buffers as much as possible to avoid constant reallocations
-	vk::BufferCreateInfo bufinfo({}, size, vk::BufferUsageFlagBits::eTransferSrc);
-	vk::raii::Buffer stagingBuf(*g_vkComputeDevice, bufinfo);
+/**
+	@brief Loads a set of textures at once
 
-	//Figure out memory requirements of the buffer and decide what physical memory type to use
-	//For now, default to using the first type in the mask that is host visible
-	auto req = stagingBuf.getMemoryRequirements();
-	auto memProperties = g_vkComputePhysicalDevice->getMemoryProperties();
-	uint32_t memType = 0;
-	for(uint32_t i=0; i<32; i++)
+	The files are decoded in parallel. Images drawn by ImGui are then packed into the icon atlas and uploaded together
+	by FlushUploads(), while images sampled by shaders get their own textures, uploaded with as few queue submissions
+	as the staging ring allows (usually just one).
+
+	@param files	Name, path, and intended use of each texture
+ */
+void TextureManager::LoadTextures(const vector<TextureLoadRequest>& files)
+{
+	if(files.empty())
+		return;
+
+	double start = GetTime();
+
+	//Decode everything on the CPU first
+	size_t count = files.size();
+	vector<size_t> widths(count);
+	vector<size_t> heights(count);
+	vector< vector<uint8_t> > pixels(count);
+	vector<uint8_t> ok(count);
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i=0; i<count; i++)
+		ok[i] = DecodePNG(files[i].m_path, widths[i], heights[i], pixels[i]);
+
+	double decoded = GetTime();
+
+	//Get anything else out of the staging ring so we have it all to ourselves
+	FlushUploads();
+
+	//Images drawn by ImGui go in the atlas. They live for the whole session, so pin them.
+	for(size_t i=0; i<count; i++)
 	{
-		//Skip anything not host visible since we have to be able to write to it
-		if(!(memProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible))
+		if(!ok[i] || files[i].m_shaderSampled)
 			continue;
 
-		//Stop if buffer is compatible
-		if(req.memoryTypeBits & (1 << i) )
+		auto& name = files[i].m_name;
+		if(widths[i] + 2 > m_iconAtlas->GetPageWidth())
 		{
-			memType = i;
-			break;
+			LogError("Texture \"%s\" is %zu pixels wide, too wide for the icon atlas (%u pixels)\n",
+				name.c_str(), widths[i], m_iconAtlas->GetPageWidth() - 2);
+			continue;
+		}
+
+		uint8_t* mappedPtr;
+		auto entry = m_iconAtlas->Add(hash<string>()(name), 0, widths[i], heights[i], mappedPtr, true);
+		if(!entry)
+		{
+			LogError("Could not add texture \"%s\" to the icon atlas\n", name.c_str());
+			continue;
+		}
+		memcpy(mappedPtr, pixels[i].data(), pixels[i].size());
+		m_images[name] = entry->GetRegion();
+	}
+	FlushUploads();
+
+	//Images sampled by shaders get their own textures
+	auto& cmdBuf = *m_cmdBuf;
+	cmdBuf.begin({});
+	for(size_t i=0; i<count; i++)
+	{
+		if(!ok[i] || !files[i].m_shaderSampled)
+			continue;
+
+		//If the ring is full, push out what we have so far and start over
+		vk::DeviceSize size = pixels[i].size();
+		vk::DeviceSize offset;
+		auto mappedPtr = m_staging->Allocate(size, offset);
+		if(!mappedPtr)
+		{
+			cmdBuf.end();
+			m_queue->SubmitAndBlock(cmdBuf);
+			m_staging->Reset();
+
+			cmdBuf.begin({});
+			mappedPtr = m_staging->Allocate(size, offset);
 		}
+		memcpy(mappedPtr, pixels[i].data(), size);
+
+		vk::ImageCreateInfo imageInfo(
+			{},
+			vk::ImageType::e2D,
+			vk::Format::eR8G8B8A8Unorm,
+			vk::Extent3D(widths[i], heights[i], 1),
+			1,
+			1,
+			VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
+			VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+			vk::SharingMode::eExclusive,
+			{},
+			vk::ImageLayout::eUndefined
+			);
+		auto tex = make_shared<Texture>(
+			*g_vkComputeDevice,
+			imageInfo,
+			m_staging->GetBuffer(),
+			widths[i],
+			heights[i],
+			this,
+			files[i].m_name,
+			true,
+			offset,
+			&cmdBuf);
+		m_textures[files[i].m_name] = tex;
+
+		TextureRegion region;
+		region.m_texture = tex;
+		m_images[files[i].m_name] = region;
 	}
-	LogTrace("Using memory type %u for staging buffer\n", memType);
+	cmdBuf.end();
+	m_queue->SubmitAndBlock(cmdBuf);
+	m_staging->Reset();
+
+	LogTrace("Loaded %zu textures in %.2f ms (%.2f ms decoding), icon atlas has %zu pages\n",
+		count,
+		(GetTime() - start) * 1000,
+		(decoded - start) * 1000,
+		m_iconAtlas->GetPageCount());
+}
 
-	//Allocate the memory and bind to the buffer
-	vk::MemoryAllocateInfo minfo(req.size, memType);
-	vk::raii::DeviceMemory physMem(*g_vkComputeDevice, minfo);
-	auto mappedPtr = reinterpret_cast<uint8_t*>(physMem.mapMemory(0, req.size));
-	stagingBuf.bindMemory(*physMem, 0);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batched uploads
 
-	//Fill the mapped buffer with image data from the PNG
-	size_t rowSize = width * bytesPerPixel;
-	for(size_t y=0; y<height; y++)
-		memcpy(mappedPtr + (y*rowSize), rowPtrs[y], rowSize);
-	physMem.unmapMemory();
+/**
+	@brief Allocates space in the shared staging ring, flushing pending uploads first if it's full
 
-	//Make the texture object
-	vk::ImageCreateInfo imageInfo(
-		{},
-		vk::ImageType::e2D,
-		vk::Format::eR8G8B8A8Unorm,
-		vk::Extent3D(width, height, 1),
-		1,
-		1,
-		VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
-		VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
-		vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-		vk::SharingMode::eExclusive,
-		{},
-		vk::ImageLayout::eUndefined
-		);
-	m_textures[name] = make_shared<Texture>(*g_vkComputeDevice, imageInfo, stagingBuf, width, height, this, name);
+	@param size		Number of bytes needed
+	@param offset	Offset of the allocation within the staging buffer
 
-	//Clean up
-	png_destroy_read_struct(&png, &info, &end);
-	fclose(fp);
+	@return Pointer to the mapped staging memory
+ */
+uint8_t* TextureManager::AllocateStaging(vk::DeviceSize size, vk::DeviceSize& offset)
+{
+	auto ptr = m_staging->Allocate(size, offset);
+	if(ptr)
+		return ptr;
+
+	FlushUploads();
+	return m_staging->Allocate(size, offset);
+}
+
+/**
+	@brief Queues a copy from the staging ring into a texture in the general layout
+
+	The source data must be written before the next call to FlushUploads().
+ */
+void TextureManager::QueueUpload(shared_ptr<Texture> tex, const vk::BufferImageCopy& region)
+{
+	m_pendingUploads.push_back(pair<shared_ptr<Texture>, vk::BufferImageCopy>(tex, region));
+}
+
+/**
+	@brief Submits all queued uploads in a single command buffer, then recycles the staging ring
+
+	Called once per frame before rendering, and whenever the staging ring fills up.
+ */
+void TextureManager::FlushUploads()
+{
+	if(m_pendingUploads.empty())
+	{
+		m_staging->Reset();
+		return;
+	}
+
+	//Group copies by destination so each texture gets one pair of barriers
+	map<Texture*, vector<vk::BufferImageCopy> > regions;
+	for(auto& it : m_pendingUploads)
+		regions[it.first.get()].push_back(it.second);
+
+	auto& cmdBuf = *m_cmdBuf;
+	cmdBuf.begin({});
+
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	for(auto& it : regions)
+	{
+		auto image = it.first->GetImage();
+
+		vk::ImageMemoryBarrier toTransfer(
+			vk::AccessFlagBits::eShaderRead,
+			vk::AccessFlagBits::eTransferWrite,
+			vk::ImageLayout::eGeneral,
+			vk::ImageLayout::eGeneral,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			image,
+			range);
+		cmdBuf.pipelineBarrier(
+			vk::PipelineStageFlagBits::eFragmentShader,
+			vk::PipelineStageFlagBits::eTransfer,
+			{},
+			{},
+			{},
+			toTransfer);
+
+		cmdBuf.copyBufferToImage(*m_staging->GetBuffer(), image, vk::ImageLayout::eGeneral, it.second);
+
+		vk::ImageMemoryBarrier toShader(
+			vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eShaderRead,
+			vk::ImageLayout::eGeneral,
+			vk::ImageLayout::eGeneral,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			image,
+			range);
+		cmdBuf.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eFragmentShader,
+			{},
+			{},
+			{},
+			toShader);
+	}
+
+	cmdBuf.end();
+	m_queue->SubmitAndBlock(cmdBuf);
+
+	m_pendingUploads.clear();
+	m_staging->Reset();
 }
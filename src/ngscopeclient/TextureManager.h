@@ -39,6 +39,8 @@ class TextureManager;
 
 #include <png.h>
 
+#include "TextureAtlas.h"
+
 /**
 	@brief Encapsulates the various Vulkan objects we need to represent texture image memory
 
@@ -55,14 +57,17 @@ public:
 		int height,
 		TextureManager* mgr,
 		const std::string& name = "",
-		bool upsampleLinear = true		//false for nearest neighbor upsampling instead
+		bool upsampleLinear = true,		//false for nearest neighbor upsampling instead
+		vk::DeviceSize srcOffset = 0,
+		vk::raii::CommandBuffer* batchCmdBuf = nullptr	//record the upload here rather than submitting it
 		);
 
 	Texture(
 		const vk::raii::Device& device,
 		const vk::ImageCreateInfo& imageInfo,
 		TextureManager* mgr,
-		const std::string& name = ""
+		const std::string& name = "",
+		bool upsampleLinear = true
 		);
 
 	~Texture();
@@ -98,8 +103,29 @@ protected:
 	std::unique_ptr<vk::raii::DeviceMemory> m_deviceMemory;
 };
 
+/**
+	@brief A texture waiting to be loaded from a file
+ */
+class TextureLoadRequest
+{
+public:
+	TextureLoadRequest(const std::string& name, const std::string& path, bool shaderSampled)
+	: m_name(name)
+	, m_path(path)
+	, m_shaderSampled(shaderSampled)
+	{}
+
+	std::string m_name;
+	std::string m_path;
+	bool m_shaderSampled;
+};
+
 /**
 	@brief Manages loading and saving texture resources to files
+
+	Images drawn by ImGui (icons etc.) are packed into a shared atlas and must be drawn with the texture coordinates
+	from GetImage(). Images sampled by our own shaders (e.g. color ramps) get a dedicated texture so the shader can
+	use the whole thing, which is available from GetView().
  */
 class TextureManager
 {
@@ -109,21 +135,28 @@ public:
 
 	void LoadTexture(
 		const std::string& name,
-		const std::string& path);
+		const std::string& path,
+		bool shaderSampled = false);
+
+	void BeginLoadBatch();
+	void EndLoadBatch();
 
 	GLFWimage LoadPNGToGLFWImage(const std::string& path);
 
-	ImTextureID GetTexture(const std::string& name)
+	/**
+		@brief Gets the texture and texture coordinates of a named image
+	 */
+	const TextureRegion& GetImage(const std::string& name)
 	{
-		auto it = m_textures.find(name);
-		if(it == m_textures.end())
+		auto it = m_images.find(name);
+		if(it == m_images.end())
 		{
 			LogFatal(
 				"Texture \"%s\" not found. This is probably the result of a developer mistyping a texture ID.\n",
 				name.c_str());
 		}
 		else
-			return it->second->GetTexture();
+			return it->second;
 	}
 
 	std::unique_ptr<vk::raii::Sampler>& GetSampler()
@@ -133,7 +166,14 @@ public:
 	{ return m_nearestSampler; }
 
 	void clear()
-	{ m_textures.clear(); }
+	{
+		m_images.clear();
+		m_textures.clear();
+		m_pendingUploads.clear();
+		m_pendingLoads.clear();
+		m_iconAtlas->clear();
+		m_scanlineAtlas->clear();
+	}
 
 	vk::raii::CommandBuffer& GetCmdBuffer()
 	{ return *m_cmdBuf; }
@@ -141,11 +181,23 @@ public:
 	std::shared_ptr<QueueHandle> GetQueue()
 	{ return m_queue; }
 
+	///@brief Gets the view of a texture loaded with shaderSampled set
 	vk::ImageView GetView(const std::string& name)
 	{ return m_textures[name]->GetView(); }
 
+	uint8_t* AllocateStaging(vk::DeviceSize size, vk::DeviceSize& offset);
+	void QueueUpload(std::shared_ptr<Texture> tex, const vk::BufferImageCopy& region);
+	void FlushUploads();
+
+	///@brief Shared atlas for small single-row images, such as protocol analyzer scanlines
+	TextureAtlas& GetScanlineAtlas()
+	{ return *m_scanlineAtlas; }
+
 protected:
 
+	bool DecodePNG(const std::string& path, size_t& width, size_t& height, std::vector<uint8_t>& pixels);
+	void LoadTextures(const std::vector<TextureLoadRequest>& files);
+
 	png_structp LoadPNG(
 		const std::string& path,
 		size_t& width,
@@ -154,6 +206,10 @@ protected:
 		png_infop& info,
 		png_infop& end);
 
+	///@brief Every named image, wherever it's stored
+	std::map<std::string, TextureRegion> m_images;
+
+	///@brief Dedicated textures for images sampled by shaders
 	std::map<std::string, std::shared_ptr<Texture> > m_textures;
 
 	///@brief Sampler for textures
@@ -164,6 +220,24 @@ protected:
 	std::shared_ptr<QueueHandle> m_queue;
 	std::unique_ptr<vk::raii::CommandPool> m_cmdPool;
 	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	///@brief Staging memory reused by all uploads
+	std::unique_ptr<TextureStagingRing> m_staging;
+
+	///@brief Copies out of m_staging waiting for FlushUploads()
+	std::vector< std::pair<std::shared_ptr<Texture>, vk::BufferImageCopy> > m_pendingUploads;
+
+	///@brief Atlas for scanline images
+	std::unique_ptr<TextureAtlas> m_scanlineAtlas;
+
+	///@brief Atlas for icons and other named images drawn by ImGui
+	std::unique_ptr<TextureAtlas> m_iconAtlas;
+
+	///@brief Nesting depth of BeginLoadBatch() calls
+	int m_loadBatchDepth;
+
+	///@brief Textures waiting for EndLoadBatch()
+	std::vector<TextureLoadRequest> m_pendingLoads;
 };
 
 #endif
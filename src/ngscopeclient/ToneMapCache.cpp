@@ -0,0 +1,114 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ToneMapCache
+ */
+#include "ngscopeclient.h"
+#include "ToneMapCache.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+ToneMapCache::ToneMapCache()
+	: m_source(nullptr)
+	, m_generation(0)
+	, m_timestamp(0, 0)
+{
+}
+
+/**
+	@brief Forgets the previous tone mapping, forcing the next one to run
+
+	Must be called whenever the output texture is reallocated, since its contents are then undefined.
+ */
+void ToneMapCache::Clear()
+{
+	m_source = nullptr;
+	m_generation = 0;
+	m_timestamp = TimePoint(0, 0);
+	m_colorRamp.clear();
+	m_args.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache keys
+
+/**
+	@brief Checks if the texture was last tone mapped from the same inputs
+
+	@param source		The buffer or waveform being tone mapped
+	@param generation	Generation or revision of the source
+	@param timestamp	Timestamp of the source, if it's a waveform
+	@param colorRamp	Color ramp being used
+	@param args			Shader arguments
+	@param argsize		Size of the shader arguments, in bytes
+ */
+bool ToneMapCache::IsCurrent(
+	const void* source,
+	uint64_t generation,
+	TimePoint timestamp,
+	const string& colorRamp,
+	const void* args,
+	size_t argsize)
+{
+	return
+		(source != nullptr) &&
+		(source == m_source) &&
+		(generation == m_generation) &&
+		(timestamp == m_timestamp) &&
+		(colorRamp == m_colorRamp) &&
+		(argsize == m_args.size()) &&
+		(memcmp(args, m_args.data(), argsize) == 0);
+}
+
+/**
+	@brief Records the inputs the texture was just tone mapped from
+ */
+void ToneMapCache::SetKey(
+	const void* source,
+	uint64_t generation,
+	TimePoint timestamp,
+	const string& colorRamp,
+	const void* args,
+	size_t argsize)
+{
+	m_source = source;
+	m_generation = generation;
+	m_timestamp = timestamp;
+	m_colorRamp = colorRamp;
+
+	auto p = reinterpret_cast<const uint8_t*>(args);
+	m_args.assign(p, p + argsize);
+}
@@ -0,0 +1,109 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ToneMapCache
+ */
+#ifndef ToneMapCache_h
+#define ToneMapCache_h
+
+/**
+	@brief Keeps track of what a channel's texture was last tone mapped from
+
+	Tone mapping is re-run for every displayed channel whenever any waveform arrives or any re-render completes, even
+	though most channels' inputs are often unchanged (e.g. an eye pattern that isn't integrating, or an area that was
+	not re-rendered). The output only depends on the source buffer contents, the color ramp, and the shader arguments
+	(which include the size, color, and any view scaling), so if none of those changed the texture is still current.
+
+	The source is identified by a pointer plus a generation counter: the channel's own rasterization count for analog
+	and digital waveforms, or the revision and timestamp of the waveform for density functions that are tone mapped
+	directly.
+ */
+class ToneMapCache
+{
+public:
+	ToneMapCache();
+
+	void Clear();
+
+	template<class T>
+	bool IsCurrent(
+		const void* source,
+		uint64_t generation,
+		TimePoint timestamp,
+		const std::string& colorRamp,
+		const T& args)
+	{ return IsCurrent(source, generation, timestamp, colorRamp, &args, sizeof(args)); }
+
+	template<class T>
+	void SetKey(
+		const void* source,
+		uint64_t generation,
+		TimePoint timestamp,
+		const std::string& colorRamp,
+		const T& args)
+	{ SetKey(source, generation, timestamp, colorRamp, &args, sizeof(args)); }
+
+protected:
+	bool IsCurrent(
+		const void* source,
+		uint64_t generation,
+		TimePoint timestamp,
+		const std::string& colorRamp,
+		const void* args,
+		size_t argsize);
+
+	void SetKey(
+		const void* source,
+		uint64_t generation,
+		TimePoint timestamp,
+		const std::string& colorRamp,
+		const void* args,
+		size_t argsize);
+
+	///@brief The buffer or waveform the texture was tone mapped from
+	const void* m_source;
+
+	///@brief Generation or revision of m_source when it was tone mapped
+	uint64_t m_generation;
+
+	///@brief Timestamp of m_source when it was tone mapped (density functions only)
+	TimePoint m_timestamp;
+
+	///@brief Color ramp used for tone mapping
+	std::string m_colorRamp;
+
+	///@brief Raw bytes of the shader arguments used for tone mapping
+	std::vector<uint8_t> m_args;
+};
+
+#endif
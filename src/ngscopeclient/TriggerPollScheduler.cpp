@@ -0,0 +1,175 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of TriggerPollScheduler
+ */
+
+#include "ngscopeclient.h"
+#include "TriggerPollScheduler.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+TriggerPollScheduler::TriggerPollScheduler()
+	: m_local(false)
+	, m_waiting(false)
+	, m_waitStart(0)
+	, m_nextPoll(0)
+	, m_backoff(MIN_INTERVAL)
+	, m_windowStart(GetTime())
+	, m_windowPolls(0)
+	, m_windowBusy(0)
+	, m_fastPolling(false)
+	, m_pollRate(0)
+	, m_pollUtilization(0)
+	, m_pollLatency(0)
+	, m_expectedInterval(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scheduling
+
+/**
+	@brief Checks if the trigger should be polled now
+
+	The first call after a trigger (or after the instrument is re-armed) starts timing the wait for the next one.
+ */
+bool TriggerPollScheduler::IsPollDue()
+{
+	double now = GetTime();
+	UpdateStatistics(now);
+
+	if(!m_waiting)
+	{
+		m_waiting = true;
+		m_waitStart = now;
+		m_nextPoll = now;
+		m_backoff = MIN_INTERVAL;
+	}
+
+	return (now >= m_nextPoll);
+}
+
+/**
+	@brief Records the result of a trigger poll and schedules the next one
+
+	@param start		Time the poll was sent
+	@param end			Time the poll returned
+	@param triggered	True if the instrument has triggered
+ */
+void TriggerPollScheduler::OnPoll(double start, double end, bool triggered)
+{
+	//Keep track of how much the poll itself costs
+	double latency = end - start;
+	m_windowPolls ++;
+	m_windowBusy += latency;
+	if(m_pollLatency == 0)
+		m_pollLatency = latency;
+	else
+		m_pollLatency = m_pollLatency * (1 - EWMA_ALPHA) + latency * EWMA_ALPHA;
+	m_fastPolling = m_local || (m_pollLatency < LOCAL_POLL_THRESHOLD);
+
+	//Learn the interval, then start waiting for the next trigger on the next IsPollDue() call
+	if(triggered)
+	{
+		double interval = end - m_waitStart;
+		if(m_expectedInterval == 0)
+			m_expectedInterval = interval;
+		else
+			m_expectedInterval = m_expectedInterval * (1 - EWMA_ALPHA) + interval * EWMA_ALPHA;
+		m_waiting = false;
+		return;
+	}
+
+	double delay;
+	double expected = m_expectedInterval;
+
+	//Polling doesn't cost anything, no reason to slow down
+	if(m_fastPolling)
+		delay = MIN_INTERVAL;
+
+	//No idea when to expect a trigger yet, or the trigger is overdue: back off exponentially
+	else if( (expected == 0) || (end - m_waitStart) > 2*expected)
+	{
+		delay = m_backoff;
+		m_backoff = min(m_backoff * 2, MAX_INTERVAL);
+	}
+
+	else
+	{
+		double remaining = expected - (end - m_waitStart);
+		double window = max(2*MIN_INTERVAL, 0.1 * expected);
+
+		//Well before the expected trigger: close half the remaining gap each poll
+		if(remaining > window)
+			delay = min(max(remaining / 2, MIN_INTERVAL), MAX_INTERVAL);
+
+		//Close to (or somewhat past) the expected time, poll at the full rate
+		else
+			delay = MIN_INTERVAL;
+	}
+
+	m_nextPoll = end + delay;
+}
+
+/**
+	@brief Called when the instrument is found to be disarmed, so the next wait starts timing when it's re-armed
+ */
+void TriggerPollScheduler::OnDisarmed()
+{
+	m_waiting = false;
+	UpdateStatistics(GetTime());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Publishes the poll rate and link utilization once per statistics window
+ */
+void TriggerPollScheduler::UpdateStatistics(double now)
+{
+	double dt = now - m_windowStart;
+	if(dt < STATS_WINDOW)
+		return;
+
+	m_pollRate = m_windowPolls / dt;
+	m_pollUtilization = m_windowBusy / dt;
+
+	m_windowStart = now;
+	m_windowPolls = 0;
+	m_windowBusy = 0;
+}
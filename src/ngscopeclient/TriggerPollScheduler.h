@@ -0,0 +1,143 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of TriggerPollScheduler
+ */
+#ifndef TriggerPollScheduler_h
+#define TriggerPollScheduler_h
+
+/**
+	@brief Decides when an armed instrument's trigger status should next be polled
+
+	Polling a network-attached scope once per millisecond costs a SCPI round trip every time, which competes with the
+	waveform download itself. The scheduler learns the typical time from re-arm to trigger for each instrument and
+	only polls at the full rate close to when the next trigger is expected. Before that point the poll interval
+	approaches the expected time geometrically, and once a trigger is overdue the interval backs off exponentially.
+
+	Drivers whose trigger status is answered locally (non-SCPI transports, or bridges which push trigger
+	notifications over their data channel so polling them never touches the wire) are detected by the cost of the
+	poll itself and keep polling at the full rate, since there is nothing to save.
+
+	Scheduling calls are made by the instrument thread only; the statistics are atomic and may be read from any thread.
+ */
+class TriggerPollScheduler
+{
+public:
+	TriggerPollScheduler();
+
+	void SetLocal(bool local)
+	{ m_local = local; }
+
+	bool IsPollDue();
+	void OnPoll(double start, double end, bool triggered);
+	void OnDisarmed();
+
+	///@brief Returns true if polls are cheap enough that we always poll at the full rate
+	bool IsFastPolling()
+	{ return m_fastPolling; }
+
+	///@brief Returns the number of trigger polls per second over the last measurement window
+	double GetPollRate()
+	{ return m_pollRate; }
+
+	///@brief Returns the fraction of time the instrument link spent servicing trigger polls
+	double GetPollLinkUtilization()
+	{ return m_pollUtilization; }
+
+	///@brief Returns the average round trip time of a single trigger poll, in seconds
+	double GetPollLatency()
+	{ return m_pollLatency; }
+
+	///@brief Returns the learned re-arm to trigger interval, in seconds (0 if not yet known)
+	double GetExpectedTriggerInterval()
+	{ return m_expectedInterval; }
+
+protected:
+	void UpdateStatistics(double now);
+
+	///@brief Shortest interval between polls, used near the expected trigger time (seconds)
+	static constexpr double MIN_INTERVAL = 0.001;
+
+	///@brief Longest interval between polls, which bounds the added trigger latency (seconds)
+	static constexpr double MAX_INTERVAL = 0.05;
+
+	///@brief Polls faster than this are assumed not to generate any link traffic (seconds)
+	static constexpr double LOCAL_POLL_THRESHOLD = 100e-6;
+
+	///@brief Weight of each new sample in the running averages
+	static constexpr double EWMA_ALPHA = 0.25;
+
+	///@brief Length of the window over which poll rate statistics are computed (seconds)
+	static constexpr double STATS_WINDOW = 1.0;
+
+	///@brief True if the transport is known to not generate link traffic
+	bool m_local;
+
+	///@brief True if we're currently waiting for a trigger
+	bool m_waiting;
+
+	///@brief Time we started waiting for the current trigger
+	double m_waitStart;
+
+	///@brief Time the next poll is due
+	double m_nextPoll;
+
+	///@brief Current backoff interval once the expected trigger time has passed
+	double m_backoff;
+
+	///@brief Start of the current statistics window
+	double m_windowStart;
+
+	///@brief Number of polls in the current statistics window
+	size_t m_windowPolls;
+
+	///@brief Time spent polling in the current statistics window
+	double m_windowBusy;
+
+	///@brief True if polls are cheap enough that we always poll at the full rate
+	std::atomic<bool> m_fastPolling;
+
+	///@brief Polls per second over the last complete statistics window
+	std::atomic<double> m_pollRate;
+
+	///@brief Fraction of the last complete statistics window spent polling
+	std::atomic<double> m_pollUtilization;
+
+	///@brief Running average of the poll round trip time
+	std::atomic<double> m_pollLatency;
+
+	///@brief Running average of the re-arm to trigger interval
+	std::atomic<double> m_expectedInterval;
+};
+
+#endif
@@ -56,10 +56,15 @@ DisplayedChannel::DisplayedChannel(StreamDescriptor stream, Session& session)
 		: MeasurementDescriptor("", stream)
 		, m_colorRamp("eye-gradient-viridis")
 		, m_session(session)
-		, m_rasterizedWaveform("DisplayedChannel.m_rasterizedWaveform")
+		, m_rasterizedWaveform(make_shared<AcceleratorBuffer<float> >("DisplayedChannel.m_rasterizedWaveform"))
 		, m_indexBuffer("DisplayedChannel.m_indexBuffer")
 		, m_rasterizedX(0)
 		, m_rasterizedY(0)
+		, m_rasterizedGeneration(0)
+		, m_textureX(0)
+		, m_textureY(0)
+		, m_textureAllocX(0)
+		, m_textureAllocY(0)
 		, m_cachedX(0)
 		, m_cachedY(0)
 		, m_persistenceEnabled(true)
@@ -69,21 +74,27 @@ DisplayedChannel::DisplayedChannel(StreamDescriptor stream, Session& session)
 	if(schan)
 		schan->AddRef();
 
-	vk::CommandPoolCreateInfo cmdPoolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		session.GetMainWindow()->GetRenderQueue()->GetQueue()->m_family );
-	m_utilCmdPool = std::make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, cmdPoolInfo);
-	vk::CommandBufferAllocateInfo bufinfo(**m_utilCmdPool, vk::CommandBufferLevel::ePrimary, 1);
-
-	m_utilCmdBuffer = make_unique<vk::raii::CommandBuffer>(
-			std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
-
 	//Use GPU-side memory for rasterized waveform
 	//TODO: instead of using CPU-side mirror, use a shader to memset it when clearing?
-	m_rasterizedWaveform.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-	m_rasterizedWaveform.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_rasterizedWaveform->SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_rasterizedWaveform->SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	//Use GPU local memory for index buffer
+	m_indexBuffer.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_indexBuffer.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+}
+
+/**
+	@brief Gets the tone mapping pipeline for this channel, creating it if necessary
+
+	Pipelines are created on first use rather than in the constructor, so channels that are never drawn (or loading
+	a session with many channels) don't pay for them up front.
+ */
+shared_ptr<ComputePipeline> DisplayedChannel::GetToneMapPipeline()
+{
+	if(m_toneMapPipe)
+		return m_toneMapPipe;
 
-	//Create tone map pipeline depending on waveform type
 	switch(m_sourceStream.GetType())
 	{
 		case Stream::STREAM_TYPE_EYE:
@@ -110,23 +121,33 @@ DisplayedChannel::DisplayedChannel(StreamDescriptor stream, Session& session)
 			m_toneMapPipe = make_shared<ComputePipeline>(
 				"shaders/WaveformToneMap.spv", 1, sizeof(WaveformToneMapArgs), 1);
 	}
+	SchedulePipelineCacheSave();
+
+	return m_toneMapPipe;
+}
 
-	//If we have native int64 support we can do the index search for sparse waveforms on the GPU
+/**
+	@brief Gets the pipeline for the X axis index search of sparse waveforms, creating it if necessary
+ */
+shared_ptr<ComputePipeline> DisplayedChannel::GetIndexSearchPipeline()
+{
+	if(m_indexSearchComputePipeline)
+		return m_indexSearchComputePipeline;
+
+	//Without native int64 support, search the X positions rebased to float by RebasedOffsets instead
 	if(g_hasShaderInt64)
 	{
 		m_indexSearchComputePipeline = make_shared<ComputePipeline>(
 				"shaders/IndexSearch.spv", 2, sizeof(IndexSearchConstants));
-
-		//Use GPU local memory for index buffer
-		m_indexBuffer.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
-		m_indexBuffer.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
 	}
 	else
 	{
-		//Use pinned memory for index buffer since it should only be read once
-		m_indexBuffer.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
-		m_indexBuffer.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_UNLIKELY);
+		m_indexSearchComputePipeline = make_shared<ComputePipeline>(
+				"shaders/IndexSearchRebased.spv", 2, sizeof(IndexSearchRebasedConstants));
 	}
+	SchedulePipelineCacheSave();
+
+	return m_indexSearchComputePipeline;
 }
 
 DisplayedChannel::~DisplayedChannel()
@@ -149,11 +170,33 @@ DisplayedChannel::~DisplayedChannel()
 		//If the channel is part of an instrument and we turned it off, we may have changed the set of sample rates
 		//Refresh the sidebar!
 		//TODO: make this more narrow and only refresh this scope etc?
-		if( (scope != nullptr) && !schan->IsEnabled())
+		if( (scope != nullptr) && !schan->IsEnabled() && m_session.GetMainWindow())
 			m_session.GetMainWindow()->RefreshStreamBrowserDialog();
 	}
 }
 
+/**
+	@brief Gets the command buffer for one-off work like refreshing eye patterns, creating it if necessary
+
+	This is only needed when the channel is displayed in a window, so it's created on the window's render queue
+	the first time it's used rather than in the constructor.
+ */
+vk::raii::CommandBuffer& DisplayedChannel::GetUtilCommandBuffer(MainWindow* top)
+{
+	if(m_utilCmdBuffer)
+		return *m_utilCmdBuffer;
+
+	vk::CommandPoolCreateInfo cmdPoolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		top->GetRenderQueue()->GetQueue()->m_family );
+	m_utilCmdPool = std::make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, cmdPoolInfo);
+	vk::CommandBufferAllocateInfo bufinfo(**m_utilCmdPool, vk::CommandBufferLevel::ePrimary, 1);
+
+	m_utilCmdBuffer = make_unique<vk::raii::CommandBuffer>(
+			std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+	return *m_utilCmdBuffer;
+}
+
 /**
 	@brief Handles a change in size of the displayed waveform
 
@@ -205,7 +248,7 @@ bool DisplayedChannel::UpdateSize(ImVec2 newSize, MainWindow* top)
 			{
 				eye->SetWidth(roundedX);
 				eye->SetHeight(roundedY);
-				eye->Refresh(*m_utilCmdBuffer, m_session.GetMainWindow()->GetRenderQueue());
+				eye->Refresh(GetUtilCommandBuffer(top), top->GetRenderQueue());
 			}
 
 			x = roundedX;
@@ -256,56 +299,36 @@ bool DisplayedChannel::UpdateSize(ImVec2 newSize, MainWindow* top)
 			y = roundedY;
 		}
 
-		LogTrace("Displayed channel resized (to %zu x %zu), reallocating texture\n", x, y);
+		//Same size class as the texture we already have? Just draw into a different part of it
+		m_textureX = x;
+		m_textureY = y;
+		size_t allocX = WaveformResourcePool::GetSizeClass(x);
+		size_t allocY = WaveformResourcePool::GetSizeClass(y);
+		if(m_texture && (allocX == m_textureAllocX) && (allocY == m_textureAllocY) )
+		{
+			LogTrace("Displayed channel resized (to %zu x %zu), reusing %zu x %zu texture\n", x, y, allocX, allocY);
+			return true;
+		}
 
-		//NOTE: Assumes the render queue is also capable of transfers (see QueueManager)
-		vk::ImageCreateInfo imageInfo(
-			{},
-			vk::ImageType::e2D,
-			vk::Format::eR32G32B32A32Sfloat,
-			vk::Extent3D(x, y, 1),
-			1,
-			1,
-			VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
-			VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
-			vk::SharingMode::eExclusive,
-			{},
-			vk::ImageLayout::eUndefined
-			);
+		LogTrace("Displayed channel resized (to %zu x %zu), switching to %zu x %zu texture\n", x, y, allocX, allocY);
 
 		//Keep a reference to the old texture around for one more frame
-		//in case the previous frame hasn't fully completed rendering yet
-		top->AddTextureUsedThisFrame(m_texture);
+		//in case the previous frame hasn't fully completed rendering yet.
+		//The pool won't hand it out again until that reference is gone.
+		auto& pool = top->GetWaveformResourcePool();
+		if(m_texture)
+		{
+			top->AddTextureUsedThisFrame(m_texture);
+			pool.ReleaseTexture(m_texture, m_textureAllocX, m_textureAllocY);
+		}
 
-		//Make the new texture and mark that as in use too
-		m_texture = make_shared<Texture>(
-			*g_vkComputeDevice, imageInfo, top->GetTextureManager(), "DisplayedChannel.m_texture");
+		//Get the new texture and mark that as in use too
+		m_toneMapCache.Clear();
+		m_texture = pool.GetTexture(allocX, allocY);
+		m_textureAllocX = allocX;
+		m_textureAllocY = allocY;
 		top->AddTextureUsedThisFrame(m_texture);
 
-		//Add a barrier to convert the image format to "general"
-		lock_guard<mutex> lock(g_vkTransferMutex);
-		vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
-		vk::ImageMemoryBarrier barrier(
-			vk::AccessFlagBits::eNone,
-			vk::AccessFlagBits::eShaderWrite,
-			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eGeneral,
-			VK_QUEUE_FAMILY_IGNORED,
-			VK_QUEUE_FAMILY_IGNORED,
-			m_texture->GetImage(),
-			range);
-		g_vkTransferCommandBuffer->begin({});
-		g_vkTransferCommandBuffer->pipelineBarrier(
-				vk::PipelineStageFlagBits::eTopOfPipe,
-				vk::PipelineStageFlagBits::eComputeShader,
-				{},
-				{},
-				{},
-				barrier);
-		g_vkTransferCommandBuffer->end();
-		g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
-
 		return true;
 	}
 
@@ -324,14 +347,22 @@ void DisplayedChannel::PrepareToRasterize(size_t x, size_t y)
 
 	if(sizeChanged)
 	{
+		//Move to a buffer from the pool if we no longer fit this one's size class (or are well below it)
 		size_t npixels = x*y;
-		m_rasterizedWaveform.resize(npixels);
+		size_t sizeClass = WaveformResourcePool::GetSizeClass(npixels);
+		if(m_rasterizedWaveform->size() != sizeClass)
+		{
+			auto& pool = m_session.GetMainWindow()->GetWaveformResourcePool();
+			pool.ReleaseBuffer(m_rasterizedWaveform);
+			m_rasterizedWaveform = pool.GetBuffer(sizeClass);
+		}
 
 		//fill with black
 		//TODO: do this in a shader
-		m_rasterizedWaveform.PrepareForCpuAccess();
-		memset(m_rasterizedWaveform.GetCpuPointer(), 0, npixels * sizeof(float));
-		m_rasterizedWaveform.MarkModifiedFromCpu();
+		m_rasterizedWaveform->PrepareForCpuAccess();
+		memset(m_rasterizedWaveform->GetCpuPointer(), 0, npixels * sizeof(float));
+		m_rasterizedWaveform->MarkModifiedFromCpu();
+		m_rasterizedGeneration ++;
 	}
 
 	//Allocate index buffer for sparse waveforms
@@ -367,6 +398,7 @@ WaveformArea::WaveformArea(StreamDescriptor stream, shared_ptr<WaveformGroup> gr
 	, m_dragState(DRAG_STATE_NONE)
 	, m_group(group)
 	, m_parent(parent)
+	, m_session(group->GetSession())
 	, m_tLastMouseMove(GetTime())
 	, m_mouseOverTriggerArrow(false)
 	, m_mouseOverBERTarget(false)
@@ -379,11 +411,31 @@ WaveformArea::WaveformArea(StreamDescriptor stream, shared_ptr<WaveformGroup> gr
 	, m_dragPeakLabel(nullptr)
 	, m_mouseOverButton(false)
 	, m_yAxisCursorMode(Y_CURSOR_NONE)
+	, m_cursor0ColorPref(group->GetSession().GetPreferences(), "Appearance.Cursors.cursor_1_color")
+	, m_cursor1ColorPref(group->GetSession().GetPreferences(), "Appearance.Cursors.cursor_2_color")
+	, m_cursorFillColorPref(group->GetSession().GetPreferences(), "Appearance.Cursors.cursor_fill_color")
+	, m_cursorFontPref(group->GetSession().GetPreferences(), "Appearance.Cursors.label_font")
+	, m_maskColorPref(group->GetSession().GetPreferences(), "Appearance.Eye Patterns.mask_color")
+	, m_maskPassColorPref(group->GetSession().GetPreferences(), "Appearance.Eye Patterns.border_color_pass")
+	, m_maskFailColorPref(group->GetSession().GetPreferences(), "Appearance.Eye Patterns.border_color_fail")
+	, m_constellationColorPref(group->GetSession().GetPreferences(), "Appearance.Constellations.point_color")
+	, m_peakTextColorPref(group->GetSession().GetPreferences(), "Appearance.Peaks.peak_text_color")
+	, m_peakFontPref(group->GetSession().GetPreferences(), "Appearance.Peaks.label_font")
+	, m_protocolFontPref(group->GetSession().GetPreferences(), "Appearance.Decodes.protocol_font")
+	, m_bottomColorPref(group->GetSession().GetPreferences(), "Appearance.Graphs.bottom_color")
+	, m_topColorPref(group->GetSession().GetPreferences(), "Appearance.Graphs.top_color")
+	, m_gridCenterlineColorPref(group->GetSession().GetPreferences(), "Appearance.Graphs.grid_centerline_color")
+	, m_gridColorPref(group->GetSession().GetPreferences(), "Appearance.Graphs.grid_color")
+	, m_gridCenterlineWidthPref(group->GetSession().GetPreferences(), "Appearance.Graphs.grid_centerline_width")
+	, m_gridWidthPref(group->GetSession().GetPreferences(), "Appearance.Graphs.grid_width")
+	, m_yAxisTextColorPref(group->GetSession().GetPreferences(), "Appearance.Graphs.y_axis_text_color")
+	, m_yAxisFontPref(group->GetSession().GetPreferences(), "Appearance.Graphs.y_axis_font")
+	, m_timelineAxisColorPref(group->GetSession().GetPreferences(), "Appearance.Timeline.axis_color")
 {
 	m_yAxisCursorPositions[0] = 0;
 	m_yAxisCursorPositions[1] = 0;
 
-	CreateInput(stream, m_parent->GetSession());
+	CreateInput(stream, m_session);
 }
 
 WaveformArea::~WaveformArea()
@@ -478,7 +530,7 @@ void WaveformArea::LoadConfiguration(YAML::Node& node)
  */
 void WaveformArea::AddStream(StreamDescriptor desc, bool persistence, const string& ramp)
 {
-	auto chan = CreateInput(desc, m_parent->GetSession());
+	auto chan = CreateInput(desc, m_session);
 	chan->SetPersistenceEnabled(persistence);
 	chan->m_colorRamp = ramp;
 	OnStreamAdded(desc);
@@ -489,7 +541,7 @@ void WaveformArea::AddStream(StreamDescriptor desc, bool persistence, const stri
  */
 void WaveformArea::AddStream(StreamDescriptor desc, size_t position, bool persistence, const string& ramp)
 {
-	auto chan = make_shared<DisplayedChannel>(desc, m_parent->GetSession());
+	auto chan = make_shared<DisplayedChannel>(desc, m_session);
 	chan->SetPersistenceEnabled(persistence);
 	chan->m_colorRamp = ramp;
 	if(position >= m_inputs.size())
@@ -935,11 +987,10 @@ void WaveformArea::RenderYAxisCursors(ImVec2 pos, ImVec2 size, float yAxisWidth)
 
 	auto list = ImGui::GetWindowDrawList();
 
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto cursor0_color = prefs.GetColor("Appearance.Cursors.cursor_1_color");
-	auto cursor1_color = prefs.GetColor("Appearance.Cursors.cursor_2_color");
-	auto fill_color = prefs.GetColor("Appearance.Cursors.cursor_fill_color");
-	auto font = m_parent->GetFontPref("Appearance.Cursors.label_font");
+	auto cursor0_color = m_cursor0ColorPref.Get();
+	auto cursor1_color = m_cursor1ColorPref.Get();
+	auto fill_color = m_cursorFillColorPref.Get();
+	auto font = m_parent->GetFontPref(m_cursorFontPref);
 	ImGui::PushFont(font.first, font.second);
 
 	float ypos0 = round(YAxisUnitsToYPosition(m_yAxisCursorPositions[0]));
@@ -1100,7 +1151,7 @@ void WaveformArea::PlotContextMenu()
 	{
 		//Look for markers that might be near our right click location
 		float lastRightClickPos = m_group->XAxisUnitsToXPosition(m_lastRightClickOffset);
-		auto& markers = m_parent->GetSession().GetMarkers(GetWaveformTimestamp());
+		auto& markers = m_session.GetMarkers(GetWaveformTimestamp());
 		bool hitMarker = false;
 		size_t selectedMarker = 0;
 		for(size_t i=0; i<markers.size(); i++)
@@ -1122,7 +1173,7 @@ void WaveformArea::PlotContextMenu()
 			if(ImGui::MenuItem("Delete"))
 			{
 				markers.erase(markers.begin() + selectedMarker);
-				m_parent->GetSession().OnMarkerChanged();
+				m_session.OnMarkerChanged();
 			}
 		}
 
@@ -1160,7 +1211,7 @@ void WaveformArea::PlotContextMenu()
 
 			if(ImGui::MenuItem("Add Marker"))
 			{
-				auto& session = m_parent->GetSession();
+				auto& session = m_session;
 				session.AddMarker(Marker(GetWaveformTimestamp(), m_lastRightClickOffset, session.GetNextMarkerName()));
 			}
 		}
@@ -1265,8 +1316,9 @@ void WaveformArea::RenderAnalogWaveform(shared_ptr<DisplayedChannel> channel, Im
 
 	//Render the tone mapped output (if we have it)
 	auto tex = channel->GetTexture();
+	auto uv = channel->GetTextureUV();
 	if(tex != nullptr)
-		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, 1), ImVec2(1, 0) );
+		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, uv.y), ImVec2(uv.x, 0) );
 
 	//If it's a peak detection filter, draw the peaks and annotations
 	auto pf = dynamic_cast<PeakDetectionFilter*>(stream.m_channel);
@@ -1296,8 +1348,9 @@ void WaveformArea::RenderWaterfallWaveform(shared_ptr<DisplayedChannel> channel,
 
 	//Render the tone mapped output (if we have it)
 	auto tex = channel->GetTexture();
+	auto uv = channel->GetTextureUV();
 	if(tex != nullptr)
-		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, 1), ImVec2(1, 0) );
+		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, uv.y), ImVec2(uv.x, 0) );
 }
 
 /**
@@ -1322,8 +1375,9 @@ void WaveformArea::RenderSpectrogramWaveform(shared_ptr<DisplayedChannel> channe
 
 	//Render the tone mapped output (if we have it)
 	auto tex = channel->GetTexture();
+	auto uv = channel->GetTextureUV();
 	if(tex != nullptr)
-		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, 1), ImVec2(1, 0) );
+		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, uv.y), ImVec2(uv.x, 0) );
 }
 
 /**
@@ -1352,8 +1406,9 @@ void WaveformArea::RenderEyeWaveform(shared_ptr<DisplayedChannel> channel, ImVec
 
 	//Render the tone mapped output (if we have it)
 	auto tex = channel->GetTexture();
+	auto uv = channel->GetTextureUV();
 	if(tex != nullptr)
-		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, 1), ImVec2(1, 0) );
+		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, uv.y), ImVec2(uv.x, 0) );
 
 	//Draw the mask (if there is one)
 	auto eye = dynamic_cast<EyePattern*>(stream.m_channel);
@@ -1361,10 +1416,9 @@ void WaveformArea::RenderEyeWaveform(shared_ptr<DisplayedChannel> channel, ImVec
 	auto bichan = dynamic_cast<BERTInputChannel*>(stream.m_channel);
 	if(eye || bichan)
 	{
-		auto& prefs = m_parent->GetSession().GetPreferences();
-		auto color = prefs.GetColor("Appearance.Eye Patterns.mask_color");
-		auto borderpass = prefs.GetColor("Appearance.Eye Patterns.border_color_pass");
-		auto borderfailed = prefs.GetColor("Appearance.Eye Patterns.border_color_fail");
+		auto color = m_maskColorPref.Get();
+		auto borderpass = m_maskPassColorPref.Get();
+		auto borderfailed = m_maskFailColorPref.Get();
 
 		auto& mask = eye ? eye->GetMask() : bichan->GetMask();
 		auto polygons = mask.GetPolygons();
@@ -1426,17 +1480,17 @@ void WaveformArea::RenderConstellationWaveform(shared_ptr<DisplayedChannel> chan
 
 	//Render the tone mapped output (if we have it)
 	auto tex = channel->GetTexture();
+	auto uv = channel->GetTextureUV();
 	if(tex != nullptr)
-		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, 1), ImVec2(1, 0) );
+		list->AddImage(tex->GetTexture(), start, ImVec2(start.x+size.x, start.y+size.y), ImVec2(0, uv.y), ImVec2(uv.x, 0) );
 
 	//Draw nominal point locations
 	auto cfilt = dynamic_cast<ConstellationFilter*>(stream.m_channel);
 	if(cfilt)
 	{
-		auto& prefs = m_parent->GetSession().GetPreferences();
 		auto& points = cfilt->GetNominalPoints();
 
-		auto color = prefs.GetColor("Appearance.Constellations.point_color");
+		auto color = m_constellationColorPref.Get();
 
 		//TODO: dynamic size?
 		float pointsize = ImGui::GetFontSize() * 0.5;
@@ -1582,10 +1636,9 @@ void WaveformArea::RenderSpectrumPeaks(ImDrawList* list, shared_ptr<DisplayedCha
 	ImVec2 wmax(wmin.x + wsize.x, wmin.y + wsize.y);
 
 	//Draw the peaks and update X/Y size for collision detection
-	auto font = m_parent->GetFontPref("Appearance.Peaks.label_font");
+	auto font = m_parent->GetFontPref(m_peakFontPref);
 	ImGui::PushFont(font.first, font.second);
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto textColor = prefs.GetColor("Appearance.Peaks.peak_text_color");
+	auto textColor = m_peakTextColorPref.Get();
 	auto mousePos = ImGui::GetMousePos();
 	float springMaxLength = 15 * ImGui::GetFontSize();
 	for(size_t i=0; i<channel->m_peakLabels.size(); i++)
@@ -1790,12 +1843,13 @@ void WaveformArea::RenderDigitalWaveform(shared_ptr<DisplayedChannel> channel, I
 	if(tex != nullptr)
 	{
 		auto ypos = channel->GetYButtonPos() + start.y;
+		auto uv = channel->GetTextureUV();
 		list->AddImage(
 			tex->GetTexture(),
 			ImVec2(start.x, ypos - m_channelButtonHeight),
 			ImVec2(start.x+size.x, ypos),
-			ImVec2(0, 1),
-			ImVec2(1, 0) );
+			ImVec2(0, uv.y),
+			ImVec2(uv.x, 0) );
 	}
 }
 
@@ -1810,94 +1864,86 @@ void WaveformArea::RenderProtocolWaveform(std::shared_ptr<DisplayedChannel> chan
 	auto data = dynamic_cast<SparseWaveformBase*>(stream.GetData());
 	if(data == nullptr)
 		return;
-	data->CacheColors();
 
 	auto list = ImGui::GetWindowDrawList();
 
-	//Calculate a bunch of constants
-	int64_t offset = m_group->GetXAxisOffset();
-	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
-
-	//Find the index of the first sample visible on screen
-	data->PrepareForCpuAccess();
-	auto ifirst = BinarySearchForGequal(
-		data->m_offsets.GetCpuPointer(),
-		data->size(),
-		offset_samples);
-
-	//Go left by one sample
-	//The last sample BEFORE the left side of our view might extend into the visible space
-	if(ifirst > 0)
-		ifirst --;
-
 	float ybot = channel->GetYButtonPos() + start.y;
 	float ytop = ybot - m_channelButtonHeight;
 	float ymid = ybot - m_channelButtonHeight/2;
 
+	//Get the skinny symbols pre-merged for the current zoom level
+	int64_t tleft = m_group->GetXAxisOffset();
+	int64_t tright = tleft + m_group->PixelsToXAxisUnits(size.x);
+	auto spans = channel->GetProtocolRenderCache().GetSpans(data, 1.0 / m_group->GetPixelsPerXUnit(), tleft, tright);
+
 	//Draw the actual stuff
-	size_t len = data->size();
 	size_t xend = start.x + size.x;
-	for(size_t i=ifirst; i<len; i++)
-	{
-		int64_t tstart = (data->m_offsets[i] * data->m_timescale) + data->m_triggerPhase;
-		int64_t end = tstart + (data->m_durations[i] * data->m_timescale);
 
-		double xs = m_group->XAxisUnitsToXPosition(tstart);
-		double xe = m_group->XAxisUnitsToXPosition(end);
-
-		if(xe < start.x)
-			continue;
-		if(xs > xend)
-			break;
+	//Nothing on screen needs merging, draw the symbols as is
+	if(!spans)
+	{
+		data->CacheColors();
+		data->PrepareForCpuAccess();
 
-		double cellwidth = xe - xs;
-		auto color = data->GetColorCached(i);
-		if(cellwidth < 2)
+		size_t len = data->size();
+		for(size_t i=ProtocolRenderCache::FindSymbol(data, tleft); i<len; i++)
 		{
-			//This sample is really skinny. There's no text to render so don't waste time with that.
-
-			//Average the color of all samples touching this pixel
-			size_t nmerged = 1;
-			float sum_red = (color >> IM_COL32_R_SHIFT) & 0xff;
-			float sum_green = (color >> IM_COL32_G_SHIFT) & 0xff;
-			float sum_blue = (color >> IM_COL32_B_SHIFT) & 0xff;
-			for(size_t j=i+1; j<len; j++)
-			{
-				int64_t cellstart = (data->m_offsets[j] * data->m_timescale) + data->m_triggerPhase;
-				double cellxs = m_group->XAxisUnitsToXPosition(cellstart);
+			int64_t tstart = (data->m_offsets[i] * data->m_timescale) + data->m_triggerPhase;
+			int64_t tend = tstart + (data->m_durations[i] * data->m_timescale);
 
-				if(cellxs > xs+2)
-					break;
+			double xs = m_group->XAxisUnitsToXPosition(tstart);
+			double xe = m_group->XAxisUnitsToXPosition(tend);
 
-				auto c = data->GetColorCached(j);
+			if(xe < start.x)
+				continue;
+			if(xs > xend)
+				break;
+
+			RenderComplexSignal(
+				list,
+				start.x, xend,
+				xs, xe, 5,
+				ybot, ymid, ytop,
+				(xe - xs >= 2) ? data->GetText(i) : "",
+				data->GetColorCached(i));
+		}
+		return;
+	}
 
-				sum_red += (c >> IM_COL32_R_SHIFT) & 0xff;
-				sum_green += (c >> IM_COL32_G_SHIFT) & 0xff;
-				sum_blue += (c >> IM_COL32_B_SHIFT) & 0xff;
-				nmerged ++;
+	//Find the first span visible on screen
+	auto it = lower_bound(
+		spans->begin(),
+		spans->end(),
+		tleft,
+		[](const ProtocolRenderSpan& span, int64_t t) { return span.m_start < t; });
 
-				//Skip these samples in the outer loop
-				i = j-1;
-			}
+	//Go left by one span
+	//The last span BEFORE the left side of our view might extend into the visible space
+	if(it != spans->begin())
+		it --;
 
-			//Render a single box for them all
-			sum_red /= nmerged;
-			sum_green /= nmerged;
-			sum_blue /= nmerged;
-			color =
-				((static_cast<int>(sum_red) & 0xff) << IM_COL32_R_SHIFT) |
-				((static_cast<int>(sum_green) & 0xff) << IM_COL32_G_SHIFT) |
-				((static_cast<int>(sum_blue) & 0xff) << IM_COL32_B_SHIFT) |
-				(0xff << IM_COL32_A_SHIFT);
+	for(; it != spans->end(); it ++)
+	{
+		double xs = m_group->XAxisUnitsToXPosition(it->m_start);
+		double xe = m_group->XAxisUnitsToXPosition(it->m_end);
 
+		if(xe < start.x)
+			continue;
+		if(xs > xend)
+			break;
 
+		//Spans are merged for the widest scale in the zoom level, so some "wide" ones may still be too skinny
+		//for text at the current scale. Don't waste time fetching text in that case.
+		double cellwidth = xe - xs;
+		if(it->m_hasText && (cellwidth >= 2) )
+		{
 			RenderComplexSignal(
 				list,
 				start.x, xend,
 				xs, xe, 5,
 				ybot, ymid, ytop,
-				"",
-				color);
+				data->GetText(it->m_index),
+				it->m_color);
 		}
 		else
 		{
@@ -1906,8 +1952,8 @@ void WaveformArea::RenderProtocolWaveform(std::shared_ptr<DisplayedChannel> chan
 				start.x, xend,
 				xs, xe, 5,
 				ybot, ymid, ytop,
-				data->GetText(i),
-				color);
+				"",
+				it->m_color);
 		}
 	}
 }
@@ -1986,8 +2032,15 @@ void WaveformArea::RenderUniformDigitalBusWaveform(
 			break;
 	}
 
-	//Draw the actual stuff
+	//Use the run-length index to skip over runs of identical samples, if the waveform has few enough runs to have one
 	size_t len = data->size();
+	auto& runs = channel->GetDigitalBusRunIndex();
+	bool useRuns = runs.Update(data);
+	size_t run = 0;
+	if(useRuns && (static_cast<size_t>(ifirst) < len))
+		run = runs.FindRun(ifirst);
+
+	//Draw the actual stuff
 	size_t xend = start.x + size.x;
 	string field;
 	for(size_t i=ifirst; i<len; i++)
@@ -1998,10 +2051,18 @@ void WaveformArea::RenderUniformDigitalBusWaveform(
 		//Merge consecutive samples with the same value
 		auto value = data->m_samples[i];
 		size_t imerge = i;
-		for(; (imerge + 1) < len; imerge ++)
+		if(useRuns)
 		{
-			if(value != data->m_samples[imerge + 1])
-				break;
+			imerge = runs.GetRunLast(run);
+			run ++;
+		}
+		else
+		{
+			for(; (imerge + 1) < len; imerge ++)
+			{
+				if(value != data->m_samples[imerge + 1])
+					break;
+			}
 		}
 		i = imerge;
 
@@ -2105,7 +2166,7 @@ void WaveformArea::RenderComplexSignal(
 	bool drew_text = false;
 	if(available_width > 15)
 	{
-		auto font = m_parent->GetFontPref("Appearance.Decodes.protocol_font");
+		auto font = m_parent->GetFontPref(m_protocolFontPref);
 		ImGui::PushFont(font.first, font.second);
 		auto textsize = ImGui::CalcTextSize(str.c_str());
 
@@ -2356,6 +2417,36 @@ void WaveformArea::RenderWaveformTextures(
 	}
 }
 
+/**
+	@brief Decide whether to rasterize analog and digital waveforms on the CPU instead of with waveform-compute.glsl
+ */
+bool WaveformArea::UseCpuRasterizer()
+{
+	//Called for every channel every frame, so don't look the preference up by path each time.
+	//Rasterization may run on several threads at once, so each gets its own handle. The rasterizer threads are
+	//persistent, so each handle is only resolved once.
+	static thread_local PreferenceHandle<int64_t> rasterizer(
+		m_session.GetPreferences(), "Miscellaneous.Rendering.waveform_rasterizer");
+
+	switch(rasterizer.Get())
+	{
+		case RASTERIZER_GPU:
+			return false;
+
+		case RASTERIZER_CPU:
+			return true;
+
+		//Use the CPU if the "GPU" is a software renderer anyway
+		case RASTERIZER_AUTO:
+		default:
+			{
+				static bool softwareDevice =
+					(g_vkComputePhysicalDevice->getProperties().deviceType == vk::PhysicalDeviceType::eCpu);
+				return softwareDevice;
+			}
+	}
+}
+
 void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 	shared_ptr<DisplayedChannel> channel,
 	vk::raii::CommandBuffer& cmdbuf,
@@ -2368,8 +2459,7 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 		return;
 	}
 
-	auto stream = channel->GetStream();
-	auto data = stream.GetData();
+	auto data = channel->GetStream().GetData();
 
 	//Prepare the memory so we can rasterize it
 	//If no data (or an empty buffer with no samples), set to 0x0 pixels and return
@@ -2384,14 +2474,54 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 		h = m_channelButtonHeight;
 	channel->PrepareToRasterize(w, h);
 
+	WaveformRasterTarget target(
+		channel->GetRasterizedWaveform(),
+		channel->GetIndexBuffer(),
+		channel->GetIndexCache(),
+		channel->GetRebasedOffsets());
+	target.m_width = w;
+	target.m_height = h;
+	target.m_xAxisOffset = m_group->GetXAxisOffset();
+	target.m_pixelsPerXUnit = m_group->GetPixelsPerXUnit();
+	target.m_pixelsPerYAxisUnit = m_pixelsPerYAxisUnit;
+	target.m_digitalHeight = m_channelButtonHeight;
+	target.m_alpha = m_parent->GetTraceAlpha();
+	if(channel->IsPersistenceEnabled() && !clearPersistence)
+		target.m_persistScale = m_parent->GetPersistDecay();
+	else
+		target.m_persistScale = 0;
+
+	RasterizeAnalogOrDigitalWaveform(channel, data, target, cmdbuf);
+	channel->OnRasterized();
+}
+
+/**
+	@brief Rasterizes an analog or digital waveform into an arbitrary target
+
+	@param channel	Channel being drawn (for display settings and pipelines)
+	@param data		Waveform to draw. Normally the channel's current data, but need not be
+	@param target	Output buffers and scales. The output and index buffers must already be sized for the target
+	@param cmdbuf	Command buffer to record GPU rendering commands into
+ */
+void WaveformArea::RasterizeAnalogOrDigitalWaveform(
+	shared_ptr<DisplayedChannel> channel,
+	WaveformBase* data,
+	const WaveformRasterTarget& target,
+	vk::raii::CommandBuffer& cmdbuf)
+{
+	auto stream = channel->GetStream();
+	size_t w = target.m_width;
+	size_t h = target.m_height;
+
 	shared_ptr<ComputePipeline> comp;
+	bool cpuRaster = UseCpuRasterizer();
 
 	//Calculate a bunch of constants
-	int64_t offset = m_group->GetXAxisOffset();
+	int64_t offset = target.m_xAxisOffset;
 	int64_t innerxoff = offset / data->m_timescale;
 	int64_t fractional_offset = offset % data->m_timescale;
 	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
-	double pixelsPerX = m_group->GetPixelsPerXUnit();
+	double pixelsPerX = target.m_pixelsPerXUnit;
 	double xscale = data->m_timescale * pixelsPerX;
 
 	//Figure out which shader to use
@@ -2401,96 +2531,138 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 	auto sadata = dynamic_cast<SparseAnalogWaveform*>(data);
 	auto uddata = dynamic_cast<UniformDigitalWaveform*>(data);
 	auto sddata = dynamic_cast<SparseDigitalWaveform*>(data);
-	if(uadata)
+	if(cpuRaster)
 	{
-		if(channel->ShouldFillUnder())
-			comp = channel->GetHistogramPipeline();
-		else
-			comp = channel->GetUniformAnalogPipeline();
+		if(!uadata && !uddata && !sadata && !sddata)
+		{
+			LogWarning("no rasterizer found\n");
+			return;
+		}
 	}
-	else if(uddata)
-		comp = channel->GetUniformDigitalPipeline();
-	else if(sadata)
-		comp = channel->GetSparseAnalogPipeline();
-	else if(sddata)
-		comp = channel->GetSparseDigitalPipeline();
-	if(!comp)
+	else
 	{
-		LogWarning("no pipeline found\n");
-		return;
+		if(uadata)
+		{
+			if(channel->ShouldFillUnder())
+				comp = channel->GetHistogramPipeline();
+			else
+				comp = channel->GetUniformAnalogPipeline();
+		}
+		else if(uddata)
+			comp = channel->GetUniformDigitalPipeline();
+		else if(sadata)
+			comp = channel->GetSparseAnalogPipeline();
+		else if(sddata)
+			comp = channel->GetSparseDigitalPipeline();
+		if(!comp)
+		{
+			LogWarning("no pipeline found\n");
+			return;
+		}
 	}
 
 	//Bind input buffers
+	bool useRebased = sdata && !g_hasShaderInt64 && !cpuRaster;
 	if(sdata)
 	{
-		//Calculate indexes for X axis
-		auto& ibuf = channel->GetIndexBuffer();
-
-		//If we have native int64, do this on the GPU
-		if(g_hasShaderInt64)
+		//Without native int64, the GPU works on X positions rebased close to the visible area
+		auto& rebased = target.m_rebasedOffsets;
+		if(useRebased)
+			rebased.Update(sdata, offset_samples, ceil(w / xscale));
+		else if(!rebased.GetOffsets().empty())
+			rebased.Clear();
+
+		//Calculate indexes for X axis, unless nothing they depend on has changed since last time
+		auto& ibuf = target.m_indexBuffer;
+		auto& icache = target.m_indexCache;
+		if(!icache.IsCurrent(sdata, w, xscale, offset_samples))
 		{
-			IndexSearchConstants cfg;
-			cfg.len = data->size();
-			cfg.w = w;
-			cfg.xscale = xscale;
-			cfg.offset_samples = offset_samples;
-
-			const uint32_t threadsPerBlock = 64;
-			const uint32_t numBlocks = GetComputeBlockCount(w, threadsPerBlock);
-
-			auto ipipe = channel->GetIndexSearchPipeline();
-			ipipe->BindBufferNonblocking(0, sdata->m_offsets, cmdbuf);
-			ipipe->BindBufferNonblocking(1, ibuf, cmdbuf, true);
-			ipipe->Dispatch(cmdbuf, cfg, numBlocks);
-			ipipe->AddComputeMemoryBarrier(cmdbuf);
-			ibuf.MarkModifiedFromGpu();
-		}
+			//Search the rebased X positions on the GPU
+			if(useRebased)
+			{
+				IndexSearchRebasedConstants cfg;
+				cfg.len = data->size();
+				cfg.w = w;
+				cfg.xscale = xscale;
+				cfg.offset_samples = offset_samples - rebased.GetBase();
+
+				const uint32_t threadsPerBlock = 64;
+				const uint32_t numBlocks = GetComputeBlockCount(w, threadsPerBlock);
+
+				auto ipipe = channel->GetIndexSearchPipeline();
+				ipipe->BindBufferNonblocking(0, rebased.GetOffsets(), cmdbuf);
+				ipipe->BindBufferNonblocking(1, ibuf, cmdbuf, true);
+				ipipe->Dispatch(cmdbuf, cfg, numBlocks);
+				ipipe->AddComputeMemoryBarrier(cmdbuf);
+				ibuf.MarkModifiedFromGpu();
+				icache.OnGpuSearch(sdata, w, xscale, offset_samples);
+			}
 
-		//otherwise CPU fallback
-		else
-		{
-			ibuf.PrepareForCpuAccess();
-			sdata->m_offsets.PrepareForCpuAccess();
-			for(size_t i=0; i<w; i++)
+			//If we have native int64, do this on the GPU (unless we're rasterizing on the CPU anyway)
+			else if(g_hasShaderInt64 && !cpuRaster)
 			{
-				int64_t target = floor(i / xscale) + offset_samples;
-				ibuf[i] = BinarySearchForGequal(
-					sdata->m_offsets.GetCpuPointer(),
-					data->size(),
-					target);
+				IndexSearchConstants cfg;
+				cfg.len = data->size();
+				cfg.w = w;
+				cfg.xscale = xscale;
+				cfg.offset_samples = offset_samples;
+
+				const uint32_t threadsPerBlock = 64;
+				const uint32_t numBlocks = GetComputeBlockCount(w, threadsPerBlock);
+
+				auto ipipe = channel->GetIndexSearchPipeline();
+				ipipe->BindBufferNonblocking(0, sdata->m_offsets, cmdbuf);
+				ipipe->BindBufferNonblocking(1, ibuf, cmdbuf, true);
+				ipipe->Dispatch(cmdbuf, cfg, numBlocks);
+				ipipe->AddComputeMemoryBarrier(cmdbuf);
+				ibuf.MarkModifiedFromGpu();
+				icache.OnGpuSearch(sdata, w, xscale, offset_samples);
 			}
-			ibuf.MarkModifiedFromCpu();
+
+			//otherwise CPU fallback, reusing the previous results to narrow the search when panning or zooming
+			else
+				icache.SearchOnCpu(sdata, ibuf, w, xscale, offset_samples);
 		}
 
 		//Bind the buffers
-		if(sadata)
-			comp->BindBufferNonblocking(1, sadata->m_samples, cmdbuf);
-		if(sddata)
-			comp->BindBufferNonblocking(1, sddata->m_samples, cmdbuf);
-
-		//Map offsets and, if requested, durations
-		comp->BindBufferNonblocking(2, sdata->m_offsets, cmdbuf);
-		comp->BindBufferNonblocking(3, ibuf, cmdbuf);
-		if(channel->ShouldMapDurations())
-			comp->BindBufferNonblocking(4, sdata->m_durations, cmdbuf);
+		if(!cpuRaster)
+		{
+			if(sadata)
+				comp->BindBufferNonblocking(1, sadata->m_samples, cmdbuf);
+			if(sddata)
+				comp->BindBufferNonblocking(1, sddata->m_samples, cmdbuf);
+
+			//Map offsets and, if requested, durations
+			if(useRebased)
+				comp->BindBufferNonblocking(2, rebased.GetOffsets(), cmdbuf);
+			else
+				comp->BindBufferNonblocking(2, sdata->m_offsets, cmdbuf);
+			comp->BindBufferNonblocking(3, ibuf, cmdbuf);
+			if(channel->ShouldMapDurations())
+				comp->BindBufferNonblocking(4, sdata->m_durations, cmdbuf);
+		}
 	}
 
-	if(uadata)
-		comp->BindBufferNonblocking(1, uadata->m_samples, cmdbuf);
-	if(uddata)
-		comp->BindBufferNonblocking(1, uddata->m_samples, cmdbuf);
+	if(!cpuRaster)
+	{
+		if(uadata)
+			comp->BindBufferNonblocking(1, uadata->m_samples, cmdbuf);
+		if(uddata)
+			comp->BindBufferNonblocking(1, uddata->m_samples, cmdbuf);
+	}
 
 	//Bind output texture and bail if there's nothing there
-	auto& imgOut = channel->GetRasterizedWaveform();
+	auto& imgOut = target.m_output;
 	if(imgOut.empty())
 		return;
-	comp->BindBufferNonblocking(0, imgOut, cmdbuf);
+	if(!cpuRaster)
+		comp->BindBufferNonblocking(0, imgOut, cmdbuf);
 
 	//Scale alpha by zoom.
 	//As we zoom out more, reduce alpha to get proper intensity grading
 	//TODO: make this constant, then apply a second alpha pass in tone mapping?
 	//This will eliminate the need for a (potentially heavy) re-render when adjusting the slider.
-	float alpha = m_parent->GetTraceAlpha();
+	float alpha = target.m_alpha;
 	auto end = data->size() - 1;
 	int64_t firstOff;
 	int64_t lastOff;
@@ -2521,7 +2693,10 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 
 	//Fill shader configuration
 	ConfigPushConstants config;
-	config.innerXoff = -innerxoff;
+	if(useRebased)
+		config.innerXoff = target.m_rebasedOffsets.GetBase() - innerxoff;
+	else
+		config.innerXoff = -innerxoff;
 	config.windowHeight = h;
 	config.windowWidth = w;
 	config.memDepth = data->size();
@@ -2531,20 +2706,68 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 	config.xscale = xscale;
 	if(sadata || uadata)	//analog
 	{
-		config.yscale = m_pixelsPerYAxisUnit;
+		config.yscale = target.m_pixelsPerYAxisUnit;
 		config.yoff = stream.GetOffset();
 		config.ybase = h * 0.5f;
 	}
 	else					//digital
 	{
 		config.yoff = 0;
-		config.yscale = m_channelButtonHeight - 1;
+		config.yscale = target.m_digitalHeight - 1;
 		config.ybase = 0;
 	}
-	if(channel->IsPersistenceEnabled() && !clearPersistence)
-		config.persistScale = m_parent->GetPersistDecay();
-	else
-		config.persistScale = 0;
+	config.persistScale = target.m_persistScale;
+
+	//Rasterize in software if requested. The tone mapping pass will push the result to the GPU.
+	if(cpuRaster)
+	{
+		CpuRasterizerInputs in;
+		if(uadata)
+		{
+			uadata->m_samples.PrepareForCpuAccess();
+			in.m_analogSamples = uadata->m_samples.GetCpuPointer();
+			if(channel->ShouldFillUnder())
+				in.m_path = CpuRasterizerInputs::PATH_HISTOGRAM;
+			else
+				in.m_zeroHold = channel->ZeroHoldFlagSet();
+		}
+		else if(sadata)
+		{
+			sadata->m_samples.PrepareForCpuAccess();
+			in.m_analogSamples = sadata->m_samples.GetCpuPointer();
+			in.m_zeroHold = channel->ZeroHoldFlagSet();
+			if(channel->ShouldMapDurations())
+			{
+				sadata->m_durations.PrepareForCpuAccess();
+				in.m_durations = sadata->m_durations.GetCpuPointer();
+			}
+		}
+		else if(uddata)
+		{
+			uddata->m_samples.PrepareForCpuAccess();
+			in.m_path = CpuRasterizerInputs::PATH_DIGITAL;
+			in.m_digitalSamples = uddata->m_samples.GetCpuPointer();
+		}
+		else if(sddata)
+		{
+			sddata->m_samples.PrepareForCpuAccess();
+			in.m_path = CpuRasterizerInputs::PATH_DIGITAL;
+			in.m_digitalSamples = sddata->m_samples.GetCpuPointer();
+		}
+		if(sdata)
+		{
+			//Index buffer is normally already on the CPU, but may be left over from a GPU search
+			sdata->m_offsets.PrepareForCpuAccess();
+			in.m_offsets = sdata->m_offsets.GetCpuPointer();
+			target.m_indexBuffer.PrepareForCpuAccess();
+			in.m_indexes = target.m_indexBuffer.GetCpuPointer();
+		}
+
+		imgOut.PrepareForCpuAccess();
+		CpuWaveformRasterizer::Rasterize(config, in, imgOut.GetCpuPointer());
+		imgOut.MarkModifiedFromCpu();
+		return;
+	}
 
 	//Dispatch the shader
 	comp->Dispatch(cmdbuf, config, w, 1, 1);
@@ -2567,17 +2790,23 @@ void WaveformArea::ToneMapAnalogOrDigitalWaveform(shared_ptr<DisplayedChannel> c
 	if( (width == 0) || (height == 0) )
 		return;
 
-	//Run the actual compute shader
-	auto pipe = channel->GetToneMapPipeline();
-	pipe->BindBufferNonblocking(0, channel->GetRasterizedWaveform(), cmdbuf);
-	pipe->BindStorageImage(
-		1,
-		**m_parent->GetTextureManager()->GetSampler(),
-		tex->GetView(),
-		vk::ImageLayout::eGeneral);
+	//Skip if nothing has been rasterized since last time, and the color and size are unchanged
+	auto& rasterized = channel->GetRasterizedWaveform();
 	auto color = ImGui::ColorConvertU32ToFloat4(ColorFromString(channel->GetStream().m_channel->m_displaycolor));
 	WaveformToneMapArgs args(color, width, height);
-	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(width, 64), height);
+	auto& cache = channel->GetToneMapCache();
+	if(cache.IsCurrent(&rasterized, channel->GetRasterizedGeneration(), TimePoint(0, 0), "", args))
+		return;
+	cache.SetKey(&rasterized, channel->GetRasterizedGeneration(), TimePoint(0, 0), "", args);
+
+	ToneMapAnalogOrDigitalWaveform(
+		channel,
+		rasterized,
+		**m_parent->GetTextureManager()->GetSampler(),
+		tex->GetView(),
+		width,
+		height,
+		cmdbuf);
 
 	//Add a barrier before we read from the fragment shader
 	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
@@ -2599,6 +2828,36 @@ void WaveformArea::ToneMapAnalogOrDigitalWaveform(shared_ptr<DisplayedChannel> c
 			barrier);
 }
 
+/**
+	@brief Runs the tone mapping shader on an arbitrary rasterized waveform
+
+	No barrier is added afterwards, since what comes next depends on what the caller does with the image.
+
+	@param channel		Channel being drawn (for color and pipeline)
+	@param rasterized	The fp32 output of RasterizeAnalogOrDigitalWaveform()
+	@param sampler		Sampler to bind along with the output image
+	@param view			Storage image to write RGBA output to, in the general layout
+	@param width		Width of the image
+	@param height		Height of the image
+	@param cmdbuf		Command buffer to record into
+ */
+void WaveformArea::ToneMapAnalogOrDigitalWaveform(
+	shared_ptr<DisplayedChannel> channel,
+	AcceleratorBuffer<float>& rasterized,
+	vk::Sampler sampler,
+	vk::ImageView view,
+	size_t width,
+	size_t height,
+	vk::raii::CommandBuffer& cmdbuf)
+{
+	auto pipe = channel->GetToneMapPipeline();
+	pipe->BindBufferNonblocking(0, rasterized, cmdbuf);
+	pipe->BindStorageImage(1, sampler, view, vk::ImageLayout::eGeneral);
+	auto color = ImGui::ColorConvertU32ToFloat4(ColorFromString(channel->GetStream().m_channel->m_displaycolor));
+	WaveformToneMapArgs args(color, width, height);
+	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(width, 64), height);
+}
+
 /**
 	@brief Tone maps a density function waveform by converting the internal fp32 buffer to RGBA and cropping/scaling
  */
@@ -2618,6 +2877,21 @@ void WaveformArea::ToneMapWaterfallWaveform(std::shared_ptr<DisplayedChannel> ch
 	if( (width == 0) || (height == 0) )
 		return;
 
+	int64_t offset = m_group->GetXAxisOffset();
+	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
+
+	double pixelsPerX = m_group->GetPixelsPerXUnit();
+	double xscale = data->m_timescale * pixelsPerX;
+
+	WaterfallToneMapArgs args(width, height, m_width, m_height, offset_samples, xscale );
+
+	//Skip if the waveform, color ramp, size, and view are the same as last time
+	auto& cache = channel->GetToneMapCache();
+	TimePoint stamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	if(cache.IsCurrent(data, data->m_revision, stamp, channel->m_colorRamp, args))
+		return;
+	cache.SetKey(data, data->m_revision, stamp, channel->m_colorRamp, args);
+
 	//Run the actual compute shader
 	auto pipe = channel->GetToneMapPipeline();
 	const auto& texmgr = m_parent->GetTextureManager();
@@ -2633,13 +2907,6 @@ void WaveformArea::ToneMapWaterfallWaveform(std::shared_ptr<DisplayedChannel> ch
 		texmgr->GetView(channel->m_colorRamp),
 		vk::ImageLayout::eShaderReadOnlyOptimal);
 
-	int64_t offset = m_group->GetXAxisOffset();
-	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
-
-	double pixelsPerX = m_group->GetPixelsPerXUnit();
-	double xscale = data->m_timescale * pixelsPerX;
-
-	WaterfallToneMapArgs args(width, height, m_width, m_height, offset_samples, xscale );
 	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(m_width, 64), m_height);
 
 	//Add a barrier before we read from the fragment shader
@@ -2681,21 +2948,6 @@ void WaveformArea::ToneMapSpectrogramWaveform(std::shared_ptr<DisplayedChannel>
 	if( (width == 0) || (height == 0) )
 		return;
 
-	//Run the actual compute shader
-	auto pipe = channel->GetToneMapPipeline();
-	const auto& texmgr = m_parent->GetTextureManager();
-	pipe->BindBufferNonblocking(0, data->GetOutData(), cmdbuf);
-	pipe->BindStorageImage(
-		1,
-		**texmgr->GetSampler(),
-		tex->GetView(),
-		vk::ImageLayout::eGeneral);
-	pipe->BindSampledImage(
-		2,
-		**texmgr->GetSampler(),
-		texmgr->GetView(channel->m_colorRamp),
-		vk::ImageLayout::eShaderReadOnlyOptimal);
-
 	int64_t offset = m_group->GetXAxisOffset();
 	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
 
@@ -2713,6 +2965,29 @@ void WaveformArea::ToneMapSpectrogramWaveform(std::shared_ptr<DisplayedChannel>
 	float yscale = 1.0 / (m_pixelsPerYAxisUnit * data->GetBinSize());
 
 	SpectrogramToneMapArgs args(width, height, m_width, m_height, offset_samples, xscale, yoff, yscale);
+
+	//Skip if the waveform, color ramp, size, and view are the same as last time
+	auto& cache = channel->GetToneMapCache();
+	TimePoint stamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	if(cache.IsCurrent(data, data->m_revision, stamp, channel->m_colorRamp, args))
+		return;
+	cache.SetKey(data, data->m_revision, stamp, channel->m_colorRamp, args);
+
+	//Run the actual compute shader
+	auto pipe = channel->GetToneMapPipeline();
+	const auto& texmgr = m_parent->GetTextureManager();
+	pipe->BindBufferNonblocking(0, data->GetOutData(), cmdbuf);
+	pipe->BindStorageImage(
+		1,
+		**texmgr->GetSampler(),
+		tex->GetView(),
+		vk::ImageLayout::eGeneral);
+	pipe->BindSampledImage(
+		2,
+		**texmgr->GetSampler(),
+		texmgr->GetView(channel->m_colorRamp),
+		vk::ImageLayout::eShaderReadOnlyOptimal);
+
 	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(m_width, 64), m_height);
 
 	//Add a barrier before we read from the fragment shader
@@ -2754,6 +3029,14 @@ void WaveformArea::ToneMapEyeWaveform(std::shared_ptr<DisplayedChannel> channel,
 	if( (width == 0) || (height == 0) )
 		return;
 
+	//Skip if the waveform, color ramp, and size are the same as last time
+	EyeToneMapArgs args(width, height);
+	auto& cache = channel->GetToneMapCache();
+	TimePoint stamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	if(cache.IsCurrent(data, data->m_revision, stamp, channel->m_colorRamp, args))
+		return;
+	cache.SetKey(data, data->m_revision, stamp, channel->m_colorRamp, args);
+
 	//Run the actual compute shader
 	auto pipe = channel->GetToneMapPipeline();
 	const auto& texmgr = m_parent->GetTextureManager();
@@ -2769,7 +3052,6 @@ void WaveformArea::ToneMapEyeWaveform(std::shared_ptr<DisplayedChannel> channel,
 		texmgr->GetView(channel->m_colorRamp),
 		vk::ImageLayout::eShaderReadOnlyOptimal);
 
-	EyeToneMapArgs args(width, height);
 	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(width, 64), height);
 
 	//Add a barrier before we read from the fragment shader
@@ -2811,6 +3093,14 @@ void WaveformArea::ToneMapConstellationWaveform(std::shared_ptr<DisplayedChannel
 	if( (width == 0) || (height == 0) )
 		return;
 
+	//Skip if the waveform, color ramp, and size are the same as last time
+	ConstellationToneMapArgs args(width, height);
+	auto& cache = channel->GetToneMapCache();
+	TimePoint stamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	if(cache.IsCurrent(data, data->m_revision, stamp, channel->m_colorRamp, args))
+		return;
+	cache.SetKey(data, data->m_revision, stamp, channel->m_colorRamp, args);
+
 	//Run the actual compute shader
 	auto pipe = channel->GetToneMapPipeline();
 	const auto& texmgr = m_parent->GetTextureManager();
@@ -2826,7 +3116,6 @@ void WaveformArea::ToneMapConstellationWaveform(std::shared_ptr<DisplayedChannel
 		texmgr->GetView(channel->m_colorRamp),
 		vk::ImageLayout::eShaderReadOnlyOptimal);
 
-	ConstellationToneMapArgs args(width, height);
 	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(width, 64), height);
 
 	//Add a barrier before we read from the fragment shader
@@ -2856,9 +3145,8 @@ void WaveformArea::ToneMapConstellationWaveform(std::shared_ptr<DisplayedChannel
  */
 void WaveformArea::RenderBackgroundGradient(ImVec2 start, ImVec2 size)
 {
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto color_bottom = prefs.GetColor("Appearance.Graphs.bottom_color");
-	auto color_top = prefs.GetColor("Appearance.Graphs.top_color");
+	auto color_bottom = m_bottomColorPref.Get();
+	auto color_top = m_topColorPref.Get();
 
 	ImDrawList* draw_list = ImGui::GetWindowDrawList();
 	draw_list->AddRectFilledMultiColor(
@@ -2874,8 +3162,8 @@ void WaveformArea::RenderBackgroundGradient(ImVec2 start, ImVec2 size)
 	if(m_group->GetXAxisUnit() == Unit::UNIT_PM)
 	{
 		//Visible spectrum texture covers 380 - 750 nm
-		draw_list->AddImage(
-			m_parent->GetTextureManager()->GetTexture("visible-spectrum-380nm-750nm"),
+		m_parent->GetImage("visible-spectrum-380nm-750nm").Draw(
+			draw_list,
 			ImVec2(m_group->XAxisUnitsToXPosition(380000), start.y),
 			ImVec2(m_group->XAxisUnitsToXPosition(750000), start.y + size.y));
 	}
@@ -2966,11 +3254,10 @@ void WaveformArea::RenderGrid(ImVec2 start, ImVec2 size, map<float, float>& grid
 	}
 
 	//Style settings
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto axisColor = prefs.GetColor("Appearance.Graphs.grid_centerline_color");
-	auto gridColor = prefs.GetColor("Appearance.Graphs.grid_color");
-	auto axisWidth = prefs.GetReal("Appearance.Graphs.grid_centerline_width");
-	auto gridWidth = prefs.GetReal("Appearance.Graphs.grid_width");
+	auto axisColor = m_gridCenterlineColorPref.Get();
+	auto gridColor = m_gridColorPref.Get();
+	auto axisWidth = m_gridCenterlineWidthPref.Get();
+	auto gridWidth = m_gridWidthPref.Get();
 
 	auto list = ImGui::GetWindowDrawList();
 	float left = start.x;
@@ -3011,10 +3298,9 @@ void WaveformArea::RenderYAxis(ImVec2 size, map<float, float>& gridmap, float vb
 	float ybot = origin.y + size.y;
 
 	//Style settings
-	auto font = m_parent->GetFontPref("Appearance.Graphs.y_axis_font");
+	auto font = m_parent->GetFontPref(m_yAxisFontPref);
 	ImGui::PushFont(font.first, font.second);
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto textColor = prefs.GetColor("Appearance.Graphs.y_axis_text_color");
+	auto textColor = m_yAxisTextColorPref.Get();
 
 	//Reserve an empty area we're going to draw into
 	ImGui::Dummy(size);
@@ -3154,7 +3440,7 @@ void WaveformArea::RenderCursors(ImVec2 start, ImVec2 size)
 	auto mouse = ImGui::GetMousePos();
 	if(m_group->IsDraggingTrigger())
 	{
-		auto color = m_parent->GetSession().GetPreferences().GetColor("Appearance.Timeline.axis_color");
+		auto color = m_timelineAxisColorPref.Get();
 		draw_list->AddLine(
 			ImVec2(mouse.x, start.y),
 			ImVec2(mouse.x, start.y + size.y),
@@ -3354,8 +3640,8 @@ void WaveformArea::CheckForScaleMismatch(ImVec2 start, ImVec2 size)
 
 	//Warning icon
 	auto list = ImGui::GetWindowDrawList();
-	list->AddImage(
-		m_parent->GetTextureManager()->GetTexture("warning"),
+	m_parent->GetImage("warning").Draw(
+		list,
 		ImVec2(center.x - 0.5, center.y - warningSize/2 - 0.5),
 		ImVec2(center.x + warningSize + 0.5, center.y + warningSize/2 + 0.5));
 
@@ -4135,8 +4421,8 @@ void WaveformArea::DrawDropScalarMessage(ImDrawList* list, ImVec2 center)
 	float iconSize = ImGui::GetFontSize() * 3;
 
 	//Warning icon
-	list->AddImage(
-		m_parent->GetTextureManager()->GetTexture("info"),
+	m_parent->GetImage("info").Draw(
+		list,
 		ImVec2(center.x - 0.5, center.y - iconSize/2 - 0.5),
 		ImVec2(center.x + iconSize + 0.5, center.y + iconSize/2 + 0.5));
 
@@ -4182,8 +4468,8 @@ void WaveformArea::DrawDropRangeMismatchMessage(
 		float warningSize = ImGui::GetFontSize() * 3;
 
 		//Warning icon
-		list->AddImage(
-			m_parent->GetTextureManager()->GetTexture("warning"),
+		m_parent->GetImage("warning").Draw(
+			list,
 			ImVec2(center.x - 0.5, center.y - warningSize/2 - 0.5),
 			ImVec2(center.x + warningSize + 0.5, center.y + warningSize/2 + 0.5));
 
@@ -4243,7 +4529,7 @@ void WaveformArea::ChannelButton(shared_ptr<DisplayedChannel> chan, size_t index
 	if(ochan)
 	{
 		auto scope = ochan->GetScope();
-		if( (scope != nullptr) && m_parent->GetSession().IsMultiScope())
+		if( (scope != nullptr) && m_session.IsMultiScope())
 			fqname = scope->m_nickname + ":" + fqname;
 	}
 
@@ -4406,12 +4692,10 @@ void WaveformArea::ChannelButton(shared_ptr<DisplayedChannel> chan, size_t index
 					auto displayName = m_parent->GetEyeGradientFriendlyName(internalName);
 
 					ImVec2 p = ImGui::GetCursorScreenPos();
-					list->AddImage(
-						m_parent->GetTexture(internalName),
+					m_parent->GetImage(internalName).Draw(
+						list,
 						p,
-						ImVec2(p.x + gradsize.x, p.y + gradsize.y),
-						ImVec2(0, 0),
-						ImVec2(1, 1));
+						ImVec2(p.x + gradsize.x, p.y + gradsize.y));
 					ImGui::Dummy(gradsize);
 					ImGui::SameLine();
 
@@ -4483,7 +4767,7 @@ void WaveformArea::FilterMenu(shared_ptr<DisplayedChannel> chan)
  */
 void WaveformArea::FilterSubmenu(shared_ptr<DisplayedChannel> chan, const string& name, Filter::Category cat)
 {
-	auto& refs = m_parent->GetSession().GetReferenceFilters();
+	auto& refs = m_session.GetReferenceFilters();
 	auto stream = chan->GetStream();
 
 	if(ImGui::BeginMenu(name.c_str()))
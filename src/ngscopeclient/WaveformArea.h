@@ -41,6 +41,13 @@ class MainWindow;
 
 #include "TextureManager.h"
 #include "Marker.h"
+#include "PreferenceHandle.h"
+#include "CpuWaveformRasterizer.h"
+#include "DigitalBusRunIndex.h"
+#include "ProtocolRenderCache.h"
+#include "RebasedOffsets.h"
+#include "SparseIndexCache.h"
+#include "ToneMapCache.h"
 
 class WaveformToneMapArgs
 {
@@ -129,31 +136,90 @@ public:
 	float m_yscale;
 };
 
-struct ConfigPushConstants
+class IndexSearchConstants
 {
-	int64_t innerXoff;
-	uint32_t windowHeight;
-	uint32_t windowWidth;
-	uint32_t memDepth;
-	uint32_t offset_samples;
-	float alpha;
-	float xoff;
+public:
+	int64_t offset_samples;
 	float xscale;
-	float ybase;
-	float yscale;
-	float yoff;
-	float persistScale;
+	uint32_t len;
+	uint32_t w;
 };
 
-class IndexSearchConstants
+/**
+	@brief Push constants for IndexSearchRebased.glsl
+ */
+class IndexSearchRebasedConstants
 {
 public:
-	int64_t offset_samples;
+	float offset_samples;
 	float xscale;
 	uint32_t len;
 	uint32_t w;
 };
 
+/**
+	@brief Where, and at what scale, to rasterize an analog or digital waveform
+
+	On screen this comes from the WaveformArea and the channel's own buffers. Offscreen rendering supplies its own
+	buffers instead, so the same channel can be drawn more than once in a single command buffer.
+ */
+class WaveformRasterTarget
+{
+public:
+	WaveformRasterTarget(
+		AcceleratorBuffer<float>& output,
+		AcceleratorBuffer<uint32_t>& indexBuffer,
+		SparseIndexCache& indexCache,
+		RebasedOffsets& rebasedOffsets)
+		: m_width(0)
+		, m_height(0)
+		, m_xAxisOffset(0)
+		, m_pixelsPerXUnit(1)
+		, m_pixelsPerYAxisUnit(1)
+		, m_digitalHeight(1)
+		, m_persistScale(0)
+		, m_alpha(0.75)
+		, m_output(output)
+		, m_indexBuffer(indexBuffer)
+		, m_indexCache(indexCache)
+		, m_rebasedOffsets(rebasedOffsets)
+	{}
+
+	///@brief Size of the output, in pixels
+	size_t m_width;
+	size_t m_height;
+
+	///@brief X axis position of the left edge of the output
+	int64_t m_xAxisOffset;
+
+	///@brief X axis scale
+	double m_pixelsPerXUnit;
+
+	///@brief Y axis scale for analog waveforms
+	float m_pixelsPerYAxisUnit;
+
+	///@brief Height of a digital waveform
+	float m_digitalHeight;
+
+	///@brief Persistence decay factor, or zero to overwrite the previous contents of the output
+	float m_persistScale;
+
+	///@brief Trace intensity, before scaling by zoom
+	float m_alpha;
+
+	///@brief Rasterized fp32 output
+	AcceleratorBuffer<float>& m_output;
+
+	///@brief X axis index buffer (sparse waveforms only)
+	AcceleratorBuffer<uint32_t>& m_indexBuffer;
+
+	///@brief What m_indexBuffer was last computed for
+	SparseIndexCache& m_indexCache;
+
+	///@brief Rebased X positions (sparse waveforms without shaderInt64 only)
+	RebasedOffsets& m_rebasedOffsets;
+};
+
 /**
 	@brief State for a single peak label
 
@@ -214,15 +280,36 @@ public:
 	std::shared_ptr<Texture> GetTexture()
 	{ return m_texture; }
 
-	void SetTexture(std::shared_ptr<Texture> tex)
-	{ m_texture = tex; }
+	/**
+		@brief Returns the texture coordinates of the bottom right corner of the image within m_texture
+
+		The texture is allocated in size classes, so only a sub-rectangle of it is actually drawn to.
+	 */
+	ImVec2 GetTextureUV()
+	{
+		if( (m_textureAllocX == 0) || (m_textureAllocY == 0) )
+			return ImVec2(1, 1);
+		return ImVec2(
+			static_cast<float>(m_textureX) / m_textureAllocX,
+			static_cast<float>(m_textureY) / m_textureAllocY);
+	}
 
 	void PrepareToRasterize(size_t x, size_t y);
 
 	bool UpdateSize(ImVec2 newSize, MainWindow* top);
 
 	AcceleratorBuffer<float>& GetRasterizedWaveform()
-	{ return m_rasterizedWaveform; }
+	{ return *m_rasterizedWaveform; }
+
+	/**
+		@brief Returns a counter that changes every time the rasterized waveform is written to
+	 */
+	uint64_t GetRasterizedGeneration()
+	{ return m_rasterizedGeneration; }
+
+	///@brief Called after the rasterized waveform has been written to
+	void OnRasterized()
+	{ m_rasterizedGeneration ++; }
 
 	/**
 		@brief Return the X axis size of the rasterized waveform
@@ -252,6 +339,7 @@ public:
 				suffix += ".int64";
 			m_uniformAnalogComputePipeline = std::make_shared<ComputePipeline>(
 				base + "analog" + suffix + ".dense.spv", 2, sizeof(ConfigPushConstants));
+			SchedulePipelineCacheSave();
 		}
 
 		return m_uniformAnalogComputePipeline;
@@ -271,6 +359,7 @@ public:
 				suffix += ".int64";
 			m_histogramComputePipeline = std::make_shared<ComputePipeline>(
 				base + "histogram" + suffix + ".dense.spv", 2, sizeof(ConfigPushConstants));
+			SchedulePipelineCacheSave();
 		}
 
 		return m_histogramComputePipeline;
@@ -294,8 +383,11 @@ public:
 			}
 			if(g_hasShaderInt64)
 				suffix += ".int64";
+			else
+				suffix += ".rebased";
 			m_sparseAnalogComputePipeline = std::make_shared<ComputePipeline>(
 				base + "analog" + suffix + ".spv", durationSSBOs + 4, sizeof(ConfigPushConstants));
+			SchedulePipelineCacheSave();
 		}
 
 		return m_sparseAnalogComputePipeline;
@@ -315,6 +407,7 @@ public:
 				suffix += ".int64";
 			m_uniformDigitalComputePipeline = std::make_shared<ComputePipeline>(
 				base + "digital" + suffix + ".dense.spv", 2, sizeof(ConfigPushConstants));
+			SchedulePipelineCacheSave();
 		}
 
 		return m_uniformDigitalComputePipeline;
@@ -333,18 +426,18 @@ public:
 			int durationSSBOs = 0;	//TODO: support gaps
 			if(g_hasShaderInt64)
 				suffix += ".int64";
+			else
+				suffix += ".rebased";
 			m_sparseDigitalComputePipeline = std::make_shared<ComputePipeline>(
 				base + "digital" + suffix + ".spv", durationSSBOs + 4, sizeof(ConfigPushConstants));
+			SchedulePipelineCacheSave();
 		}
 
 		return m_sparseDigitalComputePipeline;
 	}
 
-	std::shared_ptr<ComputePipeline> GetToneMapPipeline()
-	{ return m_toneMapPipe; }
-
-	std::shared_ptr<ComputePipeline> GetIndexSearchPipeline()
-	{ return m_indexSearchComputePipeline; }
+	std::shared_ptr<ComputePipeline> GetToneMapPipeline();
+	std::shared_ptr<ComputePipeline> GetIndexSearchPipeline();
 
 	bool ZeroHoldFlagSet()
 	{
@@ -384,6 +477,21 @@ public:
 	AcceleratorBuffer<uint32_t>& GetIndexBuffer()
 	{ return m_indexBuffer; }
 
+	SparseIndexCache& GetIndexCache()
+	{ return m_indexCache; }
+
+	RebasedOffsets& GetRebasedOffsets()
+	{ return m_rebasedOffsets; }
+
+	ToneMapCache& GetToneMapCache()
+	{ return m_toneMapCache; }
+
+	ProtocolRenderCache& GetProtocolRenderCache()
+	{ return m_protocolRenderCache; }
+
+	DigitalBusRunIndex& GetDigitalBusRunIndex()
+	{ return m_digitalBusRunIndex; }
+
 	void SetYButtonPos(float y)
 	{ m_yButtonPos = y; }
 
@@ -400,21 +508,55 @@ protected:
 	///@brief Parent session object
 	Session& m_session;
 
-	///@brief Buffer storing our rasterized waveform, prior to tone mapping
-	AcceleratorBuffer<float> m_rasterizedWaveform;
+	/**
+		@brief Buffer storing our rasterized waveform, prior to tone mapping
+
+		Allocated from the WaveformResourcePool in size classes, so it's usually larger than the rasterized image.
+	 */
+	std::shared_ptr<AcceleratorBuffer<float> > m_rasterizedWaveform;
 
 	///@brief Buffer for X axis indexes (only used for sparse waveforms)
 	AcceleratorBuffer<uint32_t> m_indexBuffer;
 
+	///@brief What m_indexBuffer was last computed for
+	SparseIndexCache m_indexCache;
+
+	///@brief X positions for sparse waveforms, rebased for GPUs without native int64
+	RebasedOffsets m_rebasedOffsets;
+
+	///@brief Merged spans for drawing protocol waveforms (only used for protocol streams)
+	ProtocolRenderCache m_protocolRenderCache;
+
+	///@brief Runs of identical samples for drawing digital bus waveforms (only used for digital bus streams)
+	DigitalBusRunIndex m_digitalBusRunIndex;
+
 	///@brief X axis size of rasterized waveform
 	size_t m_rasterizedX;
 
 	///@brief Y axis size of rasterized waveform
 	size_t m_rasterizedY;
 
+	///@brief Incremented every time m_rasterizedWaveform is written to
+	uint64_t m_rasterizedGeneration;
+
+	///@brief What m_texture was last tone mapped from
+	ToneMapCache m_toneMapCache;
+
 	///@brief The texture storing our final rendered waveform
 	std::shared_ptr<Texture> m_texture;
 
+	///@brief X axis size of the image drawn into m_texture
+	size_t m_textureX;
+
+	///@brief Y axis size of the image drawn into m_texture
+	size_t m_textureY;
+
+	///@brief X axis size of m_texture as allocated
+	size_t m_textureAllocX;
+
+	///@brief Y axis size of m_texture as allocated
+	size_t m_textureAllocY;
+
 	///@brief X axis size of the texture as of last UpdateSize() call
 	size_t m_cachedX;
 
@@ -448,7 +590,12 @@ protected:
 	///@brief Y axis position of our button within the view
 	float m_yButtonPos;
 
+	vk::raii::CommandBuffer& GetUtilCommandBuffer(MainWindow* top);
+
+	///@brief Pool for m_utilCmdBuffer (created on first use)
 	std::unique_ptr<vk::raii::CommandPool> m_utilCmdPool;
+
+	///@brief Command buffer for one-off work (created on first use)
 	std::unique_ptr<vk::raii::CommandBuffer> m_utilCmdBuffer;
 };
 
@@ -471,6 +618,20 @@ public:
 	void ReferenceWaveformTextures();
 	void ToneMapAllWaveforms(vk::raii::CommandBuffer& cmdbuf);
 
+	void RasterizeAnalogOrDigitalWaveform(
+		std::shared_ptr<DisplayedChannel> channel,
+		WaveformBase* data,
+		const WaveformRasterTarget& target,
+		vk::raii::CommandBuffer& cmdbuf);
+	void ToneMapAnalogOrDigitalWaveform(
+		std::shared_ptr<DisplayedChannel> channel,
+		AcceleratorBuffer<float>& rasterized,
+		vk::Sampler sampler,
+		vk::ImageView view,
+		size_t width,
+		size_t height,
+		vk::raii::CommandBuffer& cmdbuf);
+
 	size_t GetStreamCount()
 	{ return m_inputs.size(); }
 
@@ -565,6 +726,7 @@ protected:
 		std::shared_ptr<DisplayedChannel> channel,
 		vk::raii::CommandBuffer& cmdbuf,
 		bool clearPersistence);
+	bool UseCpuRasterizer();
 	void PlotContextMenu();
 
 	void DrawDropRangeMismatchMessage(
@@ -653,9 +815,12 @@ protected:
 	///@brief Waveform group containing us
 	std::shared_ptr<WaveformGroup> m_group;
 
-	///@brief Top level window object containing us
+	///@brief Top level window object containing us (null if we're not being displayed, e.g. for offscreen rendering)
 	MainWindow* m_parent;
 
+	///@brief The session we're displaying waveforms from
+	Session& m_session;
+
 	///@brief Time of last mouse movement
 	double m_tLastMouseMove;
 
@@ -715,6 +880,28 @@ protected:
 	float m_yAxisCursorPositions[2];
 
 	void DoCursor(int iCursor, DragState state);
+
+	//Appearance preferences read every frame
+	PreferenceHandle<ImU32> m_cursor0ColorPref;
+	PreferenceHandle<ImU32> m_cursor1ColorPref;
+	PreferenceHandle<ImU32> m_cursorFillColorPref;
+	PreferenceHandle<FontDescription> m_cursorFontPref;
+	PreferenceHandle<ImU32> m_maskColorPref;
+	PreferenceHandle<ImU32> m_maskPassColorPref;
+	PreferenceHandle<ImU32> m_maskFailColorPref;
+	PreferenceHandle<ImU32> m_constellationColorPref;
+	PreferenceHandle<ImU32> m_peakTextColorPref;
+	PreferenceHandle<FontDescription> m_peakFontPref;
+	PreferenceHandle<FontDescription> m_protocolFontPref;
+	PreferenceHandle<ImU32> m_bottomColorPref;
+	PreferenceHandle<ImU32> m_topColorPref;
+	PreferenceHandle<ImU32> m_gridCenterlineColorPref;
+	PreferenceHandle<ImU32> m_gridColorPref;
+	PreferenceHandle<double> m_gridCenterlineWidthPref;
+	PreferenceHandle<double> m_gridWidthPref;
+	PreferenceHandle<ImU32> m_yAxisTextColorPref;
+	PreferenceHandle<FontDescription> m_yAxisFontPref;
+	PreferenceHandle<ImU32> m_timelineAxisColorPref;
 };
 
 typedef std::pair<WaveformArea*, size_t> DragDescriptor;
@@ -46,7 +46,21 @@ using namespace std;
 // Construction / destruction
 
 WaveformGroup::WaveformGroup(MainWindow* parent, const string& title)
+	: WaveformGroup(parent->GetSession(), parent, title)
+{
+}
+
+/**
+	@brief Creates a group that isn't attached to any window, for drawing offscreen
+ */
+WaveformGroup::WaveformGroup(Session& session, const string& title)
+	: WaveformGroup(session, nullptr, title)
+{
+}
+
+WaveformGroup::WaveformGroup(Session& session, MainWindow* parent, const string& title)
 	: m_parent(parent)
+	, m_session(session)
 	, m_xpos(0)
 	, m_width(0)
 	, m_pixelsPerXUnit(0.00005)
@@ -62,6 +76,19 @@ WaveformGroup::WaveformGroup(MainWindow* parent, const string& title)
 	, m_mouseOverMarker(false)
 	, m_scopeTriggerDuringDrag(nullptr)
 	, m_displayingEye(false)
+	, m_overview(session.GetWaveformDataMutex())
+	, m_draggingOverview(false)
+	, m_markerColorPref(session.GetPreferences(), "Appearance.Cursors.marker_color")
+	, m_markerHoverColorPref(session.GetPreferences(), "Appearance.Cursors.hover_color")
+	, m_cursor0ColorPref(session.GetPreferences(), "Appearance.Cursors.cursor_1_color")
+	, m_cursor1ColorPref(session.GetPreferences(), "Appearance.Cursors.cursor_2_color")
+	, m_cursorFillColorPref(session.GetPreferences(), "Appearance.Cursors.cursor_fill_color")
+	, m_cursorFontPref(session.GetPreferences(), "Appearance.Cursors.label_font")
+	, m_timelineAxisColorPref(session.GetPreferences(), "Appearance.Timeline.axis_color")
+	, m_timelineTextColorPref(session.GetPreferences(), "Appearance.Timeline.text_color")
+	, m_timelineFontPref(session.GetPreferences(), "Appearance.Timeline.x_axis_font")
+	, m_showOverviewPref(session.GetPreferences(), "Appearance.Timeline.show_overview")
+	, m_overviewWindowColorPref(session.GetPreferences(), "Appearance.Timeline.overview_window_color")
 	, m_xAxisCursorMode(X_CURSOR_NONE)
 {
 	m_xAxisCursorPositions[0] = 0;
@@ -81,6 +108,7 @@ void WaveformGroup::Clear()
 	LogIndenter li;
 
 	m_areas.clear();
+	m_overview.Clear();
 
 	LogTrace("All areas removed\n");
 }
@@ -99,7 +127,8 @@ void WaveformGroup::AddArea(shared_ptr<WaveformArea>& area)
 		m_areas.push_back(area);
 	}
 
-	m_parent->RefreshStreamBrowserDialog();
+	if(m_parent)
+		m_parent->RefreshStreamBrowserDialog();
 }
 
 /**
@@ -123,7 +152,8 @@ void WaveformGroup::AddArea(shared_ptr<WaveformArea>& area, size_t position)
 		}
 	}
 
-	m_parent->RefreshStreamBrowserDialog();
+	if(m_parent)
+		m_parent->RefreshStreamBrowserDialog();
 }
 
 /**
@@ -280,6 +310,15 @@ bool WaveformGroup::Render()
 		}
 	}
 
+	//Render the overview strip above the timeline, if we have anything to show in it.
+	//Everything else moves down to make room.
+	if(RenderOverview(areas, plotWidth))
+	{
+		auto newpos = ImGui::GetCursorScreenPos();
+		clientArea.y -= newpos.y - pos.y;
+		pos = newpos;
+	}
+
 	//Render the timeline
 	m_timelineHeight = 2.5 * ImGui::GetFontSize();
 	RenderTimeline(plotWidth, m_timelineHeight);
@@ -590,7 +629,7 @@ void WaveformGroup::RenderMarkers(ImVec2 pos, ImVec2 size)
 	if(m_areas.empty())
 		return;
 
-	auto& session = m_parent->GetSession();
+	auto& session = m_session;
 	auto wavetime = m_areas[0]->GetWaveformTimestamp();
 	auto& markers = session.GetMarkers(wavetime);
 
@@ -603,10 +642,9 @@ void WaveformGroup::RenderMarkers(ImVec2 pos, ImVec2 size)
 	{
 		auto list = ImGui::GetWindowDrawList();
 
-		auto& prefs = m_parent->GetSession().GetPreferences();
-		auto color = prefs.GetColor("Appearance.Cursors.marker_color");
-		auto hcolor = prefs.GetColor("Appearance.Cursors.hover_color");
-		auto font = m_parent->GetFontPref("Appearance.Cursors.label_font");
+		auto color = m_markerColorPref.Get();
+		auto hcolor = m_markerHoverColorPref.Get();
+		auto font = m_parent->GetFontPref(m_cursorFontPref);
 		ImGui::PushFont(font.first, font.second);
 
 		//Draw the markers
@@ -705,7 +743,7 @@ void WaveformGroup::RenderMarkers(ImVec2 pos, ImVec2 size)
 			auto name = m_dragMarker->m_name;
 
 			m_dragMarker->m_offset = newpos;
-			m_parent->GetSession().OnMarkerChanged();
+			m_session.OnMarkerChanged();
 
 			//Find the marker again
 			//This is needed because OnMarkerChanged() sorts the list of markers
@@ -760,11 +798,10 @@ void WaveformGroup::RenderXAxisCursors(ImVec2 pos, ImVec2 size)
 	{
 		auto list = ImGui::GetWindowDrawList();
 
-		auto& prefs = m_parent->GetSession().GetPreferences();
-		auto cursor0_color = prefs.GetColor("Appearance.Cursors.cursor_1_color");
-		auto cursor1_color = prefs.GetColor("Appearance.Cursors.cursor_2_color");
-		auto fill_color = prefs.GetColor("Appearance.Cursors.cursor_fill_color");
-		auto font = m_parent->GetFontPref("Appearance.Cursors.label_font");
+		auto cursor0_color = m_cursor0ColorPref.Get();
+		auto cursor1_color = m_cursor1ColorPref.Get();
+		auto fill_color = m_cursorFillColorPref.Get();
+		auto font = m_parent->GetFontPref(m_cursorFontPref);
 		ImGui::PushFont(font.first, font.second);
 
 		float xpos0 = round(XAxisUnitsToXPosition(m_xAxisCursorPositions[0]));
@@ -935,10 +972,9 @@ void WaveformGroup::RenderTimeline(float width, float height)
 	auto list = ImGui::GetWindowDrawList();
 
 	//Style settings
-	auto& prefs = m_parent->GetSession().GetPreferences();
-	auto color = prefs.GetColor("Appearance.Timeline.axis_color");
-	auto textcolor = prefs.GetColor("Appearance.Timeline.text_color");
-	auto font = m_parent->GetFontPref("Appearance.Timeline.x_axis_font");
+	auto color = m_timelineAxisColorPref.Get();
+	auto textcolor = m_timelineTextColorPref.Get();
+	auto font = m_parent->GetFontPref(m_timelineFontPref);
 	ImGui::PushFont(font.first, font.second);
 
 	//Reserve an empty area for the timeline
@@ -1100,6 +1136,119 @@ void WaveformGroup::RenderTimeline(float width, float height)
 	ImGui::EndChild();
 }
 
+/**
+	@brief Draws the overview strip: a min/max envelope of the whole acquisition, with the visible region highlighted
+
+	Clicking or dragging in the strip moves the view there.
+
+	@return True if the strip was drawn
+ */
+bool WaveformGroup::RenderOverview(vector<shared_ptr<WaveformArea> >& areas, float width)
+{
+	//Overview is only meaningful for time domain analog waveforms
+	StreamDescriptor stream(nullptr, 0);
+	if(!areas.empty() && !m_displayingEye && (m_xAxisUnit == Unit(Unit::UNIT_FS)) && m_showOverviewPref.Get())
+	{
+		stream = areas[0]->GetFirstAnalogStream();
+	}
+	m_overview.Update(stream);
+	if(!m_overview.HasData())
+	{
+		m_draggingOverview = false;
+		return false;
+	}
+
+	auto& env = m_overview.GetEnvelope();
+	float height = 2 * ImGui::GetFontSize();
+
+	ImGui::BeginChild("overview", ImVec2(width, height));
+	auto list = ImGui::GetWindowDrawList();
+	auto pos = ImGui::GetWindowPos();
+	ImGui::Dummy(ImVec2(width, height));
+
+	//Style settings
+	auto color = ColorFromString(stream.m_channel->m_displaycolor);
+	auto axiscolor = m_timelineAxisColorPref.Get();
+	auto windowcolor = m_overviewWindowColorPref.Get();
+
+	//Scale the envelope to fill the strip, leaving a little room at the top and bottom
+	float margin = 2;
+	float vrange = env.m_vmax - env.m_vmin;
+	float yscale = (vrange > 0) ? (height - 2*margin) / vrange : 0;
+	float ybot = pos.y + height - margin;
+	double span = env.m_end - env.m_start;
+	double bucketsPerPixel = env.size() / width;
+
+	//Draw one vertical bar per pixel column, combining whatever buckets fall into it
+	for(float x=0; x<width; x++)
+	{
+		size_t first = floor(x * bucketsPerPixel);
+		size_t last = max(first + 1, static_cast<size_t>(floor( (x+1) * bucketsPerPixel)));
+		last = min(last, env.size());
+		if(first >= last)
+			break;
+
+		float vmin = env.m_min[first];
+		float vmax = env.m_max[first];
+		for(size_t i=first+1; i<last; i++)
+		{
+			vmin = min(vmin, env.m_min[i]);
+			vmax = max(vmax, env.m_max[i]);
+		}
+
+		float ytop = ybot - (vmax - env.m_vmin)*yscale;
+		float ybottom = ybot - (vmin - env.m_vmin)*yscale;
+		list->AddRectFilled(ImVec2(pos.x + x, ytop), ImVec2(pos.x + x + 1, ybottom + 1), color);
+	}
+
+	//Highlight the region currently visible in the plot
+	float viewLeft = pos.x + (m_xAxisOffset - env.m_start) * width / span;
+	float viewRight = pos.x + (m_xAxisOffset + PixelsToXAxisUnits(width) - env.m_start) * width / span;
+	viewLeft = max(viewLeft, pos.x);
+	viewRight = min(viewRight, pos.x + width);
+	if(viewRight - viewLeft < 2)
+	{
+		float center = (viewLeft + viewRight) / 2;
+		viewLeft = center - 1;
+		viewRight = center + 1;
+	}
+	list->AddRectFilled(ImVec2(viewLeft, pos.y), ImVec2(viewRight, pos.y + height), windowcolor);
+
+	//Bottom line
+	list->PathLineTo(ImVec2(pos.x, pos.y + height));
+	list->PathLineTo(ImVec2(pos.x + width, pos.y + height));
+	list->PathStroke(axiscolor, 1, ImDrawFlags_None);
+
+	//Click or drag to center the view at the mouse position
+	if(ImGui::IsItemHovered())
+	{
+		if(ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+			m_draggingOverview = true;
+
+		m_parent->AddStatusHelp("mouse_lmb", "Go to this point in the waveform");
+		m_parent->AddStatusHelp("mouse_lmb_drag", "Pan timeline");
+	}
+	if(m_draggingOverview)
+	{
+		float dx = ImGui::GetIO().MousePos.x - pos.x;
+		dx = max(0.0f, min(dx, width));
+		int64_t target = env.m_start + dx * span / width;
+
+		int64_t newOffset = target - PixelsToXAxisUnits(width) / 2;
+		if(newOffset != m_xAxisOffset)
+		{
+			m_xAxisOffset = newOffset;
+			ClearPersistence();
+		}
+
+		if(!ImGui::IsMouseDown(ImGuiMouseButton_Left))
+			m_draggingOverview = false;
+	}
+
+	ImGui::EndChild();
+	return true;
+}
+
 /**
 	@brief Draws an arrow for each scope's trigger position
  */
@@ -1114,7 +1263,7 @@ void WaveformGroup::RenderTriggerPositionArrows(ImVec2 pos, float height)
 
 	//Make a list of all scope triggers
 	float ybot = pos.y + height;
-	auto scopes = m_parent->GetSession().GetScopes();
+	auto scopes = m_session.GetScopes();
 	m_mouseOverTriggerArrow = false;
 	for(auto scope : scopes)
 	{
@@ -1129,7 +1278,7 @@ void WaveformGroup::RenderTriggerPositionArrows(ImVec2 pos, float height)
 		auto off = scope->GetTriggerOffset();
 
 		//If we have a skew calibration offset for this scope, display the virtual trigger there instead
-		int64_t skewCal = m_parent->GetSession().GetDeskew(scope);
+		int64_t skewCal = m_session.GetDeskew(scope);
 		if(skewCal != 0)
 			off = -skewCal;
 
@@ -1178,7 +1327,7 @@ void WaveformGroup::RenderTriggerPositionArrows(ImVec2 pos, float height)
 
 			//Primary of a multiscope group? Might have to realign secondaries since trigger can snap
 			//rather than moving with sample-level resolution
-			auto& sess = m_parent->GetSession();
+			auto& sess = m_session;
 			if(sess.IsPrimaryOfMultiScopeGroup(m_scopeTriggerDuringDrag))
 			{
 				int64_t oldoff = m_scopeTriggerDuringDrag->GetTriggerOffset();
@@ -1422,6 +1571,177 @@ void WaveformGroup::NavigateToTimestamp(int64_t timestamp, int64_t duration, Str
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
+/**
+	@brief Creates the waveform groups and areas described by the UI configuration of a session file
+
+	Groups are added to the list as soon as they're created, so any that were made before an error can be cleaned up.
+
+	@param session	The session the waveforms come from
+	@param parent	The window the groups will be displayed in, or null if they're only drawn offscreen
+	@param version	File format version
+	@param node		The "ui_config" node of the session file
+	@param groups	List to add the groups to
+
+	@return True on success
+ */
+bool WaveformGroup::LoadLayout(
+	Session& session,
+	MainWindow* parent,
+	int version,
+	const YAML::Node& node,
+	vector<shared_ptr<WaveformGroup> >& groups)
+{
+	auto gnodes = node["groups"];
+	auto areas = node["areas"];
+	for(auto it : gnodes)
+	{
+		//Create the group
+		auto gn = it.second;
+		auto gname = gn["name"].as<string>();
+		LogTrace("Creating group %s\n", gname.c_str());
+		LogIndenter li2;
+		auto group = parent ? make_shared<WaveformGroup>(parent, gname) : make_shared<WaveformGroup>(session, gname);
+		groups.push_back(group);
+
+		if(!group->LoadConfiguration(gn))
+		{
+			LogTrace("group loading failed\n");
+			return false;
+		}
+		else
+			LogTrace("Group ID is %s\n", group->GetID().c_str());
+
+		//Waveform areas
+		auto gareas = gn["areas"];
+		for(auto at : gareas)
+		{
+			//Load the area here (rather than by parsing the areas node as in glscopeclient)
+			//since ngscopeclient requires areas to be part of a group
+			auto aid = at.second["id"].as<int>();
+			LogTrace("Waveform area %d\n", aid);
+
+			if(version < 2)
+			{
+				//glscopeclient pre yaml-cpp refactor doesn't have named areas, need to bruteforce search for ID match
+				if(version == 0)
+				{
+					for(auto kt : areas)
+					{
+						auto an = kt.second;
+						if(an["id"].as<int>() == aid)
+						{
+							auto channel = session.m_idtable.Lookup<OscilloscopeChannel>(an["channel"].as<int>());
+							if(!channel)	//don't crash on bad IDs or missing filters
+								break;
+							size_t stream = 0;
+							if(an["stream"])
+								stream = an["stream"].as<int>();
+							auto area = make_shared<WaveformArea>(StreamDescriptor(channel, stream), group, parent);
+							group->AddArea(area);
+
+							//Add any overlays
+							auto overlays = an["overlays"];
+							for(auto jt : overlays)
+							{
+								auto filter = session.m_idtable.Lookup<Filter>(jt.second["id"].as<int>());
+								stream = 0;
+								if(jt.second["stream"])
+									stream = jt.second["stream"].as<int>();
+								if(filter)
+									area->AddStream(StreamDescriptor(filter, stream));
+							}
+
+							//FIXME: This borks on some v1 files that are mislabeled as v0
+							//For now, ignore persistence settings on all v0/v1 files
+							/*
+							if (version == 0)
+								area->SetPersistenceEnabled(an["persistence"].as<int>() == 1);
+							else
+								area->SetPersistenceEnabled(an["persistence"].as<bool>());
+							*/
+
+							break;
+						}
+					}
+				}
+
+				//post refactor, area nodes are named
+				else
+				{
+					auto an = areas[string("area") + to_string(aid)];
+
+					auto channel = session.m_idtable.Lookup<OscilloscopeChannel>(an["channel"].as<int>());
+					if(!channel)	//don't crash on bad IDs or missing filters
+						continue;
+					size_t stream = 0;
+					if(an["stream"])
+						stream = an["stream"].as<int>();
+					auto area = make_shared<WaveformArea>(StreamDescriptor(channel, stream), group, parent);
+					group->AddArea(area);
+
+					//Add any overlays
+					auto overlays = an["overlays"];
+					for(auto jt : overlays)
+					{
+						auto filter = session.m_idtable.Lookup<Filter>(jt.second["id"].as<int>());
+						stream = 0;
+						if(jt.second["stream"])
+							stream = jt.second["stream"].as<int>();
+						if(filter)
+							area->AddStream(StreamDescriptor(filter, stream));
+					}
+
+					//area->SetPersistenceEnabled(an["persistence"].as<bool>());
+				}
+			}
+
+			//ngscopeclient has a single list of streams
+			else
+			{
+				auto an = areas[string("area") + to_string(aid)];
+
+				shared_ptr<WaveformArea> area;
+
+				auto streams = an["streams"];
+				for(auto jt : streams)
+				{
+					auto chan = session.m_idtable.Lookup<OscilloscopeChannel>(jt.second["channel"].as<int>());
+					auto stream = jt.second["stream"].as<int>();
+					auto persist = jt.second["persistence"].as<bool>();
+					auto ramp = jt.second["colorRamp"].as<string>();
+					if(chan)
+					{
+						//Make the waveform area if needed
+						if(!area)
+						{
+							area = make_shared<WaveformArea>(StreamDescriptor(chan, stream), group, parent);
+							area->RemoveStream(0);
+						}
+
+						area->AddStream(StreamDescriptor(chan, stream), persist, ramp);
+					}
+					else
+					{
+						LogWarning("channel %d not found in area %d\n",
+							jt.second["channel"].as<int>(),
+							aid);
+					}
+				}
+
+				if(!area)
+					LogWarning("no waveform area created for area %d\n", aid);
+				else
+				{
+					group->AddArea(area);
+					area->LoadConfiguration(an);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
 bool WaveformGroup::LoadConfiguration(const YAML::Node& node)
 {
 	//Scale if needed
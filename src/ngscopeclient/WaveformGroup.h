@@ -36,6 +36,7 @@
 #define WaveformGroup_h
 
 #include "WaveformArea.h"
+#include "WaveformOverview.h"
 
 /**
 	@brief A WaveformGroup is a container for one or more WaveformArea's.
@@ -44,8 +45,16 @@ class WaveformGroup : public SerializableObject
 {
 public:
 	WaveformGroup(MainWindow* parent, const std::string& title);
+	WaveformGroup(Session& session, const std::string& title);
 	virtual ~WaveformGroup();
 
+	static bool LoadLayout(
+		Session& session,
+		MainWindow* parent,
+		int version,
+		const YAML::Node& node,
+		std::vector<std::shared_ptr<WaveformGroup> >& groups);
+
 	void Clear();
 
 	bool Render();
@@ -66,6 +75,10 @@ public:
 	const std::string& GetTitle()
 	{ return m_title; }
 
+	///@brief Returns the session we're displaying waveforms from
+	Session& GetSession()
+	{ return m_session; }
+
 	void AddArea(std::shared_ptr<WaveformArea>& area);
 
 	void AddArea(std::shared_ptr<WaveformArea>& area, size_t position);
@@ -154,6 +167,7 @@ public:
 	void AutofitHorizontal(float width);
 
 protected:
+	bool RenderOverview(std::vector< std::shared_ptr<WaveformArea> >& areas, float width);
 	void RenderTimeline(float width, float height);
 	void RenderTriggerPositionArrows(ImVec2 pos, float height);
 	void RenderXAxisCursors(ImVec2 pos, ImVec2 size);
@@ -181,9 +195,14 @@ protected:
 	int64_t GetRoundingDivisor(int64_t width_xunits);
 	void OnMouseWheel(float delta);
 
-	///@brief Top level window we're attached to
+	WaveformGroup(Session& session, MainWindow* parent, const std::string& title);
+
+	///@brief Top level window we're attached to (null if we're not being displayed, e.g. for offscreen rendering)
 	MainWindow* m_parent;
 
+	///@brief The session we're displaying waveforms from
+	Session& m_session;
+
 	///@brief X position of our child windows
 	float m_xpos;
 
@@ -241,6 +260,25 @@ protected:
 	///@brief True if we're displaying an eye pattern (fixed x axis scale)
 	bool m_displayingEye;
 
+	///@brief Envelope of the whole acquisition shown above the timeline
+	WaveformOverview m_overview;
+
+	///@brief True if we're dragging the visible region around in the overview
+	bool m_draggingOverview;
+
+	//Appearance preferences read every frame
+	PreferenceHandle<ImU32> m_markerColorPref;
+	PreferenceHandle<ImU32> m_markerHoverColorPref;
+	PreferenceHandle<ImU32> m_cursor0ColorPref;
+	PreferenceHandle<ImU32> m_cursor1ColorPref;
+	PreferenceHandle<ImU32> m_cursorFillColorPref;
+	PreferenceHandle<FontDescription> m_cursorFontPref;
+	PreferenceHandle<ImU32> m_timelineAxisColorPref;
+	PreferenceHandle<ImU32> m_timelineTextColorPref;
+	PreferenceHandle<FontDescription> m_timelineFontPref;
+	PreferenceHandle<bool> m_showOverviewPref;
+	PreferenceHandle<ImU32> m_overviewWindowColorPref;
+
 public:
 
 	///@brief Type of X axis cursor we're displaying
@@ -0,0 +1,248 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformOverview
+ */
+#include "ngscopeclient.h"
+#include "WaveformOverview.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformOverview::WaveformOverview(shared_mutex& dataMutex)
+	: m_dataMutex(dataMutex)
+	, m_stream(nullptr, 0)
+{
+}
+
+WaveformOverview::~WaveformOverview()
+{
+	CancelJob();
+}
+
+/**
+	@brief Discards the envelope and stops any background work
+ */
+void WaveformOverview::Clear()
+{
+	CancelJob();
+
+	m_stream = StreamDescriptor(nullptr, 0);
+	m_envelope = WaveformEnvelope();
+}
+
+/**
+	@brief Stops the in-progress job, if any, and waits for it to finish
+ */
+void WaveformOverview::CancelJob()
+{
+	if(!m_job)
+		return;
+
+	m_job->m_cancel = true;
+	m_future.wait();
+	m_job = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Updating
+
+/**
+	@brief Picks up finished envelopes and starts a new one if the stream has a new waveform
+
+	Must be called from the GUI thread with the waveform data mutex held (at least shared).
+
+	@param stream	The stream to summarize, or a null stream if there's nothing to show
+ */
+void WaveformOverview::Update(StreamDescriptor stream)
+{
+	//Pick up the results of the last job if it's done
+	//(even if it came back empty, so we don't keep retrying a waveform with nothing to show)
+	if(m_job && (m_future.wait_for(0s) == future_status::ready))
+	{
+		if(!m_job->m_stale)
+			m_envelope = std::move(m_job->m_envelope);
+		m_job = nullptr;
+	}
+
+	//Only analog streams have an envelope
+	auto data = stream.GetData();
+	if(!data || (stream.GetType() != Stream::STREAM_TYPE_ANALOG))
+	{
+		Clear();
+		return;
+	}
+
+	//If we switched to a different stream, whatever we had (or were working on) is useless
+	if(stream != m_stream)
+	{
+		Clear();
+		m_stream = stream;
+	}
+
+	//Nothing to do if the envelope is up to date
+	TimePoint timestamp(data->m_startTimestamp, data->m_startFemtoseconds);
+	if( (m_envelope.m_data == data) &&
+		(m_envelope.m_revision == data->m_revision) &&
+		(m_envelope.m_timestamp == timestamp) )
+	{
+		return;
+	}
+
+	//If a job is still running, let it finish before starting another.
+	//We'll come back around next frame and catch up if the waveform changed under it.
+	if(m_job)
+		return;
+
+	//Get the samples onto the CPU here, since the GUI thread may be doing the same to this waveform and
+	//AcceleratorBuffer isn't safe to prepare from two threads at once. The job only reads the CPU copy.
+	data->PrepareForCpuAccess();
+
+	m_job = make_shared<Job>(m_dataMutex, stream, data);
+	auto job = m_job;
+	m_future = async(launch::async, [job]{ job->Run(); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Envelope computation
+
+/**
+	@brief Calculates the min/max envelope of the waveform
+
+	Works directly on the CPU copy of the samples, holding a shared lock on the waveform data the whole time. That
+	doesn't block the GUI thread or any other readers, only writers, and the job checks for cancellation every bucket.
+ */
+void WaveformOverview::Job::Run()
+{
+	//Don't block waiting for the lock. If a writer is queued, a blocking shared lock could wait behind it
+	//while the GUI thread (which holds a shared lock of its own) waits for us to be cancelled.
+	shared_lock<shared_mutex> lock(m_dataMutex, defer_lock);
+	while(!lock.try_lock())
+	{
+		if(m_cancel)
+			return;
+		this_thread::sleep_for(1ms);
+	}
+
+	//Make sure the waveform is still the one Update() prepared for CPU access, since it may have been replaced or
+	//modified while we waited for the lock. If so, Update() will start over with the new one.
+	auto data = m_stream.GetData();
+	if( (data != m_envelope.m_data) ||
+		(data->m_revision != m_envelope.m_revision) ||
+		(TimePoint(data->m_startTimestamp, data->m_startFemtoseconds) != m_envelope.m_timestamp) )
+	{
+		m_stale = true;
+		return;
+	}
+
+	auto sdata = dynamic_cast<SparseAnalogWaveform*>(data);
+	auto udata = dynamic_cast<UniformAnalogWaveform*>(data);
+	if(!sdata && !udata)
+		return;
+
+	size_t len = data->size();
+	if(len < 2)
+		return;
+
+	const float* samples = sdata ? sdata->m_samples.GetCpuPointer() : udata->m_samples.GetCpuPointer();
+	const int64_t* offsets = sdata ? sdata->m_offsets.GetCpuPointer() : nullptr;
+
+	int64_t tstart = GetOffsetScaled(sdata, udata, 0);
+	int64_t tend = GetOffsetScaled(sdata, udata, len-1) + GetDurationScaled(sdata, udata, len-1);
+	if(tend <= tstart)
+		return;
+
+	//Find the first sample at or after the start of each bucket
+	const size_t nbuckets = NUM_BUCKETS;
+	vector<size_t> edges(nbuckets + 1);
+	double bucketWidth = static_cast<double>(tend - tstart) / nbuckets;
+	double timescale = data->m_timescale;
+	double phase = data->m_triggerPhase;
+	for(size_t i=0; i<nbuckets; i++)
+	{
+		double target = ceil( (tstart + i*bucketWidth - phase) / timescale );
+
+		size_t edge;
+		if(target <= 0)
+			edge = 0;
+		else if(offsets)
+			edge = lower_bound(offsets, offsets + len, static_cast<int64_t>(target)) - offsets;
+		else if(target >= len)
+			edge = len;
+		else
+			edge = static_cast<size_t>(target);
+
+		edges[i] = edge;
+	}
+	edges[nbuckets] = len;
+
+	//Min/max of each bucket.
+	//The sample before the bucket is still being displayed at its left edge, so include it too. This also means
+	//a bucket in the middle of a single long sample still shows that sample rather than a gap.
+	auto& env = m_envelope;
+	env.m_min.resize(nbuckets);
+	env.m_max.resize(nbuckets);
+	#pragma omp parallel for
+	for(size_t i=0; i<nbuckets; i++)
+	{
+		if(m_cancel)
+			continue;
+
+		size_t first = edges[i];
+		if(first > 0)
+			first --;
+		size_t last = max(edges[i+1], first + 1);
+
+		float vmin = samples[first];
+		float vmax = samples[first];
+		for(size_t j=first+1; j<last; j++)
+		{
+			vmin = min(vmin, samples[j]);
+			vmax = max(vmax, samples[j]);
+		}
+		env.m_min[i] = vmin;
+		env.m_max[i] = vmax;
+	}
+	if(m_cancel)
+	{
+		env = WaveformEnvelope();
+		return;
+	}
+
+	env.m_start = tstart;
+	env.m_end = tend;
+	env.m_vmin = *min_element(env.m_min.begin(), env.m_min.end());
+	env.m_vmax = *max_element(env.m_max.begin(), env.m_max.end());
+}
@@ -0,0 +1,173 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WaveformOverview
+ */
+#ifndef WaveformOverview_h
+#define WaveformOverview_h
+
+#include <future>
+
+/**
+	@brief Min/max envelope of an entire analog waveform, at a fixed number of buckets
+ */
+class WaveformEnvelope
+{
+public:
+	WaveformEnvelope()
+		: m_data(nullptr)
+		, m_revision(0)
+		, m_timestamp(0, 0)
+		, m_start(0)
+		, m_end(0)
+		, m_vmin(0)
+		, m_vmax(0)
+	{}
+
+	bool empty() const
+	{ return m_min.empty(); }
+
+	size_t size() const
+	{ return m_min.size(); }
+
+	///@brief The waveform the envelope was computed from
+	WaveformBase* m_data;
+
+	///@brief Revision of m_data the envelope was computed from
+	uint64_t m_revision;
+
+	///@brief Timestamp of m_data when the envelope was computed
+	TimePoint m_timestamp;
+
+	///@brief Timestamp of the start of the first bucket, in X axis units
+	int64_t m_start;
+
+	///@brief Timestamp of the end of the last bucket, in X axis units
+	int64_t m_end;
+
+	///@brief Lowest sample value in each bucket
+	std::vector<float> m_min;
+
+	///@brief Highest sample value in each bucket
+	std::vector<float> m_max;
+
+	///@brief Lowest sample value in the whole waveform
+	float m_vmin;
+
+	///@brief Highest sample value in the whole waveform
+	float m_vmax;
+};
+
+/**
+	@brief Keeps an overview envelope of a stream up to date, computing it in the background
+
+	Update() is called every frame from the GUI thread. When the stream has a new waveform, the envelope is recomputed
+	on a worker thread and the previous one stays available until the new one is done, so rendering the overview never
+	has to touch the full waveform. The worker holds a shared lock on the waveform data while it runs, which only
+	blocks writers.
+ */
+class WaveformOverview
+{
+public:
+	WaveformOverview(std::shared_mutex& dataMutex);
+	~WaveformOverview();
+
+	void Update(StreamDescriptor stream);
+	void Clear();
+
+	///@brief Returns true if we have an envelope to display
+	bool HasData()
+	{ return !m_envelope.empty(); }
+
+	const WaveformEnvelope& GetEnvelope()
+	{ return m_envelope; }
+
+	///@brief Number of buckets in the envelope
+	static const size_t NUM_BUCKETS = 4096;
+
+protected:
+
+	/**
+		@brief State of a single background envelope computation
+	 */
+	class Job
+	{
+	public:
+		Job(std::shared_mutex& dataMutex, StreamDescriptor stream, WaveformBase* data)
+			: m_dataMutex(dataMutex)
+			, m_stream(stream)
+			, m_cancel(false)
+			, m_stale(false)
+		{
+			m_envelope.m_data = data;
+			m_envelope.m_revision = data->m_revision;
+			m_envelope.m_timestamp = TimePoint(data->m_startTimestamp, data->m_startFemtoseconds);
+		}
+
+		void Run();
+
+		///@brief Mutex protecting the waveform data
+		std::shared_mutex& m_dataMutex;
+
+		///@brief The stream being summarized
+		StreamDescriptor m_stream;
+
+		///@brief Set to abandon the job early
+		std::atomic<bool> m_cancel;
+
+		///@brief Set if the waveform changed before the job got the lock, so the result should be ignored
+		bool m_stale;
+
+		///@brief The envelope (empty if there was nothing to compute or we were cancelled)
+		WaveformEnvelope m_envelope;
+	};
+
+	void CancelJob();
+
+	///@brief Mutex protecting the waveform data
+	std::shared_mutex& m_dataMutex;
+
+	///@brief The stream m_envelope belongs to
+	StreamDescriptor m_stream;
+
+	///@brief The most recent completed envelope
+	WaveformEnvelope m_envelope;
+
+	///@brief The in-progress job, if any
+	std::shared_ptr<Job> m_job;
+
+	///@brief Completion of m_job
+	std::future<void> m_future;
+};
+
+#endif
@@ -0,0 +1,263 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformResourcePool
+ */
+#include "ngscopeclient.h"
+#include "WaveformResourcePool.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformResourcePool::WaveformResourcePool(TextureManager* mgr)
+	: m_texmgr(mgr)
+	, m_freeTextureBytes(0)
+	, m_freeBufferBytes(0)
+{
+}
+
+WaveformResourcePool::~WaveformResourcePool()
+{
+	clear();
+}
+
+/**
+	@brief Frees every unused resource in the pool
+
+	@return True if anything was freed
+ */
+bool WaveformResourcePool::clear()
+{
+	//Move everything out under the lock, but destroy it outside
+	list<PooledTexture> textures;
+	list<shared_ptr<AcceleratorBuffer<float> > > buffers;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		textures.swap(m_freeTextures);
+		buffers.swap(m_freeBuffers);
+		m_freeTextureBytes = 0;
+		m_freeBufferBytes = 0;
+	}
+
+	return !textures.empty() || !buffers.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Size classes
+
+/**
+	@brief Rounds a size up to the next size class
+
+	Classes are spaced four per power of two: ..., 256, 320, 384, 448, 512, 640, ...
+ */
+size_t WaveformResourcePool::GetSizeClass(size_t n)
+{
+	if(n <= MIN_SIZE_CLASS)
+		return MIN_SIZE_CLASS;
+
+	//Find the power of two just below n
+	size_t p = MIN_SIZE_CLASS;
+	while(p*2 < n)
+		p *= 2;
+
+	size_t step = p / 4;
+	return ((n + step - 1) / step) * step;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Textures
+
+/**
+	@brief Gets a texture of exactly the requested size, in the general layout, reusing an unused one if possible
+
+	@param width	Width of the texture (normally a size class)
+	@param height	Height of the texture (normally a size class)
+ */
+shared_ptr<Texture> WaveformResourcePool::GetTexture(size_t width, size_t height)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		for(auto it = m_freeTextures.begin(); it != m_freeTextures.end(); it++)
+		{
+			if( (it->m_width != width) || (it->m_height != height) )
+				continue;
+
+			//Still referenced by a frame in flight
+			if(it->m_texture.use_count() > 1)
+				continue;
+
+			auto tex = it->m_texture;
+			m_freeTextureBytes -= width * height * 4 * sizeof(float);
+			m_freeTextures.erase(it);
+			return tex;
+		}
+	}
+
+	//Nothing suitable, make a new one (outside the lock, since allocating may trigger memory pressure handlers)
+	LogTrace("Allocating new %zu x %zu waveform texture\n", width, height);
+
+	//NOTE: Assumes the render queue is also capable of transfers (see QueueManager)
+	vk::ImageCreateInfo imageInfo(
+		{},
+		vk::ImageType::e2D,
+		vk::Format::eR32G32B32A32Sfloat,
+		vk::Extent3D(width, height, 1),
+		1,
+		1,
+		VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
+		VULKAN_HPP_NAMESPACE::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+		vk::SharingMode::eExclusive,
+		{},
+		vk::ImageLayout::eUndefined
+		);
+	auto tex = make_shared<Texture>(*g_vkComputeDevice, imageInfo, m_texmgr, "DisplayedChannel.m_texture");
+
+	//Add a barrier to convert the image format to "general"
+	lock_guard<mutex> lock(g_vkTransferMutex);
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	vk::ImageMemoryBarrier barrier(
+		vk::AccessFlagBits::eNone,
+		vk::AccessFlagBits::eShaderWrite,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eGeneral,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED,
+		tex->GetImage(),
+		range);
+	g_vkTransferCommandBuffer->begin({});
+	g_vkTransferCommandBuffer->pipelineBarrier(
+			vk::PipelineStageFlagBits::eTopOfPipe,
+			vk::PipelineStageFlagBits::eComputeShader,
+			{},
+			{},
+			{},
+			barrier);
+	g_vkTransferCommandBuffer->end();
+	g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
+
+	return tex;
+}
+
+/**
+	@brief Returns a texture to the pool
+
+	@param tex		The texture
+	@param width	Allocated width of the texture
+	@param height	Allocated height of the texture
+ */
+void WaveformResourcePool::ReleaseTexture(shared_ptr<Texture> tex, size_t width, size_t height)
+{
+	if(!tex)
+		return;
+
+	lock_guard<mutex> lock(m_mutex);
+	m_freeTextures.push_back(PooledTexture(tex, width, height));
+	m_freeTextureBytes += width * height * 4 * sizeof(float);
+	TrimTextures();
+}
+
+/**
+	@brief Drops the oldest unused textures until we're under budget
+ */
+void WaveformResourcePool::TrimTextures()
+{
+	while( (m_freeTextureBytes > MAX_FREE_BYTES) && !m_freeTextures.empty() )
+	{
+		auto& front = m_freeTextures.front();
+		m_freeTextureBytes -= front.m_width * front.m_height * 4 * sizeof(float);
+		m_freeTextures.pop_front();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rasterization buffers
+
+/**
+	@brief Gets a rasterization buffer of exactly the requested size, reusing an unused one if possible
+
+	The contents are undefined.
+
+	@param size		Number of pixels (normally a size class)
+ */
+shared_ptr<AcceleratorBuffer<float> > WaveformResourcePool::GetBuffer(size_t size)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		for(auto it = m_freeBuffers.begin(); it != m_freeBuffers.end(); it++)
+		{
+			if((*it)->size() != size)
+				continue;
+
+			auto buf = *it;
+			m_freeBufferBytes -= size * sizeof(float);
+			m_freeBuffers.erase(it);
+			return buf;
+		}
+	}
+
+	//Use GPU-side memory with a CPU-side mirror, same as other rasterization buffers
+	auto buf = make_shared<AcceleratorBuffer<float> >("DisplayedChannel.m_rasterizedWaveform");
+	buf->SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	buf->SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	buf->resize(size);
+	return buf;
+}
+
+/**
+	@brief Returns a rasterization buffer to the pool
+ */
+void WaveformResourcePool::ReleaseBuffer(shared_ptr<AcceleratorBuffer<float> > buf)
+{
+	if(!buf || buf->empty())
+		return;
+
+	lock_guard<mutex> lock(m_mutex);
+	m_freeBuffers.push_back(buf);
+	m_freeBufferBytes += buf->size() * sizeof(float);
+	TrimBuffers();
+}
+
+/**
+	@brief Drops the oldest unused buffers until we're under budget
+ */
+void WaveformResourcePool::TrimBuffers()
+{
+	while( (m_freeBufferBytes > MAX_FREE_BYTES) && !m_freeBuffers.empty() )
+	{
+		m_freeBufferBytes -= m_freeBuffers.front()->size() * sizeof(float);
+		m_freeBuffers.pop_front();
+	}
+}
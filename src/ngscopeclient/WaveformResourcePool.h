@@ -0,0 +1,116 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WaveformResourcePool
+ */
+#ifndef WaveformResourcePool_h
+#define WaveformResourcePool_h
+
+#include "TextureManager.h"
+
+/**
+	@brief Pool of tone mapping output images and rasterization buffers, shared by all DisplayedChannels
+
+	Resources are allocated in size classes (four per power of two, so no more than 25% is wasted) rather than at
+	the exact size of the channel. A channel keeps drawing into a sub-rectangle of its current resources as long as
+	the new size is in the same class, and when it moves to another class the old resources go back to the pool
+	for the next channel (or the same one, resized back) that needs them. Dragging a splitter or resizing the main
+	window thus only allocates device memory when a class is used for the first time.
+
+	Textures may still be in use by frames in flight when they're released, so one is only handed out again once
+	nobody else holds a reference to it (see VulkanWindow::AddTextureUsedThisFrame). Rasterization buffers are only
+	ever used under the session's rasterized waveform mutex, with blocking submits, so they can be reused right away.
+ */
+class WaveformResourcePool
+{
+public:
+	WaveformResourcePool(TextureManager* mgr);
+	~WaveformResourcePool();
+
+	static size_t GetSizeClass(size_t n);
+
+	std::shared_ptr<Texture> GetTexture(size_t width, size_t height);
+	void ReleaseTexture(std::shared_ptr<Texture> tex, size_t width, size_t height);
+
+	std::shared_ptr<AcceleratorBuffer<float> > GetBuffer(size_t size);
+	void ReleaseBuffer(std::shared_ptr<AcceleratorBuffer<float> > buf);
+
+	bool clear();
+
+	///@brief Smallest size class
+	static const size_t MIN_SIZE_CLASS = 64;
+
+	///@brief Maximum amount of memory held by unused textures (and, separately, unused buffers)
+	static const size_t MAX_FREE_BYTES = 256 * 1024 * 1024;
+
+protected:
+	void TrimTextures();
+	void TrimBuffers();
+
+	/**
+		@brief An unused texture and its allocated size
+	 */
+	class PooledTexture
+	{
+	public:
+		PooledTexture(std::shared_ptr<Texture> tex, size_t width, size_t height)
+			: m_texture(tex)
+			, m_width(width)
+			, m_height(height)
+		{}
+
+		std::shared_ptr<Texture> m_texture;
+		size_t m_width;
+		size_t m_height;
+	};
+
+	///@brief Mutex protecting the free lists
+	std::mutex m_mutex;
+
+	///@brief Texture manager new textures are created against
+	TextureManager* m_texmgr;
+
+	///@brief Unused textures, oldest first
+	std::list<PooledTexture> m_freeTextures;
+
+	///@brief Total size of m_freeTextures, in bytes
+	size_t m_freeTextureBytes;
+
+	///@brief Unused rasterization buffers, oldest first
+	std::list<std::shared_ptr<AcceleratorBuffer<float> > > m_freeBuffers;
+
+	///@brief Total size of m_freeBuffers, in bytes
+	size_t m_freeBufferBytes;
+};
+
+#endif
@@ -35,6 +35,8 @@
 #include "ngscopeclient.h"
 #include "pthread_compat.h"
 #include "Session.h"
+#include "MainWindow.h"
+#include "PreferenceHandle.h"
 #include "WaveformArea.h"
 
 using namespace std;
@@ -52,7 +54,61 @@ Event g_waveformProcessedEvent;
 ///@brief Time spent on the last cycle of waveform rendering shaders
 atomic<int64_t> g_lastWaveformRenderTime;
 
-void RenderAllWaveforms(vk::raii::CommandBuffer& cmdbuf, Session* session, shared_ptr<QueueHandle> queue);
+///@brief Number of queues the last cycle of waveform rendering was split across
+atomic<size_t> g_lastWaveformRenderPartitions;
+
+/**
+	@brief A queue and command buffer for rasterizing one set of waveform groups
+
+	Contexts other than the first also own a worker thread, which sleeps until Start() hands it a set of groups.
+	The first context is run directly by WaveformThread.
+ */
+class RasterizerContext
+{
+public:
+	RasterizerContext(const string& name, bool worker);
+	~RasterizerContext();
+
+	void Render(const vector<shared_ptr<WaveformGroup> >& groups, bool clearPersistence);
+
+	void Start(const vector<shared_ptr<WaveformGroup> >& groups, bool clearPersistence);
+	void Wait();
+
+protected:
+	void WorkerThread(const string& name);
+
+	///@brief Queue to submit to
+	shared_ptr<QueueHandle> m_queue;
+
+	///@brief Pool for allocating m_cmdbuf
+	vk::raii::CommandPool m_pool;
+
+	///@brief Command buffer the groups are recorded into
+	vk::raii::CommandBuffer m_cmdbuf;
+
+	///@brief Mutex protecting the job state below
+	mutex m_mutex;
+
+	///@brief Signaled when a job is started, finishes, or we're shutting down
+	condition_variable m_cond;
+
+	///@brief The groups the worker should render, or null if it's idle
+	const vector<shared_ptr<WaveformGroup> >* m_groups;
+
+	///@brief True if the worker should clear persistence while rendering m_groups
+	bool m_clearPersistence;
+
+	///@brief Exception thrown by the last job, to be rethrown by Wait()
+	exception_ptr m_error;
+
+	///@brief Set to make the worker exit
+	bool m_shuttingDown;
+
+	///@brief The worker thread, if we have one
+	thread m_thread;
+};
+
+void RenderAllWaveforms(vector<unique_ptr<RasterizerContext> >& contexts, Session* session);
 
 void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 {
@@ -63,34 +119,10 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 
 	LogTrace("Starting\n");
 
-	//Create a queue and command buffer for this thread's accelerated processing
-	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("WaveformThread.queue"));
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		queue->GetQueue()->m_family );
-	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
-
-	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
-	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
-
-	if(g_hasDebugUtils)
-	{
-		string prefix = "WaveformThread";
-		string poolname = prefix + ".pool";
-		string bufname = prefix + ".cmdbuf";
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(*pool)),
-				poolname.c_str()));
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<int64_t>(static_cast<VkCommandBuffer>(*cmdbuf)),
-				bufname.c_str()));
-	}
+	//Create a queue and command buffer for this thread's accelerated processing.
+	//More are created on demand if the waveform groups can be split across several queues.
+	vector<unique_ptr<RasterizerContext> > contexts;
+	contexts.push_back(make_unique<RasterizerContext>("WaveformThread", false));
 
 	while(!*shuttingDown)
 	{
@@ -103,7 +135,7 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 			LogTrace("WaveformThread: re-running filter graph and re-rendering\n");
 			AcceleratorBufferPerformanceCounters::Reset();
 			session->RefreshAllFilters();
-			RenderAllWaveforms(cmdbuf, session, queue);
+			RenderAllWaveforms(contexts, session);
 			g_refilterDoneEvent.Signal();
 			continue;
 		}
@@ -113,7 +145,7 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 			LogTrace("WaveformThread: re-running partial filter graph and re-rendering\n");
 			AcceleratorBufferPerformanceCounters::Reset();
 			if(session->RefreshDirtyFilters())
-				RenderAllWaveforms(cmdbuf, session, queue);
+				RenderAllWaveforms(contexts, session);
 			g_refilterDoneEvent.Signal();
 			continue;
 		}
@@ -122,7 +154,7 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 		if(g_rerenderRequestedEvent.Peek())
 		{
 			LogTrace("WaveformThread: re-rendering\n");
-			RenderAllWaveforms(cmdbuf, session, queue);
+			RenderAllWaveforms(contexts, session);
 			g_rerenderDoneEvent.Signal();
 			continue;
 		}
@@ -144,7 +176,7 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 		session->RefreshAllFilters();
 
 		//Rerun the heavyweight rendering shaders
-		RenderAllWaveforms(cmdbuf, session, queue);
+		RenderAllWaveforms(contexts, session);
 
 		//Unblock the UI threads, then wait for acknowledgement that it's processed
 		g_waveformReadyEvent.Signal();
@@ -154,7 +186,148 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 	LogTrace("Shutting down\n");
 }
 
-void RenderAllWaveforms(vk::raii::CommandBuffer& cmdbuf, Session* session, shared_ptr<QueueHandle> queue)
+RasterizerContext::RasterizerContext(const string& name, bool worker)
+	: m_queue(g_vkQueueManager->GetComputeQueue(name + ".queue"))
+	, m_pool(
+		*g_vkComputeDevice,
+		vk::CommandPoolCreateInfo(
+			vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			m_queue->GetQueue()->m_family))
+	, m_cmdbuf(std::move(vk::raii::CommandBuffers(
+		*g_vkComputeDevice,
+		vk::CommandBufferAllocateInfo(*m_pool, vk::CommandBufferLevel::ePrimary, 1)).front()))
+	, m_groups(nullptr)
+	, m_clearPersistence(false)
+	, m_shuttingDown(false)
+{
+	if(g_hasDebugUtils)
+	{
+		string poolname = name + ".pool";
+		string bufname = name + ".cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(*m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<int64_t>(static_cast<VkCommandBuffer>(*m_cmdbuf)),
+				bufname.c_str()));
+	}
+
+	if(worker)
+		m_thread = thread(&RasterizerContext::WorkerThread, this, name);
+}
+
+RasterizerContext::~RasterizerContext()
+{
+	if(!m_thread.joinable())
+		return;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_shuttingDown = true;
+	}
+	m_cond.notify_all();
+	m_thread.join();
+}
+
+/**
+	@brief Rasterizes one set of waveform groups into our command buffer, then runs it to completion
+ */
+void RasterizerContext::Render(const vector<shared_ptr<WaveformGroup> >& groups, bool clearPersistence)
+{
+	#ifdef HAVE_NVTX
+		nvtx3::scoped_range range("RasterizerContext::Render");
+	#endif
+
+	//Keep references to all displayed channels open until the rendering finishes
+	//This prevents problems if we close a WaveformArea or remove a channel from it before the shader completes
+	vector< shared_ptr<InputDescriptor> > channels;
+	m_cmdbuf.begin({});
+	for(auto& group : groups)
+		group->RenderWaveformTextures(m_cmdbuf, channels, clearPersistence);
+	m_cmdbuf.end();
+	m_queue->SubmitAndBlock(m_cmdbuf);
+}
+
+/**
+	@brief Wakes up the worker thread to render a set of groups
+
+	The groups must stay alive until Wait() returns.
+ */
+void RasterizerContext::Start(const vector<shared_ptr<WaveformGroup> >& groups, bool clearPersistence)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_groups = &groups;
+		m_clearPersistence = clearPersistence;
+	}
+	m_cond.notify_all();
+}
+
+/**
+	@brief Blocks until the worker thread has finished the groups passed to Start()
+
+	If rendering threw an exception, it's rethrown here.
+ */
+void RasterizerContext::Wait()
+{
+	exception_ptr error;
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_cond.wait(lock, [&]{ return m_groups == nullptr; });
+		swap(error, m_error);
+	}
+
+	if(error)
+		rethrow_exception(error);
+}
+
+void RasterizerContext::WorkerThread(const string& name)
+{
+	pthread_setname_np_compat(name.c_str());
+
+	unique_lock<mutex> lock(m_mutex);
+	while(true)
+	{
+		m_cond.wait(lock, [&]{ return m_shuttingDown || (m_groups != nullptr); });
+		if(m_shuttingDown)
+			break;
+
+		auto groups = m_groups;
+		bool clear = m_clearPersistence;
+		lock.unlock();
+
+		//Don't let an exception kill the thread (and the whole process); hand it to whoever is waiting on us
+		exception_ptr error;
+		try
+		{
+			Render(*groups, clear);
+		}
+		catch(...)
+		{
+			error = current_exception();
+		}
+
+		lock.lock();
+		m_error = error;
+		m_groups = nullptr;
+		m_cond.notify_all();
+	}
+}
+
+/**
+	@brief Rasterizes all waveform groups
+
+	Groups that don't share any waveforms are split across up to Miscellaneous.Rendering.rasterizer_queues command
+	buffers, each recorded and submitted by its own thread (to its own queue, if the device has enough). The helper
+	threads persist between calls, so there's no thread creation on each cycle.
+ */
+void RenderAllWaveforms(vector<unique_ptr<RasterizerContext> >& contexts, Session* session)
 {
 	#ifdef HAVE_NVTX
 		nvtx3::scoped_range range("RenderAllWaveforms");
@@ -167,13 +340,49 @@ void RenderAllWaveforms(vk::raii::CommandBuffer& cmdbuf, Session* session, share
 	shared_lock<shared_mutex> lock2(g_vulkanActivityMutex);
 	lock_guard<mutex> lock3(session->GetRasterizedWaveformMutex());
 
-	//Keep references to all displayed channels open until the rendering finishes
-	//This prevents problems if we close a WaveformArea or remove a channel from it before the shader completes
-	vector< shared_ptr<InputDescriptor> > channels;
-	cmdbuf.begin({});
-	session->RenderWaveformTextures(cmdbuf, channels);
-	cmdbuf.end();
-	queue->SubmitAndBlock(cmdbuf);
+	//Only ever called from WaveformThread, so the handle doesn't need to be thread safe
+	static PreferenceHandle<int64_t> maxQueues(session->GetPreferences(), "Miscellaneous.Rendering.rasterizer_queues");
+
+	//Headless sessions are drawn by OffscreenRenderer, nothing on screen to rasterize
+	auto wnd = session->GetMainWindow();
+	if(!wnd)
+		return;
+	bool clear = wnd->ConsumeClearPersistence();
+	auto partitions = wnd->PartitionWaveformGroups(max<int64_t>(1, maxQueues.Get()));
+
+	//Make more contexts if we need them
+	while(contexts.size() < partitions.size())
+		contexts.push_back(make_unique<RasterizerContext>("Rasterizer." + to_string(contexts.size()), true));
+
+	//Run the first set on this thread and the rest on the helper threads.
+	//Every helper has to be done with the partitions before we return, even if one of them failed.
+	for(size_t i=1; i<partitions.size(); i++)
+		contexts[i]->Start(partitions[i], clear);
+	exception_ptr error;
+	try
+	{
+		if(!partitions.empty())
+			contexts[0]->Render(partitions[0], clear);
+	}
+	catch(...)
+	{
+		error = current_exception();
+	}
+	for(size_t i=1; i<partitions.size(); i++)
+	{
+		try
+		{
+			contexts[i]->Wait();
+		}
+		catch(...)
+		{
+			if(!error)
+				error = current_exception();
+		}
+	}
+	if(error)
+		rethrow_exception(error);
 
+	g_lastWaveformRenderPartitions = partitions.size();
 	g_lastWaveformRenderTime = (GetTime() - tstart) * FS_PER_SECOND;
 }
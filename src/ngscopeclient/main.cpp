@@ -36,6 +36,8 @@
 #include "ngscopeclient.h"
 #include "ngscopeclient-version.h"
 #include "MainWindow.h"
+#include "OffscreenRenderer.h"
+#include "PreferenceHandle.h"
 #include "../scopeprotocols/scopeprotocols.h"
 #include "imgui_internal.h"
 
@@ -49,6 +51,16 @@ GuiLogSink* g_guiLog;
 void Relaunch(int argc, char* argv[]);
 #endif
 
+/**
+	@brief Logs how long a startup phase took, and starts timing the next one
+ */
+static void LogStartupPhase(const char* name, double& tphase)
+{
+	double now = GetTime();
+	LogDebug("Startup: %s took %.2f ms\n", name, (now - tphase) * 1000);
+	tphase = now;
+}
+
 static void print_help(FILE* stream)
 {
 	fprintf(stream,
@@ -62,6 +74,14 @@ static void print_help(FILE* stream)
 		"  --maximize, -m   maximize ngscopeclient window on startup\n"
 		"  --restore, -r    restore previous ngscopeclient window size and position\n"
 		"\n"
+		"Batch export options:\n"
+		"  --export-history <directory>\n"
+		"      load the session offline without opening a window, write every\n"
+		"      waveform group at every point in history to PNG files in the\n"
+		"      directory, then exit\n"
+		"  --export-size <width>x<height>\n"
+		"      size of exported images (default 1920x1080)\n"
+		"\n"
 		"Logging options:\n"
 		"  -q, --quiet  make logging one level quieter (can be repeated)\n"
 		"  --verbose    emit more detailed logs that might be useful to end users\n"
@@ -126,6 +146,9 @@ int main(int argc, char* argv[])
 	bool maximize = false;
 	bool restore = false;
 	vector<string> instrumentConnectionStrings;
+	string exportDir;
+	uint32_t exportWidth = 1920;
+	uint32_t exportHeight = 1080;
 	for(int i=1; i<argc; i++)
 	{
 		string s(argv[i]);
@@ -158,6 +181,22 @@ int main(int argc, char* argv[])
 			continue;
 		}
 
+		if( (s == "--export-history") && (i+1 < argc) )
+		{
+			exportDir = argv[++i];
+			continue;
+		}
+
+		if( (s == "--export-size") && (i+1 < argc) )
+		{
+			if( (sscanf(argv[++i], "%ux%u", &exportWidth, &exportHeight) != 2) || !exportWidth || !exportHeight )
+			{
+				fprintf(stderr, "ngscopeclient: invalid export size '%s'\n", argv[i]);
+				return 1;
+			}
+			continue;
+		}
+
 		//Other switch (unrecognized)
 		if(s.find('-') == 0)
 		{
@@ -218,6 +257,13 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
+	//Exporting needs something to export
+	if(!exportDir.empty() && sessionToOpen.empty())
+	{
+		LogError("--export-history requires a session file\n");
+		return 1;
+	}
+
 	//Complain if the OpenMP wait policy isn't set right
 	const char* policy = getenv("OMP_WAIT_POLICY");
 	#ifndef _WIN32
@@ -250,17 +296,31 @@ int main(int argc, char* argv[])
 	#endif
 
 	//Initialize object creation tables for predefined libraries
-	if(!VulkanInit())
+	double tstart = GetTime();
+	double tphase = tstart;
+	bool headless = !exportDir.empty();
+	if(!VulkanInit(headless))
 		return 1;
+	LogStartupPhase("Vulkan initialization", tphase);
 	TransportStaticInit();
 	DriverStaticInit();
 	ScopeProtocolStaticInit();
 	InitializePlugins();
+	LogStartupPhase("driver, filter, and plugin registration", tphase);
+
+	//Batch export: load the session without a window, draw everything offscreen, then exit
+	if(headless)
+	{
+		bool ok = OffscreenRenderer::ExportHistory(sessionToOpen, exportDir, exportWidth, exportHeight);
+		ScopehalStaticCleanup();
+		return ok ? 0 : 1;
+	}
 
 	{
 		//Make the top level window
 		shared_ptr<QueueHandle> queue(g_vkQueueManager->GetRenderQueue("g_mainWindow.render"));
 		g_mainWindow = make_unique<MainWindow>(queue,maximize,restore);
+		LogStartupPhase("main window creation", tphase);
 
 
 		auto& session = g_mainWindow->GetSession();
@@ -272,6 +332,8 @@ int main(int argc, char* argv[])
 		//Render the main window once, so it can initialize a new empty session before we connect any instruments
 		glfwPollEvents();
 		g_mainWindow->Render();
+		LogStartupPhase("first frame", tphase);
+		LogDebug("Startup: total %.2f ms\n", (tphase - tstart) * 1000);
 
 		//Initialize the session with the requested arguments
 		for(auto s : instrumentConnectionStrings)
@@ -302,12 +364,16 @@ int main(int argc, char* argv[])
 			session.CreateAndAddInstrument(driver, ptransport, name);
 		}
 
+		//Resolve the event loop preferences once, rather than looking them up by path every frame
+		PreferenceHandle<int64_t> eventDriven(session.GetPreferences(), "Power.Events.event_driven_ui");
+		PreferenceHandle<double> pollingTimeout(session.GetPreferences(), "Power.Events.polling_timeout");
+
 		//Main event loop
 		while(!glfwWindowShouldClose(g_mainWindow->GetWindow()))
 		{
 			//Check which event loop model to use
-			if(session.GetPreferences().GetEnumRaw("Power.Events.event_driven_ui") == 1)
-				glfwWaitEventsTimeout(session.GetPreferences().GetReal("Power.Events.polling_timeout") / FS_PER_SECOND);
+			if(eventDriven.Get() == 1)
+				glfwWaitEventsTimeout(pollingTimeout.Get() / FS_PER_SECOND);
 			else
 				glfwPollEvents();
 
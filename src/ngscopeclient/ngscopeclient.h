@@ -50,6 +50,7 @@
 #include "FunctionGeneratorState.h"
 #include "MultimeterState.h"
 #include "LoadState.h"
+#include "TriggerPollScheduler.h"
 #include "GuiLogSink.h"
 #include "Event.h"
 
@@ -64,12 +65,16 @@ public:
 	, shuttingDown(nullptr)	//initialize here to avoid static analysis warning, but must be overwritten
 							//with a valid shutdown flag pointer before spawning the InstrumentThread
 	, session(sess)
+	, pollScheduler(nullptr)
 	{}
 
 	std::shared_ptr<SCPIInstrument> inst;
 	std::atomic<bool>* shuttingDown;
 	Session* session;
 
+	///@brief Trigger poll scheduler owned by the connection state (oscilloscopes only)
+	TriggerPollScheduler* pollScheduler;
+
 	//Additional per-instrument-type state we can add
 	std::shared_ptr<OscilloscopeState> oscilloscopestate;
 	std::shared_ptr<LoadState> loadstate;
@@ -118,4 +123,6 @@ void RightJustifiedText(const std::string& str);
 bool RectIntersect(ImVec2 posA, ImVec2 sizeA, ImVec2 posB, ImVec2 sizeB);
 bool RectContains(ImVec2 posA, ImVec2 sizeA, ImVec2 posB, ImVec2 sizeB);
 
+void SchedulePipelineCacheSave();
+
 #endif
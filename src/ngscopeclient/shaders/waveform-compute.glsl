@@ -61,7 +61,7 @@ layout(std430, push_constant) uniform constants
 	int64_t innerXoff;
 #else
 	uint innerXoff_lo;	//actually a 64-bit little endian signed int
-	uint innerXoff_hi;
+	uint innerXoff_hi;	//(with REBASED_X, always fits in the low half and is relative to the rebased X positions)
 #endif
 	uint windowHeight;
 	uint windowWidth;
@@ -106,8 +106,10 @@ layout(std430, binding=0) buffer outputTex
 #ifndef DENSE_PACK
 layout(std430, binding=2) buffer waveform_x
 {
-#ifdef HAS_INT64
+#if defined(HAS_INT64)
 	int64_t xpos[];  //x position, in time ticks
+#elif defined(REBASED_X)
+	float xpos[];		//x position, in time ticks relative to a base point near the visible area
 #else
 	uint xpos[];		//x position, in time ticks
 						//actually 64-bit little endian signed ints
@@ -164,6 +166,9 @@ float FetchX(uint i)
 	#else
 		return float(xpos[i] + innerXoff);
 	#endif
+#elif defined(REBASED_X) && !defined(DENSE_PACK)
+	//X positions were rebased on the CPU so everything near the visible area fits in a float
+	return xpos[i] + float(int(innerXoff_lo));
 #else
 	//All this just because most Intel integrated GPUs lack GL_ARB_gpu_shader_int64...
 	#ifdef DENSE_PACK
@@ -0,0 +1,174 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for the protocol analyzer display filter compiler
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "ProtocolAnalyzer.h"
+#include "../../src/ngscopeclient/ProtocolDisplayFilter.h"
+
+using namespace std;
+
+static shared_ptr<PacketArena> MakeFilterTestArena();
+static vector<bool> RunFilter(const PacketArena& arena, const string& expression);
+static string CompileError(const PacketArena& arena, const string& expression);
+
+TEST_CASE("DisplayFilter_Match")
+{
+	auto arena = MakeFilterTestArena();
+
+	SECTION("Empty")
+	{ REQUIRE(RunFilter(*arena, "") == vector<bool>({true, true, true})); }
+
+	SECTION("String equality")
+	{
+		REQUIRE(RunFilter(*arena, "Type == \"Read\"") == vector<bool>({true, false, true}));
+		REQUIRE(RunFilter(*arena, "Type != \"Read\"") == vector<bool>({false, true, false}));
+	}
+
+	SECTION("Numeric equality")
+	{
+		REQUIRE(RunFilter(*arena, "Address == 32") == vector<bool>({false, true, false}));
+		REQUIRE(RunFilter(*arena, "Address == 0x20") == vector<bool>({false, true, false}));
+		REQUIRE(RunFilter(*arena, "Address == 32.0") == vector<bool>({false, true, false}));
+	}
+
+	SECTION("Column names with spaces")
+	{ REQUIRE(RunFilter(*arena, "OpCode == \"NOP\"") == vector<bool>({true, false, false})); }
+
+	SECTION("Text queries")
+	{
+		REQUIRE(RunFilter(*arena, "OpCode contains \"OA\"") == vector<bool>({false, true, false}));
+		REQUIRE(RunFilter(*arena, "OpCode startswith \"N\"") == vector<bool>({true, false, false}));
+
+		//Empty needles match every packet, even ones without the header
+		REQUIRE(RunFilter(*arena, "OpCode contains \"\"") == vector<bool>({true, true, true}));
+	}
+
+	SECTION("Data bytes")
+	{
+		REQUIRE(RunFilter(*arena, "data[0] == 0x55") == vector<bool>({true, false, false}));
+		REQUIRE(RunFilter(*arena, "data[1] == 170") == vector<bool>({true, false, false}));
+
+		//Out of range indexes never match
+		REQUIRE(RunFilter(*arena, "data[5] == 0") == vector<bool>({false, false, false}));
+	}
+
+	SECTION("Boolean operators")
+	{
+		REQUIRE(RunFilter(*arena, "Type == \"Read\" && Address == 48") == vector<bool>({false, false, true}));
+		REQUIRE(RunFilter(*arena, "Type == \"Write\" || Address == 16") == vector<bool>({true, true, false}));
+		REQUIRE(RunFilter(*arena, "!(Type == \"Read\")") == vector<bool>({false, true, false}));
+
+		//&& binds more tightly than ||
+		REQUIRE(RunFilter(*arena, "Type == \"Write\" || Type == \"Read\" && Address == 48") ==
+			vector<bool>({false, true, true}));
+		REQUIRE(RunFilter(*arena, "(Type == \"Write\" || Type == \"Read\") && Address == 48") ==
+			vector<bool>({false, false, true}));
+	}
+}
+
+TEST_CASE("DisplayFilter_CompileErrors")
+{
+	auto arena = MakeFilterTestArena();
+
+	SECTION("Unknown column")
+	{ REQUIRE(CompileError(*arena, "Bogus == 1").find("Bogus") != string::npos); }
+
+	SECTION("Missing operand")
+	{ REQUIRE(CompileError(*arena, "Type ==") != ""); }
+
+	SECTION("Missing operator")
+	{ REQUIRE(CompileError(*arena, "Type \"Read\"") != ""); }
+
+	SECTION("Unknown operator")
+	{ REQUIRE(CompileError(*arena, "Type <> \"Read\"").find("<>") != string::npos); }
+
+	SECTION("Unbalanced parentheses")
+	{ REQUIRE(CompileError(*arena, "(Type == \"Read\"") != ""); }
+}
+
+/**
+	@brief Creates three packets to run filters against
+
+	Packet 0: Type=Read, Address=16, Op Code=NOP, data 55 aa
+	Packet 1: Type=Write, Address=32, Op Code=LOAD, no data
+	Packet 2: Type=Read, Address=48, no Op Code, data 00
+ */
+static shared_ptr<PacketArena> MakeFilterTestArena()
+{
+	vector<string> cols = {"Type", "Address", "Op Code"};
+
+	vector<Packet*> packets;
+	packets.push_back(MakePacket(0, {{"Type", "Read"}, {"Address", "16"}, {"Op Code", "NOP"}}, {0x55, 0xaa}));
+	packets.push_back(MakePacket(1000, {{"Type", "Write"}, {"Address", "32"}, {"Op Code", "LOAD"}}));
+	packets.push_back(MakePacket(2000, {{"Type", "Read"}, {"Address", "48"}}, {0x00}));
+	vector<vector<Packet*> > children(packets.size());
+
+	return make_shared<PacketArena>(cols, packets, children);
+}
+
+/**
+	@brief Compiles an expression and returns which of the arena's top level packets it matches
+ */
+static vector<bool> RunFilter(const PacketArena& arena, const string& expression)
+{
+	size_t i = 0;
+	ProtocolDisplayFilter filter(expression, i);
+	REQUIRE(filter.Validate(arena.GetColumns()));
+	REQUIRE(filter.Compile(arena.GetColumns()));
+	REQUIRE(filter.GetError() == "");
+
+	ProtocolDisplayFilterContext context;
+	filter.Prepare(arena, context);
+
+	vector<bool> ret;
+	for(auto p : arena.GetPackets())
+		ret.push_back(filter.Match(arena, context, p));
+	return ret;
+}
+
+/**
+	@brief Compiles an expression which is expected to fail, and returns the error message
+ */
+static string CompileError(const PacketArena& arena, const string& expression)
+{
+	size_t i = 0;
+	ProtocolDisplayFilter filter(expression, i);
+	REQUIRE(!filter.Compile(arena.GetColumns()));
+	return filter.GetError();
+}
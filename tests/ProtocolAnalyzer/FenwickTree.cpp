@@ -0,0 +1,152 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for FenwickTree
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "ProtocolAnalyzer.h"
+#include "../../src/ngscopeclient/FenwickTree.h"
+
+using namespace std;
+
+static void VerifyFenwickTree(const FenwickTree<int64_t>& tree, const vector<int64_t>& values);
+
+TEST_CASE("FenwickTree")
+{
+	//Values include zeros, so Find() has to skip empty elements
+	uniform_int_distribution<int64_t> dist(0, 20);
+
+	FenwickTree<int64_t> tree;
+	vector<int64_t> values;
+	VerifyFenwickTree(tree, values);
+
+	SECTION("Build")
+	{
+		for(size_t n : {1, 2, 3, 7, 8, 9, 100, 1000})
+		{
+			values.resize(n);
+			for(auto& v : values)
+				v = dist(g_rng);
+			tree.Build(values);
+			VerifyFenwickTree(tree, values);
+		}
+	}
+
+	SECTION("PushBack and PopBack")
+	{
+		for(size_t i=0; i<300; i++)
+		{
+			values.push_back(dist(g_rng));
+			tree.PushBack(values.back());
+			VerifyFenwickTree(tree, values);
+		}
+
+		for(size_t i=0; i<150; i++)
+		{
+			values.pop_back();
+			tree.PopBack();
+			VerifyFenwickTree(tree, values);
+		}
+
+		//Growing again after shrinking has to give the same result as a fresh build
+		for(size_t i=0; i<50; i++)
+		{
+			values.push_back(dist(g_rng));
+			tree.PushBack(values.back());
+		}
+		VerifyFenwickTree(tree, values);
+	}
+
+	SECTION("Set")
+	{
+		values.resize(257);
+		for(auto& v : values)
+			v = dist(g_rng);
+		tree.Build(values);
+
+		uniform_int_distribution<size_t> index(0, values.size() - 1);
+		for(size_t i=0; i<500; i++)
+		{
+			auto j = index(g_rng);
+			values[j] = dist(g_rng);
+			tree.Set(j, values[j]);
+		}
+		VerifyFenwickTree(tree, values);
+	}
+
+	SECTION("Clear")
+	{
+		values.resize(10, 5);
+		tree.Build(values);
+		tree.Clear();
+		values.clear();
+		VerifyFenwickTree(tree, values);
+	}
+}
+
+/**
+	@brief Checks every query against a brute force calculation from the raw values
+ */
+static void VerifyFenwickTree(const FenwickTree<int64_t>& tree, const vector<int64_t>& values)
+{
+	REQUIRE(tree.size() == values.size());
+	REQUIRE(tree.empty() == values.empty());
+
+	int64_t sum = 0;
+	for(size_t i=0; i<values.size(); i++)
+	{
+		REQUIRE(tree.Get(i) == values[i]);
+		REQUIRE(tree.Prefix(i) == sum);
+		sum += values[i];
+	}
+	REQUIRE(tree.Prefix(values.size()) == sum);
+	REQUIRE(tree.Total() == sum);
+
+	//Find() gives the first element whose inclusive prefix sum is greater than y
+	for(int64_t y=0; y<=sum; y++)
+	{
+		size_t expected = 0;
+		int64_t end = 0;
+		for(; expected<values.size(); expected++)
+		{
+			end += values[expected];
+			if(end > y)
+				break;
+		}
+		REQUIRE(tree.Find(y) == expected);
+	}
+}
@@ -0,0 +1,135 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for PacketArena serialization
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "ProtocolAnalyzer.h"
+#include "../../src/ngscopeclient/PacketArena.h"
+
+using namespace std;
+
+static void VerifySamePackets(const PacketArena& a, const PacketArena& b, const Packet* pa, const Packet* pb);
+
+TEST_CASE("PacketArena_Serialize")
+{
+	vector<string> cols = {"Type", "Address", "Info"};
+
+	//Three top level packets, the second of which has two children
+	vector<Packet*> packets;
+	packets.push_back(MakePacket(0, {{"Type", "Read"}, {"Address", "16"}}, {0x01, 0x02, 0x03}));
+	packets.push_back(MakePacket(1000, {{"Type", "Burst"}, {"Info", "two beats"}}));
+	packets.push_back(MakePacket(2000, {{"Type", "Read"}, {"Address", "48"}}, {0xff}));
+	packets[0]->m_displayBackgroundColor = "#336699";
+	packets[1]->m_displayBackgroundColor = "#996633";
+
+	//Long enough not to fit in the small string buffer
+	packets[2]->m_displayForegroundColor = "a color name long enough to need a heap allocation";
+
+	vector<vector<Packet*> > children(packets.size());
+	children[1].push_back(MakePacket(1000, {{"Type", "Write"}, {"Address", "32"}}, {0xaa}));
+	children[1].push_back(MakePacket(1500, {{"Type", "Write"}, {"Address", "33"}}, {0xbb, 0xcc}));
+	children[1][1]->m_len = 500;
+
+	PacketArena arena(cols, packets, children);
+	arena.SetChildOpen(arena.GetPackets()[1], true);
+
+	//Filter results are not saved
+	arena.SetFilterResults({arena.GetPackets()[0]}, {});
+
+	vector<uint8_t> buf;
+	arena.Serialize(buf);
+
+	SECTION("Round trip")
+	{
+		auto copy = PacketArena::Deserialize(buf.data(), buf.size());
+		REQUIRE(copy != nullptr);
+
+		REQUIRE(copy->size() == arena.size());
+		REQUIRE(copy->GetColumns() == arena.GetColumns());
+		REQUIRE(copy->GetPackets().size() == arena.GetPackets().size());
+
+		for(size_t i=0; i<arena.GetPackets().size(); i++)
+		{
+			auto pa = arena.GetPackets()[i];
+			auto pb = copy->GetPackets()[i];
+			VerifySamePackets(arena, *copy, pa, pb);
+			REQUIRE(copy->IsChildOpen(pb) == arena.IsChildOpen(pa));
+
+			auto ca = arena.GetChildren(pa);
+			auto cb = copy->GetChildren(pb);
+			REQUIRE(cb.size() == ca.size());
+			for(size_t j=0; j<ca.size(); j++)
+				VerifySamePackets(arena, *copy, ca[j], cb[j]);
+		}
+
+		REQUIRE(!copy->HasFilterResults());
+
+		//The search index is rebuilt from the deserialized packets
+		auto hits = copy->GetSearchIndex().FindPackets("beat");
+		REQUIRE(hits.size() == copy->size());
+		for(size_t i=0; i<hits.size(); i++)
+			REQUIRE(hits[i] == (i == 1));
+	}
+
+	SECTION("Truncated")
+	{
+		for(size_t len=0; len<buf.size(); len++)
+			REQUIRE(PacketArena::Deserialize(buf.data(), len) == nullptr);
+	}
+}
+
+/**
+	@brief Checks that two packets from different arenas have the same contents
+ */
+static void VerifySamePackets(const PacketArena& a, const PacketArena& b, const Packet* pa, const Packet* pb)
+{
+	REQUIRE(pb->m_offset == pa->m_offset);
+	REQUIRE(pb->m_len == pa->m_len);
+	REQUIRE(pb->m_displayForegroundColor == pa->m_displayForegroundColor);
+	REQUIRE(pb->m_displayBackgroundColor == pa->m_displayBackgroundColor);
+
+	for(size_t i=0; i<a.GetColumns().size(); i++)
+	{
+		REQUIRE(b.HasHeader(pb, i) == a.HasHeader(pa, i));
+		REQUIRE(b.GetHeader(pb, i) == a.GetHeader(pa, i));
+	}
+
+	auto da = a.GetData(pa);
+	auto db = b.GetData(pb);
+	REQUIRE(vector<uint8_t>(db.begin(), db.end()) == vector<uint8_t>(da.begin(), da.end()));
+}
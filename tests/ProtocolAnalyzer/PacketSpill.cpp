@@ -0,0 +1,144 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for PacketSpillFile
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "ProtocolAnalyzer.h"
+#include "../../src/ngscopeclient/PacketSpillFile.h"
+
+using namespace std;
+
+static shared_ptr<PacketArena> MakeSpillTestArena(const string& type, size_t npackets);
+static void VerifySpilledArena(shared_ptr<PacketArena> arena, const string& type, size_t npackets);
+
+TEST_CASE("PacketSpillFile")
+{
+	PacketSpillFile file;
+
+	TimePoint ta(1, 0);
+	TimePoint tb(2, 0);
+	TimePoint tc(3, 0);
+
+	auto a = MakeSpillTestArena("A", 100);
+	auto b = MakeSpillTestArena("B", 50);
+	auto c = MakeSpillTestArena("C", 100);
+
+	//Write two records back to back
+	PacketSpillRecord ra;
+	PacketSpillRecord rb;
+	REQUIRE(file.Write(ta, *a, ra));
+	REQUIRE(file.Write(tb, *b, rb));
+
+	REQUIRE(ra.m_packets == 100);
+	REQUIRE(rb.m_packets == 50);
+	REQUIRE(ra.m_memory == a->GetMemoryUsage());
+	REQUIRE(rb.m_offset == ra.m_offset + ra.m_len);
+	REQUIRE(file.GetLiveSize() == ra.m_len + rb.m_len);
+	REQUIRE(file.GetFileSize() == ra.m_len + rb.m_len);
+
+	//Read both back
+	VerifySpilledArena(file.Read(ra), "A", 100);
+	VerifySpilledArena(file.Read(rb), "B", 50);
+
+	//Release the first record, and the next record of the same size should reuse its space
+	file.Release(ra);
+	REQUIRE(file.GetLiveSize() == rb.m_len);
+
+	PacketSpillRecord rc;
+	REQUIRE(file.Write(tc, *c, rc));
+	REQUIRE(rc.m_offset == ra.m_offset);
+	REQUIRE(rc.m_len == ra.m_len);
+	REQUIRE(file.GetFileSize() == ra.m_len + rb.m_len);
+
+	//The overwritten record can't be read any more, but the new one can
+	REQUIRE(file.Read(ra) == nullptr);
+	VerifySpilledArena(file.Read(rc), "C", 100);
+	VerifySpilledArena(file.Read(rb), "B", 50);
+
+	//Releasing the record at the end of the file shrinks it
+	file.Release(rb);
+	REQUIRE(file.GetLiveSize() == rc.m_len);
+	REQUIRE(file.GetFileSize() == rc.m_len);
+
+	//Once everything is released the file is empty again
+	file.Release(rc);
+	REQUIRE(file.GetLiveSize() == 0);
+	REQUIRE(file.GetFileSize() == 0);
+}
+
+/**
+	@brief Creates an arena of packets whose Type header is the given string
+ */
+static shared_ptr<PacketArena> MakeSpillTestArena(const string& type, size_t npackets)
+{
+	vector<string> cols = {"Type", "Index"};
+
+	vector<Packet*> packets;
+	for(size_t i=0; i<npackets; i++)
+	{
+		packets.push_back(MakePacket(
+			i*1000,
+			{{"Type", type}, {"Index", to_string(i)}},
+			{static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8)}));
+	}
+	vector<vector<Packet*> > children(packets.size());
+
+	return make_shared<PacketArena>(cols, packets, children);
+}
+
+/**
+	@brief Checks that an arena read back from a spill file is the one MakeSpillTestArena() created
+ */
+static void VerifySpilledArena(shared_ptr<PacketArena> arena, const string& type, size_t npackets)
+{
+	REQUIRE(arena != nullptr);
+	REQUIRE(arena->size() == npackets);
+
+	auto packets = arena->GetPackets();
+	for(size_t i=0; i<npackets; i++)
+	{
+		auto p = packets[i];
+		REQUIRE(p->m_offset == static_cast<int64_t>(i*1000));
+		REQUIRE(arena->GetHeader(p, 0) == type);
+		REQUIRE(arena->GetHeader(p, 1) == to_string(i));
+
+		auto data = arena->GetData(p);
+		REQUIRE(data.size() == 2);
+		REQUIRE(data[0] == static_cast<uint8_t>(i));
+	}
+}
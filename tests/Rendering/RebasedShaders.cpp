@@ -0,0 +1,317 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for the REBASED_X shader variants
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../src/ngscopeclient/CpuWaveformRasterizer.h"
+#include "../../src/ngscopeclient/RebasedOffsets.h"
+#include "Rendering.h"
+
+using namespace std;
+
+///@brief Push constants for IndexSearch.glsl (same layout as IndexSearchConstants in WaveformArea.h)
+struct IndexSearchTestConstants
+{
+	int64_t offset_samples;
+	float xscale;
+	uint32_t len;
+	uint32_t w;
+};
+
+///@brief Push constants for IndexSearchRebased.glsl (same layout as IndexSearchRebasedConstants in WaveformArea.h)
+struct IndexSearchRebasedTestConstants
+{
+	float offset_samples;
+	float xscale;
+	uint32_t len;
+	uint32_t w;
+};
+
+static void SearchIndexesOnCpu(
+	SparseAnalogWaveform& wfm,
+	AcceleratorBuffer<uint32_t>& indexes,
+	int64_t offset_samples,
+	float xscale,
+	uint32_t w);
+
+static void RasterizeSparse(
+	const string& path,
+	SparseAnalogWaveform& wfm,
+	AcceleratorBuffer<bool>& digital,
+	AcceleratorBuffer<float>* rebasedOffsets,
+	AcceleratorBuffer<uint32_t>& indexes,
+	AcceleratorBuffer<float>& out,
+	const ConfigPushConstants& config,
+	vk::raii::CommandBuffer& cmdbuf,
+	shared_ptr<QueueHandle> queue);
+
+TEST_CASE("Rendering_RebasedOffsets")
+{
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Rendering_RebasedOffsets.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->GetQueue()->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//A noisy sine wave with random gaps, starting so far from time zero that positions don't fit in a float
+	const size_t depth = 1000000;
+	const int64_t tstart = 1LL << 40;
+	uniform_real_distribution<float> noise(-0.05f, 0.05f);
+	uniform_int_distribution<int64_t> gap(1, 4);
+
+	SparseAnalogWaveform wfm;
+	wfm.m_timescale = 1;
+	wfm.m_triggerPhase = 0;
+	wfm.Resize(depth);
+	wfm.PrepareForCpuAccess();
+	AcceleratorBuffer<bool> digital;
+	digital.resize(depth);
+	digital.PrepareForCpuAccess();
+	int64_t t = tstart;
+	for(size_t i=0; i<depth; i++)
+	{
+		wfm.m_samples[i] = sin(i * 0.01f) * 0.4f + noise(g_rng);
+		wfm.m_offsets[i] = t;
+		wfm.m_durations[i] = gap(g_rng);
+		t += wfm.m_durations[i];
+		digital[i] = (wfm.m_samples[i] > 0);
+	}
+	wfm.MarkModifiedFromCpu();
+	digital.MarkModifiedFromCpu();
+
+	//Look at a window in the middle of the waveform, 64 ticks per pixel (a power of two so pixel boundaries are exact)
+	const uint32_t w = 1000;
+	const float xscale = 1.0f / 64;
+	int64_t offset_samples = wfm.m_offsets[depth / 2];
+
+	//Rebase near the window, then scroll a bit so the shaders have to add a nonzero offset
+	RebasedOffsets rebased;
+	REQUIRE(rebased.Update(&wfm, offset_samples, ceil(w / xscale)));
+	REQUIRE(rebased.GetBase() == offset_samples);
+	offset_samples += 1234;
+	REQUIRE(!rebased.Update(&wfm, offset_samples, ceil(w / xscale)));
+
+	//Reference index search, equivalent to IndexSearch.glsl
+	AcceleratorBuffer<uint32_t> expectedIndexes;
+	SearchIndexesOnCpu(wfm, expectedIndexes, offset_samples, xscale, w);
+
+	SECTION("IndexSearch")
+	{
+		AcceleratorBuffer<uint32_t> indexes;
+		indexes.resize(w);
+
+		IndexSearchRebasedTestConstants cfg;
+		cfg.offset_samples = offset_samples - rebased.GetBase();
+		cfg.xscale = xscale;
+		cfg.len = depth;
+		cfg.w = w;
+
+		ComputePipeline pipe("shaders/IndexSearchRebased.spv", 2, sizeof(cfg));
+		cmdbuf.begin({});
+		pipe.BindBufferNonblocking(0, rebased.GetOffsets(), cmdbuf);
+		pipe.BindBufferNonblocking(1, indexes, cmdbuf, true);
+		pipe.Dispatch(cmdbuf, cfg, GetComputeBlockCount(w, 64));
+		cmdbuf.end();
+		queue->SubmitAndBlock(cmdbuf);
+		indexes.MarkModifiedFromGpu();
+
+		indexes.PrepareForCpuAccess();
+		expectedIndexes.PrepareForCpuAccess();
+		for(size_t i=0; i<w; i++)
+			REQUIRE(indexes[i] == expectedIndexes[i]);
+
+		//The int64 search should agree too, if we have it
+		if(g_hasShaderInt64)
+		{
+			IndexSearchTestConstants cfg64;
+			cfg64.offset_samples = offset_samples;
+			cfg64.xscale = xscale;
+			cfg64.len = depth;
+			cfg64.w = w;
+
+			ComputePipeline pipe64("shaders/IndexSearch.spv", 2, sizeof(cfg64));
+			cmdbuf.begin({});
+			pipe64.BindBufferNonblocking(0, wfm.m_offsets, cmdbuf);
+			pipe64.BindBufferNonblocking(1, indexes, cmdbuf, true);
+			pipe64.Dispatch(cmdbuf, cfg64, GetComputeBlockCount(w, 64));
+			cmdbuf.end();
+			queue->SubmitAndBlock(cmdbuf);
+			indexes.MarkModifiedFromGpu();
+
+			indexes.PrepareForCpuAccess();
+			for(size_t i=0; i<w; i++)
+				REQUIRE(indexes[i] == expectedIndexes[i]);
+		}
+	}
+
+	for(string shader : {"analog", "digital"})
+	{
+		SECTION(string("Rasterize ") + shader)
+		{
+			ConfigPushConstants config;
+			config.windowHeight = 400;
+			config.windowWidth = w;
+			config.memDepth = depth;
+			config.offset_samples = 0;
+			config.alpha = 1;
+			config.xoff = 0.25;
+			config.xscale = xscale;
+			config.ybase = 200;
+			config.yscale = 350;
+			config.yoff = 0.01f;
+			config.persistScale = 0;
+			if(shader == "digital")
+			{
+				config.ybase = 0;
+				config.yoff = 0;
+				config.yscale = 20;
+				config.windowHeight = 21;
+			}
+
+			//Full 64-bit positions, relative to the left edge of the window
+			AcceleratorBuffer<float> expected;
+			string path = "shaders/waveform-compute." + shader;
+			if(g_hasShaderInt64)
+				path += ".int64";
+			config.innerXoff = -offset_samples;
+			RasterizeSparse(
+				path + ".spv", wfm, digital, nullptr, expectedIndexes, expected, config, cmdbuf, queue);
+
+			//Rebased positions, plus the distance from the base to the left edge of the window
+			AcceleratorBuffer<float> actual;
+			config.innerXoff = rebased.GetBase() - offset_samples;
+			RasterizeSparse(
+				"shaders/waveform-compute." + shader + ".rebased.spv",
+				wfm, digital, &rebased.GetOffsets(), expectedIndexes, actual, config, cmdbuf, queue);
+
+			//Positions on screen are exact either way, so only floating point reordering can make a difference
+			expected.PrepareForCpuAccess();
+			actual.PrepareForCpuAccess();
+			size_t npixels = expected.size();
+			size_t mismatches = 0;
+			double sum = 0;
+			for(size_t i=0; i<npixels; i++)
+			{
+				if(fabs(expected[i] - actual[i]) > 1e-3f)
+					mismatches ++;
+				sum += expected[i];
+			}
+			LogVerbose("%s: %zu of %zu pixels differ\n", shader.c_str(), mismatches, npixels);
+			REQUIRE(sum > 0);
+			REQUIRE(mismatches <= npixels / 1000);
+		}
+	}
+}
+
+/**
+	@brief Finds the sample before the first one in each column, the same way IndexSearch.glsl does
+ */
+static void SearchIndexesOnCpu(
+	SparseAnalogWaveform& wfm,
+	AcceleratorBuffer<uint32_t>& indexes,
+	int64_t offset_samples,
+	float xscale,
+	uint32_t w)
+{
+	wfm.m_offsets.PrepareForCpuAccess();
+	auto offsets = wfm.m_offsets.GetCpuPointer();
+	size_t len = wfm.size();
+
+	indexes.resize(w);
+	indexes.PrepareForCpuAccess();
+	for(uint32_t i=0; i<w; i++)
+	{
+		int64_t target = static_cast<int64_t>(floor(static_cast<float>(i) / xscale)) + offset_samples;
+
+		//Last sample at or before the target, then one more to the left
+		size_t iclk;
+		if(offsets[0] >= target)
+			iclk = 0;
+		else if(offsets[len-1] < target)
+			iclk = len-1;
+		else
+			iclk = (upper_bound(offsets, offsets + len, target) - offsets) - 1;
+		indexes[i] = static_cast<uint32_t>(iclk - 1);
+	}
+	indexes.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Runs a sparse waveform through one of the waveform-compute shader variants
+ */
+static void RasterizeSparse(
+	const string& path,
+	SparseAnalogWaveform& wfm,
+	AcceleratorBuffer<bool>& digital,
+	AcceleratorBuffer<float>* rebasedOffsets,
+	AcceleratorBuffer<uint32_t>& indexes,
+	AcceleratorBuffer<float>& out,
+	const ConfigPushConstants& config,
+	vk::raii::CommandBuffer& cmdbuf,
+	shared_ptr<QueueHandle> queue)
+{
+	//The shader reads the previous contents for persistence, so start from a blank image
+	size_t npixels = config.windowWidth * config.windowHeight;
+	out.resize(npixels);
+	out.PrepareForCpuAccess();
+	for(size_t i=0; i<npixels; i++)
+		out[i] = 0;
+	out.MarkModifiedFromCpu();
+
+	ComputePipeline pipe(path, 4, sizeof(ConfigPushConstants));
+	cmdbuf.begin({});
+	pipe.BindBufferNonblocking(0, out, cmdbuf, true);
+	if(path.find("digital") != string::npos)
+		pipe.BindBufferNonblocking(1, digital, cmdbuf);
+	else
+		pipe.BindBufferNonblocking(1, wfm.m_samples, cmdbuf);
+	if(rebasedOffsets)
+		pipe.BindBufferNonblocking(2, *rebasedOffsets, cmdbuf);
+	else
+		pipe.BindBufferNonblocking(2, wfm.m_offsets, cmdbuf);
+	pipe.BindBufferNonblocking(3, indexes, cmdbuf);
+	pipe.Dispatch(cmdbuf, config, config.windowWidth, 1, 1);
+	cmdbuf.end();
+	queue->SubmitAndBlock(cmdbuf);
+	out.MarkModifiedFromGpu();
+}
@@ -0,0 +1,288 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for CpuWaveformRasterizer
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../src/ngscopeclient/CpuWaveformRasterizer.h"
+#include "Rendering.h"
+
+using namespace std;
+
+/**
+	@brief Inputs for one rasterizer run, in both CPU and GPU form
+ */
+struct RasterTestCase
+{
+	AcceleratorBuffer<float> m_analog;
+	AcceleratorBuffer<bool> m_digital;
+	AcceleratorBuffer<int64_t> m_offsets;
+	AcceleratorBuffer<int64_t> m_durations;
+	AcceleratorBuffer<uint32_t> m_indexes;
+	AcceleratorBuffer<float> m_gpuOut;
+	AcceleratorBuffer<float> m_cpuOut;
+	ConfigPushConstants m_config;
+	CpuRasterizerInputs m_inputs;
+};
+
+/**
+	@brief Fills a test case with a noisy sine wave
+ */
+static void GenerateTestCase(RasterTestCase& tc, bool sparse, bool durations, size_t depth)
+{
+	uniform_real_distribution<float> noise(-0.05f, 0.05f);
+	uniform_int_distribution<int64_t> gap(1, 4);
+
+	tc.m_analog.resize(depth);
+	tc.m_digital.resize(depth);
+	tc.m_analog.PrepareForCpuAccess();
+	tc.m_digital.PrepareForCpuAccess();
+	for(size_t i=0; i<depth; i++)
+	{
+		tc.m_analog[i] = sin(i * 0.01f) * 0.4f + noise(g_rng);
+		tc.m_digital[i] = (tc.m_analog[i] > 0);
+	}
+	tc.m_analog.MarkModifiedFromCpu();
+	tc.m_digital.MarkModifiedFromCpu();
+
+	auto& c = tc.m_config;
+	c.windowWidth = 1000;
+	c.windowHeight = 400;
+	c.memDepth = depth;
+	c.innerXoff = -7;
+	c.offset_samples = 0;
+	c.alpha = 1;
+	c.xoff = 0.25;
+	c.xscale = 1000.0f / depth;
+	c.ybase = 200;
+	c.yscale = 350;
+	c.yoff = 0.01f;
+	c.persistScale = 0;
+
+	tc.m_inputs = CpuRasterizerInputs();
+	if(sparse)
+	{
+		//Random gaps between samples, then find the first sample in each column like WaveformArea does
+		tc.m_offsets.resize(depth);
+		tc.m_durations.resize(depth);
+		tc.m_offsets.PrepareForCpuAccess();
+		tc.m_durations.PrepareForCpuAccess();
+		int64_t t = 0;
+		for(size_t i=0; i<depth; i++)
+		{
+			tc.m_durations[i] = gap(g_rng);
+			tc.m_offsets[i] = t;
+			t += tc.m_durations[i];
+		}
+		tc.m_offsets.MarkModifiedFromCpu();
+		tc.m_durations.MarkModifiedFromCpu();
+		c.xscale = 1000.0f / t;
+
+		tc.m_indexes.resize(c.windowWidth);
+		tc.m_indexes.PrepareForCpuAccess();
+		auto offsets = tc.m_offsets.GetCpuPointer();
+		for(size_t i=0; i<c.windowWidth; i++)
+		{
+			int64_t target = floor(i / c.xscale);
+			tc.m_indexes[i] = lower_bound(offsets, offsets + depth, target) - offsets;
+		}
+		tc.m_indexes.MarkModifiedFromCpu();
+
+		tc.m_inputs.m_offsets = tc.m_offsets.GetCpuPointer();
+		tc.m_inputs.m_indexes = tc.m_indexes.GetCpuPointer();
+		if(durations)
+			tc.m_inputs.m_durations = tc.m_durations.GetCpuPointer();
+	}
+	tc.m_inputs.m_analogSamples = tc.m_analog.GetCpuPointer();
+	tc.m_inputs.m_digitalSamples = tc.m_digital.GetCpuPointer();
+
+	size_t npixels = c.windowWidth * c.windowHeight;
+	tc.m_gpuOut.resize(npixels);
+	tc.m_cpuOut.resize(npixels);
+}
+
+/**
+	@brief Runs a test case through the shader and the CPU rasterizer and verifies they match
+ */
+static void CompareRasterizers(
+	RasterTestCase& tc,
+	const string& shader,
+	vk::raii::CommandBuffer& cmdbuf,
+	shared_ptr<QueueHandle> queue)
+{
+	bool sparse = (tc.m_inputs.m_offsets != nullptr);
+	string path = "shaders/waveform-compute." + shader;
+	if(g_hasShaderInt64)
+		path += ".int64";
+	if(!sparse)
+		path += ".dense";
+	path += ".spv";
+
+	size_t nbuffers = 2;
+	if(sparse)
+		nbuffers = tc.m_inputs.m_durations ? 5 : 4;
+	ComputePipeline pipe(path, nbuffers, sizeof(ConfigPushConstants));
+
+	//Both rasterizers read the previous contents for persistence, so start from the same image
+	size_t npixels = tc.m_gpuOut.size();
+	tc.m_gpuOut.PrepareForCpuAccess();
+	tc.m_cpuOut.PrepareForCpuAccess();
+	for(size_t i=0; i<npixels; i++)
+	{
+		tc.m_gpuOut[i] = (i % 7) * 0.1f;
+		tc.m_cpuOut[i] = tc.m_gpuOut[i];
+	}
+	tc.m_gpuOut.MarkModifiedFromCpu();
+
+	double start = GetTime();
+	cmdbuf.begin({});
+	pipe.BindBufferNonblocking(0, tc.m_gpuOut, cmdbuf, true);
+	if(tc.m_inputs.m_path == CpuRasterizerInputs::PATH_DIGITAL)
+		pipe.BindBufferNonblocking(1, tc.m_digital, cmdbuf);
+	else
+		pipe.BindBufferNonblocking(1, tc.m_analog, cmdbuf);
+	if(sparse)
+	{
+		pipe.BindBufferNonblocking(2, tc.m_offsets, cmdbuf);
+		pipe.BindBufferNonblocking(3, tc.m_indexes, cmdbuf);
+		if(tc.m_inputs.m_durations)
+			pipe.BindBufferNonblocking(4, tc.m_durations, cmdbuf);
+	}
+	pipe.Dispatch(cmdbuf, tc.m_config, tc.m_config.windowWidth, 1, 1);
+	cmdbuf.end();
+	queue->SubmitAndBlock(cmdbuf);
+	double gpudt = GetTime() - start;
+	tc.m_gpuOut.MarkModifiedFromGpu();
+
+	start = GetTime();
+	CpuWaveformRasterizer::Rasterize(tc.m_config, tc.m_inputs, tc.m_cpuOut.GetCpuPointer());
+	double cpudt = GetTime() - start;
+	LogVerbose("%-20s GPU: %7.2f ms, CPU: %7.2f ms\n", shader.c_str(), gpudt * 1000, cpudt * 1000);
+
+	//Allow a few pixels to differ since the GPU is free to fuse or reorder floating point operations,
+	//which can move a span endpoint across a pixel boundary
+	tc.m_gpuOut.PrepareForCpuAccess();
+	size_t mismatches = 0;
+	double gpuSum = 0;
+	double cpuSum = 0;
+	for(size_t i=0; i<npixels; i++)
+	{
+		if(fabs(tc.m_gpuOut[i] - tc.m_cpuOut[i]) > 1e-3f)
+			mismatches ++;
+		gpuSum += tc.m_gpuOut[i];
+		cpuSum += tc.m_cpuOut[i];
+	}
+	LogVerbose("%zu of %zu pixels differ\n", mismatches, npixels);
+	REQUIRE(mismatches <= npixels / 1000);
+	REQUIRE(fabs(gpuSum - cpuSum) <= gpuSum * 1e-3);
+}
+
+TEST_CASE("Rendering_CpuWaveformRasterizer")
+{
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Rendering_CpuWaveformRasterizer.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->GetQueue()->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	const size_t depth = 1000000;
+	RasterTestCase tc;
+
+	SECTION("UniformAnalog")
+	{
+		GenerateTestCase(tc, false, false, depth);
+		CompareRasterizers(tc, "analog", cmdbuf, queue);
+
+		tc.m_config.persistScale = 0.9f;
+		CompareRasterizers(tc, "analog", cmdbuf, queue);
+	}
+
+	SECTION("UniformAnalogZeroHold")
+	{
+		GenerateTestCase(tc, false, false, depth);
+		tc.m_inputs.m_zeroHold = true;
+		CompareRasterizers(tc, "analog.zerohold", cmdbuf, queue);
+	}
+
+	SECTION("Histogram")
+	{
+		GenerateTestCase(tc, false, false, 5000);
+		tc.m_inputs.m_path = CpuRasterizerInputs::PATH_HISTOGRAM;
+		CompareRasterizers(tc, "histogram", cmdbuf, queue);
+	}
+
+	SECTION("UniformDigital")
+	{
+		GenerateTestCase(tc, false, false, depth);
+		tc.m_inputs.m_path = CpuRasterizerInputs::PATH_DIGITAL;
+		tc.m_config.ybase = 0;
+		tc.m_config.yoff = 0;
+		tc.m_config.yscale = 20;
+		tc.m_config.windowHeight = 21;
+		CompareRasterizers(tc, "digital", cmdbuf, queue);
+	}
+
+	SECTION("SparseAnalog")
+	{
+		GenerateTestCase(tc, true, false, depth);
+		CompareRasterizers(tc, "analog", cmdbuf, queue);
+	}
+
+	SECTION("SparseAnalogZeroHold")
+	{
+		GenerateTestCase(tc, true, true, depth);
+		tc.m_inputs.m_zeroHold = true;
+		CompareRasterizers(tc, "analog.zerohold", cmdbuf, queue);
+	}
+
+	SECTION("SparseDigital")
+	{
+		GenerateTestCase(tc, true, false, depth);
+		tc.m_inputs.m_path = CpuRasterizerInputs::PATH_DIGITAL;
+		tc.m_config.ybase = 0;
+		tc.m_config.yoff = 0;
+		tc.m_config.yscale = 20;
+		tc.m_config.windowHeight = 21;
+		CompareRasterizers(tc, "digital", cmdbuf, queue);
+	}
+}